@@ -0,0 +1,186 @@
+﻿#pragma once
+// alloc_track.h
+// Счётчик выделений кучи: сколько за кадр и где. Только в отладочной сборке
+// (ALLOC_TRACKING = _DEBUG по умолчанию), в релизе макросы пустые и operator new родной.
+//
+//   ALLOC_SCOPE("RemoveGrassAt");   // всё, что выделено до конца блока (в этом потоке) — сюда
+//
+// Место — самый внутренний ALLOC_SCOPE потока; вне их — "(other)". Считается во всех
+// потоках (сим, воркеры), кадр — кадр рендера: AllocEndFrame() после SwapBuffers.
+// Раз в 10 с в лог: выделений за кадр (среднее / максимум) и топ мест.
+// Глобальные operator new/delete заменяются здесь — подключать в одну единицу трансляции (main.cpp).
+
+#ifndef ALLOC_TRACKING
+#ifdef _DEBUG
+#define ALLOC_TRACKING 1
+#else
+#define ALLOC_TRACKING 0
+#endif
+#endif
+
+#if ALLOC_TRACKING
+
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+#include "core_platform.h"
+#include "trace.h"
+
+struct AllocSite
+{
+    const char* name;
+    std::atomic<uint64_t> frameCount{ 0 };     // с прошлого AllocEndFrame
+    uint64_t maxPerFrame = 0;                  // дальше — только главный поток
+    uint64_t windowCount = 0;                  // за окно отчёта
+    AllocSite* next = nullptr;
+
+    explicit AllocSite(const char* n);
+};
+
+struct AllocTracker
+{
+    std::atomic<AllocSite*> sites{ nullptr };  // список без локов (new внутри new нельзя)
+    std::atomic<uint64_t> frameCount{ 0 };
+    std::atomic<uint64_t> frameBytes{ 0 };
+
+    uint64_t windowFrames = 0, windowCount = 0, windowMax = 0, windowBytes = 0;
+};
+
+AllocTracker g_alloc;
+AllocSite g_allocOther("(other)");
+
+thread_local AllocSite* t_allocSite = nullptr;
+
+inline AllocSite::AllocSite(const char* n) : name(n)
+{
+    AllocSite* head = g_alloc.sites.load();
+    do { next = head; } while (!g_alloc.sites.compare_exchange_weak(head, this));
+}
+
+struct AllocSiteScope
+{
+    AllocSite* prev;
+    explicit AllocSiteScope(AllocSite& s) : prev(t_allocSite) { t_allocSite = &s; }
+    ~AllocSiteScope() { t_allocSite = prev; }
+    AllocSiteScope(const AllocSiteScope&) = delete;
+    AllocSiteScope& operator=(const AllocSiteScope&) = delete;
+};
+
+inline void AllocCount(size_t bytes)
+{
+    AllocSite* s = t_allocSite ? t_allocSite : &g_allocOther;
+    s->frameCount.fetch_add(1, std::memory_order_relaxed);
+    g_alloc.frameCount.fetch_add(1, std::memory_order_relaxed);
+    g_alloc.frameBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+// главный поток, раз в кадр
+void AllocEndFrame()
+{
+    uint64_t count = g_alloc.frameCount.exchange(0);
+    g_alloc.windowBytes += g_alloc.frameBytes.exchange(0);
+    TRACE_COUNTER("allocs", count);
+
+    for (AllocSite* s = g_alloc.sites.load(); s; s = s->next)
+    {
+        uint64_t c = s->frameCount.exchange(0);
+        s->windowCount += c;
+        s->maxPerFrame = std::max(s->maxPerFrame, c);
+    }
+
+    ++g_alloc.windowFrames;
+    g_alloc.windowCount += count;
+    g_alloc.windowMax = std::max(g_alloc.windowMax, count);
+
+    if (g_alloc.windowFrames < 600)
+        return;
+
+    char buf[192];
+    snprintf(buf, sizeof(buf), "Alloc: %.1f allocs/frame avg, %llu max, %.1f KB/frame over %llu frames\n",
+        double(g_alloc.windowCount) / double(g_alloc.windowFrames), (unsigned long long)g_alloc.windowMax,
+        double(g_alloc.windowBytes) / 1024.0 / double(g_alloc.windowFrames), (unsigned long long)g_alloc.windowFrames);
+    CoreLog(buf);
+
+    // топ-5 мест за окно
+    AllocSite* top[5] = {};
+    for (AllocSite* s = g_alloc.sites.load(); s; s = s->next)
+    {
+        if (!s->windowCount) continue;
+        for (int i = 0; i < 5; ++i)
+        {
+            if (!top[i] || s->windowCount > top[i]->windowCount)
+            {
+                for (int j = 4; j > i; --j) top[j] = top[j - 1];
+                top[i] = s;
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < 5 && top[i]; ++i)
+    {
+        snprintf(buf, sizeof(buf), "  %-28s %8.1f/frame  max %llu\n", top[i]->name,
+            double(top[i]->windowCount) / double(g_alloc.windowFrames),
+            (unsigned long long)top[i]->maxPerFrame);
+        CoreLog(buf);
+    }
+
+    for (AllocSite* s = g_alloc.sites.load(); s; s = s->next)
+    {
+        s->windowCount = 0;
+        s->maxPerFrame = 0;
+    }
+    g_alloc.windowFrames = g_alloc.windowCount = g_alloc.windowMax = g_alloc.windowBytes = 0;
+}
+
+void* operator new(size_t size)
+{
+    AllocCount(size);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    AllocCount(size);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    AllocCount(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    AllocCount(size);
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+
+#define ALLOC_CONCAT2(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT2(a, b)
+
+#define ALLOC_SCOPE(name) \
+    static AllocSite ALLOC_CONCAT(allocSite_, __LINE__)(name); \
+    AllocSiteScope ALLOC_CONCAT(allocScope_, __LINE__)(ALLOC_CONCAT(allocSite_, __LINE__))
+
+#else // !ALLOC_TRACKING
+
+inline void AllocEndFrame() {}
+
+#define ALLOC_SCOPE(name) ((void)0)
+
+#endif
@@ -0,0 +1,347 @@
+﻿#pragma once
+// anim_rig.h
+// Скелет и клип без GL: иерархия нод, каналы TRS, выборка позы, палитра костей.
+// Model (modelwork.h) — наследник с мешами и буферами; импорт из Assimp — mesh_import.h.
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include "core_platform.h"
+#include "jobs.h"
+
+// =======================================================
+// ANIMATION (node TRS)
+// =======================================================
+
+struct NodeTRS
+{
+    glm::vec3 t{ 0,0,0 };
+    glm::quat r;        // identity
+    glm::vec3 s{ 1,1,1 };
+
+    NodeTRS() : r(1.0f, 0.0f, 0.0f, 0.0f) {}
+};
+
+struct AnimChannel
+{
+    int nodeIndex = -1;
+
+    std::vector<double> tTimes;
+    std::vector<glm::vec3> tValues;
+
+    std::vector<double> rTimes;
+    std::vector<glm::quat> rValues;
+
+    std::vector<double> sTimes;
+    std::vector<glm::vec3> sValues;
+};
+
+struct AnimClip
+{
+    double durationTicks = 0.0;
+    double ticksPerSecond = 25.0;
+    std::vector<AnimChannel> channels;
+};
+
+// =======================================================
+// RIG
+// =======================================================
+
+struct AnimRig
+{
+    // Ноды (для анимации)
+    std::vector<std::string> nodeNames;
+    std::vector<int> nodeParent;
+    std::vector<glm::mat4> nodeBaseLocal;  // base local from aiNode->mTransformation
+    std::vector<glm::mat4> nodeAnimLocal;  // animated local (base * TRS from clip)
+    std::vector<glm::mat4> nodeGlobal;     // final global
+
+    AnimClip clip;
+    bool hasAnimation = false;
+    double animTimeTicks = 0.0;
+
+    // Скиннинг (кости из aiMesh::mBones)
+    std::vector<std::string> boneNames;
+    std::vector<glm::mat4> boneOffsets;  // inverse bind pose
+    std::vector<int> boneNode;           // нода, которая двигает кость
+    std::vector<glm::mat4> skinPalette;  // [0] = world (identity), [1..N] = кости, дальше то же для нормалей
+    glm::mat4 globalInverse = glm::mat4(1.0f);
+    bool hasSkin = false;
+
+    void ClearRig();
+
+    // после импорта нод и костей: bind pose, кости -> ноды, палитра
+    void FinishRig(const std::unordered_map<std::string, int>& nodeIndexByName);
+
+    // анимация нод
+    void ResetAnimation() { animTimeTicks = 0.0; }
+    void UpdateAnimation(float dt);
+
+    // поза в момент ticks без изменения состояния модели (для инстансов)
+    // channelGrain > 0 — каналы по потокам jobs.h (одна большая модель); 0 — в вызывающем потоке
+    void EvaluatePose(double ticks, std::vector<glm::mat4>& local, std::vector<glm::mat4>& global, int channelGrain = 0) const;
+    // out[b] = globalInverse * global[boneNode[b]] * boneOffsets[b],
+    // out[NormalOffset() + b] — её обратная-транспонированная (в костях бывает неравномерный масштаб)
+    void BuildBonePalette(const std::vector<glm::mat4>& global, glm::mat4* out, int boneGrain = 0) const;
+    // world инстанса в начало блока + его матрица нормалей
+    void SetPaletteWorld(glm::mat4* block, const glm::mat4& world) const
+    {
+        block[0] = world;
+        block[NormalOffset()] = glm::inverseTranspose(world);
+    }
+    // блок инстанса: [world, кости...] и следом [world, кости...] для нормалей
+    int  NormalOffset() const { return 1 + (int)boneNames.size(); }
+    int  BoneStride() const { return 2 * NormalOffset(); }
+};
+
+// =======================================================
+// HELPERS
+// =======================================================
+
+inline int FindKeyIndex(const std::vector<double>& times, double t)
+{
+    if (times.empty()) return -1;
+    int i = 0;
+    while (i + 1 < (int)times.size() && times[i + 1] <= t) ++i;
+    return i;
+}
+
+inline glm::vec3 LerpVec3(const glm::vec3& a, const glm::vec3& b, float k)
+{
+    return a + (b - a) * k;
+}
+
+// =======================================================
+// Rig (import helpers)
+// =======================================================
+
+inline void AnimRig::ClearRig()
+{
+    nodeNames.clear();
+    nodeParent.clear();
+    nodeBaseLocal.clear();
+    nodeAnimLocal.clear();
+    nodeGlobal.clear();
+    clip.channels.clear();
+    hasAnimation = false;
+    animTimeTicks = 0.0;
+
+    boneNames.clear();
+    boneOffsets.clear();
+    boneNode.clear();
+    skinPalette.clear();
+    hasSkin = false;
+    globalInverse = glm::mat4(1.0f);
+}
+
+inline void AnimRig::FinishRig(const std::unordered_map<std::string, int>& nodeIndexByName)
+{
+    nodeAnimLocal = nodeBaseLocal;
+    nodeGlobal.resize(nodeBaseLocal.size());
+
+    // bind pose: global из базовых локалок (нужен и без анимации)
+    for (int i = 0; i < (int)nodeBaseLocal.size(); ++i)
+    {
+        int p = nodeParent[i];
+        nodeGlobal[i] = (p >= 0) ? (nodeGlobal[p] * nodeBaseLocal[i]) : nodeBaseLocal[i];
+    }
+
+    // кости -> ноды (ноды костей могут идти в обходе позже мешей)
+    hasSkin = !boneNames.empty();
+    if (hasSkin)
+    {
+        boneNode.resize(boneNames.size(), -1);
+        for (size_t b = 0; b < boneNames.size(); ++b)
+        {
+            auto it = nodeIndexByName.find(boneNames[b]);
+            if (it != nodeIndexByName.end())
+                boneNode[b] = it->second;
+            else
+                CoreLog("Skinning: no node for bone " + boneNames[b] + "\n");
+        }
+
+        skinPalette.assign(BoneStride(), glm::mat4(1.0f));
+        BuildBonePalette(nodeGlobal, skinPalette.data() + 1);
+    }
+}
+
+// =======================================================
+// UpdateAnimation (node TRS)
+// =======================================================
+
+inline void AnimRig::UpdateAnimation(float dt)
+{
+    if (!hasAnimation) return;
+
+    animTimeTicks += (double)dt * clip.ticksPerSecond;
+    if (clip.durationTicks > 0.0)
+        animTimeTicks = std::fmod(animTimeTicks, clip.durationTicks);
+
+    // выборка каналов и палитра — по потокам; иерархия (global) последовательная
+    EvaluatePose(animTimeTicks, nodeAnimLocal, nodeGlobal, 32);
+
+    // палитра костей сразу после позы
+    if (hasSkin)
+        BuildBonePalette(nodeGlobal, skinPalette.data() + 1, 64);
+}
+
+inline void AnimRig::EvaluatePose(double ticks,
+    std::vector<glm::mat4>& local, std::vector<glm::mat4>& global, int channelGrain) const
+{
+    local.resize(nodeBaseLocal.size());
+    global.resize(nodeBaseLocal.size());
+
+    // по умолчанию — base pose
+    for (size_t i = 0; i < nodeBaseLocal.size(); ++i)
+        local[i] = nodeBaseLocal[i];
+
+    // применяем каналы: мы перезаписываем локалку на base*TRS
+    auto sampleChannels = [&](int c0, int c1)
+    {
+        for (int c = c0; c < c1; ++c)
+        {
+            const AnimChannel& ch = clip.channels[c];
+            int ni = ch.nodeIndex;
+            if (ni < 0 || ni >= (int)local.size()) continue;
+
+            glm::vec3 T(0, 0, 0);
+            glm::quat R(1, 0, 0, 0);
+            glm::vec3 S(1, 1, 1);
+
+            // T
+            if (!ch.tTimes.empty())
+            {
+                int k = FindKeyIndex(ch.tTimes, ticks);
+                int k2 = std::min(k + 1, (int)ch.tTimes.size() - 1);
+                if (k >= 0)
+                {
+                    double t0 = ch.tTimes[k], t1 = ch.tTimes[k2];
+                    float f = (t1 > t0) ? (float)((ticks - t0) / (t1 - t0)) : 0.0f;
+                    T = LerpVec3(ch.tValues[k], ch.tValues[k2], f);
+                }
+            }
+
+            // R
+            if (!ch.rTimes.empty())
+            {
+                int k = FindKeyIndex(ch.rTimes, ticks);
+                int k2 = std::min(k + 1, (int)ch.rTimes.size() - 1);
+                if (k >= 0)
+                {
+                    double t0 = ch.rTimes[k], t1 = ch.rTimes[k2];
+                    float f = (t1 > t0) ? (float)((ticks - t0) / (t1 - t0)) : 0.0f;
+                    glm::quat q0 = ch.rValues[k];
+                    glm::quat q1 = ch.rValues[k2];
+
+                    // чтобы не крутило через "длинный путь"
+                    if (glm::dot(q0, q1) < 0.0f) q1 = -q1;
+
+                    R = glm::normalize(glm::quat(
+                        q0.w + (q1.w - q0.w) * f,
+                        q0.x + (q1.x - q0.x) * f,
+                        q0.y + (q1.y - q0.y) * f,
+                        q0.z + (q1.z - q0.z) * f
+                    ));
+                }
+            }
+
+            // S
+            if (!ch.sTimes.empty())
+            {
+                int k = FindKeyIndex(ch.sTimes, ticks);
+                int k2 = std::min(k + 1, (int)ch.sTimes.size() - 1);
+                if (k >= 0)
+                {
+                    double t0 = ch.sTimes[k], t1 = ch.sTimes[k2];
+                    float f = (t1 > t0) ? (float)((ticks - t0) / (t1 - t0)) : 0.0f;
+                    S = LerpVec3(ch.sValues[k], ch.sValues[k2], f);
+                }
+            }
+
+            glm::mat4 TRS(1.0f);
+            TRS = glm::translate(TRS, T);
+            TRS *= glm::mat4_cast(R);
+            TRS = glm::scale(TRS, S);
+
+            //local[ni] = nodeBaseLocal[ni] * TRS;
+            local[ni] = TRS;
+        }
+    };
+
+    // каналы независимы (у каждого своя нода) — при channelGrain > 0 кусками по потокам (jobs.h)
+    if (channelGrain > 0)
+        ParallelFor((int)clip.channels.size(), channelGrain, sampleChannels);
+    else
+        sampleChannels(0, (int)clip.channels.size());
+
+    // пересчитать global
+    for (int i = 0; i < (int)local.size(); ++i)
+    {
+        int p = nodeParent[i];
+        global[i] = (p >= 0) ? (global[p] * local[i]) : local[i];
+    }
+}
+
+inline void AnimRig::BuildBonePalette(const std::vector<glm::mat4>& global, glm::mat4* out, int boneGrain) const
+{
+    const int normals = NormalOffset();
+    auto build = [&](int b0, int b1)
+    {
+        for (int b = b0; b < b1; ++b)
+        {
+            int ni = boneNode[b];
+            glm::mat4 G = (ni >= 0 && ni < (int)global.size()) ? global[ni] : glm::mat4(1.0f);
+            out[b] = globalInverse * G * boneOffsets[b];
+            out[normals + b] = glm::inverseTranspose(out[b]);
+        }
+    };
+
+    if (boneGrain > 0)
+        ParallelFor((int)boneNames.size(), boneGrain, build);
+    else
+        build(0, (int)boneNames.size());
+}
+
+// =======================================================
+// MORPH TARGETS (CPU)
+// =======================================================
+
+// out = base, pos/nrm = base + сумма(weights[t] * delta[t]); у V есть pos и nrm (glm::vec3).
+// nrmDeltas может быть пустым (морфы без нормалей). Weights — любой вектор float (ArenaVector)
+template <typename V, typename Weights>
+void BlendMorphTargets(const std::vector<V>& base,
+    const std::vector<std::vector<glm::vec3>>& posDeltas,
+    const std::vector<std::vector<glm::vec3>>& nrmDeltas,
+    const Weights& weights,
+    std::vector<V>& out)
+{
+    out = base;
+
+    for (size_t vi = 0; vi < out.size(); ++vi)
+    {
+        glm::vec3 p = base[vi].pos;
+        glm::vec3 n = base[vi].nrm;
+
+        for (size_t ti = 0; ti < weights.size() && ti < posDeltas.size(); ++ti)
+        {
+            float ww = weights[ti];
+            if (ww == 0.0f) continue;
+
+            p += posDeltas[ti][vi] * ww;
+
+            if (!nrmDeltas.empty())
+                n += nrmDeltas[ti][vi] * ww;
+        }
+
+        out[vi].pos = p;
+        out[vi].nrm = glm::normalize(n);
+    }
+}
@@ -0,0 +1,89 @@
+// atmosphere.glsl
+// Модель атмосферы для LUT'ов неба (sky.h): рэлей + ми + озон, единицы — километры.
+// Параметры земные (как в статье Hillaire 2020), без multiple scattering LUT —
+// у горизонта небо чуть темнее эталона, для нашей сцены незаметно.
+
+const float PI = 3.14159265;
+
+const float PLANET_R = 6360.0;
+const float ATMOS_R  = 6460.0;
+
+const vec3  RAYLEIGH_SCATTER = vec3(5.802, 13.558, 33.1) * 1e-3;   // 1/км на уровне моря
+const float RAYLEIGH_H       = 8.0;
+const float MIE_SCATTER      = 3.996e-3;
+const float MIE_EXTINCTION   = 4.40e-3;
+const float MIE_H            = 1.2;
+const float MIE_G            = 0.8;
+const vec3  OZONE_ABSORB     = vec3(0.650, 1.881, 0.085) * 1e-3;   // слой ~10..40 км
+
+// мир маленький (холмы до 50 м) — камера для неба всегда на одной высоте, LUT от неё не зависит
+const float SKY_VIEW_HEIGHT = 0.2;
+
+void AtmosphereMedium(float h, out vec3 rayleigh, out float mie, out vec3 extinction)
+{
+    float rd = exp(-h / RAYLEIGH_H);
+    float md = exp(-h / MIE_H);
+    float od = max(0.0, 1.0 - abs(h - 25.0) / 15.0);
+
+    rayleigh = RAYLEIGH_SCATTER * rd;
+    mie = MIE_SCATTER * md;
+    extinction = rayleigh + MIE_EXTINCTION * md + OZONE_ABSORB * od;
+}
+
+float RayleighPhase(float c)
+{
+    return 3.0 / (16.0 * PI) * (1.0 + c * c);
+}
+
+// Cornette-Shanks
+float MiePhase(float c)
+{
+    float g2 = MIE_G * MIE_G;
+    return 3.0 / (8.0 * PI) * (1.0 - g2) * (1.0 + c * c) /
+        ((2.0 + g2) * pow(1.0 + g2 - 2.0 * MIE_G * c, 1.5));
+}
+
+// ближайшее пересечение луча с шаром радиуса r вокруг центра планеты, -1 — мимо
+float RaySphere(vec3 ro, vec3 rd, float r)
+{
+    float lr = length(ro);
+    float b = dot(ro, rd);
+    float c = (lr - r) * (lr + r);   // |ro|^2 - r^2 без потери точности на 6000 км
+    float d = b * b - c;
+    if (d < 0.0) return -1.0;
+
+    d = sqrt(d);
+    float t0 = -b - d, t1 = -b + d;
+    if (t0 > 0.0) return t0;
+    if (t1 > 0.0) return t1;
+    return -1.0;
+}
+
+// transmittance LUT: u — косинус зенитного угла, v — высота
+vec2 TransmittanceUV(float h, float mu)
+{
+    return vec2(mu * 0.5 + 0.5, clamp(h / (ATMOS_R - PLANET_R), 0.0, 1.0));
+}
+
+vec3 SampleTransmittance(sampler2D lut, float h, float mu)
+{
+    return texture(lut, TransmittanceUV(h, mu)).rgb;
+}
+
+// sky-view LUT: u — азимут (мировой, шов заворачивается GL_REPEAT),
+// v — высота над горизонтом, нелинейно: у горизонта больше текселей
+vec2 SkyViewUV(vec3 dir)
+{
+    float lat = asin(clamp(dir.y, -1.0, 1.0));
+    float v = 0.5 + 0.5 * sign(lat) * sqrt(abs(lat) / (0.5 * PI));
+    float u = atan(dir.z, dir.x) / (2.0 * PI) + 0.5;
+    return vec2(u, v);
+}
+
+vec3 SkyViewDir(vec2 uv)
+{
+    float s = uv.y * 2.0 - 1.0;
+    float lat = sign(s) * s * s * 0.5 * PI;
+    float az = (uv.x - 0.5) * 2.0 * PI;
+    return vec3(cos(lat) * cos(az), sin(lat), cos(lat) * sin(az));
+}
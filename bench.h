@@ -0,0 +1,357 @@
+﻿#pragma once
+// bench.h
+// Бенчмарки внутри приложения (им нужен живой GL-контекст).
+// Запуск через командную строку:
+//   -bench skinning [model.glb]   100 анимированных skinned персонажей, instanced draw
+//   -bench flythrough [noprepass] облёт по кругу над самой густой травой (depth pre-pass вкл/выкл)
+// Результат: OutputDebugString + файл bench_<имя>.txt, после замера приложение закрывается.
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+
+enum BenchMode {
+    BENCH_NONE = 0,
+    BENCH_SKINNING = 1,
+    BENCH_FLYTHROUGH = 2
+};
+
+const int BENCH_GPU_QUERIES = 4;   // кольцо пар timestamp query: читаем с задержкой, без ожидания GPU
+
+struct BenchState
+{
+    BenchMode mode = BENCH_NONE;
+    std::string arg;            // необязательный параметр (путь к модели и т.п.)
+
+    int frame = 0;
+    int warmupFrames = 60;      // прогрев драйвера/кэшей
+    int measureFrames = 600;
+
+    // статистика кадра
+    double sumMs = 0.0, minMs = 1e9, maxMs = 0.0;
+    double sumCpuMs = 0.0;      // CPU-часть, которую меряет конкретный бенч
+    double lastCpuMs = 0.0;
+
+    // GPU-время прохода мира: пара GL_TIMESTAMP (TIME_ELAPSED занят зонами profiler.h —
+    // он не вкладывается)
+    GLuint gpuQueries[BENCH_GPU_QUERIES][2] = {};
+    bool gpuPending[BENCH_GPU_QUERIES] = {};
+    int gpuIndex = 0;
+    double sumGpuMs = 0.0;
+    int gpuSamples = 0;
+};
+
+BenchState g_bench;
+
+inline double BenchNowMs()
+{
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return double(c.QuadPart) * 1000.0 / double(f.QuadPart);
+}
+
+// =======================================================
+// SKINNING: 100 персонажей, у каждого своё время клипа
+// =======================================================
+
+const int SKIN_BENCH_COUNT = 100;
+
+struct SkinBenchChar
+{
+    glm::mat4 world = glm::mat4(1.0f);
+    double ticks = 0.0;
+    float speed = 1.0f;
+};
+
+Model  g_skinBenchOwnModel;            // если модель передана аргументом
+Model* g_skinBenchModel = nullptr;
+std::vector<SkinBenchChar> g_skinBenchChars;
+std::vector<glm::mat4> g_skinBenchBlocks;   // SKIN_BENCH_COUNT блоков [world, кости...] x2 (позиции, нормали)
+BonePaletteBuffer g_skinBenchBuffer;
+
+bool BenchSkinningInit()
+{
+    if (!g_bench.arg.empty())
+    {
+        if (!g_skinBenchOwnModel.Load(g_bench.arg)) {
+            OutputDebugStringA(("bench skinning: failed to load " + g_bench.arg + "\n").c_str());
+            return false;
+        }
+        g_skinBenchModel = &g_skinBenchOwnModel;
+    }
+    else
+    {
+        g_skinBenchModel = g_treeCutAnimLoaded ? &g_treeCutAnimModel : nullptr;
+    }
+
+    if (!g_skinBenchModel || !g_skinBenchModel->hasSkin) {
+        OutputDebugStringA("bench skinning: model has no bones\n");
+        return false;
+    }
+
+    // сетка 10x10 перед камерой
+    const int side = 10;
+    const float spacing = 4.0f;
+    glm::vec3 fwd = glm::normalize(glm::vec3(g_cam.front.x, 0.0f, g_cam.front.z));
+    glm::vec3 right = glm::normalize(glm::cross(fwd, glm::vec3(0, 1, 0)));
+    glm::vec3 origin = g_cam.pos + fwd * 8.0f;
+
+    g_skinBenchChars.resize(SKIN_BENCH_COUNT);
+    for (int i = 0; i < SKIN_BENCH_COUNT; ++i)
+    {
+        int gx = i % side, gz = i / side;
+        glm::vec3 p = origin + right * ((gx - side * 0.5f) * spacing) + fwd * (gz * spacing);
+        p.y = g_terrain.getHeight(p.x, p.z);
+
+        SkinBenchChar& c = g_skinBenchChars[i];
+        c.world = glm::translate(glm::mat4(1.0f), p);
+        c.world = glm::scale(c.world, glm::vec3(0.2f));
+        // детерминированный разброс фаз, чтобы позы не совпадали
+        c.ticks = g_skinBenchModel->clip.durationTicks * (i * 0.137 - int(i * 0.137));
+        c.speed = 0.8f + 0.4f * float(i % 7) / 6.0f;
+    }
+
+    g_skinBenchBlocks.assign((size_t)SKIN_BENCH_COUNT * g_skinBenchModel->BoneStride(), glm::mat4(1.0f));
+    return true;
+}
+
+void BenchSkinningUpdate(float dt)
+{
+    Model& m = *g_skinBenchModel;
+    const int stride = m.BoneStride();
+
+    double t0 = BenchNowMs();
+
+    // персонажи независимы — по потокам jobs.h, у каждого потока свои local/global
+    ParallelFor(SKIN_BENCH_COUNT, 4, [&](int i0, int i1)
+        {
+            thread_local std::vector<glm::mat4> local, global;
+            for (int i = i0; i < i1; ++i)
+            {
+                SkinBenchChar& c = g_skinBenchChars[i];
+                c.ticks += (double)dt * m.clip.ticksPerSecond * c.speed;
+                if (m.clip.durationTicks > 0.0)
+                    c.ticks = std::fmod(c.ticks, m.clip.durationTicks);
+
+                m.EvaluatePose(c.ticks, local, global);
+
+                glm::mat4* block = &g_skinBenchBlocks[(size_t)i * stride];
+                m.SetPaletteWorld(block, c.world);
+                m.BuildBonePalette(global, block + 1);
+            }
+        });
+
+    g_skinBenchBuffer.Upload(g_skinBenchBlocks.data(), (int)g_skinBenchBlocks.size(), stride);
+
+    g_bench.lastCpuMs = BenchNowMs() - t0;
+}
+
+void BenchSkinningDraw(const glm::mat4& proj, const glm::mat4& view)
+{
+    if (!g_cutShader) return;
+    const Model& m = *g_skinBenchModel;
+
+    // матрицы/камера/свет — в блоке Frame
+    g_gl.UseProgram(g_cutShader);
+
+    glm::mat4 I(1.0f);
+    glUniformMatrix4fv(UniformLoc(g_cutShader, "uModel"), 1, GL_FALSE, &I[0][0]);
+    glUniformMatrix4fv(UniformLoc(g_cutShader, "uModelNormal"), 1, GL_FALSE, &I[0][0]);
+    glUniform1i(UniformLoc(g_cutShader, "uSkinned"), 1);
+    g_skinBenchBuffer.Bind(g_cutShader, BONE_PALETTE_UNIT);
+
+    g_gl.Disable(GL_CULL_FACE);
+    g_gl.Enable(GL_DEPTH_TEST);
+    g_gl.DepthMask(GL_TRUE);
+    g_gl.DepthFunc(GL_LEQUAL);
+
+    // только skinned меши: rigid-ноды в бенче не интересны
+    for (const auto& mesh : m.meshes)
+        if (mesh.skinned)
+            mesh.DrawInstanced(g_cutShader, SKIN_BENCH_COUNT);
+
+    glUniform1i(UniformLoc(g_cutShader, "uSkinned"), 0);
+}
+
+// =======================================================
+// FLYTHROUGH: облёт по кругу над травой, меряем фрагментную нагрузку
+// =======================================================
+
+glm::vec3 g_flyCenter(0.0f);
+float g_flyRadius = 30.0f;
+
+bool BenchFlythroughInit()
+{
+    if (g_bench.arg == "noprepass")
+        g_depthPrepass = false;
+
+    // центр — среднее живых пучков травы: там самый большой overdraw
+    glm::vec3 sum(0.0f);
+    int n = 0;
+    for (const auto& gi : g_grassInstances)
+        if (gi.alive) { sum += gi.pos; ++n; }
+
+    g_flyCenter = (n > 0) ? sum / float(n) : g_cam.pos;
+    return true;
+}
+
+void BenchFlythroughUpdate()
+{
+    // путь зависит только от номера кадра — одинаковый в каждом прогоне
+    float t = float(g_bench.frame) / float(g_bench.warmupFrames + g_bench.measureFrames);
+    float a = t * 2.0f * glm::pi<float>();
+
+    glm::vec3 p = g_flyCenter + glm::vec3(std::cos(a), 0.0f, std::sin(a)) * g_flyRadius;
+    p.y = g_terrain.getHeight(p.x, p.z) + g_eyeHeight;
+
+    // камера кадра (после ApplyRenderState), игрок в симуляции стоит на месте
+    g_renderCam.pos = p;
+    g_renderCam.yaw = glm::degrees(a) + 90.0f;   // по касательной
+    g_renderCam.pitch = -8.0f;                   // чуть вниз, в траву
+    g_renderCam.updateVectors();
+}
+
+// =======================================================
+// Общая обвязка
+// =======================================================
+
+// timestamp'ы вокруг мира (небо + pre-pass + мир), только когда идёт бенч
+void BenchGpuBegin()
+{
+    if (g_bench.mode == BENCH_NONE) return;
+
+    int i = g_bench.gpuIndex;
+    if (!g_bench.gpuQueries[0][0])
+        glGenQueries(BENCH_GPU_QUERIES * 2, &g_bench.gpuQueries[0][0]);
+
+    // результат этого слота был запрошен BENCH_GPU_QUERIES кадров назад — уже готов
+    if (g_bench.gpuPending[i])
+    {
+        GLuint64 t0 = 0, t1 = 0;
+        glGetQueryObjectui64v(g_bench.gpuQueries[i][0], GL_QUERY_RESULT, &t0);
+        glGetQueryObjectui64v(g_bench.gpuQueries[i][1], GL_QUERY_RESULT, &t1);
+        GLuint64 ns = t1 - t0;
+        g_bench.gpuPending[i] = false;
+        if (g_bench.frame > g_bench.warmupFrames)
+        {
+            g_bench.sumGpuMs += double(ns) * 1e-6;
+            ++g_bench.gpuSamples;
+        }
+    }
+
+    glQueryCounter(g_bench.gpuQueries[i][0], GL_TIMESTAMP);
+}
+
+void BenchGpuEnd()
+{
+    if (g_bench.mode == BENCH_NONE || !g_bench.gpuQueries[0][0]) return;
+
+    glQueryCounter(g_bench.gpuQueries[g_bench.gpuIndex][1], GL_TIMESTAMP);
+    g_bench.gpuPending[g_bench.gpuIndex] = true;
+    g_bench.gpuIndex = (g_bench.gpuIndex + 1) % BENCH_GPU_QUERIES;
+}
+
+void BenchFinish()
+{
+    const char* name = "unknown";
+    std::ostringstream os;
+
+    if (g_bench.mode == BENCH_SKINNING)
+    {
+        name = "skinning";
+        os << "bench skinning: characters=" << SKIN_BENCH_COUNT
+            << " bones=" << (g_skinBenchModel ? (int)g_skinBenchModel->boneNames.size() : 0) << "\n";
+    }
+    else if (g_bench.mode == BENCH_FLYTHROUGH)
+    {
+        name = g_depthPrepass ? "flythrough" : "flythrough_noprepass";
+        os << "bench flythrough: prepass=" << (g_depthPrepass ? "on" : "off")
+            << " grass=" << g_grassAliveCount << " radius=" << g_flyRadius << "\n";
+    }
+
+    int n = g_bench.frame - g_bench.warmupFrames;
+    if (n > 0)
+    {
+        double avg = g_bench.sumMs / n;
+        os << "frames=" << n
+            << " frame_ms avg=" << avg << " min=" << g_bench.minMs << " max=" << g_bench.maxMs
+            << " fps=" << (avg > 0.0 ? 1000.0 / avg : 0.0) << "\n"
+            << "cpu_ms avg=" << g_bench.sumCpuMs / n << " jobs=" << g_jobs.threadCount << "\n";
+        if (g_bench.gpuSamples > 0)
+            os << "gpu_world_ms avg=" << g_bench.sumGpuMs / g_bench.gpuSamples << "\n";
+    }
+    else
+    {
+        os << "not enough frames\n";
+    }
+
+    OutputDebugStringA(os.str().c_str());
+    std::ofstream f(std::string("bench_") + name + ".txt");
+    f << os.str();
+
+    g_bench.mode = BENCH_NONE;
+    g_running = false;
+}
+
+// разбор командной строки WinMain: "-bench <name> [arg]"
+void BenchInit(const char* cmdLine)
+{
+    if (!cmdLine) return;
+
+    std::istringstream ss(cmdLine);
+    std::string tok;
+    while (ss >> tok)
+    {
+        if (tok == "-bench")
+        {
+            std::string name;
+            ss >> name;
+            if (name == "skinning") g_bench.mode = BENCH_SKINNING;
+            else if (name == "flythrough") g_bench.mode = BENCH_FLYTHROUGH;
+
+            // необязательный аргумент, если это не следующий ключ
+            std::streampos pos = ss.tellg();
+            std::string arg;
+            if (ss >> arg && arg[0] != '-') g_bench.arg = arg;
+            else { ss.clear(); ss.seekg(pos); }
+        }
+    }
+
+    bool ok = true;
+    if (g_bench.mode == BENCH_SKINNING) ok = BenchSkinningInit();
+    else if (g_bench.mode == BENCH_FLYTHROUGH) ok = BenchFlythroughInit();
+
+    if (!ok)
+        BenchFinish();
+}
+
+// вызывается раз в кадр до Render(); dt = время прошлого кадра
+void BenchUpdate(float dt)
+{
+    if (g_bench.mode == BENCH_NONE) return;
+
+    if (g_bench.frame >= g_bench.warmupFrames)
+    {
+        double ms = dt * 1000.0;
+        g_bench.sumMs += ms;
+        g_bench.minMs = std::min(g_bench.minMs, ms);
+        g_bench.maxMs = std::max(g_bench.maxMs, ms);
+        g_bench.sumCpuMs += g_bench.lastCpuMs;
+    }
+
+    if (++g_bench.frame > g_bench.warmupFrames + g_bench.measureFrames)
+    {
+        BenchFinish();
+        return;
+    }
+
+    if (g_bench.mode == BENCH_SKINNING) BenchSkinningUpdate(dt);
+    else if (g_bench.mode == BENCH_FLYTHROUGH) BenchFlythroughUpdate();
+}
+
+void BenchDraw(const glm::mat4& proj, const glm::mat4& view)
+{
+    if (g_bench.mode == BENCH_SKINNING) BenchSkinningDraw(proj, view);
+}
@@ -0,0 +1,473 @@
+﻿// bench_core.cpp
+// Микробенчмарки CPU-ядра (Google Benchmark) без окна и GL: террейн, раскопка + маска воды,
+// трава/деревья, разбор OBJ, анимация скелета, морфы пилы.
+// Собирается отдельно от игры, на любой платформе:
+//   g++ -std=c++17 -O2 -I. bench_core.cpp -pthread -lbenchmark -lassimp -o bench_core
+//   (без Assimp: -DCORE_NO_ASSIMP вместо -lassimp;
+//    -DBENCH_COMMIT="\"$(git rev-parse --short HEAD)\"" — коммит попадёт в JSON)
+// Результаты — JSON в bench_results.json (или свой --benchmark_out=...);
+// сравнить два прогона: tools/compare.py из Google Benchmark.
+// Свои ключи: -jobs N, -obj файл (+ разбор этого файла), -model файл (+ анимация этой модели).
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#undef STB_IMAGE_IMPLEMENTATION
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+
+#include <benchmark/benchmark.h>
+
+#ifndef CORE_NO_ASSIMP
+#include <assimp/Importer.hpp>
+#endif
+
+#include "core_platform.h"
+#include "jobs.h"
+#include "heightfield.h"
+#include "vegetation.h"
+#include "anim_rig.h"
+#include "mesh_import.h"
+#include "world_config.h"
+
+#ifndef BENCH_COMMIT
+#define BENCH_COMMIT "unknown"
+#endif
+
+// ===== общие данные (строятся один раз на параметр) =====
+
+const Heightfield& BenchTerrain(int n)
+{
+    static std::map<int, std::unique_ptr<Heightfield>> cache;
+    auto& hf = cache[n];
+    if (!hf)
+    {
+        hf.reset(new Heightfield());
+        hf->Generate(n, WORLD_SIZE, WORLD_MAX_HEIGHT);   // размеры мира — как в игре (world_config.h)
+    }
+    return *hf;
+}
+
+const std::vector<GrassInstance>& BenchGrass(int count)
+{
+    static std::map<int, std::vector<GrassInstance>> cache;
+    auto& g = cache[count];
+    if (g.empty())
+        ScatterGrass(BenchTerrain(WORLD_VERTS), count, 1234, g);
+    return g;
+}
+
+const std::vector<TreeInstance>& BenchTrees(int count)
+{
+    static std::map<int, std::vector<TreeInstance>> cache;
+    auto& t = cache[count];
+    if (t.empty())
+        ScatterTrees(BenchTerrain(WORLD_VERTS), count, 5678, t);
+    return t;
+}
+
+// плоская сетка n x n в тексте OBJ (v/vt/vn, как у экспортёров)
+const std::string& BenchGridOBJ(int n)
+{
+    static std::map<int, std::string> cache;
+    std::string& text = cache[n];
+    if (!text.empty())
+        return text;
+
+    std::ostringstream ss;
+    for (int z = 0; z < n; ++z)
+        for (int x = 0; x < n; ++x)
+            ss << "v " << x * 0.1f << " " << ((x * 7 + z * 3) % 5) * 0.02f << " " << z * 0.1f << "\n";
+    for (int z = 0; z < n; ++z)
+        for (int x = 0; x < n; ++x)
+            ss << "vt " << (float)x / n << " " << (float)z / n << "\n";
+    ss << "vn 0 1 0\n";
+    for (int z = 0; z + 1 < n; ++z)
+        for (int x = 0; x + 1 < n; ++x)
+        {
+            int i0 = z * n + x + 1, i1 = i0 + 1, i2 = i0 + n, i3 = i2 + 1;
+            ss << "f " << i0 << "/" << i0 << "/1 " << i2 << "/" << i2 << "/1 " << i1 << "/" << i1 << "/1\n";
+            ss << "f " << i1 << "/" << i1 << "/1 " << i2 << "/" << i2 << "/1 " << i3 << "/" << i3 << "/1\n";
+        }
+    text = ss.str();
+    return text;
+}
+
+// цепочка из nodes нод, у каждой канал TRS на keys ключей, каждая нода — кость
+void MakeSyntheticRig(AnimRig& rig, int nodes, int keys)
+{
+    rig.ClearRig();
+    std::unordered_map<std::string, int> byName;
+    for (int i = 0; i < nodes; ++i)
+    {
+        rig.nodeNames.push_back("n" + std::to_string(i));
+        rig.nodeParent.push_back(i - 1);
+        rig.nodeBaseLocal.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.1f, 0.0f)));
+        byName[rig.nodeNames.back()] = i;
+
+        rig.boneNames.push_back(rig.nodeNames.back());
+        rig.boneOffsets.push_back(glm::mat4(1.0f));
+
+        AnimChannel ch;
+        ch.nodeIndex = i;
+        for (int k = 0; k < keys; ++k)
+        {
+            double t = (double)k;
+            float a = 0.05f * (float)k + 0.01f * (float)i;
+            ch.tTimes.push_back(t); ch.tValues.push_back(glm::vec3(0.0f, 0.1f, 0.0f));
+            ch.rTimes.push_back(t); ch.rValues.push_back(glm::quat(std::cos(a), 0.0f, std::sin(a), 0.0f));
+            ch.sTimes.push_back(t); ch.sValues.push_back(glm::vec3(1.0f));
+        }
+        rig.clip.channels.push_back(std::move(ch));
+    }
+    rig.clip.durationTicks = (double)(keys - 1);
+    rig.clip.ticksPerSecond = 30.0;
+    rig.hasAnimation = true;
+    rig.FinishRig(byName);
+}
+
+// ===== террейн =====
+
+// точки по всей карте вразброс — худший случай для кэша
+static void BM_GetHeightRandom(benchmark::State& state)
+{
+    const Heightfield& hf = BenchTerrain((int)state.range(0));
+    PhiloxStream rng(42);
+    float half = hf.size * 0.5f;
+
+    for (auto _ : state)
+    {
+        float x = -half + rng.Next01() * hf.size;
+        float z = -half + rng.Next01() * hf.size;
+        benchmark::DoNotOptimize(hf.getHeight(x, z));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetHeightRandom)->Arg(512)->Arg(1024)->Arg(2048);
+
+// шагами по 0.25 м вдоль линии — как камера, рейкаст и расстановка рядом
+static void BM_GetHeightCoherent(benchmark::State& state)
+{
+    const Heightfield& hf = BenchTerrain((int)state.range(0));
+    float half = hf.size * 0.5f;
+    float x = -half, z = -half * 0.5f;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(hf.getHeight(x, z));
+        x += 0.25f;
+        if (x > half) x = -half;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetHeightCoherent)->Arg(512)->Arg(1024)->Arg(2048);
+
+// луч из глаз вниз-вперёд; Arg — дальность (грабли 6 м, дальний луч)
+static void BM_RaycastTerrain(benchmark::State& state)
+{
+    const Heightfield& hf = BenchTerrain(WORLD_VERTS);
+    float maxDist = (float)state.range(0);
+    PhiloxStream rng(7);
+    float half = hf.size * 0.45f;
+    int hits = 0;
+
+    for (auto _ : state)
+    {
+        float x = -half + rng.Next01() * half * 2.0f;
+        float z = -half + rng.Next01() * half * 2.0f;
+        glm::vec3 origin(x, hf.getHeight(x, z) + 1.7f, z);
+        glm::vec3 dir = glm::normalize(glm::vec3(1.0f, -0.3f, 0.2f));
+        glm::vec3 hit;
+        hits += RaycastHeightfield(hf, origin, dir, maxDist, hit) ? 1 : 0;
+    }
+    state.counters["hitRate"] = benchmark::Counter((double)hits / std::max<int64_t>(1, state.iterations()));
+}
+BENCHMARK(BM_RaycastTerrain)->Arg(6)->Arg(50);
+
+// Terrain::Dig целиком: яма + все вершины + маска воды (заливка в GL не входит)
+static void BM_DigRebuild(benchmark::State& state)
+{
+    Heightfield hf = BenchTerrain((int)state.range(0));   // копия: копаем
+    std::vector<float> verts;
+    std::vector<uint8_t> mask;
+    PhiloxStream rng(11);
+    float half = hf.size * 0.4f;
+
+    for (auto _ : state)
+    {
+        glm::vec3 c(-half + rng.Next01() * half * 2.0f, 0.0f, -half + rng.Next01() * half * 2.0f);
+        hf.ApplyDig(c, 2.0f);
+        hf.BuildVertices(verts);
+        hf.BuildWaterMask(WORLD_WATER_LEVEL, mask);
+        benchmark::ClobberMemory();
+    }
+    state.counters["vertices"] = (double)hf.width * hf.height;
+}
+BENCHMARK(BM_DigRebuild)->Arg(256)->Arg(512)->Arg(1024)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+static void BM_RebuildVertices(benchmark::State& state)
+{
+    const Heightfield& hf = BenchTerrain((int)state.range(0));
+    std::vector<float> verts;
+
+    for (auto _ : state)
+    {
+        hf.BuildVertices(verts);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)(verts.size() * sizeof(float)));
+}
+BENCHMARK(BM_RebuildVertices)->Arg(256)->Arg(512)->Arg(1024)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+static void BM_RebuildWaterMask(benchmark::State& state)
+{
+    const Heightfield& hf = BenchTerrain((int)state.range(0));
+    std::vector<uint8_t> mask;
+
+    for (auto _ : state)
+    {
+        hf.BuildWaterMask(WORLD_WATER_LEVEL, mask);
+        benchmark::ClobberMemory();
+    }
+    state.counters["wet"] = (double)std::count(mask.begin(), mask.end(), (uint8_t)255);
+}
+BENCHMARK(BM_RebuildWaterMask)->Arg(256)->Arg(512)->Arg(1024)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+// ===== растительность =====
+
+// RemoveGrassAt без заливки: вырубка в радиусе + сбор живых в инстанс-буфер
+static void BM_RemoveGrassAt(benchmark::State& state)
+{
+    const std::vector<GrassInstance>& all = BenchGrass((int)state.range(0));
+    std::vector<GrassInstance> grass;
+    std::vector<glm::vec4> data;
+    PhiloxStream rng(13);
+    float half = WORLD_SIZE * 0.5f;
+
+    for (auto _ : state)
+    {
+        // каждый раз нетронутая трава: иначе итерации шли бы по всё более редкой
+        state.PauseTiming();
+        grass = all;
+        glm::vec3 c(-half + rng.Next01() * WORLD_SIZE, 0.0f, -half + rng.Next01() * WORLD_SIZE);
+        state.ResumeTiming();
+
+        KillGrassInRadius(grass, c, 2.5f);
+        CollectGrassInstanceData(grass, data);
+        benchmark::ClobberMemory();
+    }
+    state.counters["instances"] = (double)grass.size();
+}
+BENCHMARK(BM_RemoveGrassAt)->Arg(100000)->Arg(400000)->Arg(4000000)->Unit(benchmark::kMillisecond);
+
+static void BM_ResolveTreeCollisions(benchmark::State& state)
+{
+    const std::vector<TreeInstance>& trees = BenchTrees((int)state.range(0));
+    std::vector<bool> removed;
+    PhiloxStream rng(17);
+    float half = WORLD_SIZE * 0.5f;
+
+    for (auto _ : state)
+    {
+        glm::vec3 p(-half + rng.Next01() * WORLD_SIZE, 0.0f, -half + rng.Next01() * WORLD_SIZE);
+        ResolveTreeCollisionsXZ(trees, removed, 0.6f, p);
+        benchmark::DoNotOptimize(p);
+    }
+    state.counters["trees"] = (double)trees.size();
+}
+BENCHMARK(BM_ResolveTreeCollisions)->Arg(2000)->Arg(100000);
+
+static void BM_ScatterGrass(benchmark::State& state)
+{
+    const Heightfield& hf = BenchTerrain(WORLD_VERTS);
+    std::vector<GrassInstance> grass;
+
+    for (auto _ : state)
+        ScatterGrass(hf, (int)state.range(0), 1234, grass);
+    state.counters["instances"] = (double)grass.size();
+}
+BENCHMARK(BM_ScatterGrass)->Arg(GRASS_TARGET)->Unit(benchmark::kMillisecond);
+
+// ===== меши =====
+
+// LoadOBJ без заливки; Arg — сторона сетки (512 -> 262k вершин, 522k треугольников)
+static void BM_ParseOBJ(benchmark::State& state)
+{
+    const std::string& text = BenchGridOBJ((int)state.range(0));
+    CpuMesh mesh;
+
+    for (auto _ : state)
+    {
+        std::istringstream ss(text);
+        ParseOBJ(ss, mesh);
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)text.size());
+    state.counters["vertices"] = (double)mesh.VertexCount();
+}
+BENCHMARK(BM_ParseOBJ)->Arg(128)->Arg(256)->Arg(512)->Unit(benchmark::kMillisecond);
+
+// "-obj файл"
+static void BM_ParseOBJFile(benchmark::State& state, std::string path)
+{
+    CpuMesh mesh;
+    for (auto _ : state)
+    {
+        if (!ParseOBJ(path.c_str(), mesh))
+        {
+            state.SkipWithError("ParseOBJ failed");
+            break;
+        }
+    }
+    state.counters["vertices"] = (double)mesh.VertexCount();
+}
+
+// ===== анимация =====
+
+// Model::UpdateAnimation: выборка каналов + иерархия + палитра; Arg — нод (все — кости)
+static void BM_UpdateAnimation(benchmark::State& state)
+{
+    AnimRig rig;
+    MakeSyntheticRig(rig, (int)state.range(0), 120);
+
+    for (auto _ : state)
+    {
+        rig.UpdateAnimation(1.0f / 60.0f);
+        benchmark::DoNotOptimize(rig.skinPalette.data());
+    }
+    state.counters["nodes"] = (double)rig.nodeNames.size();
+}
+BENCHMARK(BM_UpdateAnimation)->Arg(32)->Arg(128)->Arg(512);
+
+#ifndef CORE_NO_ASSIMP
+// "-model файл": та же анимация на настоящей модели (cut-анимация, персонаж)
+static void BM_UpdateAnimationModel(benchmark::State& state, std::string path)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+    AnimRig rig;
+    std::vector<CpuMesh> meshes;
+    if (!ImportModelScene(scene, rig, meshes) || !rig.hasAnimation)
+    {
+        state.SkipWithError("model has no animation");
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        rig.UpdateAnimation(1.0f / 60.0f);
+        benchmark::DoNotOptimize(rig.nodeGlobal.data());
+    }
+    state.counters["nodes"] = (double)rig.nodeNames.size();
+}
+#endif
+
+// вершина как CST_Vertex в chainsaw_test.h (тот же размер — та же пропускная способность)
+struct BenchMorphVertex
+{
+    glm::vec3 pos;
+    glm::vec3 nrm;
+    glm::vec2 uv;
+    int   boneIds[MAX_BONE_INFLUENCE] = { 0, 0, 0, 0 };
+    float boneWeights[MAX_BONE_INFLUENCE] = { 0, 0, 0, 0 };
+};
+
+// ChainsawTest::Update: морф цепи на CPU. Args — вершин, морф-таргетов
+static void BM_ChainsawMorph(benchmark::State& state)
+{
+    int verts = (int)state.range(0);
+    int targets = (int)state.range(1);
+
+    std::vector<BenchMorphVertex> base(verts), work;
+    std::vector<std::vector<glm::vec3>> posDeltas(targets), nrmDeltas(targets);
+    PhiloxStream rng(19);
+    for (int v = 0; v < verts; ++v)
+    {
+        base[v].pos = glm::vec3(rng.Next01(), rng.Next01(), rng.Next01());
+        base[v].nrm = glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+    for (int t = 0; t < targets; ++t)
+    {
+        posDeltas[t].resize(verts);
+        nrmDeltas[t].resize(verts);
+        for (int v = 0; v < verts; ++v)
+        {
+            posDeltas[t][v] = glm::vec3(rng.Next01() - 0.5f, 0.0f, rng.Next01() - 0.5f) * 0.01f;
+            nrmDeltas[t][v] = glm::vec3(0.0f, 0.0f, rng.Next01() * 0.1f);
+        }
+    }
+
+    std::vector<float> w(targets, 0.0f);
+    float time = 0.0f;
+    for (auto _ : state)
+    {
+        // как ключи glTF: два соседних таргета, вес перетекает
+        time += 1.0f / 60.0f;
+        int k = (int)(time * 10.0f) % targets;
+        float f = time * 10.0f - std::floor(time * 10.0f);
+        std::fill(w.begin(), w.end(), 0.0f);
+        w[k] = 1.0f - f;
+        w[(k + 1) % targets] += f;
+
+        BlendMorphTargets(base, posDeltas, nrmDeltas, w, work);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * verts);
+}
+BENCHMARK(BM_ChainsawMorph)->Args({ 5000, 2 })->Args({ 5000, 8 })->Args({ 50000, 2 });
+
+// ===== main =====
+
+int main(int argc, char** argv)
+{
+    // свои ключи забираем, остальное — Google Benchmark
+    std::vector<char*> args;
+    std::string jobsCmd, objPath, modelPath;
+    bool hasOut = false;
+    for (int i = 0; i < argc; ++i)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (!strcmp(argv[i], "-jobs") && hasValue) { jobsCmd = std::string("-jobs ") + argv[++i]; continue; }
+        if (!strcmp(argv[i], "-obj") && hasValue) { objPath = argv[++i]; continue; }
+        if (!strcmp(argv[i], "-model") && hasValue) { modelPath = argv[++i]; continue; }
+        if (!strncmp(argv[i], "--benchmark_out=", 16)) hasOut = true;
+        args.push_back(argv[i]);
+    }
+
+    // по умолчанию JSON рядом — для сравнения между коммитами
+    static char defOut[] = "--benchmark_out=bench_results.json";
+    static char defFormat[] = "--benchmark_out_format=json";
+    if (!hasOut)
+    {
+        args.push_back(defOut);
+        args.push_back(defFormat);
+    }
+
+    JobsInit(jobsCmd.c_str());
+
+    if (!objPath.empty())
+        benchmark::RegisterBenchmark("BM_ParseOBJFile", BM_ParseOBJFile, objPath)->Unit(benchmark::kMillisecond);
+#ifndef CORE_NO_ASSIMP
+    if (!modelPath.empty())
+        benchmark::RegisterBenchmark("BM_UpdateAnimationModel", BM_UpdateAnimationModel, modelPath);
+#endif
+
+    int n = (int)args.size();
+    benchmark::Initialize(&n, args.data());
+    if (benchmark::ReportUnrecognizedArguments(n, args.data()))
+        return 1;
+
+    benchmark::AddCustomContext("commit", BENCH_COMMIT);
+    benchmark::AddCustomContext("jobs", std::to_string(g_jobs.threadCount));
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    JobsShutdown();
+    return 0;
+}
@@ -5,7 +5,7 @@ in vec2 vTex;
 
 out vec4 FragColor;
 
-uniform vec3 uLightDir;
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
 
 uniform sampler2D uTex;
 uniform int uHasTex;
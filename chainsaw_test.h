@@ -14,8 +14,9 @@
 #include <cctype>
 
 #include "stb_image.h"   //  STB_IMAGE_IMPLEMENTATION !
+#include "skinning.h"     // BoneVertex / BonePaletteBuffer (AiToGlm  mesh_import.h)
 
-extern GLuint CreateShaderProgram(const char* vsPath, const char* fsPath);
+extern GLuint CreateShaderProgram(const char* vsPath, const char* fsPath, const char* defines);
 void StartCutAnimAt(const glm::vec3& worldPos);
 extern int g_currentTool;
 
@@ -32,6 +33,7 @@ float g_cutTime = 0.0f;
 const float g_cutDuration = 0.55f;   //   ""
 int   g_targetTreeIndex = -1;        //  ,  
 bool  g_lockPlayerDuringCut = true;  //      
+float g_chainsawTime = 0.0f;         //    ();     AnimateChainsawTest
 
 inline void DebugMoveTool(float dt)
 {
@@ -39,7 +41,7 @@ inline void DebugMoveTool(float dt)
     const float rotSpeed = 90.0f * dt;
     const float scaleSpd = 1.0f * dt;
 
-    auto down = [](int vkey) { return (GetAsyncKeyState(vkey) & 0x8000) != 0; };
+    auto down = [](int vkey) { return InputHeld(vkey); };
 
     // ===  ===
     if (down(VK_LEFT))  g_toolOffset.x -= moveSpeed;
@@ -66,7 +68,7 @@ inline void DebugMoveTool(float dt)
     if (down(VK_SUBTRACT)) g_toolScale -= scaleSpd;
 
     // === PRINT  DEBUG ( NUMPAD5) ===
-    if (GetAsyncKeyState(VK_NUMPAD5) & 1)
+    if (InputPressed(VK_NUMPAD5))
     {
         char buf[512];
         sprintf_s(buf,
@@ -82,24 +84,9 @@ inline void DebugMoveTool(float dt)
 
 
 // ====== helpers ======
-static glm::mat4 CST_AiToGlm(const aiMatrix4x4& m)
-{
-    glm::mat4 r;
-    r[0][0] = m.a1; r[1][0] = m.a2; r[2][0] = m.a3; r[3][0] = m.a4;
-    r[0][1] = m.b1; r[1][1] = m.b2; r[2][1] = m.b3; r[3][1] = m.b4;
-    r[0][2] = m.c1; r[1][2] = m.c2; r[2][2] = m.c3; r[3][2] = m.c4;
-    r[0][3] = m.d1; r[1][3] = m.d2; r[2][3] = m.d3; r[3][3] = m.d4;
-    return r;
-}
-
-static std::string CST_ToLower(std::string s)
-{
-    for (auto& c : s) c = (char)std::tolower((unsigned char)c);
-    return s;
-}
-
 static GLuint CST_TexFromMemory(const unsigned char* bytes, int len)
 {
+    TRACE_SCOPE("CST_TexFromMemory");
     int w = 0, h = 0, comp = 0;
     stbi_set_flip_vertically_on_load(1);
     unsigned char* data = stbi_load_from_memory(bytes, len, &w, &h, &comp, 4);
@@ -107,9 +94,11 @@ static GLuint CST_TexFromMemory(const unsigned char* bytes, int len)
 
     GLuint tex = 0;
     glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
+    g_gl.BindTexture(GL_TEXTURE_2D, tex);
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    CountGpuUpload((size_t)w * h * 4);
+    MemGpuTexture(tex, GL_RGBA, w, h, true);
     glGenerateMipmap(GL_TEXTURE_2D);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -180,6 +169,8 @@ struct CST_Vertex
     glm::vec3 pos;
     glm::vec3 nrm;
     glm::vec2 uv;
+    int   boneIds[MAX_BONE_INFLUENCE] = { 0, 0, 0, 0 };          // layout 3
+    float boneWeights[MAX_BONE_INFLUENCE] = { 0, 0, 0, 0 };      // layout 4 (0 =  skinned)
 };
 
 // ====== mesh ======
@@ -194,6 +185,7 @@ struct CST_Mesh
     std::vector<std::vector<glm::vec3>> morphPosDeltas; // [morphTarget][vertex] delta
     std::vector<std::vector<glm::vec3>> morphNrmDeltas; // [target][v] 
     bool isChain = false;
+    bool skinned = false;   //  aiMesh::mBones -> uNode = identity
 
     std::string nodeName;
     glm::mat4 bindNode = glm::mat4(1.0f);
@@ -202,13 +194,14 @@ struct CST_Mesh
 
     void Draw() const
     {
-        glBindVertexArray(vao);
+        g_gl.BindVertexArray(vao);
         glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        ProfDraw(GL_TRIANGLES, indexCount);
     }
 };
 
-struct ChainsawTest
+// , ,     AnimRig (anim_rig.h),   Model;    
+struct ChainsawTest : AnimRig
 {
     Assimp::Importer importer;
     const aiScene* scene = nullptr;
@@ -218,8 +211,11 @@ struct ChainsawTest
     //   
     float t = 0.0f;
 
+    BonePaletteBuffer skinBuffer;
+
     bool Load(const char* path)
     {
+        TRACE_SCOPE("ChainsawTest::Load");
         scene = importer.ReadFile(path,
             aiProcess_Triangulate |
             aiProcess_GenSmoothNormals |
@@ -229,146 +225,189 @@ struct ChainsawTest
 
         meshes.clear();
 
-        std::function<void(aiNode*, aiMatrix4x4)> walk;
-        walk = [&](aiNode* node, aiMatrix4x4 parent)
-            {
-                aiMatrix4x4 global = parent * node->mTransformation;
-
-                for (unsigned mi = 0; mi < node->mNumMeshes; ++mi)
-                {
-                    aiMesh* m = scene->mMeshes[node->mMeshes[mi]];
-                    if (!m) continue;
+        // , ,       (mesh_import.h);   bind pose  
+        std::vector<CpuMesh> cpuMeshes;
+        ImportModelScene(scene, *this, cpuMeshes);
 
-                    std::vector<CST_Vertex> verts;
-                    std::vector<unsigned> idx;
+        for (const CpuMesh& src : cpuMeshes)
+        {
+            const aiMesh* m = scene->mMeshes[src.sceneMesh];
+            size_t count = src.VertexCount();
 
-                    verts.resize(m->mNumVertices);
-                    glm::vec3 bmin(1e9f), bmax(-1e9f);
-                    for (unsigned k = 0; k < m->mNumVertices; ++k)
+            std::vector<CST_Vertex> verts(count);
+            glm::vec3 bmin(1e9f), bmax(-1e9f);
+            for (size_t k = 0; k < count; ++k)
+            {
+                const float* f = &src.vertices[k * MESH_VERTEX_FLOATS];
+                CST_Vertex& v = verts[k];
+                v.pos = glm::vec3(f[0], f[1], f[2]);
+                v.nrm = glm::vec3(f[3], f[4], f[5]);
+                v.uv = glm::vec2(f[6], f[7]);
+
+                //   (top-4, )
+                if (src.skinned)
+                    for (int s = 0; s < MAX_BONE_INFLUENCE; ++s)
                     {
+                        v.boneIds[s] = src.bones[k].ids[s];
+                        v.boneWeights[s] = src.bones[k].weights[s];
+                    }
 
-                        const aiVector3D& p = m->mVertices[k];
-                        aiVector3D n = m->HasNormals() ? m->mNormals[k] : aiVector3D(0, 1, 0);
-
-                        aiVector3D uv(0, 0, 0);
-                        if (m->HasTextureCoords(0) && m->mTextureCoords[0])
-                            uv = m->mTextureCoords[0][k];
+                bmin = glm::min(bmin, v.pos);
+                bmax = glm::max(bmax, v.pos);
+            }
 
-                        CST_Vertex v;
-                        v.pos = glm::vec3(p.x, p.y, p.z);
-                        
-                        v.nrm = glm::vec3(n.x, n.y, n.z);
-                        v.uv = glm::vec2(uv.x, uv.y);
+            CST_Mesh out;
+            out.indexCount = (GLsizei)src.indices.size();
+            out.nodeName = nodeNames[src.nodeIndex];
+            out.bindNode = nodeGlobal[src.nodeIndex];   // bind pose (AnimRig::FinishRig)
+            out.localCenter = (bmin + bmax) * 0.5f;
 
-                        bmin = glm::min(bmin, v.pos);
-                        bmax = glm::max(bmax, v.pos);
+            out.meshName = src.name;          // :   ( morph channel)
+            out.baseVerts = verts;            //  
+            out.workVerts = verts;            //   (  )
 
-                        verts[k] = v;
-                    }
+            // ===== morph targets ( ) =====
+            if (m->mNumAnimMeshes > 0)
+            {
+                out.morphPosDeltas.resize(m->mNumAnimMeshes);
+                out.morphNrmDeltas.resize(m->mNumAnimMeshes);
 
-                    idx.reserve(m->mNumFaces * 3);
-                    for (unsigned f = 0; f < m->mNumFaces; ++f)
-                        for (unsigned j = 0; j < m->mFaces[f].mNumIndices; ++j)
-                            idx.push_back(m->mFaces[f].mIndices[j]);
+                for (unsigned ti = 0; ti < m->mNumAnimMeshes; ++ti)
+                {
+                    aiAnimMesh* am = m->mAnimMeshes[ti];
 
-                    CST_Mesh out;
-                    out.indexCount = (GLsizei)idx.size();
-                    out.nodeName = node->mName.C_Str();
-                    out.bindNode = CST_AiToGlm(global);
-                    out.localCenter = (bmin + bmax) * 0.5f;
+                    out.morphPosDeltas[ti].resize(m->mNumVertices, glm::vec3(0));
+                    out.morphNrmDeltas[ti].resize(m->mNumVertices, glm::vec3(0));
 
-                    out.meshName = m->mName.C_Str(); // :   ( morph channel)
-                    out.baseVerts = verts;            //  
-                    out.workVerts = verts;            //   (  )
+                    bool hasMorphNormals = (am->mNormals != nullptr) && m->HasNormals();
 
-                    // ===== morph targets ( ) =====
-                    if (m->mNumAnimMeshes > 0)
+                    for (unsigned vi = 0; vi < m->mNumVertices; ++vi)
                     {
-                        out.morphPosDeltas.resize(m->mNumAnimMeshes);
-                        out.morphNrmDeltas.resize(m->mNumAnimMeshes);
+                        // pos delta
+                        const aiVector3D& tp = am->mVertices[vi];
+                        const aiVector3D& bp = m->mVertices[vi];
+                        out.morphPosDeltas[ti][vi] = glm::vec3(tp.x - bp.x, tp.y - bp.y, tp.z - bp.z);
 
-                        for (unsigned ti = 0; ti < m->mNumAnimMeshes; ++ti)
+                        // normal delta ( )
+                        if (hasMorphNormals)
                         {
-                            aiAnimMesh* am = m->mAnimMeshes[ti];
-
-                            out.morphPosDeltas[ti].resize(m->mNumVertices, glm::vec3(0));
-                            out.morphNrmDeltas[ti].resize(m->mNumVertices, glm::vec3(0));
-
-                            bool hasMorphNormals = (am->mNormals != nullptr) && m->HasNormals();
-
-                            for (unsigned vi = 0; vi < m->mNumVertices; ++vi)
-                            {
-                                // pos delta
-                                const aiVector3D& tp = am->mVertices[vi];
-                                const aiVector3D& bp = m->mVertices[vi];
-                                out.morphPosDeltas[ti][vi] = glm::vec3(tp.x - bp.x, tp.y - bp.y, tp.z - bp.z);
-
-                                // normal delta ( )
-                                if (hasMorphNormals)
-                                {
-                                    const aiVector3D& tn = am->mNormals[vi];
-                                    const aiVector3D& bn = m->mNormals[vi];
-                                    out.morphNrmDeltas[ti][vi] = glm::vec3(tn.x - bn.x, tn.y - bn.y, tn.z - bn.z);
-                                }
-                            }
+                            const aiVector3D& tn = am->mNormals[vi];
+                            const aiVector3D& bn = m->mNormals[vi];
+                            out.morphNrmDeltas[ti][vi] = glm::vec3(tn.x - bn.x, tn.y - bn.y, tn.z - bn.z);
                         }
-
                     }
+                }
 
-                    out.isChain = (m->mNumAnimMeshes > 0);
+            }
 
-                    // texture from material (embedded)
-                    int matIndex = (int)m->mMaterialIndex;
-                    if (matIndex >= 0 && matIndex < (int)scene->mNumMaterials)
-                        out.baseTex = CST_LoadAnyBaseColor(scene, scene->mMaterials[matIndex]);
-                    
-                    glGenVertexArrays(1, &out.vao);
-                    glGenBuffers(1, &out.vbo);
-                    glGenBuffers(1, &out.ebo);
+            out.isChain = (m->mNumAnimMeshes > 0);
+            out.skinned = src.skinned;
 
-                    glBindVertexArray(out.vao);
+            // texture from material (embedded)
+            if (src.materialIndex < scene->mNumMaterials)
+                out.baseTex = CST_LoadAnyBaseColor(scene, scene->mMaterials[src.materialIndex]);
 
-                    glBindBuffer(GL_ARRAY_BUFFER, out.vbo);
-                    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(CST_Vertex), verts.data(), GL_DYNAMIC_DRAW);
+            glGenVertexArrays(1, &out.vao);
+            glGenBuffers(1, &out.vbo);
+            glGenBuffers(1, &out.ebo);
 
+            g_gl.BindVertexArray(out.vao);
 
-                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, out.ebo);
-                    glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(unsigned), idx.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, out.vbo);
+            glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(CST_Vertex), verts.data(), GL_DYNAMIC_DRAW);
+            CountGpuUpload(verts.size() * sizeof(CST_Vertex));
+            MemGpuBuffer(out.vbo, verts.size() * sizeof(CST_Vertex));
 
-                    GLsizei stride = sizeof(CST_Vertex);
 
-                    glEnableVertexAttribArray(0);
-                    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CST_Vertex, pos));
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, out.ebo);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, src.indices.size() * sizeof(unsigned), src.indices.data(), GL_STATIC_DRAW);
+            CountGpuUpload(src.indices.size() * sizeof(unsigned));
+            MemGpuBuffer(out.ebo, src.indices.size() * sizeof(unsigned));
 
-                    glEnableVertexAttribArray(1);
-                    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CST_Vertex, nrm));
+            GLsizei stride = sizeof(CST_Vertex);
 
-                    glEnableVertexAttribArray(2);
-                    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CST_Vertex, uv));
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CST_Vertex, pos));
 
-                    glBindVertexArray(0);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CST_Vertex, nrm));
 
-                    meshes.push_back(out);
-                }
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CST_Vertex, uv));
+
+            glEnableVertexAttribArray(3);
+            glVertexAttribIPointer(3, 4, GL_INT, stride, (void*)offsetof(CST_Vertex, boneIds));
+
+            glEnableVertexAttribArray(4);
+            glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CST_Vertex, boneWeights));
 
-                for (unsigned c = 0; c < node->mNumChildren; ++c)
-                    walk(node->mChildren[c], global);
-            };
+            g_gl.BindVertexArray(0);
 
-        walk(scene->mRootNode, aiMatrix4x4());
+            meshes.push_back(out);
+        }
+
+        if (hasSkin)
+            skinBuffer.Upload(skinPalette.data(), (int)skinPalette.size(), BoneStride());
+
+        MemSetCpu(this, CpuBytes(), MEM_CHAINSAW);
         return !meshes.empty();
     }
 
-    void Update(float dt)
+    // CPU: /  + ,    aiScene (importer   
+    //    -  ). aiScene    
+    size_t CpuBytes() const
     {
+        size_t bytes = 0;
+        for (const CST_Mesh& m : meshes)
+        {
+            bytes += (m.baseVerts.capacity() + m.workVerts.capacity()) * sizeof(CST_Vertex);
+            for (const auto& d : m.morphPosDeltas) bytes += d.capacity() * sizeof(glm::vec3);
+            for (const auto& d : m.morphNrmDeltas) bytes += d.capacity() * sizeof(glm::vec3);
+        }
+        if (!scene) return bytes;
 
-        if (!scene || !scene->HasAnimations()) return;
+        for (unsigned i = 0; i < scene->mNumMeshes; ++i)
+        {
+            const aiMesh* m = scene->mMeshes[i];
+            size_t perVert = sizeof(aiVector3D) * (2 + (m->mTangents ? 2 : 0) + m->GetNumUVChannels())
+                + sizeof(aiColor4D) * m->GetNumColorChannels();
+            bytes += perVert * m->mNumVertices + m->mNumFaces * (sizeof(aiFace) + 3 * sizeof(unsigned));
+            bytes += (size_t)m->mNumAnimMeshes * m->mNumVertices * 2 * sizeof(aiVector3D);
+            for (unsigned b = 0; b < m->mNumBones; ++b)
+                bytes += sizeof(aiBone) + m->mBones[b]->mNumWeights * sizeof(aiVertexWeight);
+        }
+        for (unsigned i = 0; i < scene->mNumTextures; ++i)
+        {
+            const aiTexture* t = scene->mTextures[i];
+            bytes += t->mHeight ? (size_t)t->mWidth * t->mHeight * sizeof(aiTexel) : t->mWidth;
+        }
+        for (unsigned i = 0; i < scene->mNumAnimations; ++i)
+        {
+            const aiAnimation* a = scene->mAnimations[i];
+            for (unsigned c = 0; c < a->mNumChannels; ++c)
+            {
+                const aiNodeAnim* ch = a->mChannels[c];
+                bytes += (ch->mNumPositionKeys + ch->mNumScalingKeys) * sizeof(aiVectorKey)
+                    + ch->mNumRotationKeys * sizeof(aiQuatKey);
+            }
+        }
+        return bytes;
+    }
+
+    void Update(float dt)
+    {
+        ALLOC_SCOPE("ChainsawTest::Update");
+        if (!scene || !hasAnimation) return;
 
         t += dt;
 
+        // === 0)      (AnimRig::UpdateAnimation),    GPU
+        UpdateAnimation(dt);
+        if (hasSkin)
+            skinBuffer.Upload(skinPalette.data(), (int)skinPalette.size(), BoneStride());
+
         aiAnimation* anim = scene->mAnimations[0];
-        double tps = anim->mTicksPerSecond != 0.0 ? anim->mTicksPerSecond : 25.0;
-        double time = fmod(t * tps, anim->mDuration);
+        double time = animTimeTicks;
 
         // === 1)     morph-  
         if (anim->mNumMorphMeshChannels == 0) return;
@@ -413,7 +452,7 @@ struct ChainsawTest
             // -  mValues ( morph targets)
             // -  mWeights ()
             // ( glTF    "weights")
-            std::vector<float> w(dst->morphPosDeltas.size(), 0.0f);
+            ArenaVector<float> w(dst->morphPosDeltas.size(), 0.0f);   //   (frame_arena.h)
 
             auto applyKey = [&](const aiMeshMorphKey& key, float kf)
                 {
@@ -436,35 +475,12 @@ struct ChainsawTest
             }
 
             // === 4)   : base + (weight * delta)
-            // (CPU morphing)
-            dst->workVerts = dst->baseVerts;
-
-            for (size_t vi = 0; vi < dst->workVerts.size(); ++vi)
-            {
-                glm::vec3 p = dst->baseVerts[vi].pos;
-                glm::vec3 n = dst->baseVerts[vi].nrm;
-
-                for (size_t ti = 0; ti < w.size(); ++ti)
-                {
-                    float ww = w[ti];
-                    if (ww == 0.0f) continue;
-
-                    p += dst->morphPosDeltas[ti][vi] * ww;
+            // (CPU morphing, anim_rig.h)
+            BlendMorphTargets(dst->baseVerts, dst->morphPosDeltas, dst->morphNrmDeltas, w, dst->workVerts);
 
-                    if (!dst->morphNrmDeltas.empty())
-                        n += dst->morphNrmDeltas[ti][vi] * ww;
-                }
-
-                dst->workVerts[vi].pos = p;
-                dst->workVerts[vi].nrm = glm::normalize(n);
-            }
-
-            // === 5)     VBO
-            glBindBuffer(GL_ARRAY_BUFFER, dst->vbo);
-            glBufferSubData(GL_ARRAY_BUFFER, 0,
-                (GLsizeiptr)(dst->workVerts.size() * sizeof(CST_Vertex)),
-                dst->workVerts.data());
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            // === 5)     VBO ( ,    VBO)
+            g_upload.Upload(dst->vbo, 0, dst->workVerts.data(),
+                (GLsizeiptr)(dst->workVerts.size() * sizeof(CST_Vertex)));
         }
     }
 
@@ -498,7 +514,8 @@ static GLuint g_chainsawShader = 0;
 
 inline void InitChainsawTest()
 {
-    g_chainsawShader = CreateShaderProgram("chainsaw_test.vert", "chainsaw_test.frag");
+    MemScope memTag(MEM_CHAINSAW);
+    if (!g_chainsawShader) g_chainsawShader = CreateShaderProgram("chainsaw_test.vert", "chainsaw_test.frag");
 
     if (!g_chainsawTest.Load("chainsaw.glb"))
         OutputDebugStringA("ChainsawTest: load failed\n");
@@ -506,25 +523,31 @@ inline void InitChainsawTest()
         OutputDebugStringA("ChainsawTest: load OK\n");
 }
 
+// -:  ; /      AnimateChainsawTest
 inline void UpdateChainsawTest(float dt)
 {
     DebugMoveTool(dt);
     if (g_currentTool != 3) return;
-    g_chainsawTest.Update(dt);
+    g_chainsawTime += dt;
+}
+
+//  ,   :     
+inline void AnimateChainsawTest(const SimSnapshot& rs)
+{
+    if (rs.tool != 3) return;
+    if (rs.chainsawTime > g_chainsawTest.t)
+        g_chainsawTest.Update(rs.chainsawTime - g_chainsawTest.t);
 }
 
 inline void DrawChainsawTestViewModel(const glm::mat4& proj, const glm::mat4& view)
 {
-    if (g_currentTool != 3) return;
+    ALLOC_SCOPE("DrawChainsawTestViewModel");
+    const SimSnapshot& rs = g_renderState;
+    if (rs.tool != 3) return;
     if (!g_chainsawShader || g_chainsawTest.meshes.empty()) return;
 
-    glUseProgram(g_chainsawShader);
-
-    glUniformMatrix4fv(glGetUniformLocation(g_chainsawShader, "uProjection"), 1, GL_FALSE, &proj[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(g_chainsawShader, "uView"), 1, GL_FALSE, &view[0][0]);
-
-    glm::vec3 lightDir = glm::normalize(glm::vec3(0.4f, 1.0f, 0.2f));
-    glUniform3fv(glGetUniformLocation(g_chainsawShader, "uLightDir"), 1, &lightDir[0]);
+    //       Frame (frame_ubo.h)
+    g_gl.UseProgram(g_chainsawShader);
 
     // viewmodel transform + sway
     glm::mat4 local(1.0f);
@@ -532,7 +555,7 @@ inline void DrawChainsawTestViewModel(const glm::mat4& proj, const glm::mat4& vi
     float swayX = sinf(g_chainsawTest.t * 2.0f) * 0.03f;
     float swayY = cosf(g_chainsawTest.t * 2.3f) * 0.02f;
 
-    local = glm::translate(local, g_toolOffset + glm::vec3(1.7799, -1.5826, -2.4089));
+    local = glm::translate(local, rs.toolOffset + glm::vec3(1.7799, -1.5826, -2.4089));
 
     local = glm::rotate(local, glm::radians((float)207.6271), glm::vec3(1, 0, 0));
     local = glm::rotate(local, glm::radians((float)68.5759), glm::vec3(0, 1, 0));
@@ -554,9 +577,9 @@ inline void DrawChainsawTestViewModel(const glm::mat4& proj, const glm::mat4& vi
     //    SCALE = 0.5745
 
 
-    if (g_cuttingTree)
+    if (rs.cuttingTree)
     {
-        float t = glm::clamp(g_cutTime / g_cutDuration, 0.0f, 1.0f);
+        float t = glm::clamp(rs.cutTime / g_cutDuration, 0.0f, 1.0f);
 
         // 0..1..0 ( -> )
         float pass = sin(t * 3.1415926f);
@@ -577,29 +600,36 @@ inline void DrawChainsawTestViewModel(const glm::mat4& proj, const glm::mat4& vi
     glm::mat4 camMatrix = glm::inverse(view);
     glm::mat4 model = camMatrix * local;
 
-    glUniformMatrix4fv(glGetUniformLocation(g_chainsawShader, "uModel"), 1, GL_FALSE, &model[0][0]);
+    glUniformMatrix4fv(UniformLoc(g_chainsawShader, "uModel"), 1, GL_FALSE, &model[0][0]);
 
     // viewmodel depth
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-    glDepthFunc(GL_LEQUAL);
-    glDepthRange(0.0, 0.1);
-
-    GLint locNode = glGetUniformLocation(g_chainsawShader, "uNode");
-    GLint locHasTex = glGetUniformLocation(g_chainsawShader, "uHasTex");
-    GLint locTex = glGetUniformLocation(g_chainsawShader, "uTex");
-    GLint locIsChain = glGetUniformLocation(g_chainsawShader, "uIsChain");
-    GLint locTime = glGetUniformLocation(g_chainsawShader, "uTime");
-    GLint locSpeed = glGetUniformLocation(g_chainsawShader, "uChainSpeed");
+    g_gl.Disable(GL_CULL_FACE);
+    g_gl.Enable(GL_DEPTH_TEST);
+    g_gl.DepthMask(GL_TRUE);
+    g_gl.DepthFunc(GL_LEQUAL);
+    g_gl.DepthRange(0.0, 0.1);
+
+    GLint locNode = UniformLoc(g_chainsawShader, "uNode");
+    GLint locHasTex = UniformLoc(g_chainsawShader, "uHasTex");
+    GLint locTex = UniformLoc(g_chainsawShader, "uTex");
+    GLint locIsChain = UniformLoc(g_chainsawShader, "uIsChain");
+    GLint locTime = UniformLoc(g_chainsawShader, "uTime");
+    GLint locSpeed = UniformLoc(g_chainsawShader, "uChainSpeed");
+
+    //   (      stride 0,   )
+    GLint locBoneStride = UniformLoc(g_chainsawShader, "uBoneStride");
+    if (g_chainsawTest.hasSkin)
+        g_chainsawTest.skinBuffer.Bind(g_chainsawShader, BONE_PALETTE_UNIT);
+    else if (locBoneStride >= 0)
+        glUniform1i(locBoneStride, 0);
 
     for (const auto& mesh : g_chainsawTest.meshes)
     {
         // texture
         if (mesh.baseTex)
         {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, mesh.baseTex);
+            g_gl.ActiveTexture(GL_TEXTURE0);
+            g_gl.BindTexture(GL_TEXTURE_2D, mesh.baseTex);
             if (locTex >= 0) glUniform1i(locTex, 0);
             if (locHasTex >= 0) glUniform1i(locHasTex, 1);
         }
@@ -608,13 +638,12 @@ inline void DrawChainsawTestViewModel(const glm::mat4& proj, const glm::mat4& vi
             if (locHasTex >= 0) glUniform1i(locHasTex, 0);
         }
 
-        // node
-        glm::mat4 nodeM = mesh.bindNode;
+        // node (skinned:    )
+        glm::mat4 nodeM = mesh.skinned ? glm::mat4(1.0f) : mesh.bindNode;
         if (locNode >= 0)
             glUniformMatrix4fv(locNode, 1, GL_FALSE, &nodeM[0][0]);
 
         // chain flag + time
-        std::string low = CST_ToLower(mesh.nodeName);
         int isChain = mesh.isChain ? 1 : 0;
 
         if (locIsChain >= 0) glUniform1i(locIsChain, isChain);
@@ -624,7 +653,7 @@ inline void DrawChainsawTestViewModel(const glm::mat4& proj, const glm::mat4& vi
         mesh.Draw();
     }
 
-    glDepthRange(0.0, 1.0);
+    g_gl.DepthRange(0.0, 1.0);
 }
 
 void StartCutAnimAt(const glm::vec3& worldPos)
@@ -643,15 +672,13 @@ void StartCutAnimAt(const glm::vec3& worldPos)
     // g_treeCutAnimModel.ResetAnimation();
 }
 
+// -:  ;     AnimateCutTree
 void UpdateCutAnim(float dt)
 {
     if (!g_cutAnim.active) return;
 
     g_cutAnim.t += dt;
 
-    //   
-    g_treeCutAnimModel.UpdateAnimation(dt);
-
     if (g_cutAnim.t >= g_cutAnim.duration)
     {
         g_cutAnim.active = false;
@@ -662,53 +689,50 @@ void UpdateCutAnim(float dt)
     }
 }
 
-void DrawCutAnim(const glm::mat4& proj, const glm::mat4& view)
+//  :        (+    GPU)
+void AnimateCutTree(const SimSnapshot& rs)
 {
-    if (!g_cutAnim.active) return;
-
-    GLint prevProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &prevProgram);
-
-    GLint prevVAO = 0;
-    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prevVAO);
+    static float shownTime = 0.0f;
+    if (!rs.cutAnimActive) return;
 
-    GLint prevActiveTex = 0;
-    glGetIntegerv(GL_ACTIVE_TEXTURE, &prevActiveTex);
+    //       
+    float dt = (rs.cutAnimTime >= shownTime) ? rs.cutAnimTime - shownTime : rs.cutAnimTime;
+    shownTime = rs.cutAnimTime;
+    if (dt <= 0.0f) return;
 
-    // () cull   /
-    GLboolean cullWas = glIsEnabled(GL_CULL_FACE);
-    glDisable(GL_CULL_FACE);
-
-    glUseProgram(g_cutShader);
-    glUniformMatrix4fv(glGetUniformLocation(g_cutShader, "uProjection"), 1, GL_FALSE, &proj[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(g_cutShader, "uView"), 1, GL_FALSE, &view[0][0]);
-
-    glUniform3f(glGetUniformLocation(g_cutShader, "uCamPos"), g_cam.pos.x, g_cam.pos.y, g_cam.pos.z);
-    glm::vec3 g_lightDir = glm::normalize(glm::vec3(0.4f, 1.0f, 0.2f));
-    glUniform3f(glGetUniformLocation(g_cutShader, "uLightDir"), g_lightDir.x, g_lightDir.y, g_lightDir.z);
+    g_treeCutAnimModel.UpdateAnimation(dt);
+    g_treeCutAnimModel.UploadSkinPalette();
+}
 
+void DrawCutAnim(const glm::mat4& proj, const glm::mat4& view)
+{
+    const SimSnapshot& rs = g_renderState;
+    if (!rs.cutAnimActive) return;
 
+    //   /   glGet:  
+    //  ,   ,  g_gl  
 
-    glUniform3f(glGetUniformLocation(g_cutShader, "uFogColor"), g_fogColor.x, g_fogColor.y, g_fogColor.z);
-    glUniform1f(glGetUniformLocation(g_cutShader, "uFogDensity"), g_fogDensity);
-    glUniform1i(glGetUniformLocation(g_cutShader, "uUnderwater"), g_underwater ? 1 : 0);
+    // () cull   /
+    g_gl.Disable(GL_CULL_FACE);
+    g_gl.Enable(GL_BLEND);
+    g_gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    g_gl.Enable(GL_DEPTH_TEST);
+    g_gl.DepthMask(GL_TRUE);
+    g_gl.DepthFunc(GL_LEQUAL);
+
+    // //    Frame    ,   
+    g_gl.UseProgram(g_cutShader);
     //  :
     //g_treeCutAnimModel.DrawWithAnimation(g_cutShader, world);
 
     glm::mat4 M(1.0f);
-    M = glm::translate(M, glm::vec3(g_cutAnim.pos.x, g_cutAnim.pos.y + 0.5, g_cutAnim.pos.z) );
+    M = glm::translate(M, glm::vec3(rs.cutAnimPos.x, rs.cutAnimPos.y + 0.5, rs.cutAnimPos.z) );
     M = glm::rotate(M, (float) - 1.1, glm::vec3(0, 1, 0));
-    M = glm::rotate(M, g_cutAnim.rot.x, glm::vec3(1, 0, 0));
-    M = glm::rotate(M, g_cutAnim.rot.z, glm::vec3(0, 0, 1));
+    M = glm::rotate(M, rs.cutAnimRot.x, glm::vec3(1, 0, 0));
+    M = glm::rotate(M, rs.cutAnimRot.z, glm::vec3(0, 0, 1));
     M = glm::scale(M, glm::vec3(0.2));
 
     g_treeCutAnimModel.DrawWithAnimation(g_cutShader, M);
-
-    // restore
-    if (cullWas) glEnable(GL_CULL_FACE);
-    glActiveTexture(prevActiveTex);
-    glBindVertexArray(prevVAO);
-    glUseProgram(prevProgram);
     
     ///*OFFSET = 0.8842, 1.2589, -3.1173
     //    ROT = -10.0000, 12.0000, 0.0000
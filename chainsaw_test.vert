@@ -6,29 +6,40 @@ layout(location = 2) in vec2 aTex;
 layout(location = 3) in ivec4 aBoneIds;
 layout(location = 4) in vec4 aWeights;
 
-uniform mat4 uProjection;
-uniform mat4 uView;
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
+
 uniform mat4 uModel;
 uniform mat4 uNode;              // <-- ВАЖНО: матрица узла (rigid animation)
 
-const int MAX_BONES = 128;
-uniform mat4 uBones[MAX_BONES];
+// палитра костей в texture buffer (см. skinning.h): блок = [world, кости...], следом матрицы нормалей
+uniform samplerBuffer uBonePalette;
+uniform int uBoneStride;
 
 out vec3 vNormal;
 out vec2 vTex;
 
+mat4 FetchPalette(int i)
+{
+    int b = i * 4;
+    return mat4(texelFetch(uBonePalette, b + 0),
+                texelFetch(uBonePalette, b + 1),
+                texelFetch(uBonePalette, b + 2),
+                texelFetch(uBonePalette, b + 3));
+}
+
 void main()
 {
     float wsum = aWeights.x + aWeights.y + aWeights.z + aWeights.w;
 
     mat4 skin = mat4(1.0);
-    if (wsum > 0.0001)
+    if (wsum > 0.0001 && uBoneStride > 1)
     {
+        int base = gl_InstanceID * uBoneStride + 1;
         skin =
-            aWeights.x * uBones[aBoneIds.x] +
-            aWeights.y * uBones[aBoneIds.y] +
-            aWeights.z * uBones[aBoneIds.z] +
-            aWeights.w * uBones[aBoneIds.w];
+            aWeights.x * FetchPalette(base + aBoneIds.x) +
+            aWeights.y * FetchPalette(base + aBoneIds.y) +
+            aWeights.z * FetchPalette(base + aBoneIds.z) +
+            aWeights.w * FetchPalette(base + aBoneIds.w);
     }
 
     vec4 localPos = skin * vec4(aPos, 1.0);
@@ -0,0 +1,24 @@
+﻿#pragma once
+// core_platform.h
+// Минимум платформы для CPU-ядра (heightfield.h, vegetation.h, anim_rig.h, mesh_import.h, jobs.h):
+// без windows.h и GL, чтобы ядро собиралось отдельно (bench_core.cpp, Linux).
+// В игре лог идёт в OutputDebugStringA, как и весь остальной.
+
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+// одна функция из kernel32 — объявляем сами, совпадает с объявлением в windows.h
+extern "C" __declspec(dllimport) void __stdcall OutputDebugStringA(const char* lpOutputString);
+#endif
+
+inline void CoreLog(const char* msg)
+{
+#ifdef _WIN32
+    OutputDebugStringA(msg);
+#else
+    fputs(msg, stderr);
+#endif
+}
+
+inline void CoreLog(const std::string& msg) { CoreLog(msg.c_str()); }
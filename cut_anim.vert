@@ -3,23 +3,65 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aUV;
+layout (location = 3) in ivec4 aBoneIds;
+layout (location = 4) in vec4 aWeights;
+
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
 
-uniform mat4 uProjection;
-uniform mat4 uView;
 uniform mat4 uModel;
+uniform mat4 uModelNormal;   // inverseTranspose(uModel), считает CPU
+
+// скиннинг: палитра в texture buffer, блок инстанса = [world, кости...] и столько же
+// обратных-транспонированных для нормалей (skinning.h)
+uniform int uSkinned;
+uniform samplerBuffer uBonePalette;
+uniform int uBoneStride;
 
 out vec3 vNormal;
 out vec3 vWorldPos;
 out vec2 vTex;
 
+mat4 FetchPalette(int i)
+{
+    int b = i * 4;
+    return mat4(texelFetch(uBonePalette, b + 0),
+                texelFetch(uBonePalette, b + 1),
+                texelFetch(uBonePalette, b + 2),
+                texelFetch(uBonePalette, b + 3));
+}
+
 void main()
 {
-    vec4 worldPos = uModel * vec4(aPos, 1.0);
+    mat4 M = uModel;
+    mat3 N = mat3(uModelNormal);
+
+    if (uSkinned == 1)
+    {
+        int base = gl_InstanceID * uBoneStride;
+        mat4 skin =
+            aWeights.x * FetchPalette(base + 1 + aBoneIds.x) +
+            aWeights.y * FetchPalette(base + 1 + aBoneIds.y) +
+            aWeights.z * FetchPalette(base + 1 + aBoneIds.z) +
+            aWeights.w * FetchPalette(base + 1 + aBoneIds.w);
+
+        M = uModel * FetchPalette(base) * skin;
+
+        // нормали — тем же весам, но по готовым обратным-транспонированным костей
+        int nbase = base + uBoneStride / 2;
+        mat4 skinN =
+            aWeights.x * FetchPalette(nbase + 1 + aBoneIds.x) +
+            aWeights.y * FetchPalette(nbase + 1 + aBoneIds.y) +
+            aWeights.z * FetchPalette(nbase + 1 + aBoneIds.z) +
+            aWeights.w * FetchPalette(nbase + 1 + aBoneIds.w);
+
+        N = N * mat3(FetchPalette(nbase)) * mat3(skinN);
+    }
+
+    vec4 worldPos = M * vec4(aPos, 1.0);
     vWorldPos = worldPos.xyz;
 
-    // нормали с учётом масштаба/поворота
-    vNormal = mat3(transpose(inverse(uModel))) * aNormal;
+    vNormal = normalize(N * aNormal);
 
     vTex = aUV;
     gl_Position = uProjection * uView * worldPos;
-}
\ No newline at end of file
+}
@@ -0,0 +1,29 @@
+// depth_prepass.frag
+// Depth-only проход для террейна / деревьев / травы.
+// Вершинник берётся родной (terrain.vert, tree_mesh.vert, grass.vert),
+// здесь только альфа-тест. Без ALPHA_TEST шейдер пустой — чистый early-z.
+#version 330 core
+
+#ifdef ALPHA_TEST
+in vec2 vTex;
+in vec3 vWorldPos;
+
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
+
+uniform sampler2D uTex;
+uniform float uAlphaCut;   // 0.2 деревья, 0.3 трава
+uniform int   uFlipV;      // деревья: uv.y перевёрнут
+uniform float uMaxDist;    // дальность леса (трава: очень много)
+#endif
+
+void main()
+{
+#ifdef ALPHA_TEST
+    vec2 uv = (uFlipV == 1) ? vec2(vTex.x, 1.0 - vTex.y) : vTex;
+    if (texture(uTex, uv).a < uAlphaCut)
+        discard;
+
+    if (length(uCamPos - vWorldPos) > uMaxDist)
+        discard;
+#endif
+}
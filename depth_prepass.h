@@ -0,0 +1,105 @@
+﻿#pragma once
+// depth_prepass.h
+// Depth pre-pass для террейна, деревьев и травы.
+// 1) depth-only: те же вершинники + depth_prepass.frag (только альфа-тест), цвет не пишем
+// 2) цветовой проход: GL_EQUAL, без записи глубины, варианты шейдеров без discard
+//    (без ALPHA_TEST, shader_variants.h) — тяжёлый фрагментник (свет, туман) считается раз на пиксель.
+// Вкл/выкл: клавиша P, "-bench flythrough noprepass" для замера без него.
+
+bool g_depthPrepass = true;
+
+GLuint g_terrainDepthShader = 0;   // terrain.vert + пустой фрагментник
+GLuint g_treeDepthShader = 0;      // tree_mesh.vert + альфа-тест
+GLuint g_grassDepthShader = 0;     // grass.vert + альфа-тест
+
+GLuint g_treeShaderPrepassed = 0;  // tree_mesh без discard (выбирает SelectWorldVariants)
+GLuint g_grassShaderPrepassed = 0; // grass без discard
+
+// зовётся из LoadShaders (вместе со всеми) или из InitDepthPrepass
+void LoadDepthPrepassShaders()
+{
+    if (!g_terrainDepthShader)
+        g_terrainDepthShader = CreateShaderProgram("terrain.vert", "depth_prepass.frag");
+    if (!g_treeDepthShader)
+        g_treeDepthShader = CreateShaderProgram("tree_mesh.vert", "depth_prepass.frag", ShaderVariantDefines(SV_ALPHA_TEST | SV_INSTANCED).c_str());
+    if (!g_grassDepthShader)
+        g_grassDepthShader = CreateShaderProgram("grass.vert", "depth_prepass.frag", ShaderVariantDefines(SV_ALPHA_TEST).c_str());
+}
+
+void InitDepthPrepass()
+{
+    LoadDepthPrepassShaders();
+
+    // постоянные uniform'ы
+    glm::mat4 I(1.0f);
+    g_gl.UseProgram(g_terrainDepthShader);
+    glUniformMatrix4fv(UniformLoc(g_terrainDepthShader, "uModel"), 1, GL_FALSE, &I[0][0]);
+
+    g_gl.UseProgram(g_treeDepthShader);
+    glUniform1f(UniformLoc(g_treeDepthShader, "uAlphaCut"), 0.2f);
+    glUniform1i(UniformLoc(g_treeDepthShader, "uFlipV"), 1);
+    glUniform1f(UniformLoc(g_treeDepthShader, "uMaxDist"), 250.0f); // как в SetupTreeVariant
+
+    g_gl.UseProgram(g_grassDepthShader);
+    glUniform1f(UniformLoc(g_grassDepthShader, "uAlphaCut"), 0.3f);
+    glUniform1i(UniformLoc(g_grassDepthShader, "uFlipV"), 0);
+    glUniform1f(UniformLoc(g_grassDepthShader, "uMaxDist"), 1.0e9f);
+
+    g_gl.UseProgram(0);
+
+    if (!g_terrainDepthShader || !g_treeDepthShader || !g_grassDepthShader)
+    {
+        OutputDebugStringA("DepthPrepass: shaders failed, pre-pass disabled\n");
+        g_depthPrepass = false;
+    }
+}
+
+// общее состояние depth-only прохода (ColorMask ставит Render)
+inline void BeginDepthOnly(bool cull)
+{
+    g_gl.Disable(GL_BLEND);
+    g_gl.Enable(GL_DEPTH_TEST);
+    g_gl.DepthMask(GL_TRUE);
+    g_gl.DepthFunc(GL_LEQUAL);
+    if (cull) g_gl.Enable(GL_CULL_FACE);
+    else      g_gl.Disable(GL_CULL_FACE);
+}
+
+// цветовой проход для того, что уже лежит в глубине
+inline void BeginPrepassedColor()
+{
+    g_gl.Enable(GL_DEPTH_TEST);
+    g_gl.DepthMask(GL_FALSE);
+    g_gl.DepthFunc(GL_EQUAL);
+}
+
+void DrawTerrainDepth()
+{
+    g_gl.UseProgram(g_terrainDepthShader);
+    BeginDepthOnly(true);
+    g_terrain.draw();
+}
+
+void DrawTreesDepth()
+{
+    if (g_treeModel.meshes.empty() || g_treeInstanceCount == 0) return;
+
+    g_gl.UseProgram(g_treeDepthShader);
+    BeginDepthOnly(false);   // двухсторонние листья
+    g_treeModel.DrawInstanced(g_treeDepthShader, g_treeInstanceCount);
+}
+
+void DrawGrassDepth()
+{
+    if (!g_grassVAO || !g_grassTex || g_grassAliveCount == 0) return;
+
+    g_gl.UseProgram(g_grassDepthShader);
+    BeginDepthOnly(false);
+
+    g_gl.ActiveTexture(GL_TEXTURE0);
+    g_gl.BindTexture(GL_TEXTURE_2D, g_grassTex);
+
+    g_gl.BindVertexArray(g_grassVAO);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, g_grassAliveCount);
+    ProfDraw(GL_TRIANGLE_STRIP, 4, g_grassAliveCount);
+}
@@ -0,0 +1,147 @@
+﻿#pragma once
+// dynres.h
+// Динамическое разрешение мира. g_sceneFBO выделен под окно, мир рисуется в его
+// левый нижний угол размером scale * окно; пост-проход растягивает на экран
+// (билинейно + лёгкий шарпен, пока scale < 1). Вьюмодели рисуются после поста — в родном.
+//
+// scale ведёт контроллер по GPU-времени кадра (пара timestamp query, читаем с задержкой,
+// не дожидаясь GPU — с TIME_ELAPSED зон profiler.h не конфликтуют):
+//   сглаженное время выше бюджета  — сразу шаг вниз;
+//   долго ниже budget * upThreshold — шаг вверх (гистерезис, чтобы не дёргалось).
+// Фиксированный масштаб (для замеров): "-resscale 0.75"; под -bench по умолчанию 1.0.
+
+#include <sstream>
+#include <string>
+#include <algorithm>
+
+const int DYNRES_QUERIES = 4;   // кольцо кадров в полёте
+
+struct DynResState
+{
+    float scale = 1.0f;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float step = 0.05f;
+    float fixedScale = 0.0f;        // > 0 — контроллер выключен
+
+    double budgetMs = 14.0;         // цель по GPU (мир + пост), запас под 60 Гц
+    double upThreshold = 0.80;      // ниже budget * 0.8 — кандидат на повышение
+    int upFrames = 60;              // ...столько кадров подряд
+    int fastStreak = 0;
+    int cooldown = 0;               // после смены: старые query ещё со старым scale
+    double gpuMs = 0.0;             // сглаженное
+
+    float sharpen = 0.25f;          // сила шарпена при апскейле
+
+    GLuint queries[DYNRES_QUERIES][2] = {};
+    bool pending[DYNRES_QUERIES] = {};
+    int index = 0;
+};
+
+DynResState g_dynRes;
+
+// "-resscale <0.5..1>" — фиксированный масштаб; бенч без него тоже фиксирован (1.0)
+void DynResInit(const char* cmdLine)
+{
+    if (cmdLine)
+    {
+        std::istringstream ss(cmdLine);
+        std::string tok;
+        while (ss >> tok)
+        {
+            if (tok == "-resscale")
+            {
+                float s = 0.0f;
+                if (ss >> s) g_dynRes.fixedScale = std::max(0.1f, std::min(1.0f, s));
+            }
+        }
+    }
+
+    if (g_dynRes.fixedScale <= 0.0f && g_bench.mode != BENCH_NONE)
+        g_dynRes.fixedScale = 1.0f;
+
+    if (g_dynRes.fixedScale > 0.0f)
+        g_dynRes.scale = g_dynRes.fixedScale;
+}
+
+// размер прямоугольника мира в g_sceneFBO на этот кадр
+inline void DynResViewport(int& w, int& h)
+{
+    w = std::max(1, (int)(g_winWidth * g_dynRes.scale + 0.5f));
+    h = std::max(1, (int)(g_winHeight * g_dynRes.scale + 0.5f));
+}
+
+// контроллер: одно новое измерение GPU-времени кадра
+void DynResFeed(double ms)
+{
+    DynResState& d = g_dynRes;
+    d.gpuMs = (d.gpuMs <= 0.0) ? ms : d.gpuMs * 0.9 + ms * 0.1;
+
+    if (d.fixedScale > 0.0f) return;
+    if (d.cooldown > 0) { --d.cooldown; return; }
+
+    float newScale = d.scale;
+    if (d.gpuMs > d.budgetMs)
+    {
+        newScale = d.scale - d.step;
+        d.fastStreak = 0;
+    }
+    else if (d.gpuMs < d.budgetMs * d.upThreshold)
+    {
+        if (++d.fastStreak >= d.upFrames)
+        {
+            newScale = d.scale + d.step;
+            d.fastStreak = 0;
+        }
+    }
+    else
+    {
+        d.fastStreak = 0;
+    }
+
+    newScale = std::max(d.minScale, std::min(d.maxScale, newScale));
+    if (newScale != d.scale)
+    {
+        d.scale = newScale;
+        d.cooldown = DYNRES_QUERIES * 2;
+        // сглаживание заново: старое время было при другом scale
+        d.gpuMs = 0.0;
+    }
+}
+
+// начало GPU-кадра (до неба)
+void DynResGpuBegin()
+{
+    DynResState& d = g_dynRes;
+    if (!d.queries[0][0])
+        glGenQueries(DYNRES_QUERIES * 2, &d.queries[0][0]);
+
+    int i = d.index;
+    if (d.pending[i])
+    {
+        // слот записан DYNRES_QUERIES кадров назад; если GPU всё ещё не дошёл — пропускаем замер
+        GLint ready = 0;
+        glGetQueryObjectiv(d.queries[i][1], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (ready)
+        {
+            GLuint64 t0 = 0, t1 = 0;
+            glGetQueryObjectui64v(d.queries[i][0], GL_QUERY_RESULT, &t0);
+            glGetQueryObjectui64v(d.queries[i][1], GL_QUERY_RESULT, &t1);
+            DynResFeed(double(t1 - t0) * 1e-6);
+        }
+        d.pending[i] = false;
+    }
+
+    glQueryCounter(d.queries[i][0], GL_TIMESTAMP);
+}
+
+// конец GPU-кадра (после пост-прохода)
+void DynResGpuEnd()
+{
+    DynResState& d = g_dynRes;
+    if (!d.queries[0][0]) return;
+
+    glQueryCounter(d.queries[d.index][1], GL_TIMESTAMP);
+    d.pending[d.index] = true;
+    d.index = (d.index + 1) % DYNRES_QUERIES;
+}
@@ -0,0 +1,64 @@
+// fog.glsl
+// Туман мира — один раз на пиксель в пост-проходе (screen_post.frag), по глубине сцены.
+// Материалы (террейн, трава, деревья) туман больше не считают.
+#include "frame.glsl"
+#include "sky.glsl"
+
+uniform sampler2D uSceneDepth;   // глубина мира; вода пишет её только над водой
+
+// дистанция от камеры до точки по глубине из depth-текстуры (перспектива без inverse):
+// z_view = P[3][2] / (-ndc.z - P[2][2]), x/y — через фокусные P[0][0] / P[1][1]
+float SceneDistance(vec2 uv, float depth)
+{
+    vec3 ndc = vec3(uv, depth) * 2.0 - 1.0;
+    float z = uProjection[3][2] / (-ndc.z - uProjection[2][2]);
+    vec2 xy = ndc.xy * (-z) / vec2(uProjection[0][0], uProjection[1][1]);
+    return length(vec3(xy, z));
+}
+
+// глубина вдоль взгляда (положительная) — для сравнения глубин в апскейле воды
+float SceneViewDepth(float depth)
+{
+    return uProjection[3][2] / (depth * 2.0 - 1.0 + uProjection[2][2]);
+}
+
+// направление взгляда в мире для экранных uv
+vec3 ViewDirFromUV(vec2 uv)
+{
+    vec2 ndc = uv * 2.0 - 1.0;
+    vec3 v = vec3(ndc.x / uProjection[0][0], ndc.y / uProjection[1][1], -1.0);
+    return normalize(transpose(mat3(uView)) * v);
+}
+
+// над водой туман — цвет неба у горизонта в ту же сторону (sky-view LUT), под водой — свой
+vec3 FogColor(vec2 uv)
+{
+    if (uUnderwater == 1)
+        return uFogColor;
+
+    vec3 dir = ViewDirFromUV(uv);
+    return SkyColor(normalize(vec3(dir.x, max(dir.y, 0.0) + 1e-3, dir.z)));
+}
+
+// туман по готовой дистанции (вода из половинки приносит свою)
+vec3 ApplyFog(vec3 color, float dist, vec2 uv)
+{
+    float fogFactor = clamp(1.0 - exp(-uFogDensity * dist), 0.0, 1.0);
+    color = mix(color, FogColor(uv), fogFactor);
+
+    // чуть приглушим свет под водой
+    if (uUnderwater == 1)
+        color *= 0.85;
+    return color;
+}
+
+// uv — экранные 0..1 (для дистанции), sceneUV — где этот пиксель лежит в FBO
+// (динамическое разрешение: мир занимает только часть текстуры)
+vec3 ApplySceneFog(vec3 color, vec2 uv, vec2 sceneUV)
+{
+    float depth = texture(uSceneDepth, sceneUV).r;
+    if (depth >= 1.0)
+        return color;   // небо: туман не трогает
+
+    return ApplyFog(color, SceneDistance(uv, depth), uv);
+}
@@ -0,0 +1,12 @@
+// frame.glsl
+// Общие константы кадра (frame_ubo.h, struct FrameConstants).
+// Подключается через #include "frame.glsl" — препроцессор в CreateShaderProgram
+// вставляет файл один раз, даже если его тянут и сам шейдер, и fog.glsl / lighting.glsl.
+layout(std140) uniform Frame
+{
+    mat4  uProjection;
+    mat4  uView;
+    vec3  uCamPos;    float uTime;
+    vec3  uLightDir;  float uFogDensity;
+    vec3  uFogColor;  int   uUnderwater;
+};
@@ -0,0 +1,194 @@
+﻿#pragma once
+// frame_arena.h
+// Линейная арена под временные буферы кадра (тика): выделение — сдвиг указателя,
+// освобождение — Reset() целиком в конце кадра. Блоки остаются за ареной, так что
+// в установившемся режиме куча не трогается вовсе.
+//
+//   ArenaVector<glm::vec4> data;            // в арене текущего потока
+//   CollectGrassInstanceData(grass, data);  // core-функции принимают любой вектор
+//
+// Арена у каждого потока своя (thread_local), сбрасывает её хозяин:
+//   рендер — после кадра, сим — после тика (FrameArenaEndFrame).
+// Данные, уехавшие командой в g_gpuCommands, живут в арене сима, пока рендер их не
+// исполнит и пока их заливка идёт кусками (stream_upload.h): сброс откладывается, пока
+// не пусты обе очереди (см. вызовы FrameArenaEndFrame).
+// Освобождение из чужого потока (команда умерла у рендера) — пустое, память вернёт Reset.
+// Копия ArenaVector уходит в арену того потока, который копирует.
+
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <algorithm>
+
+#include "mem_track.h"
+
+class FrameArena
+{
+public:
+    static constexpr size_t DEFAULT_BLOCK = 1u << 20;
+    static constexpr size_t KEEP_BYTES = 64u << 20;   // больше — на Reset отдаём обратно в кучу
+    static constexpr size_t GROW_LIMIT = 16u << 20;
+
+    FrameArena() = default;
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    ~FrameArena()
+    {
+        for (Block& b : blocks) std::free(b.data);
+        MemSetCpu(this, 0, MEM_SCRATCH);
+    }
+
+    void* Alloc(size_t bytes, size_t align)
+    {
+        if (bytes == 0) bytes = 1;
+        for (;;)
+        {
+            if (current < blocks.size())
+            {
+                Block& b = blocks[current];
+                size_t at = (used + align - 1) & ~(align - 1);
+                if (at + bytes <= b.size)
+                {
+                    last = at;
+                    used = at + bytes;
+                    frameBytes += bytes;
+                    peakBytes = std::max(peakBytes, frameBytes);
+                    return b.data + at;
+                }
+                // не влезло — в следующий блок (хвост этого пропадает до Reset)
+                if (current + 1 < blocks.size())
+                {
+                    ++current;
+                    used = 0;
+                    continue;
+                }
+            }
+            Grow(bytes + align);
+        }
+    }
+
+    // последнее выделение можно вернуть сразу (временный вектор, умерший в той же функции)
+    void Free(void* p, size_t bytes)
+    {
+        if (current >= blocks.size() || !p) return;
+        Block& b = blocks[current];
+        if ((char*)p == b.data + last && last + bytes == used)
+            used = last;
+    }
+
+    // конец кадра: всё выделенное недействительно. Если кадр не влез в один блок —
+    // склеиваем в один (в следующий раз влезет), но не держим больше KEEP_BYTES
+    void Reset()
+    {
+        if (blocks.size() > 1 || (!blocks.empty() && blocks[0].size > KEEP_BYTES))
+        {
+            size_t total = 0;
+            for (Block& b : blocks) { total += b.size; std::free(b.data); }
+            blocks.clear();
+            if (total <= KEEP_BYTES) AddBlock(total);
+        }
+        current = 0;
+        used = last = 0;
+        frameBytes = 0;
+        TrackCapacity();
+    }
+
+    size_t Capacity() const
+    {
+        size_t total = 0;
+        for (const Block& b : blocks) total += b.size;
+        return total;
+    }
+
+    size_t FrameBytes() const { return frameBytes; }
+    size_t PeakBytes() const { return peakBytes; }
+
+private:
+    struct Block { char* data; size_t size; };
+
+    void AddBlock(size_t size)
+    {
+        Block b{ (char*)std::malloc(size), size };
+        if (!b.data) throw std::bad_alloc();
+        blocks.push_back(b);
+    }
+
+    void Grow(size_t need)
+    {
+        // удвоение, но крупные (вершины террейна) — ровно по запросу
+        size_t grow = blocks.empty() ? DEFAULT_BLOCK : std::min(blocks.back().size * 2, GROW_LIMIT);
+        size_t size = std::max(need, grow);
+        AddBlock(size);
+        current = blocks.size() - 1;
+        used = last = 0;
+        TrackCapacity();
+    }
+
+    void TrackCapacity()
+    {
+        size_t cap = Capacity();
+        if (cap != trackedCapacity)
+        {
+            MemSetCpu(this, cap, MEM_SCRATCH);
+            trackedCapacity = cap;
+        }
+    }
+
+    std::vector<Block> blocks;
+    size_t current = 0;       // блок, в который пишем
+    size_t used = 0;          // занято в нём
+    size_t last = 0;          // начало последнего выделения (для Free)
+    size_t frameBytes = 0;
+    size_t peakBytes = 0;
+    size_t trackedCapacity = 0;
+};
+
+inline FrameArena& FrameScratch()
+{
+    thread_local FrameArena arena;
+    return arena;
+}
+
+// аллокатор на арену потока, в котором создан
+template <typename T>
+struct ArenaAllocator
+{
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    FrameArena* arena;
+
+    ArenaAllocator() : arena(&FrameScratch()) {}
+    template <typename U> ArenaAllocator(const ArenaAllocator<U>& o) : arena(o.arena) {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(arena->Alloc(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        if (arena == &FrameScratch())
+            arena->Free(p, n * sizeof(T));
+    }
+
+    // копия — в арену копирующего потока
+    ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+    template <typename U> bool operator==(const ArenaAllocator<U>& o) const { return arena == o.arena; }
+    template <typename U> bool operator!=(const ArenaAllocator<U>& o) const { return arena != o.arena; }
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// конец кадра / тика. canReset = false — арену ещё читают (команды в очереди)
+inline void FrameArenaEndFrame(bool canReset)
+{
+    if (canReset)
+        FrameScratch().Reset();
+}
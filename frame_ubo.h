@@ -0,0 +1,50 @@
+﻿#pragma once
+// frame_ubo.h
+// Общие константы кадра в одном std140 uniform-буфере.
+// Заливаются один раз за кадр, все программы видят их через блок "Frame"
+// (биндинг FRAME_UBO_BINDING, см. ReflectProgram).
+//
+// В шейдерах — #include "frame.glsl":
+//   layout(std140) uniform Frame
+//   {
+//       mat4  uProjection;
+//       mat4  uView;
+//       vec3  uCamPos;     float uTime;
+//       vec3  uLightDir;   float uFogDensity;
+//       vec3  uFogColor;   int   uUnderwater;
+//   };
+
+#include <glm/glm.hpp>
+
+// раскладка совпадает с std140: vec3 + скаляр укладываются в 16 байт
+struct FrameConstants
+{
+    glm::mat4 proj;
+    glm::mat4 view;
+    glm::vec3 camPos;    float time;
+    glm::vec3 lightDir;  float fogDensity;
+    glm::vec3 fogColor;  int   underwater;
+};
+static_assert(sizeof(FrameConstants) == 176, "FrameConstants must match std140 block Frame");
+
+GLuint g_frameUBO = 0;
+
+void InitFrameUBO()
+{
+    if (!g_frameUBO) glGenBuffers(1, &g_frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, g_frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), nullptr, GL_DYNAMIC_DRAW);
+    MemGpuBuffer(g_frameUBO, sizeof(FrameConstants), MEM_STREAMING);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // биндинг постоянный — больше его не трогаем
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UBO_BINDING, g_frameUBO);
+}
+
+void UpdateFrameUBO(const FrameConstants& fc)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, g_frameUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &fc);
+    CountGpuUpload(sizeof(FrameConstants));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
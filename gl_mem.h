@@ -0,0 +1,57 @@
+﻿#pragma once
+// gl_mem.h
+// GL-сторона mem_track.h: размеры буферов и текстур по тем же параметрам, что ушли в GL.
+// Зовётся рядом с glBufferData / glTexImage2D (как CountGpuUpload) и с glDelete*.
+// Размер — оценка: драйвер выравнивает и может держать копии, но для бюджетов хватает.
+
+#include "mem_track.h"
+
+// байт на тексель по внутреннему формату (то, что в проекте встречается)
+inline size_t GLTexelBytes(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_R8:                 return 1;
+    case GL_RG8:                return 2;
+    case GL_R16F:               return 2;
+    case GL_RGB:
+    case GL_RGB8:               return 3;
+    case GL_RGBA:
+    case GL_RGBA8:
+    case GL_R32F:
+    case GL_RG16F:
+    case GL_R11F_G11F_B10F:
+    case GL_DEPTH_COMPONENT24:  // на деле 32 бита
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH_COMPONENT32F: return 4;
+    case GL_RGBA16F:
+    case GL_RG32F:              return 8;
+    case GL_RGB16F:             return 6;
+    case GL_RGBA32F:            return 16;
+    case GL_RGB32F:             return 12;
+    default:                    return 4;
+    }
+}
+
+inline void MemGpuBuffer(GLuint buffer, size_t bytes, MemTag tag = MemCurrentTag())
+{
+    MemSetGpu(MEM_KIND_BUFFER, buffer, bytes, tag);
+}
+
+// mipmaps — вся цепочка (glGenerateMipmap): +1/3
+inline void MemGpuTexture(GLuint tex, GLenum internalFormat, int w, int h, bool mipmaps = false, MemTag tag = MemCurrentTag())
+{
+    size_t bytes = (size_t)w * h * GLTexelBytes(internalFormat);
+    if (mipmaps) bytes += bytes / 3;
+    MemSetGpu(MEM_KIND_TEXTURE, tex, bytes, tag);
+}
+
+inline void MemGpuDeleteBuffers(GLsizei n, const GLuint* names)
+{
+    for (GLsizei i = 0; i < n; ++i) MemReleaseGpu(MEM_KIND_BUFFER, names[i]);
+}
+
+inline void MemGpuDeleteTextures(GLsizei n, const GLuint* names)
+{
+    for (GLsizei i = 0; i < n; ++i) MemReleaseGpu(MEM_KIND_TEXTURE, names[i]);
+}
@@ -0,0 +1,234 @@
+﻿#pragma once
+// gl_state.h
+// Теневая копия GL-состояния: программа, VAO, текстуры по юнитам,
+// blend / depth / cull / depth range / color mask.
+// Весь рендер зовёт g_gl.* вместо gl*: если значение не меняется — вызов
+// в драйвер не уходит. Драйвер НИКОГДА не опрашиваем (никаких glGet/glIsEnabled),
+// поэтому всё, что меняет это состояние, обязано идти через g_gl
+// (и удаление текстур тоже — g_gl.DeleteTextures).
+
+struct GLStateStats
+{
+    unsigned issued = 0;     // ушло в драйвер за кадр
+    unsigned skipped = 0;    // отброшено как no-op
+};
+
+struct GLStateCache
+{
+    static const int MAX_UNITS = 16;
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    GLuint program;
+    GLuint vao;
+    GLenum activeUnit;                 // индекс юнита (0..MAX_UNITS-1)
+    GLuint tex2D[MAX_UNITS];
+    GLuint texBuffer[MAX_UNITS];
+
+    int blend, depthTest, cullFace;    // -1 = неизвестно
+    int depthMask;
+    int colorMask;                     // RGBA вместе: 1 = пишем цвет
+    GLenum depthFunc;
+    GLenum blendSrc, blendDst;
+    GLenum blendSrcAlpha, blendDstAlpha;
+    GLenum cullMode, frontFace;
+    double depthNear, depthFar;
+
+    GLStateStats frame;                // текущий кадр
+    GLStateStats last;                 // прошлый кадр (для отладки)
+
+    GLStateCache() { Invalidate(); }
+
+    // всё в "неизвестно": следующий вызов каждой функции гарантированно уйдёт в драйвер
+    void Invalidate()
+    {
+        program = vao = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (int i = 0; i < MAX_UNITS; ++i)
+            tex2D[i] = texBuffer[i] = UNKNOWN;
+
+        blend = depthTest = cullFace = depthMask = colorMask = -1;
+        depthFunc = blendSrc = blendDst = blendSrcAlpha = blendDstAlpha = cullMode = frontFace = UNKNOWN;
+        depthNear = depthFar = -1.0;
+    }
+
+    bool Skip(bool same)
+    {
+        if (same) { ++frame.skipped; return true; }
+        ++frame.issued;
+        return false;
+    }
+
+    void UseProgram(GLuint p)
+    {
+        if (Skip(program == p)) return;
+        program = p;
+        glUseProgram(p);
+    }
+
+    void BindVertexArray(GLuint v)
+    {
+        if (Skip(vao == v)) return;
+        vao = v;
+        glBindVertexArray(v);
+    }
+
+    // unit = GL_TEXTURE0 + i, как у glActiveTexture
+    void ActiveTexture(GLenum unit)
+    {
+        GLenum idx = unit - GL_TEXTURE0;
+        if (Skip(activeUnit == idx)) return;
+        activeUnit = idx;
+        glActiveTexture(unit);
+    }
+
+    // на текущий активный юнит
+    void BindTexture(GLenum target, GLuint tex)
+    {
+        GLuint* slot = nullptr;
+        if (activeUnit < (GLenum)MAX_UNITS)
+        {
+            if (target == GL_TEXTURE_2D) slot = &tex2D[activeUnit];
+            else if (target == GL_TEXTURE_BUFFER) slot = &texBuffer[activeUnit];
+        }
+
+        if (slot)
+        {
+            if (Skip(*slot == tex)) return;
+            *slot = tex;
+        }
+        else
+        {
+            ++frame.issued;   // неотслеживаемый таргет/юнит — просто пропускаем в драйвер
+        }
+        glBindTexture(target, tex);
+    }
+
+    // юнит + бинд одной строкой
+    void BindTexture(GLenum unit, GLenum target, GLuint tex)
+    {
+        ActiveTexture(unit);
+        BindTexture(target, tex);
+    }
+
+    // GL часто тут же отдаёт удалённое имя новой текстуре: слоты с ним — в "неизвестно",
+    // иначе бинд новой отбросится как повторный
+    void DeleteTextures(GLsizei n, const GLuint* names)
+    {
+        for (GLsizei k = 0; k < n; ++k)
+            for (int i = 0; i < MAX_UNITS; ++i)
+            {
+                if (tex2D[i] == names[k]) tex2D[i] = UNKNOWN;
+                if (texBuffer[i] == names[k]) texBuffer[i] = UNKNOWN;
+            }
+        glDeleteTextures(n, names);
+    }
+
+    void Enable(GLenum cap)  { SetCap(cap, true); }
+    void Disable(GLenum cap) { SetCap(cap, false); }
+
+    void SetCap(GLenum cap, bool on)
+    {
+        int* slot = nullptr;
+        if (cap == GL_BLEND) slot = &blend;
+        else if (cap == GL_DEPTH_TEST) slot = &depthTest;
+        else if (cap == GL_CULL_FACE) slot = &cullFace;
+
+        if (slot)
+        {
+            if (Skip(*slot == (on ? 1 : 0))) return;
+            *slot = on ? 1 : 0;
+        }
+        else
+        {
+            ++frame.issued;
+        }
+
+        if (on) glEnable(cap);
+        else    glDisable(cap);
+    }
+
+    void DepthMask(GLboolean m)
+    {
+        int v = m ? 1 : 0;
+        if (Skip(depthMask == v)) return;
+        depthMask = v;
+        glDepthMask(m);
+    }
+
+    void ColorMask(bool on)
+    {
+        int v = on ? 1 : 0;
+        if (Skip(colorMask == v)) return;
+        colorMask = v;
+        GLboolean b = on ? GL_TRUE : GL_FALSE;
+        glColorMask(b, b, b, b);
+    }
+
+    void DepthFunc(GLenum f)
+    {
+        if (Skip(depthFunc == f)) return;
+        depthFunc = f;
+        glDepthFunc(f);
+    }
+
+    void BlendFunc(GLenum src, GLenum dst)
+    {
+        if (Skip(blendSrc == src && blendDst == dst && blendSrcAlpha == src && blendDstAlpha == dst)) return;
+        blendSrc = blendSrcAlpha = src;
+        blendDst = blendDstAlpha = dst;
+        glBlendFunc(src, dst);
+    }
+
+    // альфа отдельно (premultiplied в offscreen-буфер, water_halfres.h)
+    void BlendFuncSeparate(GLenum src, GLenum dst, GLenum srcAlpha, GLenum dstAlpha)
+    {
+        if (Skip(blendSrc == src && blendDst == dst && blendSrcAlpha == srcAlpha && blendDstAlpha == dstAlpha)) return;
+        blendSrc = src;
+        blendDst = dst;
+        blendSrcAlpha = srcAlpha;
+        blendDstAlpha = dstAlpha;
+        glBlendFuncSeparate(src, dst, srcAlpha, dstAlpha);
+    }
+
+    void CullFace(GLenum mode)
+    {
+        if (Skip(cullMode == mode)) return;
+        cullMode = mode;
+        glCullFace(mode);
+    }
+
+    void FrontFace(GLenum mode)
+    {
+        if (Skip(frontFace == mode)) return;
+        frontFace = mode;
+        glFrontFace(mode);
+    }
+
+    void DepthRange(double n, double f)
+    {
+        if (Skip(depthNear == n && depthFar == f)) return;
+        depthNear = n;
+        depthFar = f;
+        glDepthRange(n, f);
+    }
+
+    // конец кадра: запоминаем счётчики, в debug раз в ~5 секунд пишем в лог
+    void EndFrame()
+    {
+        last = frame;
+        frame = GLStateStats();
+
+#ifdef _DEBUG
+        static int frames = 0;
+        if (++frames >= 300)
+        {
+            frames = 0;
+            char buf[128];
+            sprintf_s(buf, "GLState: issued %u, skipped %u per frame\n", last.issued, last.skipped);
+            OutputDebugStringA(buf);
+        }
+#endif
+    }
+};
+
+GLStateCache g_gl;
@@ -6,30 +6,23 @@ out vec4 FragColor;
 
 uniform sampler2D uGrassTex;
 
-// туман
-uniform vec3 uCamPos;
-uniform int  uUnderwater;
-uniform vec3 uFogColor;
-uniform float uFogDensity;
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
 
 void main()
 {
     vec4 tex = texture(uGrassTex, vTex);
 
+    // после depth pre-pass альфа-тест уже сделан (глубина GL_EQUAL),
+    // а discard в шейдере выключает early-z — тогда вариант без ALPHA_TEST
+#ifdef ALPHA_TEST
     if (tex.a < 0.3)
         discard;
+#endif
 
     float shade = mix(0.6, 1.0, vTex.y);
     vec3 color = tex.rgb * shade;
 
-    // === ТУМАН ===
-    float dist = length(vWorldPos - uCamPos);
-    float fogFactor = 1.0 - exp(-uFogDensity * dist);
-    fogFactor = clamp(fogFactor, 0.0, 1.0);
-    color = mix(color, uFogColor, fogFactor);
-
-    if (uUnderwater == 1)
-        color *= 0.85;
+    // туман — в пост-проходе (fog.glsl)
 
     FragColor = vec4(color, tex.a);
 }
@@ -1,10 +1,5 @@
 #pragma once
-struct GrassInstance {
-    glm::vec3 pos;   //    
-    float scale;     // 
-    bool  alive;     //   
-};
-
+// GrassInstance,      vegetation.h;    
 std::vector<GrassInstance> g_grassInstances;
 GLuint g_grassVAO = 0;
 GLuint g_grassVBOQuad = 0;
@@ -18,50 +13,37 @@ bool RaycastTerrain(const glm::vec3& origin,
     float maxDist,
     glm::vec3& hitPos)
 {
-    float t = 0.0f;
-    const float step = 0.5f;
-
-    while (t < maxDist)
-    {
-        glm::vec3 p = origin + dir * t;
-        float h = g_terrain.getHeight(p.x, p.z);
-
-        if (p.y <= h + 0.1f) {
-            hitPos = glm::vec3(p.x, h, p.z);
-            return true;
-        }
-
-        t += step;
-    }
-    return false;
+    return RaycastHeightfield(g_terrain, origin, dir, maxDist, hitPos);
 }
 
 void RemoveGrassAt(const glm::vec3& center, float radius)
 {
-    float r2 = radius * radius;
-
-    for (auto& gi : g_grassInstances)
-    {
-        if (!gi.alive) continue;
-        glm::vec2 d(gi.pos.x - center.x, gi.pos.z - center.z);
-        if (glm::dot(d, d) <= r2)
-            gi.alive = false;
-    }
-
-    //     
-    std::vector<glm::vec4> data;
-    data.reserve(g_grassInstances.size());
-    for (auto& gi : g_grassInstances)
-        if (gi.alive)
-            data.emplace_back(gi.pos, gi.scale);
-
-    g_grassAliveCount = (GLsizei)data.size();
-
-    glBindBuffer(GL_ARRAY_BUFFER, g_grassVBOInstances);
-    glBufferData(GL_ARRAY_BUFFER,
-        data.size() * sizeof(glm::vec4),
-        data.data(),
-        GL_DYNAMIC_DRAW);
+    TRACE_SCOPE("RemoveGrassAt");
+    ALLOC_SCOPE("RemoveGrassAt");
+    KillGrassInRadius(g_grassInstances, center, radius);
+
+    //      ( 6     , frame_arena.h)
+    ArenaVector<glm::vec4> data;
+    CollectGrassInstanceData(g_grassInstances, data);
+    TRACE_COUNTER("grassAlive", data.size());
+
+    //    InitGrass   ,    
+    //      (stream_upload.h),  .
+    //   -: GL        (sim_thread.h).
+    //      :     ( 
+    //  ),          
+    g_gpuCommands.Push([data = std::move(data)]() mutable
+        {
+            GLsizei alive = (GLsizei)data.size();
+            if (data.empty())
+            {
+                g_grassAliveCount = 0;
+                return;
+            }
+            auto owner = std::make_shared<ArenaVector<glm::vec4>>(std::move(data));
+            g_upload.Upload(g_grassVBOInstances, 0, owner->data(), (GLsizeiptr)(alive * sizeof(glm::vec4)),
+                owner, [alive]() { g_grassAliveCount = alive; });
+        });
 }
 
 
@@ -4,15 +4,17 @@ layout (location = 0) in vec2 aQuadPos;   // -0.5..0.5, 0..1
 layout (location = 1) in vec2 aTex;
 layout (location = 2) in vec4 aInstance;  // xyz (центр), w = scale
 
-uniform mat4 uProjection;
-uniform mat4 uView;
-uniform float uTime;
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
+
 uniform vec3 uCameraRight;
 uniform vec3 uCameraUp;
 
 out vec2 vTex;
 out vec3 vWorldPos;
 
+// глубина в pre-pass и в цветовом проходе должна совпасть бит в бит (GL_EQUAL)
+invariant gl_Position;
+
 void main()
 {
     vec3 center = aInstance.xyz;
@@ -0,0 +1,407 @@
+﻿#pragma once
+// heightfield.h
+// Сетка высот террейна без GL: генерация (heightmap или формула), выборка высоты,
+// вершины/индексы в раскладке VBO, раскопка, маска воды (заливка от краёв карты).
+// Terrain в main.cpp — наследник, который только заливает это в буферы.
+// Тяжёлые циклы — построчно через ParallelFor (jobs.h).
+
+#include <vector>
+#include <queue>
+#include <utility>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "stb_image.h"
+#include "core_platform.h"
+#include "jobs.h"
+
+const int HEIGHTFIELD_VERTEX_FLOATS = 9;   // pos3 + normal3 + uv2 + mat1
+
+struct Heightfield
+{
+    float size = 0.0f;
+    float maxHeight = 0.0f;
+    int      width = 0;    // кол-во вершин по X
+    int      height = 0;   // кол-во вершин по Z
+    std::vector<float> heights;
+    std::vector<float> material;
+
+    // heightmap
+    int hmW = 0, hmH = 0;
+    std::vector<float> hmData; // [0..1]
+
+    bool hasHeightmap() const { return !hmData.empty(); }
+
+    float sampleHeightmap(float xNorm, float zNorm) const
+    {
+        if (!hasHeightmap()) return 0.0f;
+        xNorm = glm::clamp(xNorm, 0.0f, 1.0f);
+        zNorm = glm::clamp(zNorm, 0.0f, 1.0f);
+
+        float fx = xNorm * (hmW - 1);
+        float fz = zNorm * (hmH - 1);
+        int x0 = (int)fx;
+        int z0 = (int)fz;
+        int x1 = glm::min(x0 + 1, hmW - 1);
+        int z1 = glm::min(z0 + 1, hmH - 1);
+        float tx = fx - x0;
+        float tz = fz - z0;
+
+        auto H = [&](int x, int z) {
+            return hmData[z * hmW + x] * maxHeight;
+            };
+
+        float h0 = H(x0, z0) * (1 - tx) + H(x1, z0) * tx;
+        float h1 = H(x0, z1) * (1 - tx) + H(x1, z1) * tx;
+        return h0 * (1 - tz) + h1 * tz;
+    }
+
+    // процедурная функция если нет heightmap
+    float func(float x, float z) const
+    {
+        return std::sin(x * 0.08f) * std::cos(z * 0.08f) * maxHeight * 0.5f;
+    }
+
+    float getHeight(float worldX, float worldZ) const
+    {
+        float half = size * 0.5f;
+        if (worldX < -half || worldX > half || worldZ < -half || worldZ > half)
+            return 0.0f;
+
+        // Если есть актуальная сетка высот — пользуем её
+        if (!heights.empty() && width > 1 && height > 1)
+        {
+            float cell = size / float(width - 1);
+
+            float fx = (worldX + half) / cell;
+            float fz = (worldZ + half) / cell;
+
+            int x0 = (int)floorf(fx);
+            int z0 = (int)floorf(fz);
+            int x1 = x0 + 1;
+            int z1 = z0 + 1;
+
+            x0 = std::max(0, std::min(width - 1, x0));
+            x1 = std::max(0, std::min(width - 1, x1));
+            z0 = std::max(0, std::min(height - 1, z0));
+            z1 = std::max(0, std::min(height - 1, z1));
+
+            float tx = fx - x0;
+            float tz = fz - z0;
+
+            auto H = [&](int x, int z) {
+                return heights[z * width + x];
+                };
+
+            float h00 = H(x0, z0);
+            float h10 = H(x1, z0);
+            float h01 = H(x0, z1);
+            float h11 = H(x1, z1);
+
+            float h0 = h00 + (h10 - h00) * tx;
+            float h1 = h01 + (h11 - h01) * tx;
+            return h0 + (h1 - h0) * tz;
+        }
+
+        // fallback, если heights почему-то пуст
+        if (hasHeightmap()) {
+            float xn = (worldX + half) / size;
+            float zn = (worldZ + half) / size;
+            return sampleHeightmap(xn, zn);
+        }
+        else {
+            return func(worldX, worldZ);
+        }
+    }
+
+    // нормаль ближайшей вершины сетки (наклон для расстановки) — 4 чтения без интерполяции
+    glm::vec3 normalAt(float worldX, float worldZ) const
+    {
+        if (heights.empty() || width < 3 || height < 3)
+            return glm::vec3(0.0f, 1.0f, 0.0f);
+
+        float half = size * 0.5f;
+        float cell = size / float(width - 1);
+        int x = std::max(1, std::min(width - 2, (int)((worldX + half) / cell + 0.5f)));
+        int z = std::max(1, std::min(height - 2, (int)((worldZ + half) / cell + 0.5f)));
+        int idx = z * width + x;
+
+        return glm::normalize(glm::vec3(heights[idx - 1] - heights[idx + 1], 2.0f * cell,
+            heights[idx - width] - heights[idx + width]));
+    }
+
+    void loadHeightmap(const char* path)
+    {
+        int ch = 0;
+        unsigned char* data = stbi_load(path, &hmW, &hmH, &ch, 1);
+        if (!data) {
+            CoreLog("Failed to load heightmap\n");
+            return;
+        }
+        hmData.resize(hmW * hmH);
+        for (int i = 0; i < hmW * hmH; ++i) {
+            hmData[i] = data[i] / 255.0f;
+        }
+        stbi_image_free(data);
+    }
+
+    // n x n вершин на worldSize; высоты из heightmap (если загружена) или func
+    void Generate(int n, float worldSize, float h)
+    {
+        size = worldSize;
+        maxHeight = h;
+
+        width = n;
+        height = n;
+
+        heights.assign(width * height, 0.0f);
+        material.assign(width * height, 0.0f); // 0 = земля
+
+        float step = size / float(n - 1);
+        float half = size * 0.5f;
+
+        // строки — по потокам jobs.h
+        ParallelFor(height, 16, [&](int z0, int z1)
+            {
+                for (int z = z0; z < z1; ++z)
+                {
+                    for (int x = 0; x < width; ++x)
+                    {
+                        float wx = -half + x * step;
+                        float wz = -half + z * step;
+                        heights[z * width + x] = hasHeightmap()
+                            ? sampleHeightmap((wx + half) / size, (wz + half) / size)
+                            : func(wx, wz);
+                    }
+                }
+            });
+    }
+
+    // вершины для VBO (HEIGHTFIELD_VERTEX_FLOATS на вершину).
+    // Строки независимы (heights только читаем) — jobs.h.
+    // Out — std::vector<float> или ArenaVector<float> (frame_arena.h)
+    template <typename Out>
+    void BuildVertices(Out& verts) const
+    {
+        verts.resize((size_t)width * height * HEIGHTFIELD_VERTEX_FLOATS);
+        if (width <= 1 || height <= 1 || heights.empty())
+            return;
+
+        float half = size * 0.5f;
+        float cell = size / float(width - 1);
+
+        ParallelFor(height, 16, [&](int z0, int z1)
+            {
+                for (int z = z0; z < z1; ++z)
+                {
+                    for (int x = 0; x < width; ++x)
+                    {
+                        int idx = z * width + x;
+                        float* o = &verts[(size_t)idx * HEIGHTFIELD_VERTEX_FLOATS];
+
+                        o[0] = -half + x * cell;
+                        o[1] = heights[idx];
+                        o[2] = -half + z * cell;
+
+                        // на краю карты нормаль вверх, внутри — по соседям
+                        glm::vec3 n(0.0f, 1.0f, 0.0f);
+                        if (x > 0 && x < width - 1 && z > 0 && z < height - 1)
+                        {
+                            float hL = heights[idx - 1];
+                            float hR = heights[idx + 1];
+                            float hD = heights[idx - width];
+                            float hU = heights[idx + width];
+                            n = glm::normalize(glm::vec3(hL - hR, 2.0f * cell, hD - hU));
+                        }
+                        o[3] = n.x;
+                        o[4] = n.y;
+                        o[5] = n.z;
+
+                        o[6] = (float)x / (width - 1) * 16.0f;
+                        o[7] = (float)z / (height - 1) * 16.0f;
+
+                        o[8] = material.empty() ? 0.0f : material[idx];
+                    }
+                }
+            });
+    }
+
+    // два треугольника на квад
+    void BuildIndices(std::vector<unsigned int>& indices) const
+    {
+        int n = width;
+        indices.resize((size_t)(n - 1) * (height - 1) * 6);
+
+        ParallelFor(height - 1, 32, [&](int z0, int z1)
+            {
+                for (int z = z0; z < z1; ++z)
+                {
+                    unsigned int* o = &indices[(size_t)z * (n - 1) * 6];
+                    for (int x = 0; x < n - 1; ++x)
+                    {
+                        unsigned int i0 = z * n + x;
+                        unsigned int i1 = z * n + x + 1;
+                        unsigned int i2 = (z + 1) * n + x;
+                        unsigned int i3 = (z + 1) * n + x + 1;
+
+                        *o++ = i0; *o++ = i2; *o++ = i1;
+                        *o++ = i1; *o++ = i2; *o++ = i3;
+                    }
+                }
+            });
+    }
+
+    // яма с плоским дном на ближайшем меньшем "этаже"; false — сетки нет
+    bool ApplyDig(const glm::vec3& center, float radius)
+    {
+        if (width <= 1 || height <= 1 || heights.empty())
+            return false;
+
+        float half = size * 0.5f;
+        float cell = size / float(width - 1);
+
+        // шаг по высоте сетки
+        const float gridStep = 1.5f;
+
+        // текущая высота в точке удара
+        float baseH = getHeight(center.x, center.z);
+
+        // целевой уровень — ближайший МЕНЬШИЙ уровень сетки
+        // (чуть вычитаем, чтобы повторный вызов уходил на следующий "этаж")
+        float targetH = std::floor((baseH - 0.001f) / gridStep) * gridStep;
+
+        // радиусы: внутреннее плоское дно и внешние склоны
+        float rFlat = radius * 0.5f;
+        float rOuter = radius;
+
+        int ixMin = std::max(0, int(std::floor((center.x - rOuter + half) / cell)));
+        int ixMax = std::min(width - 1, int(std::ceil((center.x + rOuter + half) / cell)));
+        int izMin = std::max(0, int(std::floor((center.z - rOuter + half) / cell)));
+        int izMax = std::min(height - 1, int(std::ceil((center.z + rOuter + half) / cell)));
+
+        for (int z = izMin; z <= izMax; ++z)
+        {
+            for (int x = ixMin; x <= ixMax; ++x)
+            {
+                int idx = z * width + x;
+                float vx = -half + x * cell;
+                float vz = -half + z * cell;
+
+                float dx = vx - center.x;
+                float dz = vz - center.z;
+                float dist = std::sqrt(dx * dx + dz * dz);
+
+                if (dist <= rFlat)
+                {
+                    // жёсткое плоское дно
+                    heights[idx] = std::min(heights[idx], targetH);
+                    if (!material.empty())
+                        material[idx] = 1.0f; // чистый песок
+                }
+                else if (dist <= rOuter)
+                {
+                    // плавный склон между baseH (снаружи) и targetH (у края дна)
+                    float t = (dist - rFlat) / (rOuter - rFlat); // 0..1
+                    float desiredH = targetH + (baseH - targetH) * t;
+
+                    heights[idx] = std::min(heights[idx], desiredH);
+
+                    // песка меньше на склоне
+                    if (!material.empty())
+                    {
+                        float sand = 1.0f - t;
+                        material[idx] = std::max(material[idx], sand);
+                    }
+                }
+                // вне rOuter ничего не трогаем
+            }
+        }
+        return true;
+    }
+
+    // вода = клетки ниже level, связанные с краем карты (океан вокруг); 255 — вода.
+    // Маска того же размера, что и сетка высот
+    void BuildWaterMask(float level, std::vector<uint8_t>& mask) const
+    {
+        int w = width, h = height;
+        mask.assign((size_t)std::max(0, w * h), 0);
+        if (w <= 0 || h <= 0 || heights.empty())
+            return;
+
+        std::queue< std::pair<int, int> > q;
+
+        auto TryPush = [&](int x, int z)
+            {
+                if (x < 0 || x >= w || z < 0 || z >= h)
+                    return;
+
+                int idx = z * w + x;
+                if (mask[idx])          // уже помечен
+                    return;
+
+                if (heights[idx] < level)   // ниже уровня моря — потенциал воды
+                    q.push(std::make_pair(x, z));
+            };
+
+        // стартуем с краёв карты
+        for (int x = 0; x < w; ++x)
+        {
+            TryPush(x, 0);
+            TryPush(x, h - 1);
+        }
+        for (int z = 0; z < h; ++z)
+        {
+            TryPush(0, z);
+            TryPush(w - 1, z);
+        }
+
+        // flood fill
+        while (!q.empty())
+        {
+            std::pair<int, int> p = q.front();
+            q.pop();
+            int x = p.first;
+            int z = p.second;
+
+            int idx = z * w + x;
+            if (mask[idx])
+                continue;
+
+            mask[idx] = 255;
+
+            // 4-соседа
+            TryPush(x + 1, z);
+            TryPush(x - 1, z);
+            TryPush(x, z + 1);
+            TryPush(x, z - 1);
+        }
+    }
+};
+
+// луч по шагам 0.5 м до земли
+inline bool RaycastHeightfield(const Heightfield& hf,
+    const glm::vec3& origin,
+    const glm::vec3& dir,
+    float maxDist,
+    glm::vec3& hitPos)
+{
+    float t = 0.0f;
+    const float step = 0.5f;
+
+    while (t < maxDist)
+    {
+        glm::vec3 p = origin + dir * t;
+        float h = hf.getHeight(p.x, p.z);
+
+        if (p.y <= h + 0.1f) {
+            hitPos = glm::vec3(p.x, h, p.z);
+            return true;
+        }
+
+        t += step;
+    }
+    return false;
+}
@@ -0,0 +1,353 @@
+﻿#pragma once
+// input.h
+// Ввод симуляции через одну точку: сим в начале тика снимает клавиши и мышь в InputFrame,
+// UpdateCamera / инструменты читают только его (InputHeld / InputPressed / InputMouse*).
+// Поэтому тик можно записать и потом проиграть — тот же мир, те же раскопки и вырубка.
+//
+//   -record [файл]              — писать ввод каждого тика + seed мира (по умолчанию input.rec),
+//                                 файл пишется на выходе
+//   -seed <n> | random          — seed мира (по умолчанию постоянный, INPUT_DEFAULT_SEED —
+//                                 тогда мир берётся запечённым, world_cache.h); random — от time()
+//   -replay <файл> [headless]   — проиграть: ровно тик на кадр (фиксированный шаг, без сим-потока),
+//                                 seed из файла. headless — окно скрыто, без Render: тики,
+//                                 GL-команды сима и кольцо заливки (сколько стоит сама симуляция).
+//                                 В конце — replay_<имя>.txt (кадр/тик мс, хеш мира), выход.
+//
+// Нажатие (pressed) — фронт за тик, а не GetAsyncKeyState & 1: тот бит общий на процесс
+// и "съедается" любым другим опросом. Проверка рассинхрона: на каждый тик пишется хеш
+// позиции камеры после тика, при проигрывании первое расхождение — в лог.
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+// клавиши, которые читает симуляция (бит = индекс)
+const int INPUT_KEYS[] = {
+    'W', 'S', 'A', 'D', VK_SPACE, VK_LBUTTON,
+    '1', '2', '0', '9',
+    VK_LEFT, VK_RIGHT, VK_UP, VK_DOWN, VK_PRIOR, VK_NEXT,
+    VK_NUMPAD1, VK_NUMPAD2, VK_NUMPAD3, VK_NUMPAD4, VK_NUMPAD5,
+    VK_NUMPAD6, VK_NUMPAD7, VK_NUMPAD8, VK_NUMPAD9,
+    VK_ADD, VK_SUBTRACT, VK_OEM_MINUS, VK_OEM_PLUS
+};
+const int INPUT_KEY_COUNT = sizeof(INPUT_KEYS) / sizeof(INPUT_KEYS[0]);
+static_assert(INPUT_KEY_COUNT <= 32, "InputFrame keys are a 32-bit mask");
+
+const uint32_t INPUT_FILE_MAGIC = 0x52504E49;   // "INPR"
+const uint32_t INPUT_DEFAULT_SEED = 1;
+const uint32_t INPUT_FILE_VERSION = 1;
+
+// один тик ввода (в файле — как есть)
+struct InputFrame
+{
+    uint32_t held = 0;       // зажаты на начало тика
+    uint32_t pressed = 0;    // нажаты с прошлого тика
+    int32_t mouseDx = 0, mouseDy = 0;
+    int32_t tool = 0;        // инструмент на начало тика
+    uint32_t check = 0;      // хеш камеры после тика (рассинхрон)
+};
+
+struct InputFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seed;
+    uint32_t simHz;
+    uint32_t count;
+};
+
+enum InputMode {
+    INPUT_LIVE = 0,
+    INPUT_RECORD = 1,
+    INPUT_REPLAY = 2
+};
+
+struct InputState
+{
+    InputMode mode = INPUT_LIVE;
+    bool headless = false;
+    std::string path = "input.rec";
+    uint32_t seed = 0;
+
+    InputFrame cur;                  // ввод текущего тика (сим)
+    uint32_t prevHeld = 0;
+    std::vector<InputFrame> frames;  // запись / проигрывание
+    size_t pos = 0;                  // следующий кадр проигрывания
+    bool replayDone = false;
+    uint64_t desyncTick = 0;         // 0 — не было
+
+    // замеры проигрывания (главный поток)
+    LARGE_INTEGER freq{}, tickStart{};
+    std::vector<double> frameMs;
+    double sumTickMs = 0.0, maxTickMs = 0.0;
+    uint64_t ticks = 0;
+};
+
+InputState g_input;
+
+inline int InputKeyIndex(int vk)
+{
+    static int8_t map[256];
+    static bool built = false;
+    if (!built)
+    {
+        memset(map, -1, sizeof(map));
+        for (int i = 0; i < INPUT_KEY_COUNT; ++i) map[INPUT_KEYS[i] & 0xFF] = (int8_t)i;
+        built = true;
+    }
+    return map[vk & 0xFF];
+}
+
+inline bool InputHeld(int vk)
+{
+    int i = InputKeyIndex(vk);
+    return i >= 0 && (g_input.cur.held & (1u << i)) != 0;
+}
+
+inline bool InputPressed(int vk)
+{
+    int i = InputKeyIndex(vk);
+    return i >= 0 && (g_input.cur.pressed & (1u << i)) != 0;
+}
+
+inline int InputMouseDx() { return g_input.cur.mouseDx; }
+inline int InputMouseDy() { return g_input.cur.mouseDy; }
+
+inline uint32_t InputHashFloats(const float* f, size_t n, uint32_t h = 2166136261u)
+{
+    const unsigned char* p = (const unsigned char*)f;
+    for (size_t i = 0; i < n * sizeof(float); ++i) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+// WinMain, до srand и создания окна
+void InputInit(const char* cmdLine)
+{
+    g_input.seed = INPUT_DEFAULT_SEED;
+    QueryPerformanceFrequency(&g_input.freq);
+    if (!cmdLine) return;
+
+    bool seedGiven = false;
+    std::istringstream ss(cmdLine);
+    std::string tok;
+    while (ss >> tok)
+    {
+        if (tok == "-seed")
+        {
+            std::string arg;
+            ss >> arg;
+            g_input.seed = (arg == "random") ? (uint32_t)time(nullptr) : (uint32_t)strtoul(arg.c_str(), nullptr, 10);
+            seedGiven = true;
+        }
+        else if (tok == "-record" || tok == "-replay")
+        {
+            g_input.mode = (tok == "-record") ? INPUT_RECORD : INPUT_REPLAY;
+            std::streampos p = ss.tellg();
+            std::string arg;
+            if (ss >> arg && arg[0] != '-') g_input.path = arg;
+            else { ss.clear(); ss.seekg(p); }
+
+            if (g_input.mode == INPUT_REPLAY)
+            {
+                p = ss.tellg();
+                if (ss >> arg && arg == "headless") g_input.headless = true;
+                else { ss.clear(); ss.seekg(p); }
+            }
+        }
+    }
+
+    if (g_input.mode != INPUT_REPLAY)
+        return;
+
+    FILE* f = fopen(g_input.path.c_str(), "rb");
+    InputFileHeader h = {};
+    bool ok = f && fread(&h, sizeof(h), 1, f) == 1 &&
+        h.magic == INPUT_FILE_MAGIC && h.version == INPUT_FILE_VERSION && h.simHz == (uint32_t)SIM_HZ;
+    if (ok)
+    {
+        g_input.frames.resize(h.count);
+        ok = h.count == 0 || fread(g_input.frames.data(), sizeof(InputFrame), h.count, f) == h.count;
+    }
+    if (f) fclose(f);
+
+    if (!ok)
+    {
+        OutputDebugStringA(("Input: can't replay " + g_input.path + "\n").c_str());
+        g_input.mode = INPUT_LIVE;
+        g_input.headless = false;
+        g_input.frames.clear();
+        return;
+    }
+
+    if (seedGiven)
+        OutputDebugStringA("Input: -seed ignored, replay uses the recorded seed\n");
+    g_input.seed = h.seed;
+
+    // тик на кадр, в главном потоке: кадр N всегда рисует тик N
+    g_sim.threaded = false;
+    g_sim.lockstep = true;
+
+    char buf[256];
+    sprintf_s(buf, "Input: replay %s, %u ticks, seed %u%s\n",
+        g_input.path.c_str(), h.count, h.seed, g_input.headless ? ", headless" : "");
+    OutputDebugStringA(buf);
+}
+
+// сим, начало тика: снять ввод (живой / из записи)
+void InputBeginTick(int currentTool)
+{
+    QueryPerformanceCounter(&g_input.tickStart);
+
+    // мышь копит главный поток (ProcessMouse) — забираем всегда, чтобы не копилась
+    int dx = g_simInput.mouseDx.exchange(0);
+    int dy = g_simInput.mouseDy.exchange(0);
+
+    if (g_input.mode == INPUT_REPLAY)
+    {
+        if (g_input.pos < g_input.frames.size())
+            g_input.cur = g_input.frames[g_input.pos++];
+        else
+        {
+            g_input.cur = InputFrame();
+            g_input.cur.tool = currentTool;
+            g_input.replayDone = true;
+        }
+        return;
+    }
+
+    uint32_t held = 0, pressed = 0;
+    for (int i = 0; i < INPUT_KEY_COUNT; ++i)
+    {
+        SHORT s = GetAsyncKeyState(INPUT_KEYS[i]);
+        bool down = (s & 0x8000) != 0;
+        if (down) held |= 1u << i;
+        // быстрый тап между тиками — по биту 1
+        if ((down && !(g_input.prevHeld & (1u << i))) || (s & 0x0001)) pressed |= 1u << i;
+    }
+    g_input.prevHeld = held;
+
+    g_input.cur.held = held;
+    g_input.cur.pressed = pressed;
+    g_input.cur.mouseDx = dx;
+    g_input.cur.mouseDy = dy;
+    g_input.cur.tool = currentTool;
+    g_input.cur.check = 0;
+}
+
+// сим, конец тика: хеш камеры — в запись / сверка с записью
+void InputEndTick(const glm::vec3& camPos, float yaw, float pitch)
+{
+    float f[5] = { camPos.x, camPos.y, camPos.z, yaw, pitch };
+    uint32_t check = InputHashFloats(f, 5);
+
+    if (g_input.mode == INPUT_RECORD)
+    {
+        g_input.cur.check = check;
+        g_input.frames.push_back(g_input.cur);
+    }
+    else if (g_input.mode == INPUT_REPLAY && !g_input.replayDone)
+    {
+        if (!g_input.desyncTick && check != g_input.cur.check)
+        {
+            g_input.desyncTick = g_input.pos;
+            char buf[128];
+            sprintf_s(buf, "Input: replay desync at tick %llu\n", (unsigned long long)g_input.pos);
+            OutputDebugStringA(buf);
+        }
+
+        LARGE_INTEGER t1;
+        QueryPerformanceCounter(&t1);
+        double ms = double(t1.QuadPart - g_input.tickStart.QuadPart) * 1000.0 / double(g_input.freq.QuadPart);
+        g_input.sumTickMs += ms;
+        g_input.maxTickMs = std::max(g_input.maxTickMs, ms);
+        ++g_input.ticks;
+    }
+}
+
+// состояние мира после прогона: высоты + живая трава + срубленные деревья
+uint32_t InputWorldHash()
+{
+    uint32_t h = InputHashFloats(g_terrain.heights.data(), g_terrain.heights.size());
+    for (const GrassInstance& g : g_grassInstances) { h ^= g.alive ? 1u : 0u; h *= 16777619u; }
+    for (bool r : g_treeRemoved) { h ^= r ? 1u : 0u; h *= 16777619u; }
+    return h;
+}
+
+void InputReplayFinish()
+{
+    std::ostringstream os;
+    std::string name = g_input.path;
+    size_t slash = name.find_last_of("/\\");
+    if (slash != std::string::npos) name = name.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos) name = name.substr(0, dot);
+
+    os << "replay " << g_input.path << ": ticks=" << g_input.ticks << " seed=" << g_input.seed
+        << (g_input.headless ? " headless" : " windowed") << "\n";
+
+    // первый кадр — досчитывание загрузки, не считаем
+    std::vector<double> ms(g_input.frameMs.begin() + std::min<size_t>(1, g_input.frameMs.size()), g_input.frameMs.end());
+    if (!ms.empty())
+    {
+        double sum = 0.0;
+        for (double v : ms) sum += v;
+        std::vector<double> sorted = ms;
+        std::sort(sorted.begin(), sorted.end());
+        os << "frames=" << ms.size() << " frame_ms avg=" << sum / ms.size()
+            << " min=" << sorted.front() << " p99=" << sorted[(sorted.size() - 1) * 99 / 100]
+            << " max=" << sorted.back() << "\n";
+    }
+    if (g_input.ticks > 0)
+        os << "tick_ms avg=" << g_input.sumTickMs / g_input.ticks << " max=" << g_input.maxTickMs << "\n";
+
+    char hash[16];
+    sprintf_s(hash, "%08x", InputWorldHash());
+    os << "world_hash=" << hash << " edits=" << g_terrainEdits << " trees_cut=" << g_treeRemovals
+        << " desync_tick=" << g_input.desyncTick << "\n";
+
+    OutputDebugStringA(os.str().c_str());
+    std::ofstream f("replay_" + name + ".txt");
+    f << os.str();
+
+    g_running = false;
+}
+
+// главный цикл, раз в кадр (и в headless): dt — прошлый кадр
+void InputReplayFrame(float dt)
+{
+    if (g_input.mode != INPUT_REPLAY || !g_running) return;
+
+    g_input.frameMs.push_back(dt * 1000.0);
+    if (g_input.replayDone)
+        InputReplayFinish();
+}
+
+// на выходе (после SimShutdown — сим-поток уже не пишет)
+void InputShutdown()
+{
+    if (g_input.mode != INPUT_RECORD) return;
+
+    FILE* f = fopen(g_input.path.c_str(), "wb");
+    if (!f)
+    {
+        OutputDebugStringA(("Input: can't write " + g_input.path + "\n").c_str());
+        return;
+    }
+    InputFileHeader h = { INPUT_FILE_MAGIC, INPUT_FILE_VERSION, g_input.seed, (uint32_t)SIM_HZ, (uint32_t)g_input.frames.size() };
+    fwrite(&h, sizeof(h), 1, f);
+    if (!g_input.frames.empty())
+        fwrite(g_input.frames.data(), sizeof(InputFrame), g_input.frames.size(), f);
+    fclose(f);
+
+    char buf[256];
+    sprintf_s(buf, "Input: recorded %u ticks -> %s (seed %u)\n", h.count, g_input.path.c_str(), h.seed);
+    OutputDebugStringA(buf);
+}
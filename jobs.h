@@ -0,0 +1,337 @@
+﻿#pragma once
+// jobs.h
+// Система задач с кражей работы (work stealing) для CPU-части движка.
+//  - у каждого потока своя дека: хозяин кладёт/берёт с хвоста (тёплый кэш),
+//    голодные потоки крадут с головы — там самые крупные, ранние куски;
+//  - JobCounter: счётчик незавершённых задач; WaitJobs() не спит, а помогает выполнять;
+//    RunJobAfter — задача стартует, когда счётчик другой группы дошёл до нуля (зависимости);
+//  - ParallelFor(count, grain, fn(begin, end)) — самое частое использование;
+//  - RunOnMainThread: всё, что трогает GL, — только в потоке с контекстом
+//    (исполняется в JobsPumpMain раз в кадр или в WaitJobs() из главного потока).
+// Потоков: ядра - 1 (+ главный). "-jobs N" — всего N потоков (1 = всё в главном, для замеров).
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+
+#include "core_platform.h"
+#include "trace.h"
+
+struct JobCounter;
+
+struct Job
+{
+    std::function<void()> fn;
+    JobCounter* counter = nullptr;   // уменьшается, когда fn отработала
+};
+
+struct JobCounter
+{
+    std::atomic<int> count{ 0 };
+
+    // продолжения: ждут, пока count дойдёт до нуля
+    std::mutex waitMutex;
+    std::vector<Job> waiting;
+};
+
+struct JobWorkerQueue
+{
+    std::mutex m;
+    std::deque<Job> jobs;
+};
+
+struct JobStats
+{
+    std::atomic<unsigned long long> executed{ 0 };
+    std::atomic<unsigned long long> stolen{ 0 };
+};
+
+struct JobSystem
+{
+    int threadCount = 1;                       // вместе с главным
+    std::vector<std::thread> threads;
+    std::vector<JobWorkerQueue*> queues;       // [0] — главный поток
+    std::atomic<bool> quit{ false };
+    std::atomic<int> queued{ 0 };              // чтобы спящие воркеры знали, что есть работа
+
+    JobWorkerQueue mainOnly;                   // задачи с GL
+    std::thread::id mainThread;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    JobStats stats;
+};
+
+JobSystem g_jobs;
+
+// номер потока в g_jobs.queues; -1 — чужой поток
+thread_local int t_jobWorker = -1;
+
+inline bool IsMainThread() { return std::this_thread::get_id() == g_jobs.mainThread; }
+
+void JobPush(Job&& job);
+
+// задача отработала: счётчик вниз, на нуле — отпустить продолжения.
+// Под мьютексом: WaitJobs, увидев ноль, берёт его же — счётчик на стеке ждущего
+// не умрёт, пока мы его ещё держим
+inline void JobFinish(JobCounter* c)
+{
+    if (!c) return;
+
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> lock(c->waitMutex);
+        if (--c->count == 0)
+            ready.swap(c->waiting);
+    }
+    for (Job& j : ready)
+        JobPush(std::move(j));
+}
+
+inline void JobExecute(Job& job)
+{
+    {
+        TRACE_SCOPE("job");
+        job.fn();
+    }
+    ++g_jobs.stats.executed;
+    JobFinish(job.counter);
+}
+
+// своя дека — с хвоста, чужие — с головы
+bool JobTryRun(int worker)
+{
+    Job job;
+    bool found = false;
+    int n = (int)g_jobs.queues.size();
+
+    if (worker >= 0 && worker < n)
+    {
+        JobWorkerQueue& q = *g_jobs.queues[worker];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (!q.jobs.empty())
+        {
+            job = std::move(q.jobs.back());
+            q.jobs.pop_back();
+            found = true;
+        }
+    }
+
+    for (int k = 1; !found && k <= n; ++k)
+    {
+        int victim = ((worker < 0 ? 0 : worker) + k) % n;
+        if (victim == worker) continue;
+
+        JobWorkerQueue& q = *g_jobs.queues[victim];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (!q.jobs.empty())
+        {
+            job = std::move(q.jobs.front());
+            q.jobs.pop_front();
+            found = true;
+            ++g_jobs.stats.stolen;
+        }
+    }
+
+    if (!found) return false;
+
+    --g_jobs.queued;
+    JobExecute(job);
+    return true;
+}
+
+// задачи "только главный поток"; true — что-то выполнили
+bool JobRunMainOnly()
+{
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(g_jobs.mainOnly.m);
+        if (g_jobs.mainOnly.jobs.empty()) return false;
+        job = std::move(g_jobs.mainOnly.jobs.front());
+        g_jobs.mainOnly.jobs.pop_front();
+    }
+    JobExecute(job);
+    return true;
+}
+
+void JobPush(Job&& job)
+{
+    // из чужого потока (или до JobsInit) — в деку главного
+    int w = (t_jobWorker >= 0 && t_jobWorker < (int)g_jobs.queues.size()) ? t_jobWorker : 0;
+    if (g_jobs.queues.empty())
+    {
+        JobExecute(job);   // система не поднята — выполняем на месте
+        return;
+    }
+
+    {
+        JobWorkerQueue& q = *g_jobs.queues[w];
+        std::lock_guard<std::mutex> lock(q.m);
+        q.jobs.push_back(std::move(job));
+    }
+    ++g_jobs.queued;
+    g_jobs.wake.notify_one();
+}
+
+void JobWorkerMain(int index)
+{
+    t_jobWorker = index;
+    TRACE_THREAD_NAME(("job " + std::to_string(index)).c_str());
+    while (!g_jobs.quit.load())
+    {
+        if (JobTryRun(index)) continue;
+
+        std::unique_lock<std::mutex> lock(g_jobs.sleepMutex);
+        g_jobs.wake.wait_for(lock, std::chrono::milliseconds(2),
+            [] { return g_jobs.quit.load() || g_jobs.queued.load() > 0; });
+    }
+}
+
+// "-jobs N" — всего потоков вместе с главным
+void JobsInit(const char* cmdLine)
+{
+    if (!g_jobs.queues.empty()) return;
+
+    int n = (int)std::thread::hardware_concurrency();
+    if (n <= 0) n = 4;
+
+    if (cmdLine)
+    {
+        std::istringstream ss(cmdLine);
+        std::string tok;
+        while (ss >> tok)
+        {
+            if (tok == "-jobs")
+            {
+                int v = 0;
+                if (ss >> v && v > 0) n = v;
+            }
+        }
+    }
+
+    g_jobs.threadCount = std::max(1, std::min(n, 64));
+    g_jobs.mainThread = std::this_thread::get_id();
+    t_jobWorker = 0;
+
+    for (int i = 0; i < g_jobs.threadCount; ++i)
+        g_jobs.queues.push_back(new JobWorkerQueue());
+    for (int i = 1; i < g_jobs.threadCount; ++i)
+        g_jobs.threads.emplace_back(JobWorkerMain, i);
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "Jobs: %d threads\n", g_jobs.threadCount);
+    CoreLog(buf);
+}
+
+void JobsShutdown()
+{
+    g_jobs.quit = true;
+    g_jobs.wake.notify_all();
+    for (auto& t : g_jobs.threads) t.join();
+    g_jobs.threads.clear();
+
+    for (JobWorkerQueue* q : g_jobs.queues) delete q;
+    g_jobs.queues.clear();
+}
+
+// fn в любом потоке; counter (если есть) +1 сейчас, -1 по завершении
+inline void RunJob(std::function<void()> fn, JobCounter* counter = nullptr)
+{
+    if (counter) ++counter->count;
+    Job j;
+    j.fn = std::move(fn);
+    j.counter = counter;
+    JobPush(std::move(j));
+}
+
+// fn только в главном потоке (GL): в JobsPumpMain или пока главный ждёт в Wait
+inline void RunOnMainThread(std::function<void()> fn, JobCounter* counter = nullptr)
+{
+    if (counter) ++counter->count;
+    Job j;
+    j.fn = std::move(fn);
+    j.counter = counter;
+
+    if (g_jobs.queues.empty())
+    {
+        JobExecute(j);   // до JobsInit поток один
+        return;
+    }
+    std::lock_guard<std::mutex> lock(g_jobs.mainOnly.m);
+    g_jobs.mainOnly.jobs.push_back(std::move(j));
+}
+
+// fn стартует, когда dependsOn дойдёт до нуля (сразу, если уже)
+void RunJobAfter(JobCounter& dependsOn, std::function<void()> fn, JobCounter* counter = nullptr)
+{
+    if (counter) ++counter->count;
+    Job j;
+    j.fn = std::move(fn);
+    j.counter = counter;
+
+    {
+        std::lock_guard<std::mutex> lock(dependsOn.waitMutex);
+        if (dependsOn.count.load() > 0)
+        {
+            dependsOn.waiting.push_back(std::move(j));
+            return;
+        }
+    }
+    JobPush(std::move(j));
+}
+
+// ждём, помогая: свои/чужие задачи, а в главном потоке ещё и GL-задачи
+void WaitJobs(JobCounter& c)
+{
+    bool main = IsMainThread();
+    while (c.count.load() > 0)
+    {
+        if (main && JobRunMainOnly()) continue;
+        if (JobTryRun(t_jobWorker)) continue;
+        std::this_thread::yield();
+    }
+
+    // последний JobFinish мог ещё не отпустить мьютекс
+    std::lock_guard<std::mutex> lock(c.waitMutex);
+}
+
+// раз в кадр из главного цикла
+void JobsPumpMain()
+{
+    while (JobRunMainOnly()) {}
+}
+
+// [0, count) кусками по grain; возвращается, когда всё готово.
+// Мелкое (один кусок) или без воркеров — прямо здесь, без задач.
+template <typename Fn>
+void ParallelFor(int count, int grain, const Fn& fn)
+{
+    if (count <= 0) return;
+    grain = std::max(1, grain);
+
+    if (count <= grain || g_jobs.threadCount <= 1 || g_jobs.queues.empty())
+    {
+        fn(0, count);
+        return;
+    }
+
+    JobCounter done;
+    for (int begin = grain; begin < count; begin += grain)
+    {
+        int end = std::min(count, begin + grain);
+        RunJob([&fn, begin, end] { fn(begin, end); }, &done);
+    }
+
+    fn(0, std::min(count, grain));   // первый кусок — сами
+    WaitJobs(done);
+}
@@ -0,0 +1,10 @@
+// lighting.glsl
+// Простой ламберт от солнца (uLightDir из блока Frame).
+#include "frame.glsl"
+
+// ambient + (1 - ambient) * dot(N, L)
+float Lambert(vec3 normal, float ambient)
+{
+    float diff = max(dot(normalize(normal), normalize(uLightDir)), 0.0);
+    return ambient + (1.0 - ambient) * diff;
+}
@@ -41,10 +41,28 @@ bool g_lmbDown = false;
 bool g_lmbPressed = false; // true ровно 1 кадр
 
 
+#include "shader_reflect.h"
+#include "gl_state.h"
+#include "profiler.h"
+#include "startup_profile.h"
+#include "gl_mem.h"
+#include "alloc_track.h"
+#include "frame_arena.h"
+#include "frame_ubo.h"
+#include "shader_cache.h"
+#include "stream_upload.h"
+#include "jobs.h"
+#include "heightfield.h"
+#include "vegetation.h"
+#include "world_config.h"
+#include "world_cache.h"
+#include "sim_thread.h"
+#include "render_queue.h"
 #include "modelwork.h"
 
 Model g_treeModel;
 GLuint g_treeInstanceVBO = 0;
+GLsizeiptr g_treeInstanceBytes = 0;   // выделено в g_treeInstanceVBO
 GLsizei g_treeInstanceCount = 0;
 std::vector<TreeInstance> g_treeInstances;
 GLuint g_treeShader = 0;
@@ -71,7 +89,12 @@ struct CutAnimInstance
 
 
 
-float g_time = 0.0f; // глобальное время, накапливается в главном цикле
+float g_time = 0.0f; // время симуляции, накапливается сим-тиком (sim_thread.h)
+
+// правки мира для снапшота (сами данные уходят в g_gpuCommands)
+uint32_t g_treeRemovals = 0;
+uint32_t g_terrainEdits = 0;
+glm::vec4 g_lastTerrainEdit(0.0f);
 
 //Выбор инструмента
 enum Tool {
@@ -131,46 +154,110 @@ std::string LoadTextFile(const char* path)
     return ss.str();
 }
 
-GLuint CreateShaderProgram(const char* vsPath, const char* fsPath)
+// #include "file" в шейдерах: текстовая вставка, каждый файл один раз (как #pragma once).
+// Пути — от рабочей папки, как и у самих шейдеров.
+void AppendShaderSource(const std::string& path, std::string& out, std::vector<std::string>& included, int depth)
 {
-    auto vsSrc = LoadTextFile(vsPath);
-    auto fsSrc = LoadTextFile(fsPath);
+    for (const std::string& p : included)
+        if (p == path) return;
+    included.push_back(path);
+
+    std::string src = LoadTextFile(path.c_str());
+    if (src.empty() || depth > 16) {
+        OutputDebugStringA(("Shader include failed: " + path + "\n").c_str());
+        return;
+    }
+
+    std::istringstream in(src);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        size_t p = line.find_first_not_of(" \t");
+        if (p != std::string::npos && line.compare(p, 8, "#include") == 0)
+        {
+            size_t q0 = line.find('"', p);
+            size_t q1 = (q0 != std::string::npos) ? line.find('"', q0 + 1) : std::string::npos;
+            if (q1 != std::string::npos) {
+                AppendShaderSource(line.substr(q0 + 1, q1 - q0 - 1), out, included, depth + 1);
+                continue;
+            }
+        }
+        out += line;
+        out += '\n';
+    }
+}
+
+// вставляет строки defines ("#define X\n...") сразу после #version
+std::string InjectDefines(const std::string& src, const char* defines)
+{
+    if (!defines || !*defines) return src;
+
+    size_t pos = src.find("#version");
+    if (pos == std::string::npos) return std::string(defines) + src;
+
+    size_t eol = src.find('\n', pos);
+    if (eol == std::string::npos) return src + "\n" + defines;
+    return src.substr(0, eol + 1) + defines + src.substr(eol + 1);
+}
+
+// файл шейдера с раскрытыми #include + defines
+std::string PreprocessShader(const char* path, const char* defines)
+{
+    std::string out;
+    std::vector<std::string> included;
+    AppendShaderSource(path, out, included, 0);
+    return InjectDefines(out, defines);
+}
+
+// defines — варианты одного и того же шейдера (shader_variants.h).
+// Статус компиляции тут НЕ спрашиваем: программа уходит в g_pendingPrograms,
+// проверка/лог/рефлексия — в FinishShaderPrograms() или при первом UniformLoc.
+GLuint CreateShaderProgram(const char* vsPath, const char* fsPath, const char* defines = nullptr)
+{
+    InitShaderCache();
+
+    auto vsSrc = PreprocessShader(vsPath, defines);
+    auto fsSrc = PreprocessShader(fsPath, defines);
+    uint64_t key = ProgramCacheKey(vsSrc, fsSrc);
+
+    // бинарник с прошлого запуска — без компиляции вообще
+    GLuint prog = LoadProgramBinary(key);
+    if (prog)
+    {
+        ++g_shaderCache.fromCache;
+        ReflectProgram(prog);
+        return prog;
+    }
 
     auto compile = [](GLenum type, const std::string& src)->GLuint {
         GLuint s = glCreateShader(type);
         const char* c = src.c_str();
         glShaderSource(s, 1, &c, nullptr);
         glCompileShader(s);
-        GLint ok = 0;
-        glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
-        if (!ok) {
-            char log[1024];
-            glGetShaderInfoLog(s, 1024, nullptr, log);
-            OutputDebugStringA(log);
-        }
         return s;
         };
 
-    GLuint vs = compile(GL_VERTEX_SHADER, vsSrc);
-    GLuint fs = compile(GL_FRAGMENT_SHADER, fsSrc);
+    PendingProgram pp;
+    pp.vs = compile(GL_VERTEX_SHADER, vsSrc);
+    pp.fs = compile(GL_FRAGMENT_SHADER, fsSrc);
 
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, vs);
-    glAttachShader(prog, fs);
+    prog = glCreateProgram();
+    glAttachShader(prog, pp.vs);
+    glAttachShader(prog, pp.fs);
+    if (g_shaderCache.binarySupported)
+        g_shaderCache.programParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(prog);
 
-    GLint ok = 0;
-    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-    if (!ok) {
-        char log[1024];
-        glGetProgramInfoLog(prog, 1024, nullptr, log);
-        OutputDebugStringA(log);
-    }
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    pp.prog = prog;
+    pp.key = key;
+    pp.name = std::string(vsPath) + " + " + fsPath + (defines ? " [variant]" : "");
+    g_pendingPrograms.push_back(pp);
+    ++g_shaderCache.compiled;
     return prog;
 }
 
+#include "shader_variants.h"
+
 
 
 // ===== CAMERA =====
@@ -208,7 +295,8 @@ GLuint CreateShaderProgram(const char* vsPath, const char* fsPath)
 //    }
 //};
 
-Camera g_cam(glm::vec3(0.0f, 10.0f, 20.0f));
+Camera g_cam(glm::vec3(0.0f, 10.0f, 20.0f));   // игрок — живёт в сим-потоке
+Camera g_renderCam(glm::vec3(0.0f, 10.0f, 20.0f)); // из снапшота, для отрисовки (ApplyRenderState)
 //
 
 // ===== TERRAIN =====
@@ -216,239 +304,94 @@ Camera g_cam(glm::vec3(0.0f, 10.0f, 20.0f));
 #include "water.h"
 #include "sky.h"
 
-struct Terrain {
+// CPU-часть (высоты, раскопка, маска воды) — Heightfield (heightfield.h), здесь только GL
+struct Terrain : Heightfield {
     GLuint vao = 0, vbo = 0, ebo = 0;
+    GLuint vaoBack = 0, vboBack = 0;   // второй набор вершин: в него идёт перезаливка (UploadVertices)
     int vertsPerSide = 0;
-    float size = 0.0f;
-    float maxHeight = 0.0f;
-    int      width;    // кол-во вершин по X
-    int      height;   // кол-во вершин по Z
     GLuint texture = 0;
-    std::vector<float> heights;
-    std::vector<float> material;
-
-    // heightmap
-    int hmW = 0, hmH = 0;
-    std::vector<float> hmData; // [0..1]
-
-    bool hasHeightmap() const { return !hmData.empty(); }
-
-    float sampleHeightmap(float xNorm, float zNorm) const
-    {
-        if (!hasHeightmap()) return 0.0f;
-        xNorm = glm::clamp(xNorm, 0.0f, 1.0f);
-        zNorm = glm::clamp(zNorm, 0.0f, 1.0f);
-
-        float fx = xNorm * (hmW - 1);
-        float fz = zNorm * (hmH - 1);
-        int x0 = (int)fx;
-        int z0 = (int)fz;
-        int x1 = glm::min(x0 + 1, hmW - 1);
-        int z1 = glm::min(z0 + 1, hmH - 1);
-        float tx = fx - x0;
-        float tz = fz - z0;
-
-        auto H = [&](int x, int z) {
-            return hmData[z * hmW + x] * maxHeight;
-            };
-
-        float h0 = H(x0, z0) * (1 - tx) + H(x1, z0) * tx;
-        float h1 = H(x0, z1) * (1 - tx) + H(x1, z1) * tx;
-        return h0 * (1 - tz) + h1 * tz;
-    }
-
-    // процедурная функция если нет heightmap
-    float func(float x, float z) const
-    {
-        return std::sin(x * 0.08f) * std::cos(z * 0.08f) * maxHeight * 0.5f;
-    }
 
-    float getHeight(float worldX, float worldZ) const
-    {
-        float half = size * 0.5f;
-        if (worldX < -half || worldX > half || worldZ < -half || worldZ > half)
-            return 0.0f;
-
-        // Если есть актуальная сетка высот — пользуем её
-        if (!heights.empty() && width > 1 && height > 1)
-        {
-            float cell = size / float(width - 1);
-
-            float fx = (worldX + half) / cell;
-            float fz = (worldZ + half) / cell;
-
-            int x0 = (int)floorf(fx);
-            int z0 = (int)floorf(fz);
-            int x1 = x0 + 1;
-            int z1 = z0 + 1;
-
-            x0 = std::max(0, std::min(width - 1, x0));
-            x1 = std::max(0, std::min(width - 1, x1));
-            z0 = std::max(0, std::min(height - 1, z0));
-            z1 = std::max(0, std::min(height - 1, z1));
-
-            float tx = fx - x0;
-            float tz = fz - z0;
-
-            auto H = [&](int x, int z) {
-                return heights[z * width + x];
-                };
-
-            float h00 = H(x0, z0);
-            float h10 = H(x1, z0);
-            float h01 = H(x0, z1);
-            float h11 = H(x1, z1);
-
-            float h0 = h00 + (h10 - h00) * tx;
-            float h1 = h01 + (h11 - h01) * tx;
-            return h0 + (h1 - h0) * tz;
-        }
-
-        // fallback, если heights почему-то пуст
-        if (hasHeightmap()) {
-            float xn = (worldX + half) / size;
-            float zn = (worldZ + half) / size;
-            return sampleHeightmap(xn, zn);
-        }
-        else {
-            return func(worldX, worldZ);
-        }
-    }
-
-    void loadHeightmap(const char* path)
-    {
-        int ch = 0;
-        unsigned char* data = stbi_load(path, &hmW, &hmH, &ch, 1);
-        if (!data) {
-            OutputDebugStringA("Failed to load heightmap\n");
-            return;
-        }
-        hmData.resize(hmW * hmH);
-        for (int i = 0; i < hmW * hmH; ++i) {
-            hmData[i] = data[i] / 255.0f;
-        }
-        stbi_image_free(data);
-    }
-
-    void build(int n, float worldSize, float h)
+    // heightmapPath — откуда высоты, если мир не запечён (nullptr — процедурный func)
+    void build(int n, float worldSize, float h, const char* heightmapPath)
     {
+        TRACE_SCOPE("Terrain::build");
+        MemScope memTag(MEM_TERRAIN);
         vertsPerSide = n;
-        size = worldSize;
-        maxHeight = h;
 
-        width = n;
-        height = n;
-
-        heights.assign(width * height, 0.0f);
-        material.assign(width * height, 0.0f); // 0 = земля
-
-        std::vector<float> vertices;        // pos3 + normal3 + uv2 + mat1
-        std::vector<unsigned int> indices;
-
-        float step = size / float(n - 1);
-        float half = size * 0.5f;
-
-        auto Hworld = [&](float wx, float wz)
-            {
-                if (hasHeightmap()) {
-                    float xn = (wx + half) / size;
-                    float zn = (wz + half) / size;
-                    return sampleHeightmap(xn, zn);
-                }
-                else {
-                    return std::sin(wx * 0.08f) * std::cos(wz * 0.08f) * maxHeight * 0.5f;
-                }
-            };
-
-        // заполняем heights
-        for (int z = 0; z < height; ++z)
+        // запечённый мир (world_cache.h): высоты и готовые вершины, без Generate/BuildVertices
+        size_t cells = (size_t)n * n;
+        size_t vertexFloats = 0;
+        const float* cachedVerts = WorldCacheGet<float>(WORLD_VERTICES, vertexFloats, cells * HEIGHTFIELD_VERTEX_FLOATS);
+        std::vector<float> vertices;
+        if (cachedVerts && WorldCacheRead(WORLD_HEIGHTS, heights, cells) && WorldCacheRead(WORLD_MATERIAL, material, cells))
         {
-            for (int x = 0; x < width; ++x)
-            {
-                float wx = -half + x * step;
-                float wz = -half + z * step;
-                heights[z * width + x] = Hworld(wx, wz);
-            }
+            size = worldSize;
+            maxHeight = h;
+            width = height = n;
         }
-
-        auto getH = [&](int x, int z)
-            {
-                x = std::max(0, std::min(width - 1, x));
-                z = std::max(0, std::min(height - 1, z));
-                return heights[z * width + x];
-            };
-
-        vertices.reserve(width * height * 9);
-
-        // позиции, нормали, uv, material
-        for (int z = 0; z < height; ++z)
+        else
         {
-            for (int x = 0; x < width; ++x)
-            {
-                float wx = -half + x * step;
-                float wz = -half + z * step;
-                float wy = getH(x, z);
-
-                float hl = getH(x - 1, z);
-                float hr = getH(x + 1, z);
-                float hd = getH(x, z - 1);
-                float hu = getH(x, z + 1);
-                glm::vec3 normal(hl - hr, 2.0f, hd - hu);
-                normal = glm::normalize(normal);
-
-                float u = (float)x / (float)(n - 1) * 16.0f;
-                float v = (float)z / (float)(n - 1) * 16.0f;
-
-                vertices.push_back(wx);
-                vertices.push_back(wy);
-                vertices.push_back(wz);
-
-                vertices.push_back(normal.x);
-                vertices.push_back(normal.y);
-                vertices.push_back(normal.z);
-
-                vertices.push_back(u);
-                vertices.push_back(v);
-
-                vertices.push_back(0.0f); // material = земля
-            }
+            // битая секция террейна — не полагаемся и на остальные; высоты из heightmap,
+            // иначе Generate уйдёт в func и такой мир запечётся обратно
+            WorldCacheDrop("terrain sections rejected");
+            cachedVerts = nullptr;
+            if (heightmapPath && !hasHeightmap())
+                loadHeightmap(heightmapPath);
+            Generate(n, worldSize, h);
+            BuildVertices(vertices);
+            vertexFloats = vertices.size();
         }
+        const float* vertexData = cachedVerts ? cachedVerts : vertices.data();
 
-        // индексы
-        for (int z = 0; z < n - 1; ++z)
-        {
-            for (int x = 0; x < n - 1; ++x)
-            {
-                unsigned int i0 = z * n + x;
-                unsigned int i1 = z * n + x + 1;
-                unsigned int i2 = (z + 1) * n + x;
-                unsigned int i3 = (z + 1) * n + x + 1;
-
-                indices.push_back(i0); indices.push_back(i2); indices.push_back(i1);
-                indices.push_back(i1); indices.push_back(i2); indices.push_back(i3);
-            }
-        }
+        std::vector<unsigned int> indices;
+        BuildIndices(indices);
 
-        // буферы
+        // буферы (GL — только здесь, в главном потоке)
         if (!vao) glGenVertexArrays(1, &vao);
         if (!vbo) glGenBuffers(1, &vbo);
         if (!ebo) glGenBuffers(1, &ebo);
+        if (!vaoBack) glGenVertexArrays(1, &vaoBack);
+        if (!vboBack) glGenBuffers(1, &vboBack);
 
-        glBindVertexArray(vao);
+        g_gl.BindVertexArray(vao);
 
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER,
-            vertices.size() * sizeof(float),
-            vertices.data(),
+            vertexFloats * sizeof(float),
+            vertexData,
             GL_DYNAMIC_DRAW); // динамический, будем обновлять
 
+        // задний — пустой: до показа его целиком перезальют
+        glBindBuffer(GL_ARRAY_BUFFER, vboBack);
+        glBufferData(GL_ARRAY_BUFFER, vertexFloats * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER,
             indices.size() * sizeof(unsigned int),
             indices.data(),
             GL_STATIC_DRAW);
+        CountGpuUpload(vertexFloats * sizeof(float) + indices.size() * sizeof(unsigned int));
+        MemGpuBuffer(vbo, vertexFloats * sizeof(float));
+        MemGpuBuffer(vboBack, vertexFloats * sizeof(float));
+        MemGpuBuffer(ebo, indices.size() * sizeof(unsigned int));
+
+        // CPU-копии Heightfield живут всю игру (раскопка, высоты для травы/деревьев)
+        MemTrackVector(heights);
+        MemTrackVector(material);
+        MemTrackVector(hmData);
+
+        SetupVertexArray(vao, vbo);
+        SetupVertexArray(vaoBack, vboBack);
+    }
+
+    // атрибуты вершины террейна (раскладка HEIGHTFIELD_VERTEX_FLOATS) + общий EBO
+    void SetupVertexArray(GLuint va, GLuint vb)
+    {
+        g_gl.BindVertexArray(va);
+        glBindBuffer(GL_ARRAY_BUFFER, vb);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 
-        GLsizei stride = 9 * sizeof(float);
+        GLsizei stride = HEIGHTFIELD_VERTEX_FLOATS * sizeof(float);
 
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
@@ -462,314 +405,182 @@ struct Terrain {
         glEnableVertexAttribArray(3);
         glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)(8 * sizeof(float)));
 
-        glBindVertexArray(0);
+        g_gl.BindVertexArray(0);
     }
 
 
 
     void draw() const
     {
-        glBindVertexArray(vao);
+        g_gl.BindVertexArray(vao);
         int quadCount = (vertsPerSide - 1) * (vertsPerSide - 1);
         glDrawElements(GL_TRIANGLES, quadCount * 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        ProfDraw(GL_TRIANGLES, quadCount * 6);
     }
 
     void Dig(const glm::vec3& center, float radius)
     {
-        if (width <= 1 || height <= 1 || heights.empty())
+        TRACE_SCOPE("Terrain::Dig");
+        ALLOC_SCOPE("Terrain::Dig");
+        if (!ApplyDig(center, radius))
             return;
 
-        float half = size * 0.5f;
-        float cell = size / float(width - 1);
-
-        // шаг по высоте сетки
-        const float gridStep = 1.5f;
-
-        // текущая высота в точке удара
-        float baseH = getHeight(center.x, center.z);
-
-        // целевой уровень — ближайший МЕНЬШИЙ уровень сетки
-        // (чуть вычитаем, чтобы повторный вызов уходил на следующий "этаж")
-        float targetH = std::floor((baseH - 0.001f) / gridStep) * gridStep;
-
-        // радиусы: внутреннее плоское дно и внешние склоны
-        float rFlat = radius * 0.5f;
-        float rOuter = radius;
-
-        int ixMin = std::max(0, int(std::floor((center.x - rOuter + half) / cell)));
-        int ixMax = std::min(width - 1, int(std::ceil((center.x + rOuter + half) / cell)));
-        int izMin = std::max(0, int(std::floor((center.z - rOuter + half) / cell)));
-        int izMax = std::min(height - 1, int(std::ceil((center.z + rOuter + half) / cell)));
-
-        for (int z = izMin; z <= izMax; ++z)
-        {
-            for (int x = ixMin; x <= ixMax; ++x)
-            {
-                int idx = z * width + x;
-                float vx = -half + x * cell;
-                float vz = -half + z * cell;
-
-                float dx = vx - center.x;
-                float dz = vz - center.z;
-                float dist = std::sqrt(dx * dx + dz * dz);
-
-                if (dist <= rFlat)
-                {
-                    // жёсткое плоское дно
-                    heights[idx] = std::min(heights[idx], targetH);
-                    if (!material.empty())
-                        material[idx] = 1.0f; // чистый песок
-                }
-                else if (dist <= rOuter)
-                {
-                    // плавный склон между baseH (снаружи) и targetH (у края дна)
-                    float t = (dist - rFlat) / (rOuter - rFlat); // 0..1
-                    float desiredH = targetH + (baseH - targetH) * t;
-
-                    heights[idx] = std::min(heights[idx], desiredH);
-
-                    // песка меньше на склоне
-                    if (!material.empty())
-                    {
-                        float sand = 1.0f - t;
-                        material[idx] = std::max(material[idx], sand);
-                    }
-                }
-                // вне rOuter ничего не трогаем
-            }
-        }
-
         RebuildVertices();
         RebuildWaterMask();
-        UploadWaterMaskFromTerrain();
+
+        // текстура маски и меш воды — в потоке рендера, по копии маски и её размеров:
+        // waterMask/waterW/waterH принадлежат сим-потоку
+        float terrainSize = size;
+        int w = waterW, h = waterH;
+        g_gpuCommands.Push([mask = waterMask, w, h, terrainSize]()
+            {
+                g_terrain.UploadWaterMaskFromTerrain(mask, w, h);
+                UpdateWaterMesh(mask, w, h, terrainSize);   // только тайлы, где поменялась маска
+            });
     }
-    void UploadWaterMaskFromTerrain()
+    void UploadWaterMaskFromTerrain(const std::vector<uint8_t>& mask, int w, int h)
     {
-        if (waterW <= 0 || waterH <= 0 ||
-            waterMask.empty())
+        if (w <= 0 || h <= 0 ||
+            (int)mask.size() != w * h)
             return;
 
         if (!g_waterMaskTex)
             glGenTextures(1, &g_waterMaskTex);
 
-        glBindTexture(GL_TEXTURE_2D, g_waterMaskTex);
+        g_gl.BindTexture(GL_TEXTURE_2D, g_waterMaskTex);
 
         glTexImage2D(
             GL_TEXTURE_2D, 0,
             GL_R8,                           // один канал (маска)
-            waterW,
-            waterH,
+            w,
+            h,
             0,
             GL_RED, GL_UNSIGNED_BYTE,
-            waterMask.data()
+            mask.data()
         );
+        CountGpuUpload(mask.size());
+        MemGpuTexture(g_waterMaskTex, GL_R8, w, h, false, MEM_WATER);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+        g_gl.BindTexture(GL_TEXTURE_2D, 0);
     }
 
     void RebuildVertices()
     {
-        if (!vbo || width <= 0 || height <= 0 || heights.empty())
+        TRACE_SCOPE("Terrain::RebuildVertices");
+        ALLOC_SCOPE("Terrain::RebuildVertices");
+        if (width <= 0 || height <= 0 || heights.empty())
             return;
 
-        std::vector<float> verts(width * height * 9);
-
-        float half = size * 0.5f;
-        float cell = size / float(width - 1);
+        ArenaVector<float> verts;
+        BuildVertices(verts);
 
-        // позиции, uv, material
-        for (int z = 0; z < height; ++z)
-        {
-            for (int x = 0; x < width; ++x)
+        // Заливает поток рендера: вершины переезжают в команду (память — арена сима,
+        // держится, пока заливка не закончится, frame_arena.h)
+        g_gpuCommands.Push([verts = std::move(verts)]() mutable
             {
-                int idx = z * width + x;
-                float wx = -half + x * cell;
-                float wz = -half + z * cell;
-                float wy = heights[idx];
-
-                int o = idx * 9;
-                verts[o + 0] = wx;
-                verts[o + 1] = wy;
-                verts[o + 2] = wz;
-
-                // временная нормаль — позже пересчитаем
-                verts[o + 3] = 0.0f;
-                verts[o + 4] = 1.0f;
-                verts[o + 5] = 0.0f;
-
-                verts[o + 6] = (float)x / (width - 1) * 16.0f;
-                verts[o + 7] = (float)z / (height - 1) * 16.0f;
-
-                float m = material.empty() ? 0.0f : material[idx];
-                verts[o + 8] = m;
-            }
-        }
+                g_terrain.UploadVertices(std::make_shared<ArenaVector<float>>(std::move(verts)));
+            });
+    }
 
-        // нормали
-        for (int z = 1; z < height - 1; ++z)
-        {
-            for (int x = 1; x < width - 1; ++x)
+    // поток рендера. ~38 МБ на 1024x1024 идут через кольцо кусками за несколько кадров
+    // (stream_upload.h) — в задний VBO; рисуем передний, целый. Последний кусок ушёл —
+    // меняем местами: швов из старых и новых вершин на экране не бывает
+    void UploadVertices(std::shared_ptr<ArenaVector<float>> verts)
+    {
+        if (!vboBack || verts->empty())
+            return;
+        g_upload.Upload(vboBack, 0, verts->data(), (GLsizeiptr)(verts->size() * sizeof(float)), verts,
+            [this]()
             {
-                float hL = heights[z * width + (x - 1)];
-                float hR = heights[z * width + (x + 1)];
-                float hD = heights[(z - 1) * width + x];
-                float hU = heights[(z + 1) * width + x];
-
-                glm::vec3 n = glm::normalize(glm::vec3(
-                    hL - hR,
-                    2.0f * cell,
-                    hD - hU
-                ));
-
-                int o = (z * width + x) * 9;
-                verts[o + 3] = n.x;
-                verts[o + 4] = n.y;
-                verts[o + 5] = n.z;
-            }
-        }
+                std::swap(vao, vaoBack);
+                std::swap(vbo, vboBack);
+            });
+    }
 
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0,
-            verts.size() * sizeof(float),
-            verts.data());
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // старт: маска из запечённого мира, иначе заново
+    void LoadWaterMask()
+    {
+        waterW = width;
+        waterH = height;
+        if (!WorldCacheRead(WORLD_WATER_MASK, waterMask, (size_t)width * height))
+            RebuildWaterMask();
+        MemTrackVector(waterMask, MEM_WATER);
     }
 
     void RebuildWaterMask()
     {
+        TRACE_SCOPE("Terrain::RebuildWaterMask");
         // карта воды имеет тот же размер, что и сетка высот
         waterW = width;
         waterH = height;
+        BuildWaterMask(g_waterHeight, waterMask);
+        MemTrackVector(waterMask, MEM_WATER);
+    }
 
-        if (waterW <= 0 || waterH <= 0 || heights.empty())
-            return;
-
-        waterMask.assign(waterW * waterH, 0);
-
-        std::queue< std::pair<int, int> > q;
-
-        // вспомогательная лямбда в духе TryPushCell
-        auto TryPush = [&](int x, int z)
-            {
-                if (x < 0 || x >= waterW || z < 0 || z >= waterH)
-                    return;
-
-                int idx = z * waterW + x;
-                if (waterMask[idx])     // уже помечен
-                    return;
 
-                float h = heights[idx]; // текущая высота террейна
-                if (h < g_waterHeight)  // ниже уровня моря — потенциал воды
-                {
-                    q.push(std::make_pair(x, z));
-                }
-            };
-
-        // стартуем с краёв карты (океан вокруг)
-        for (int x = 0; x < waterW; ++x)
-        {
-            TryPush(x, 0);           // верхняя кромка
-            TryPush(x, waterH - 1);  // нижняя
-        }
-        for (int z = 0; z < waterH; ++z)
-        {
-            TryPush(0, z);    // левая
-            TryPush(waterW - 1, z);    // правая
-        }
+    // постоянные uniform'ы воды — на каждый вариант программы (после build())
+    void SetupWaterUniforms(GLuint prog)
+    {
+        // цвет воды (можно позже вынести в параметры)
+        glUniform3f(UniformLoc(prog, "uWaterColor"), 0.0f, 0.4f, 1.0f);
 
-        // flood fill
-        while (!q.empty())
-        {
-            std::pair<int, int> p = q.front();
-            q.pop();
-            int x = p.first;
-            int z = p.second;
+        // маска воды и размер террейна
+        glUniform1i(UniformLoc(prog, "uWaterMask"), 0);
+        glUniform1f(UniformLoc(prog, "uTerrainSize"), size);
 
-            int idx = z * waterW + x;
-            if (waterMask[idx])
-                continue;
+        // отражение неба — из sky-view LUT (sky.h)
+        SetSkyLUTSamplers(prog);
 
-            waterMask[idx] = 255;
-
-            // 4-соседа
-            TryPush(x + 1, z);
-            TryPush(x - 1, z);
-            TryPush(x, z + 1);
-            TryPush(x, z - 1);
-        }
+        // у воды свой туман (всегда подводный), не тот, что в блоке Frame
+        glUniform3fv(UniformLoc(prog, "uWaterFogColor"), 1, &fogColorUnder[0]);
+        glUniform1f(UniformLoc(prog, "uWaterFogDensity"), fogDensityUnder);
     }
 
-
-    void DrawWater(const glm::mat4& proj, const glm::mat4& view)
+    // halfRes — в половинку water_halfres.h: альфа копится отдельно, глубину не пишем
+    void DrawWater(const glm::mat4& proj, const glm::mat4& view, bool halfRes = false)
     {
-        if (!g_waterShader || !g_waterVAO) return;
-
-        glDepthRange(0.0, 1.0);
+        if (!g_waterShader || !g_waterVAO || g_waterMesh.indexCount == 0) return;
 
-        glUseProgram(g_waterShader);
+        g_gl.DepthRange(0.0, 1.0);
 
-        // подводный режим
-        glUniform1i(glGetUniformLocation(g_waterShader, "uUnderwater"),underwater ? 1 : 0);
+        g_gl.UseProgram(g_waterShader);
 
+        // подводный режим (uUnderwater/матрицы/камера — в блоке Frame)
         if (underwater) {
-            glDisable(GL_CULL_FACE);
-            glUniform1f(glGetUniformLocation(g_waterShader, "uAlpha"), 0.85f);
+            glUniform1f(UniformLoc(g_waterShader, "uAlpha"), 0.85f);
         }
         else {
-            glUniform1f(glGetUniformLocation(g_waterShader, "uAlpha"), 0.95f);
+            glUniform1f(UniformLoc(g_waterShader, "uAlpha"), 0.95f);
         }
 
-        glUniformMatrix4fv(glGetUniformLocation(g_waterShader, "uProjection"),
-            1, GL_FALSE, &proj[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(g_waterShader, "uView"),
-            1, GL_FALSE, &view[0][0]);
-        glUniform1f(glGetUniformLocation(g_waterShader, "uTime"), g_time);
-
-        // цвет воды (можно позже вынести в параметры)
-        glUniform3f(glGetUniformLocation(g_waterShader, "uWaterColor"),
-            0.0f, 0.4f, 1.0f);
-
-        // === НОВОЕ: маска воды и размер террейна ===
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, g_waterMaskTex);
-        glUniform1i(glGetUniformLocation(g_waterShader, "uWaterMask"), 0);
-
-        glUniform1f(glGetUniformLocation(g_waterShader, "uTerrainSize"), size);
-
-
-        // новые uniforms
-        glm::vec3 skyColor(0.55f, 0.72f, 0.95f); // под цвет твоего неба
-        glUniform3fv(glGetUniformLocation(g_waterShader, "uSkyColor"),
-            1, &skyColor[0]);
-
-        glm::vec3 lightDir = glm::normalize(glm::vec3(0.4f, 1.0f, 0.2f));
-        glUniform3fv(glGetUniformLocation(g_waterShader, "uLightDir"),
-            1, &lightDir[0]);
-
-        glUniform3fv(glGetUniformLocation(g_waterShader, "uCamPos"),
-            1, &g_cam.pos[0]);
-        glUniform3fv(glGetUniformLocation(g_waterShader, "uFogColor"),
-            1, &fogColorUnder[0]);   // или твой глобальный
-        glUniform1f(glGetUniformLocation(g_waterShader, "uFogDensity"),
-            fogDensityUnder);        // тот же, что для подводного тумана
+        g_gl.ActiveTexture(GL_TEXTURE0);
+        g_gl.BindTexture(GL_TEXTURE_2D, g_waterMaskTex);
 
 
         // рендер стейты
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glEnable(GL_DEPTH_TEST);
-        glDepthMask(GL_TRUE);
-        glDisable(GL_CULL_FACE);
-
-        glBindVertexArray(g_waterVAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        g_gl.Enable(GL_BLEND);
+        if (halfRes)
+            g_gl.BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        else
+            g_gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        g_gl.Enable(GL_DEPTH_TEST);
+        g_gl.DepthFunc(GL_LEQUAL);
+        g_gl.Disable(GL_CULL_FACE);
+
+        // глубину воды читает туман в пост-проходе: над водой поверхность почти
+        // непрозрачна — туманим по ней; снизу она невидима (alpha 0) — глубину не пишем,
+        // иначе туман считался бы до поверхности, а не до того, что видно сквозь неё
+        // (в половинке глубина — уменьшенная глубина мира, по ней апскейл; дистанцию пишем в цвет1)
+        g_gl.DepthMask((underwater || halfRes) ? GL_FALSE : GL_TRUE);
+
+        g_gl.BindVertexArray(g_waterVAO);
+        glDrawElements(GL_TRIANGLES, g_waterMesh.indexCount, GL_UNSIGNED_INT, 0);
+        ProfDraw(GL_TRIANGLES, g_waterMesh.indexCount);
     }
 
 };
@@ -782,7 +593,11 @@ Terrain g_terrain;
 #include "grass.h"
 #include "rake.h"
 #include "shovel.h"
+#include "input.h"
 #include "chainsaw_test.h"
+#include "depth_prepass.h"
+#include "bench.h"
+#include "dynres.h"
 
 void RemoveGrassInRadius(const glm::vec3& center, float radius);
 bool IsTreeBlockingDig(const glm::vec3& center, float holeRadius);
@@ -792,7 +607,8 @@ bool IsTreeBlockingDig(const glm::vec3& center, float holeRadius);
 void InitSceneFBO(int w, int h);
 GLuint g_sceneFBO = 0;
 GLuint g_sceneColorTex = 0;
-GLuint g_sceneDepthRBO = 0;
+int g_sceneFBOWidth = 0, g_sceneFBOHeight = 0;   // под окно; мир — в его части (dynres.h)
+GLuint g_sceneDepthTex = 0;   // сэмплится в пост-проходе (туман по глубине)
 //FBO--
 
 //создаём VAO/VBO++
@@ -800,6 +616,8 @@ GLuint g_screenVAO = 0, g_screenVBO = 0;
 void InitScreenQuad();
 //создаём VAO/VBO--
 
+#include "water_halfres.h"
+
 struct Grass {
     GLuint vao = 0;
     GLuint vboQuad = 0;
@@ -866,6 +684,7 @@ void CaptureMouse(bool capture)
     }
 }
 
+// главный поток (окно): смещение курсора копится, сим забирает его в начале тика (input.h)
 void ProcessMouse()
 {
     if (!g_mouseCaptured) return;
@@ -876,6 +695,20 @@ void ProcessMouse()
     int dx = p.x - g_centerPos.x;
     int dy = p.y - g_centerPos.y;
 
+    if (dx != 0 || dy != 0) {
+        g_simInput.mouseDx += dx;
+        g_simInput.mouseDy += dy;
+
+        SetCursorPos(g_centerPos.x, g_centerPos.y);
+    }
+}
+
+// сим-поток, начало тика
+void ApplyMouseInput()
+{
+    int dx = InputMouseDx();
+    int dy = InputMouseDy();
+
     if (dx != 0 || dy != 0) {
         g_cam.yaw += dx * g_mouseSensitivity;
         g_cam.pitch -= dy * g_mouseSensitivity;
@@ -884,15 +717,38 @@ void ProcessMouse()
         if (g_cam.pitch < -89.0f) g_cam.pitch = -89.0f;
 
         g_cam.updateVectors();
-
-        SetCursorPos(g_centerPos.x, g_centerPos.y);
     }
 }
 
+// переключатели рендера — в главном потоке, раз в кадр
+void PollRenderKeys()
+{
+    // depth pre-pass вкл/выкл (сравнить overdraw на траве)
+    if (GetAsyncKeyState('P') & 0x0001)
+        g_depthPrepass = !g_depthPrepass;
+
+    // вода в половинном разрешении вкл/выкл (water_halfres.h)
+    if (GetAsyncKeyState('H') & 0x0001)
+        g_waterHalfRes = !g_waterHalfRes;
+
+    // оверлей профайлера по проходам (profiler.h)
+    if (GetAsyncKeyState(VK_F3) & 0x0001)
+        g_prof.overlay = !g_prof.overlay;
+
+    // запись трассы: старт / стоп со сбросом в trace.json (trace.h)
+    if (GetAsyncKeyState(VK_F4) & 0x0001)
+        TraceToggle();
+
+    // память по тегам: таблица в лог и в mem_report.txt (mem_track.h)
+    if (GetAsyncKeyState(VK_F5) & 0x0001)
+        MemWriteReport("mem_report.txt");
+}
+
 void TryStartCut();
 
 void UpdateCamera(float dt)
 {
+    TRACE_SCOPE("UpdateCamera");
 
     //if (GetAsyncKeyState(VK_ESCAPE) & 0x0001)
     //{
@@ -900,28 +756,28 @@ void UpdateCamera(float dt)
     //    return;
     //}
     
-    ProcessMouse();
+    ApplyMouseInput();
 
     if (g_cutAnim.active)
     {
         float step = 0.05f;
         float rotStep = glm::radians(2.0f);
 
-        if (GetAsyncKeyState(VK_LEFT) & 0x8000) g_cutAnim.pos.x -= step;
-        if (GetAsyncKeyState(VK_RIGHT) & 0x8000) g_cutAnim.pos.x += step;
-        if (GetAsyncKeyState(VK_UP) & 0x8000) g_cutAnim.pos.z -= step;
-        if (GetAsyncKeyState(VK_DOWN) & 0x8000) g_cutAnim.pos.z += step;
+        if (InputHeld(VK_LEFT)) g_cutAnim.pos.x -= step;
+        if (InputHeld(VK_RIGHT)) g_cutAnim.pos.x += step;
+        if (InputHeld(VK_UP)) g_cutAnim.pos.z -= step;
+        if (InputHeld(VK_DOWN)) g_cutAnim.pos.z += step;
 
-        if (GetAsyncKeyState(VK_PRIOR) & 0x8000) g_cutAnim.pos.y += step; // PageUp
-        if (GetAsyncKeyState(VK_NEXT) & 0x8000) g_cutAnim.pos.y -= step; // PageDown
+        if (InputHeld(VK_PRIOR)) g_cutAnim.pos.y += step; // PageUp
+        if (InputHeld(VK_NEXT)) g_cutAnim.pos.y -= step; // PageDown
 
-        if (GetAsyncKeyState(VK_NUMPAD1) & 0x8000) g_cutAnim.rot.y -= rotStep;
-        if (GetAsyncKeyState(VK_NUMPAD3) & 0x8000) g_cutAnim.rot.y += rotStep;
+        if (InputHeld(VK_NUMPAD1)) g_cutAnim.rot.y -= rotStep;
+        if (InputHeld(VK_NUMPAD3)) g_cutAnim.rot.y += rotStep;
 
-        if (GetAsyncKeyState(VK_OEM_MINUS) & 0x8000)
+        if (InputHeld(VK_OEM_MINUS))
             g_cutAnim.scale = glm::max(0.01f, g_cutAnim.scale - 0.01f);
 
-        if (GetAsyncKeyState(VK_OEM_PLUS) & 0x8000)
+        if (InputHeld(VK_OEM_PLUS))
             g_cutAnim.scale += 0.01f;
     }
 
@@ -939,7 +795,7 @@ void UpdateCamera(float dt)
 
 
     auto key = [](int vk) {
-        return (GetAsyncKeyState(vk) & 0x8000) != 0;
+        return InputHeld(vk);
         };
 
     float moveSpeed = 10.0f;
@@ -952,17 +808,17 @@ void UpdateCamera(float dt)
     if (key('D')) move += g_cam.right;
 
     //Управление инструментом
-    if (GetAsyncKeyState('1') & 0x0001) { // 0x0001 = нажатие (edge)
+    if (InputPressed('1')) { // нажатие (edge) за тик
         g_currentTool = (g_currentTool == TOOL_RAKE) ? TOOL_NONE : TOOL_RAKE;
     }
 
-    if (GetAsyncKeyState('2') & 0x0001)
+    if (InputPressed('2'))
         g_currentTool = (g_currentTool == TOOL_SHOVEL) ? TOOL_NONE : TOOL_SHOVEL;
 
-    if (GetAsyncKeyState('0') & 0x0001)
+    if (InputPressed('0'))
         g_currentTool = (g_currentTool == TOOL_CHAINSAW_TEST) ? TOOL_NONE : TOOL_CHAINSAW_TEST;
 
-    bool key9 = (GetAsyncKeyState('9') & 0x0001) != 0;
+    bool key9 = InputPressed('9');
     if (key9)
     {
         glm::vec3 p = g_cam.pos + g_cam.front * 2.0f;
@@ -974,7 +830,7 @@ void UpdateCamera(float dt)
     //Если выбраны грабли отлов левой клавиши мыши для  удаления травы
     // Запуск анимации взмаха граблями по клику
     if (g_currentTool == TOOL_RAKE &&
-        (GetAsyncKeyState(VK_LBUTTON) & 0x8000) &&
+        InputHeld(VK_LBUTTON) &&
         !g_rakeSwinging)
     {
         g_rakeSwinging = true;
@@ -984,7 +840,7 @@ void UpdateCamera(float dt)
 
     // Лопата: копаем ямку ЛКМ, радиус 0.5м, глубина 0.5м, дистанция до 3м
     if (g_currentTool == TOOL_SHOVEL &&
-        (GetAsyncKeyState(VK_LBUTTON) & 0x8000) &&
+        InputHeld(VK_LBUTTON) &&
         !g_shovelSwinging)
     {
         g_shovelSwinging = true;
@@ -992,8 +848,8 @@ void UpdateCamera(float dt)
         g_shovelHitDone = false;
     }
 
-    // 2) ЛКМ "одноразовое нажатие" (edge) — сработает ровно 1 кадр
-    bool lmbPressed = (GetAsyncKeyState(VK_LBUTTON) & 0x0001) != 0;
+    // 2) ЛКМ "одноразовое нажатие" (edge) — сработает ровно 1 тик
+    bool lmbPressed = InputPressed(VK_LBUTTON);
 
     // 3) Старт распила ТОЛЬКО если в руках бензопила
     if (g_currentTool == TOOL_CHAINSAW_TEST && lmbPressed && !g_cuttingTree)
@@ -1090,6 +946,8 @@ void UpdateCamera(float dt)
                 {
                     RemoveGrassInRadius(hit, holeRadius);
                     g_terrain.Dig(hit, holeRadius);
+                    ++g_terrainEdits;
+                    g_lastTerrainEdit = glm::vec4(hit, holeRadius);
                 }
             }
         }
@@ -1104,7 +962,7 @@ void UpdateCamera(float dt)
 
     if (g_currentTool == TOOL_RAKE)
     {
-        bool lmb = (GetAsyncKeyState(VK_LBUTTON) & 0x8000) != 0;
+        bool lmb = InputHeld(VK_LBUTTON);
 
         if (lmb)
         {
@@ -1138,123 +996,335 @@ bool IsCameraUnderwater()
     return hasWaterHere && (g_cam.pos.y < g_waterHeight - 0.05f);
 }
 
-// ===== РЕНДЕР =====
+// ===== СИМУЛЯЦИЯ (sim_thread.h) =====
 
-void Render()
+// один фиксированный тик: ввод, игрок, инструменты, правки мира
+void SimTick(float dt)
 {
-    // 1) Рисуем МИР в FBO
-    glBindFramebuffer(GL_FRAMEBUFFER, g_sceneFBO);
-    
-    glViewport(0, 0, g_winWidth, g_winHeight);
-   
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-    if(!underwater)
-        glClearColor(0.5f, 0.7f, 1.0f, 1.0f);
-    else
-        glClearColor(0.29f, 0.44f, 1.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // ввод тика: живой, в запись или из записи (-record / -replay)
+    InputBeginTick(g_currentTool);
+    g_currentTool = g_input.cur.tool;
 
-    glm::mat4 proj = glm::perspective(glm::radians(60.0f),
-        float(g_winWidth) / float(g_winHeight),
-        0.1f, 500.0f);
-    glm::mat4 view = g_cam.getView();
-    glm::mat4 model = glm::mat4(1.0f);
+    UpdateCamera(dt);
+    UpdateChainsawTest(dt);
+    g_time += dt;
 
-    DrawSkySphere(proj, view);
+    InputEndTick(g_cam.pos, g_cam.yaw, g_cam.pitch);
+}
 
-    // === Для подводы ===
-    underwater = IsCameraUnderwater();
-    
+// игровые глобалы -> снапшот; в конце тика, в том же потоке
+void CaptureSimSnapshot(SimSnapshot& s)
+{
+    s.camPos = g_cam.pos;
+    s.camYaw = g_cam.yaw;
+    s.camPitch = g_cam.pitch;
+    s.underwater = IsCameraUnderwater();
+
+    s.tool = g_currentTool;
+    s.rakeSwinging = g_rakeSwinging;
+    s.rakeSwingTime = g_rakeSwingTime;
+    s.shovelSwinging = g_shovelSwinging;
+    s.shovelSwingTime = g_shovelSwingTime;
+    s.cuttingTree = g_cuttingTree;
+    s.cutTime = g_cutTime;
+    s.chainsawTime = g_chainsawTime;
+    s.toolOffset = g_toolOffset;
+
+    s.cutAnimActive = g_cutAnim.active;
+    s.cutAnimPos = g_cutAnim.pos;
+    s.cutAnimRot = g_cutAnim.rot;
+    s.cutAnimScale = g_cutAnim.scale;
+    s.cutAnimTime = g_cutAnim.t;
+
+    s.treeRemovals = g_treeRemovals;
+    s.terrainEdits = g_terrainEdits;
+    s.lastEdit = g_lastTerrainEdit;
+}
+
+// главный поток, до Render(): камера и анимации моделей — по состоянию кадра
+void ApplyRenderState()
+{
+    const SimSnapshot& rs = g_renderState;
+
+    g_renderCam.pos = rs.camPos;
+    g_renderCam.yaw = rs.camYaw;
+    g_renderCam.pitch = rs.camPitch;
+    g_renderCam.updateVectors();
+
+    AnimateChainsawTest(rs);
+    AnimateCutTree(rs);
+}
 
-    // Раздаём туман всем шейдерам МИРА
-    for (auto sh : { g_shader, g_treeShader, g_grassShader, g_waterShader })
+// ===== ВАРИАНТЫ ШЕЙДЕРОВ МИРА =====
+
+void SetupTerrainVariant(GLuint prog)
+{
+    glm::mat4 I(1.0f);
+    glUniformMatrix4fv(UniformLoc(prog, "uModel"), 1, GL_FALSE, &I[0][0]);
+    glUniform1i(UniformLoc(prog, "uTexGrass"), 0);
+    glUniform1i(UniformLoc(prog, "uTexSand"), 1);
+}
+
+void SetupTreeVariant(GLuint prog)
+{
+    glUniform1f(UniformLoc(prog, "uMaxDist"), 250.0f); // дальность леса, по вкусу
+}
+
+void SetupWaterVariant(GLuint prog)
+{
+    g_terrain.SetupWaterUniforms(prog);
+}
+
+// туман у материалов больше не считается (пост-проход), подвода важна только воде
+ShaderFamily g_terrainFamily = { "terrain.vert", "terrain.frag", 0, SetupTerrainVariant };
+ShaderFamily g_grassFamily = { "grass.vert", "grass.frag", SV_ALPHA_TEST, nullptr };
+ShaderFamily g_treeFamily = { "tree_mesh.vert", "tree_mesh.frag", SV_ALPHA_TEST | SV_INSTANCED, SetupTreeVariant };
+// срубленное дерево: свой вершинник (скиннинг), фрагментник — как у леса, но без дальности
+ShaderFamily g_cutFamily = { "cut_anim.vert", "tree_mesh.frag", SV_ALPHA_TEST, nullptr };
+ShaderFamily g_waterFamily = { "water.vert", "water.frag", SV_UNDERWATER, SetupWaterVariant };
+
+unsigned WorldVariantBits(bool under)
+{
+    return under ? SV_UNDERWATER : 0u;
+}
+
+// раз в кадр: хэндлы g_shader / g_treeShader / ... указывают на вариант под этот кадр
+void SelectWorldVariants(unsigned bits, bool prewarm = false)
+{
+    g_shader = GetShaderVariant(g_terrainFamily, bits, prewarm);
+    g_grassShader = GetShaderVariant(g_grassFamily, bits | SV_ALPHA_TEST, prewarm);
+    g_treeShader = GetShaderVariant(g_treeFamily, bits | SV_ALPHA_TEST | SV_INSTANCED, prewarm);
+    g_cutShader = GetShaderVariant(g_cutFamily, bits | SV_ALPHA_TEST, prewarm);
+    g_waterShader = GetShaderVariant(g_waterFamily, bits, prewarm);
+
+    // после depth pre-pass — без discard
+    if (g_depthPrepass)
     {
-        glUseProgram(sh);
+        g_grassShaderPrepassed = GetShaderVariant(g_grassFamily, bits, prewarm);
+        g_treeShaderPrepassed = GetShaderVariant(g_treeFamily, bits | SV_INSTANCED, prewarm);
+    }
+}
 
-        glUniform3fv(glGetUniformLocation(sh, "uCamPos"), 1, &g_cam.pos[0]);
-        glUniform1i(glGetUniformLocation(sh, "uUnderwater"), underwater ? 1 : 0);
+// ===== РЕНДЕР =====
 
-        if (underwater)
-        {
-            glUniform3fv(glGetUniformLocation(sh, "uFogColor"), 1, &fogColorUnder[0]);
-            glUniform1f(glGetUniformLocation(sh, "uFogDensity"), fogDensityUnder);
-        }
-        else
-        {
-            glUniform3fv(glGetUniformLocation(sh, "uFogColor"), 1, &fogColorTop[0]);
-            glUniform1f(glGetUniformLocation(sh, "uFogDensity"), fogDensityTop);
-        }
+void DrawTerrain()
+{
+    // uModel / юниты сэмплеров выставлены один раз при создании программы
+    g_gl.UseProgram(g_shader);
+    g_gl.Disable(GL_BLEND);
+    g_gl.Enable(GL_CULL_FACE);
+    if (g_depthPrepass)
+        BeginPrepassedColor();
+    else {
+        g_gl.Enable(GL_DEPTH_TEST);
+        g_gl.DepthMask(GL_TRUE);
+        g_gl.DepthFunc(GL_LEQUAL);
     }
 
-   
+    g_gl.ActiveTexture(GL_TEXTURE0);
+    g_gl.BindTexture(GL_TEXTURE_2D, g_terrainGrassTex);
 
-    // === ТЕРРЕЙН ===
-    glUseProgram(g_shader);
+    g_gl.ActiveTexture(GL_TEXTURE1);
+    g_gl.BindTexture(GL_TEXTURE_2D, g_terrainSandTex);
+    g_gl.ActiveTexture(GL_TEXTURE0);
 
-    glm::vec3 lightDir = glm::normalize(glm::vec3(0.4f, 1.0f, 0.2f));
-    glUniform3fv(glGetUniformLocation(g_shader, "uLightDir"), 1, &lightDir[0]);
-    glUniformMatrix4fv(glGetUniformLocation(g_shader, "uProjection"), 1, GL_FALSE, &proj[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(g_shader, "uView"), 1, GL_FALSE, &view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(g_shader, "uModel"), 1, GL_FALSE, &model[0][0]);
+    g_terrain.draw();
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, g_terrainGrassTex);
-    glUniform1i(glGetUniformLocation(g_shader, "uTexGrass"), 0);
+// Все отрисовки кадра идут пакетами в g_renderQueue; порядок — по ключу
+// (проход, bucket, состояние, глубина), см. render_queue.h
+void SubmitScene(RenderQueue& q)
+{
+    const glm::vec3 cam = g_renderCam.pos;
+    GLuint treeTex = 0, treeVao = 0;
+    if (!g_treeModel.meshes.empty()) {
+        const Mesh& m0 = g_treeModel.meshes[0];
+        treeTex = m0.textures.empty() ? 0 : m0.textures[0].id;
+        treeVao = m0.vao;
+    }
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, g_terrainSandTex);
-    glUniform1i(glGetUniformLocation(g_shader, "uTexSand"), 1);
+    // depth pre-pass: террейн первым (дальше всех не бывает, зато закрывает больше всего)
+    if (g_depthPrepass)
+    {
+        q.Submit(PASS_DEPTH, BUCKET_OPAQUE, g_terrainDepthShader, 0, g_terrain.vao, cam,
+            [](const DrawPacket&, const RenderView&) { ProfScope z(PROF_PREPASS); DrawTerrainDepth(); });
+        q.Submit(PASS_DEPTH, BUCKET_ALPHATEST, g_treeDepthShader, treeTex, treeVao, cam,
+            [](const DrawPacket&, const RenderView&) { ProfScope z(PROF_PREPASS); DrawTreesDepth(); });
+        q.Submit(PASS_DEPTH, BUCKET_ALPHATEST, g_grassDepthShader, g_grassTex, g_grassVAO, cam,
+            [](const DrawPacket&, const RenderView&) { ProfScope z(PROF_PREPASS); DrawGrassDepth(); });
+    }
 
-    
+    q.Submit(PASS_WORLD, BUCKET_OPAQUE, g_shader, g_terrainGrassTex, g_terrain.vao, cam,
+        [](const DrawPacket&, const RenderView&) { ProfScope z(PROF_TERRAIN); DrawTerrain(); });
 
-    g_terrain.draw();
+    q.Submit(PASS_WORLD, BUCKET_ALPHATEST, g_depthPrepass ? g_treeShaderPrepassed : g_treeShader, treeTex, treeVao, cam,
+        [](const DrawPacket&, const RenderView& v) { ProfScope z(PROF_TREES); DrawTreeObjects(v.proj, v.view); });
+
+    q.Submit(PASS_WORLD, BUCKET_ALPHATEST, g_depthPrepass ? g_grassShaderPrepassed : g_grassShader, g_grassTex, g_grassVAO, cam,
+        [](const DrawPacket&, const RenderView& v) { ProfScope z(PROF_GRASS); DrawGrass(v.proj, v.view); });
+
+    if (g_renderState.cutAnimActive)
+        q.Submit(PASS_WORLD, BUCKET_ALPHATEST, g_cutShader, 0, 0, g_renderState.cutAnimPos,
+            [](const DrawPacket&, const RenderView& v) { ProfScope z(PROF_CUTANIM); DrawCutAnim(v.proj, v.view); });
+
+    // бенчмарк (если запущен с -bench)
+    if (g_bench.mode != BENCH_NONE)
+        q.Submit(PASS_WORLD, BUCKET_OPAQUE, g_cutShader, 0, 0, cam,
+            [](const DrawPacket&, const RenderView& v) { BenchDraw(v.proj, v.view); });
+
+    // небо — после непрозрачного, до воды (вода смешивается с ним)
+    q.Submit(PASS_WORLD, BUCKET_BACKGROUND, g_skyShader, 0, g_skyVAO, cam,
+        [](const DrawPacket&, const RenderView&) { ProfScope z(PROF_SKY); DrawSky(); });
+
+    // вода — прозрачная, дистанция до плоскости воды (или отдельно, в половинном разрешении)
+    if (!WaterHalfResActive())
+        q.Submit(PASS_WORLD, BUCKET_TRANSPARENT, g_waterShader, g_waterMaskTex, g_waterVAO,
+            glm::vec3(cam.x, g_waterHeight, cam.z),
+            [](const DrawPacket&, const RenderView& v) { ProfScope z(PROF_WATER); g_terrain.DrawWater(v.proj, v.view); });
+
+    // 3) Вьюмодели (грабли/лопата) — поверх постобработки
+    q.Submit(PASS_VIEWMODEL, BUCKET_OPAQUE, g_rakeShader, 0, 0, cam,
+        [](const DrawPacket&, const RenderView& v) { ProfScope z(PROF_VIEWMODEL); DrawRakeViewModel(v.proj, v.view); });
+    q.Submit(PASS_VIEWMODEL, BUCKET_OPAQUE, g_shovelShader, 0, 0, cam,
+        [](const DrawPacket&, const RenderView& v) { ProfScope z(PROF_VIEWMODEL); DrawShovelViewModel(v.proj, v.view); });
+    if (!g_renderState.cutAnimActive)
+        q.Submit(PASS_VIEWMODEL, BUCKET_OPAQUE, g_chainsawShader, 0, 0, cam,
+            [](const DrawPacket&, const RenderView& v) { ProfScope z(PROF_VIEWMODEL); DrawChainsawTestViewModel(v.proj, v.view); });
+}
+
+void Render()
+{
+    TRACE_SCOPE("Render");
+    ALLOC_SCOPE("Render");
+    ProfBeginFrame();
+
+    // окно поменяло размер — FBO под новый (свёрнутое окно пропускаем)
+    if (g_winWidth > 0 && g_winHeight > 0 &&
+        (g_winWidth != g_sceneFBOWidth || g_winHeight != g_sceneFBOHeight))
+        InitSceneFBO(g_winWidth, g_winHeight);
+
+    // LUT'ы неба — только если сдвинулось солнце (свой FBO, до сцены)
+    {
+        ProfScope z(PROF_SKY);
+        UpdateSkyLUTs();
+    }
 
-    // === ДЕРЕВЬЯ ===
-    DrawTreeObjects(proj, view);
+    // 1) Рисуем МИР в FBO — в угол размером scale * окно (динамическое разрешение)
+    glBindFramebuffer(GL_FRAMEBUFFER, g_sceneFBO);
 
-    // === ТРАВА ===
-    DrawGrass(proj, view);
+    int sceneW, sceneH;
+    DynResViewport(sceneW, sceneH);
+    glViewport(0, 0, sceneW, sceneH);
 
-    // === ВОДА ===
-    g_terrain.DrawWater(proj, view);
+    // glClear уважает маску глубины, а вьюмодели прошлого кадра могли сузить depth range
+    g_gl.Enable(GL_DEPTH_TEST);
+    g_gl.DepthMask(GL_TRUE);
+    g_gl.DepthRange(0.0, 1.0);
 
-    //распиливание дерева
-    DrawCutAnim(proj, view);
+    // === Для подводы === (считает сим: маска воды и высоты — его данные)
+    // до glClearColor: иначе цвет очистки отстаёт на снимок при пересечении поверхности
+    underwater = g_renderState.underwater;
+
+    if(!underwater)
+        glClearColor(0.5f, 0.7f, 1.0f, 1.0f);
+    else
+        glClearColor(0.29f, 0.44f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f),
+        float(g_winWidth) / float(g_winHeight),
+        0.1f, 500.0f);
+    glm::mat4 view = g_renderCam.getView();
+
+    // Общие константы кадра: матрицы, камера, свет, туман — один UBO на все шейдеры
+    FrameConstants fc;
+    fc.proj = proj;
+    fc.view = view;
+    fc.camPos = g_renderCam.pos;
+    fc.time = (float)g_renderState.time;
+    fc.lightDir = glm::normalize(glm::vec3(0.4f, 1.0f, 0.2f));
+    fc.fogColor = underwater ? fogColorUnder : fogColorTop;
+    fc.fogDensity = underwater ? fogDensityUnder : fogDensityTop;
+    fc.underwater = underwater ? 1 : 0;
+    UpdateFrameUBO(fc);
+
+    // подвода — выбор варианта программ, а не ветка в шейдере
+    SelectWorldVariants(WorldVariantBits(underwater));
+
+    // Собираем пакеты всего кадра и сортируем один раз
+    g_renderQueue.Begin(proj, view, g_renderCam.pos);
+    SubmitScene(g_renderQueue);
+    g_renderQueue.Sort();
+
+    DynResGpuBegin();
+    BenchGpuBegin();
+
+    // depth pre-pass: только глубина
+    if (g_depthPrepass)
+    {
+        g_gl.ColorMask(false);
+        g_renderQueue.Execute(PASS_DEPTH, PASS_DEPTH);
+        g_gl.ColorMask(true);
+    }
+
+    // мир (opaque front-to-back, потом alpha-tested, потом прозрачное back-to-front)
+    g_renderQueue.Execute(PASS_WORLD, PASS_WORLD);
+
+    bool waterHalf = WaterHalfResActive();
+    if (waterHalf)
+    {
+        ProfScope z(PROF_WATER);
+        RenderWaterHalfRes(sceneW, sceneH, proj, view);
+    }
+    BenchGpuEnd();
 
     // 2) Пост-обработка: рисуем FBO на ЭКРАН
+    bool postZone = ProfBeginZone(PROF_POST);
     glBindFramebuffer(GL_FRAMEBUFFER, 0); // backbuffer
     glViewport(0, 0, g_winWidth, g_winHeight);
 
-    glDisable(GL_DEPTH_TEST);   // depth нам не нужен для полноэкранного квадрата
-    glDisable(GL_BLEND);        // ВАЖНО: без смешивания с прошлым кадром
+    g_gl.Disable(GL_DEPTH_TEST);   // depth нам не нужен для полноэкранного квадрата
+    g_gl.Disable(GL_BLEND);        // ВАЖНО: без смешивания с прошлым кадром
+
+    g_gl.UseProgram(g_postShader);
+    g_gl.BindTexture(GL_TEXTURE1, GL_TEXTURE_2D, g_sceneDepthTex);   // туман по глубине
+    g_gl.BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, g_sceneColorTex);
 
-    glUseProgram(g_postShader);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, g_sceneColorTex);
-    glUniform1i(glGetUniformLocation(g_postShader, "uSceneTex"), 0);
-    glUniform1i(glGetUniformLocation(g_postShader, "uUnderwater"), underwater ? 1 : 0);
-    glUniform1f(glGetUniformLocation(g_postShader, "uTime"), g_time);
+    // апскейл из прямоугольника мира
+    glUniform2f(UniformLoc(g_postShader, "uSceneScale"),
+        float(sceneW) / float(g_sceneFBOWidth), float(sceneH) / float(g_sceneFBOHeight));
+    glUniform2f(UniformLoc(g_postShader, "uSceneTexel"),
+        1.0f / float(g_sceneFBOWidth), 1.0f / float(g_sceneFBOHeight));
+    glUniform1f(UniformLoc(g_postShader, "uSharpen"),
+        (sceneW < g_sceneFBOWidth) ? g_dynRes.sharpen : 0.0f);
+    BindWaterHalfResForPost(g_postShader, waterHalf);
 
-    glBindVertexArray(g_screenVAO);
+    g_gl.BindVertexArray(g_screenVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+    ProfDraw(GL_TRIANGLE_STRIP, 4);
+    if (postZone) ProfEndZone();
+    DynResGpuEnd();
 
 
 
     // 3) Вьюмодели (грабли/лопата) — поверх постобработки
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
+    g_gl.Enable(GL_DEPTH_TEST);
+    g_gl.DepthMask(GL_TRUE);
     glClear(GL_DEPTH_BUFFER_BIT);   // очищаем глубину в ДЕФОЛТНОМ буфере,
     // чтобы инструменты не конфликтовали со сценой
 
-    DrawRakeViewModel(proj, view);
-    DrawShovelViewModel(proj, view);
-    if (!g_cutAnim.active)
-     DrawChainsawTestViewModel(proj, view);
+    g_renderQueue.Execute(PASS_VIEWMODEL, PASS_VIEWMODEL);
+
+    ProfDrawOverlay(g_winWidth, g_winHeight, g_hWnd);
+    ProfEndFrame();
 
+    g_gl.EndFrame();
 
-    SwapBuffers(g_hDC);
+    {
+        TRACE_SCOPE("SwapBuffers");
+        SwapBuffers(g_hDC);
+    }
+    g_upload.EndFrame();
 }
 
 
@@ -1263,7 +1333,7 @@ void Render()
 
 LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
-    if (g_cuttingTree && g_lockPlayerDuringCut)
+    if (g_renderState.cuttingTree && g_lockPlayerDuringCut)
     {
         // не менять позицию/скорость игрока от ввода
         // (оставь гравитацию/прилипание к земле как у тебя устроено)
@@ -1298,6 +1368,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 GLuint LoadTexture2D(const char* path)
 {
+    TRACE_SCOPE("LoadTexture2D");
     int w, h, chan;
     stbi_set_flip_vertically_on_load(1); // чтобы не было вверх ногами
     unsigned char* data = stbi_load(path, &w, &h, &chan, 4); // принудительно RGBA
@@ -1309,10 +1380,12 @@ GLuint LoadTexture2D(const char* path)
 
     GLuint tex = 0;
     glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
+    g_gl.BindTexture(GL_TEXTURE_2D, tex);
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h,
         0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    CountGpuUpload((size_t)w * h * 4);
+    MemGpuTexture(tex, GL_RGBA, w, h, true);
     glGenerateMipmap(GL_TEXTURE_2D);
 
     // параметры фильтрации/повторения
@@ -1327,14 +1400,70 @@ GLuint LoadTexture2D(const char* path)
 
 
 
+// ===== SHADERS =====
+
+// Все программы разом в начале: компиляции уходят в драйвер одна за другой,
+// пока CPU строит террейн и грузит модели. Init* ниже видят готовый хэндл
+// и повторно не создают.
+void LoadShaders()
+{
+    g_postShader = CreateShaderProgram("screen_post.vert", "screen_post.frag");
+    LoadSkyShaders();
+    g_rakeShader = CreateShaderProgram("rake.vert", "rake.frag");
+    g_shovelShader = CreateShaderProgram("shovel.vert", "shovel.frag");
+    g_chainsawShader = CreateShaderProgram("chainsaw_test.vert", "chainsaw_test.frag");
+    g_waterDownsampleShader = CreateShaderProgram("screen_post.vert", "water_downsample.frag");
+
+    // мир: варианты под надводный кадр; подводные соберутся лениво при первом нырке
+    SelectWorldVariants(WorldVariantBits(false), true);
+
+    LoadDepthPrepassShaders();
+}
+
+// время от старта WinMain до первого SwapBuffers: в лог и в startup.txt
+void ReportTimeToFirstFrame(const LARGE_INTEGER& start)
+{
+    LARGE_INTEGER now, freq;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&freq);
+    double ms = double(now.QuadPart - start.QuadPart) * 1000.0 / double(freq.QuadPart);
+
+    const double MB = 1024.0 * 1024.0;
+    char buf[384];
+    sprintf_s(buf, "Startup: first frame %.1f ms (programs: %d from cache, %d compiled, %d failed, parallel=%d; "
+        "disk %.1f MB, gpu %.1f MB, peak RSS %.1f MB)\n",
+        ms, g_shaderCache.fromCache, g_shaderCache.compiled, g_shaderCache.failed,
+        g_shaderCache.parallelCompile ? 1 : 0,
+        StartupDiskRead() / MB, g_gpuUploadBytes / MB, StartupPeakRss() / MB);
+
+    // + таблица по фазам (startup_profile.h)
+    StartupReport(buf);
+}
+
 // ===== MAIN / WinMain =====
 
-int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int)
+int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE, LPSTR cmdLine, int)
 {
-    srand((unsigned)time(nullptr));
+    LARGE_INTEGER startupT0;
+    QueryPerformanceCounter(&startupT0);
+
+    // -record / -replay / -seed (input.h): seed мира, до всего, что зовёт rand()
     g_currentTool = TOOL_NONE;
+    InputInit(cmdLine);
+    srand(g_input.seed);
+
+    // -trace: с самого начала, чтобы в трассу попала загрузка
+    TraceInit(cmdLine);
+    MemInit(cmdLine);   // -membudget: до загрузки, чтобы перебор был виден сразу
+
+    // фазы загрузки: время / диск / GPU / RSS — таблица после первого кадра
+    StartupPhase("jobs");
+
+    // потоки задач — до постройки мира (террейн, трава, деревья считаются на них)
+    JobsInit(cmdLine);
 
     // Регистрируем класс окна
+    StartupPhase("window + GL");
     WNDCLASS wc = {};
     wc.style = CS_OWNDC;
     wc.lpfnWndProc = WndProc;
@@ -1342,10 +1471,10 @@ int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int)
     wc.lpszClassName = L"GLTerrainWindow";
     RegisterClass(&wc);
 
-    // Создаём окно
+    // Создаём окно (-replay headless: скрытое — GL-контекст нужен, показывать нечего)
     g_hWnd = CreateWindowW(
         L"GLTerrainWindow", L"OpenGL Terrain",
-        WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+        WS_OVERLAPPEDWINDOW | (g_input.headless ? 0 : WS_VISIBLE),
         CW_USEDEFAULT, CW_USEDEFAULT,
         g_winWidth, g_winHeight,
         nullptr, nullptr, hInst, nullptr);
@@ -1359,38 +1488,95 @@ int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int)
     InitSceneFBO(g_winWidth, g_winHeight);
     InitScreenQuad();
 
-    // Загружаем шейдеры
-    g_shader = CreateShaderProgram("terrain.vert", "terrain.frag");
-    g_postShader = CreateShaderProgram("screen_post.vert", "screen_post.frag");
-    g_cutShader = CreateShaderProgram("cut_anim.vert", "cut_anim.frag");
+    // Загружаем шейдеры (компиляция идёт фоном, статусы — в FinishShaderPrograms)
+    StartupPhase("shaders");
+    LoadShaders();
+    InitFrameUBO();
+    g_upload.Init();
+
+    // постоянные uniform'ы: ставим один раз, в кадре их больше не трогаем
+    // (у программ мира — SetupXxxVariant на каждый вариант)
+    {
+        g_gl.UseProgram(g_postShader);
+        glUniform1i(UniformLoc(g_postShader, "uSceneTex"), 0);
+        glUniform1i(UniformLoc(g_postShader, "uSceneDepth"), 1);
+        glUniform1i(UniformLoc(g_postShader, "uWaterTex"), 2);
+        glUniform1i(UniformLoc(g_postShader, "uWaterDist"), 3);
+        glUniform1i(UniformLoc(g_postShader, "uWaterLowDepth"), 4);
+        SetSkyLUTSamplers(g_postShader);   // цвет тумана
+        g_gl.UseProgram(0);
+    }
 
-    // Загружаем heightmap (если есть) и строим террейн
-    g_terrain.loadHeightmap("heightmap.png");   // можно закомментить, если файла нет
-    g_terrain.build(1024, 1024.0f, 50.0f);       // (кол-во вершин, размер, макс. высота) РАЗМЕР КАРТЫ
-    g_terrain.RebuildWaterMask();
-    g_terrain.UploadWaterMaskFromTerrain();
+    // Загружаем heightmap (если есть) и строим террейн.
+    // Запечённый мир с тем же ключом — высоты, маска, трава, деревья берутся из него (world_cache.h)
+    StartupPhase("heightmap");
+    WorldParams worldParams = { WORLD_VERTS, WORLD_SIZE, WORLD_MAX_HEIGHT, g_waterHeight, GRASS_TARGET, TREE_TARGET };
+    WorldCacheOpen(cmdLine, "heightmap.png", worldParams, g_input.seed);
+    StartupPhase("terrain build");
+    g_terrain.build(WORLD_VERTS, WORLD_SIZE, WORLD_MAX_HEIGHT, "heightmap.png");   // nullptr, если файла нет
+    StartupPhase("water mask");
+    g_terrain.LoadWaterMask();
+    g_terrain.UploadWaterMaskFromTerrain(waterMask, waterW, waterH);
     // грузим текстуру травы
-    g_terrain.texture = LoadTexture2D("Detal2048tropic.png");  // или .jpg как назовёшь
-    InitSkySphere();
+    StartupPhase("terrain texture");
+    {
+        MemScope memTag(MEM_TERRAIN);
+        g_terrain.texture = LoadTexture2D("Detal2048tropic.png");  // или .jpg как назовёшь
+    }
+    StartupPhase("sky");
+    InitSky();
+    StartupPhase("grass");
     InitGrass();
+    StartupPhase("trees");
     InitTreeObjects();
+    StartupPhase("rake");
     InitRake();
+    StartupPhase("shovel");
     InitShovel();
+    StartupPhase("chainsaw");
     InitChainsawTest();
+    StartupPhase("water");
     InitWater();
+    UpdateWaterMesh(waterMask, waterW, waterH, g_terrain.size);
+    StartupPhase("depth prepass");
+    InitDepthPrepass();
 
+    StartupPhase("test_cut.glb");
     if (!g_treeCutAnimLoaded)
     {
+        MemScope memTag(MEM_MODELS);
         g_treeCutAnimLoaded = g_treeCutAnimModel.Load("test_cut.glb"); // путь поправь под свой assets
         if (!g_treeCutAnimLoaded)
             OutputDebugStringA("FAILED: test_cut.glb\n");
     }
     g_treeRemoved.assign(g_treeInstances.size(), false);
 
+    // отображение больше не нужно; что-то считали заново — перезапекаем (до старта сима)
+    StartupPhase("world cache");
+    WorldCacheFinish(g_terrain, waterMask, g_grassInstances, g_treeInstances);
+
+    // всё, что ещё не спросили через UniformLoc, дожидаемся тут
+    StartupPhase("shader finish");
+    FinishShaderPrograms();
+
+    // -bench <name>: после загрузки всего мира
+    StartupPhase("bench/sim init");
+    BenchInit(cmdLine);
+    DynResInit(cmdLine);   // после BenchInit: под бенчем масштаб фиксирован
+    WaterHalfResInit(cmdLine);
+    SimInit(cmdLine);
+    ProfInit(cmdLine);
+
     // Настраиваем таймер
     QueryPerformanceFrequency(&g_freq);
     QueryPerformanceCounter(&g_prevTime);
 
+    // мир загружен — симуляция с этого момента тикает сама (или в цикле при -simsync)
+    SimStart(SimTick, CaptureSimSnapshot);
+
+    // до первого SwapBuffers (закрывает ReportTimeToFirstFrame)
+    StartupPhase("first frame");
+
     // Главный цикл
     MSG msg;
     while (g_running) {
@@ -1404,14 +1590,59 @@ int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int)
         double dt = double(now.QuadPart - g_prevTime.QuadPart) / double(g_freq.QuadPart);
         g_prevTime = now;
 
-        UpdateCamera((float)dt);
-        UpdateChainsawTest((float)dt);
+        TRACE_COUNTER("frameMs", dt * 1000.0);
+        if (dt > 0.05)
+            TRACE_INSTANT("hitch");   // провал кадра — ищем рядом на таймлайне
+
+        JobsPumpMain();   // GL-задачи, поставленные из воркеров
+        PollRenderKeys();
+        ProcessMouse();
+
+        // -simsync / -replay: тики тут же; иначе их считает сим-поток
+        SimAdvanceSync((float)dt);
+
+        // сначала снапшот, потом GL-команды сима: всё, что он прислал до этого тика, уже в очереди
+        SimInterpolate(g_renderState);
+        {
+            TRACE_SCOPE("GpuCommands");
+            ALLOC_SCOPE("GpuCommands");
+            g_gpuCommands.Execute();
+        }
+        InputReplayFrame((float)dt);
+
+        if (g_input.headless)
+        {
+            // без отрисовки: команды сима исполнены выше, закрываем кадр кольца заливки
+            g_upload.EndFrame();
+        }
+        else
+        {
+            ApplyRenderState();
+
+            BenchUpdate((float)dt);
+
+            Render();
+        }
+
+        // временное кадра — в арене (frame_arena.h); -simsync: сим в этом же потоке,
+        // его команды к этому моменту исполнены (Execute выше), но проверяем честно
+        FrameArenaEndFrame(g_gpuCommands.Drained());
+        AllocEndFrame();
 
-        Render();
-        g_time += dt;
+        static bool firstFrame = true;
+        if (firstFrame)
+        {
+            firstFrame = false;
+            ReportTimeToFirstFrame(startupT0);
+        }
     }
 
     // Чистим ресурсы
+    ProfShutdown();
+    SimShutdown();
+    InputShutdown();   // после сим-потока: запись больше не растёт
+    JobsShutdown();
+    TraceShutdown();   // после потоков: их кольца уже не пишутся
     wglMakeCurrent(nullptr, nullptr);
     if (g_hRC) wglDeleteContext(g_hRC);
     if (g_hDC) ReleaseDC(g_hWnd, g_hDC);
@@ -1421,14 +1652,26 @@ int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int)
 
 
 
+// расстановка (ScatterGrass/ScatterTrees) — vegetation.h, побитно одинакова при любом числе потоков
+
+inline uint64_t ScatterSeed()
+{
+    // ключ Philox — seed мира (input.h): один и тот же лес (и запечённый мир), пока не -seed
+    return ((uint64_t)g_input.seed << 32) | 0x5CA77E2Du;
+}
 
 void InitGrass()
 {
-    // шейдеры травы
-    g_grassShader = CreateShaderProgram("grass.vert", "grass.frag");
+    TRACE_SCOPE("InitGrass");
+    // шейдеры травы — варианты g_grassFamily (LoadShaders)
+    MemScope memTag(MEM_GRASS);
     g_grassTex = LoadTexture2D("grass_billboard.png"); // твоя текстура травы (RGBA)
-    g_terrainGrassTex = LoadTexture2D("Detal2048tropic.png"); // или твоя трава
-    g_terrainSandTex = LoadTexture2D("sandphoto.png");
+    {
+        // слои террейна — грузятся тут, но считаются за террейн
+        MemScope terrainTag(MEM_TERRAIN);
+        g_terrainGrassTex = LoadTexture2D("Detal2048tropic.png"); // или твоя трава
+        g_terrainSandTex = LoadTexture2D("sandphoto.png");
+    }
     GLuint g_terrainGrassTex = 0;
     GLuint g_terrainSandTex = 0;
     if (!g_grassShader || !g_grassTex) return;
@@ -1446,10 +1689,11 @@ void InitGrass()
     if (!g_grassVBOQuad) glGenBuffers(1, &g_grassVBOQuad);
     if (!g_grassVBOInstances) glGenBuffers(1, &g_grassVBOInstances);
 
-    glBindVertexArray(g_grassVAO);
+    g_gl.BindVertexArray(g_grassVAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, g_grassVBOQuad);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    MemGpuBuffer(g_grassVBOQuad, sizeof(quad));
 
     // layout 0: позиция в кваде
     glEnableVertexAttribArray(0);
@@ -1458,58 +1702,44 @@ void InitGrass()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 
-    // ---------- генерируем инстансы ----------
-    g_grassInstances.clear();
-    float half = g_terrain.size * 0.5f;
-
-    const int targetCount = 400000; // плотность травы
-    int tries = 0;
-    while ((int)g_grassInstances.size() < targetCount && tries < targetCount * 10)
+    // ---------- генерируем инстансы (или берём запечённые) ----------
+    size_t cachedCount = 0;
+    const glm::vec4* cached = WorldCacheGet<glm::vec4>(WORLD_GRASS, cachedCount);
+    if (cached)
     {
-        ++tries;
-        float rx = (float)rand() / RAND_MAX;
-        float rz = (float)rand() / RAND_MAX;
-
-        float x = -half + rx * g_terrain.size;
-        float z = -half + rz * g_terrain.size;
-        float y = g_terrain.getHeight(x, z);
-
-        // фильтр по высоте (не на скалах)
-        if (y < 3.0f || y > 35.0f)
-            continue;
-
-        GrassInstance gi;
-        gi.pos = glm::vec3(x, y, z);
-        gi.scale = 0.6f + ((float)rand() / RAND_MAX) * 0.8f;
-        gi.alive = true;
-
-
-        g_grassInstances.push_back(gi);
+        g_grassInstances.resize(cachedCount);
+        for (size_t i = 0; i < cachedCount; ++i)
+            g_grassInstances[i] = GrassInstance{ glm::vec3(cached[i]), cached[i].w, true };
     }
+    else
+        ScatterGrass(g_terrain, GRASS_TARGET, ScatterSeed(), g_grassInstances);
+    MemTrackVector(g_grassInstances);
 
-    // грузим живые инстансы в буфер
+    // грузим живые инстансы в буфер (запечённые — уже в его раскладке)
     std::vector<glm::vec4> data;
-    data.reserve(g_grassInstances.size());
-    for (auto& gi : g_grassInstances)
-        if (gi.alive)
-            data.emplace_back(gi.pos, gi.scale);
+    if (!cached)
+        CollectGrassInstanceData(g_grassInstances, data);
+    const glm::vec4* instData = cached ? cached : data.data();
+    size_t instCount = cached ? cachedCount : data.size();
 
-    g_grassAliveCount = (GLsizei)data.size();
+    g_grassAliveCount = (GLsizei)instCount;
 
     int t = 0;
 
     glBindBuffer(GL_ARRAY_BUFFER, g_grassVBOInstances);
     glBufferData(GL_ARRAY_BUFFER,
-        data.size() * sizeof(glm::vec4),
-        data.data(),
+        instCount * sizeof(glm::vec4),
+        instData,
         GL_DYNAMIC_DRAW);
+    CountGpuUpload(instCount * sizeof(glm::vec4));
+    MemGpuBuffer(g_grassVBOInstances, instCount * sizeof(glm::vec4));
 
     // layout 2: vec4 (pos.xyz + scale) как инстанс-атрибут
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
     glVertexAttribDivisor(2, 1);
 
-    glBindVertexArray(0);
+    g_gl.BindVertexArray(0);
 
 }
 
@@ -1518,212 +1748,68 @@ void DrawGrass(const glm::mat4& proj, const glm::mat4& view)
     if (!g_grassVAO || !g_grassShader || !g_grassTex || g_grassAliveCount == 0)
         return;
 
-    glUseProgram(g_grassShader);
+    // после pre-pass — вариант без discard и глубина GL_EQUAL
+    GLuint sh = g_depthPrepass ? g_grassShaderPrepassed : g_grassShader;
+    g_gl.UseProgram(sh);
 
-    glUniformMatrix4fv(glGetUniformLocation(g_grassShader, "uProjection"), 1, GL_FALSE, &proj[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(g_grassShader, "uView"), 1, GL_FALSE, &view[0][0]);
-    glUniform1f(glGetUniformLocation(g_grassShader, "uTime"), g_time);
+    // матрицы/время/туман — в блоке Frame
+    glm::vec3 camRight = g_renderCam.right;
+    glm::vec3 camUp = g_renderCam.up;
 
-    glm::vec3 camRight = g_cam.right;
-    glm::vec3 camUp = g_cam.up;
+    glUniform3fv(UniformLoc(sh, "uCameraRight"), 1, &camRight[0]);
+    glUniform3fv(UniformLoc(sh, "uCameraUp"), 1, &camUp[0]);
 
-    glUniform3fv(glGetUniformLocation(g_grassShader, "uCameraRight"), 1, &camRight[0]);
-    glUniform3fv(glGetUniformLocation(g_grassShader, "uCameraUp"), 1, &camUp[0]);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, g_grassTex);
-    glUniform1i(glGetUniformLocation(g_grassShader, "uGrassTex"), 0);
+    // uGrassTex = юнит 0 (значение сэмплера по умолчанию)
+    g_gl.ActiveTexture(GL_TEXTURE0);
+    g_gl.BindTexture(GL_TEXTURE_2D, g_grassTex);
 
     // для травы: alpha cutout, обычно без блендинга достаточно
-    glDisable(GL_CULL_FACE);
+    g_gl.Disable(GL_BLEND);
+    g_gl.Disable(GL_CULL_FACE);
+    if (g_depthPrepass)
+        BeginPrepassedColor();
+    else {
+        g_gl.Enable(GL_DEPTH_TEST);
+        g_gl.DepthMask(GL_TRUE);
+        g_gl.DepthFunc(GL_LEQUAL);
+    }
 
-    glBindVertexArray(g_grassVAO);
+    g_gl.BindVertexArray(g_grassVAO);
     glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, g_grassAliveCount);
-    glBindVertexArray(0);
-
-    glEnable(GL_CULL_FACE);
+    ProfDraw(GL_TRIANGLE_STRIP, 4, g_grassAliveCount);
 }
 
+// разбор — ParseOBJ (mesh_import.h), здесь только заливка
 bool LoadOBJ(const char* path, Mesh& outMesh)
 {
-    std::ifstream file(path);
-    if (!file) {
-        std::string msg = std::string("Failed to open OBJ: ") + path + "\n";
-        OutputDebugStringA(msg.c_str());
+    CpuMesh cpu;
+    if (!ParseOBJ(path, cpu))
         return false;
-    }
-
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texcoords;
-
-    struct VertexKey {
-        int vi, ti, ni;
-        bool operator<(const VertexKey& o) const {
-            if (vi != o.vi) return vi < o.vi;
-            if (ti != o.ti) return ti < o.ti;
-            return ni < o.ni;
-        }
-    };
 
-    std::map<VertexKey, unsigned int> vertMap;
-    std::vector<float> vertexData;
-    std::vector<unsigned int> indices;
-
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line.size() < 2) continue;
-        if (line[0] == 'v' && line[1] == ' ') {
-            std::istringstream ss(line.substr(2));
-            glm::vec3 v; ss >> v.x >> v.y >> v.z;
-            positions.push_back(v);
-        }
-        else if (line[0] == 'v' && line[1] == 't') {
-            std::istringstream ss(line.substr(3));
-            glm::vec2 t; ss >> t.x >> t.y;
-            texcoords.push_back(t);
-        }
-        else if (line[0] == 'v' && line[1] == 'n') {
-            std::istringstream ss(line.substr(3));
-            glm::vec3 n; ss >> n.x >> n.y >> n.z;
-            normals.push_back(n);
-        }
-        else if (line[0] == 'f' && line[1] == ' ') {
-            std::istringstream ss(line.substr(2));
-            std::string comps[3];
-            ss >> comps[0] >> comps[1] >> comps[2];
-            for (int k = 0; k < 3; ++k) {
-                VertexKey key = { -1,-1,-1 };
-                std::string& c = comps[k];
-                int s1 = (int)c.find('/');
-                int s2 = (int)c.find('/', s1 + 1);
-
-                key.vi = std::stoi(c.substr(0, s1)) - 1;
-                if (s2 > s1 + 1)
-                    key.ti = std::stoi(c.substr(s1 + 1, s2 - s1 - 1)) - 1;
-                else
-                    key.ti = -1;
-                if (s2 != (int)std::string::npos)
-                    key.ni = std::stoi(c.substr(s2 + 1)) - 1;
-
-                auto it = vertMap.find(key);
-                if (it == vertMap.end()) {
-                    glm::vec3 pos = positions[key.vi];
-                    glm::vec3 nor(0, 1, 0);
-                    glm::vec2 uv(0, 0);
-
-                    if (key.ni >= 0 && key.ni < (int)normals.size())
-                        nor = normals[key.ni];
-                    if (key.ti >= 0 && key.ti < (int)texcoords.size())
-                        uv = texcoords[key.ti];
-
-                    unsigned int newIndex = (unsigned int)(vertexData.size() / 8);
-                    vertMap[key] = newIndex;
-
-                    vertexData.push_back(pos.x);
-                    vertexData.push_back(pos.y);
-                    vertexData.push_back(pos.z);
-                    vertexData.push_back(nor.x);
-                    vertexData.push_back(nor.y);
-                    vertexData.push_back(nor.z);
-                    vertexData.push_back(uv.x);
-                    vertexData.push_back(uv.y);
-
-                    indices.push_back(newIndex);
-                }
-                else {
-                    indices.push_back(it->second);
-                }
-            }
-        }
-    }
-
-    if (vertexData.empty() || indices.empty()) {
-        OutputDebugStringA("OBJ has no geometry or faces\n");
-        return false;
-    }
-
-    if (!outMesh.vao) glGenVertexArrays(1, &outMesh.vao);
-    if (!outMesh.vbo) glGenBuffers(1, &outMesh.vbo);
-    if (!outMesh.ebo) glGenBuffers(1, &outMesh.ebo);
-
-    glBindVertexArray(outMesh.vao);
-
-    glBindBuffer(GL_ARRAY_BUFFER, outMesh.vbo);
-    glBufferData(GL_ARRAY_BUFFER,
-        vertexData.size() * sizeof(float),
-        vertexData.data(),
-        GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, outMesh.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-        indices.size() * sizeof(unsigned int),
-        indices.data(),
-        GL_STATIC_DRAW);
-
-    GLsizei stride = 8 * sizeof(float);
-    glEnableVertexAttribArray(0); // pos
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-    glEnableVertexAttribArray(1); // normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2); // uv
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-
-    glBindVertexArray(0);
-
-    outMesh.indexCount = (GLsizei)indices.size();
+    UploadCpuMesh(cpu, outMesh);
     return true;
 }
 
 
 void InitTreeObjects()
 {
+    TRACE_SCOPE("InitTreeObjects");
+    MemScope memTag(MEM_TREES);
     if (!g_treeModel.Load("spruce2\\untitled.obj")) { // или "tree.obj"
         OutputDebugStringA("Failed to load tree model\n");
         return;
     }
 
-    g_treeShader = CreateShaderProgram("tree_mesh.vert", "tree_mesh.frag");
-
-    g_treeInstances.clear();
-
-    const int treeCount = 2000;               // Сколько деревьев хотим
-    float half = g_terrain.size * 0.5f;
+    // шейдер — варианты g_treeFamily, дальность леса — SetupTreeVariant
 
-    int tries = 0;
-    while ((int)g_treeInstances.size() < treeCount && tries < treeCount * 10)
-    {
-        ++tries;
-
-        float rx = (float)rand() / RAND_MAX;
-        float rz = (float)rand() / RAND_MAX;
-
-        float wx = -half + rx * g_terrain.size;
-        float wz = -half + rz * g_terrain.size;
-        float wy = g_terrain.getHeight(wx, wz);
-
-        // ограничения по высоте, чтобы не росли на вершинах/в ямах
-        if (wy < 3.0f || wy > 45.0f)
-            continue;
-
-        // наклон
-        float eps = 1.0f;
-        float hL = g_terrain.getHeight(wx - eps, wz);
-        float hR = g_terrain.getHeight(wx + eps, wz);
-        float hD = g_terrain.getHeight(wx, wz - eps);
-        float hU = g_terrain.getHeight(wx, wz + eps);
-        glm::vec3 n(hL - hR, 2.0f, hD - hU);
-        n = glm::normalize(n);
-        if (n.y < 0.9f) // только почти ровные места
-            continue;
-
-        TreeInstance inst;
-        inst.pos = glm::vec3(wx, wy, wz);
-        inst.scale = 2.5f + ((float)rand() / RAND_MAX) * 3.5f; // разные высоты
-        inst.radius = 0.4f * inst.scale;                     // для коллизии
-
-        g_treeInstances.push_back(inst);
-    }
+    // запечённые (world_cache.h): инстансы и готовые матрицы
+    size_t cachedMatCount = 0;
+    const glm::mat4* cachedMats = nullptr;
+    if (WorldCacheRead(WORLD_TREES, g_treeInstances))
+        cachedMats = WorldCacheGet<glm::mat4>(WORLD_TREE_MATRICES, cachedMatCount, g_treeInstances.size());
+    if (!cachedMats)
+        ScatterTrees(g_terrain, TREE_TARGET, ScatterSeed(), g_treeInstances);
+    MemTrackVector(g_treeInstances);
 
     g_treeInstanceCount = (GLsizei)g_treeInstances.size();
 
@@ -1732,15 +1818,10 @@ void InitTreeObjects()
 
     // готовим матрицы инстансов
     std::vector<glm::mat4> models;
-    models.reserve(g_treeInstanceCount);
-
-    for (const auto& inst : g_treeInstances)
-    {
-        glm::mat4 m(1.0f);
-        m = glm::translate(m, inst.pos);
-        m = glm::scale(m, glm::vec3(inst.scale));
-        models.push_back(m);
-    }
+    if (!cachedMats)
+        BuildTreeMatrices(g_treeInstances, g_treeRemoved, models);
+    const glm::mat4* matData = cachedMats ? cachedMats : models.data();
+    size_t matCount = cachedMats ? cachedMatCount : models.size();
 
     // VBO под матрицы
     if (!g_treeInstanceVBO)
@@ -1748,15 +1829,18 @@ void InitTreeObjects()
 
     glBindBuffer(GL_ARRAY_BUFFER, g_treeInstanceVBO);
     glBufferData(GL_ARRAY_BUFFER,
-        sizeof(glm::mat4) * models.size(),
-        models.data(),
+        sizeof(glm::mat4) * matCount,
+        matData,
         GL_STATIC_DRAW);
+    CountGpuUpload(sizeof(glm::mat4) * matCount);
+    MemGpuBuffer(g_treeInstanceVBO, sizeof(glm::mat4) * matCount);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    g_treeInstanceBytes = (GLsizeiptr)(sizeof(glm::mat4) * matCount);
 
     // привязываем этот VBO как инстанс-атрибут для всех мешей модели
     for (auto& mesh : g_treeModel.meshes)
     {
-        glBindVertexArray(mesh.vao);
+        g_gl.BindVertexArray(mesh.vao);
         glBindBuffer(GL_ARRAY_BUFFER, g_treeInstanceVBO);
 
         std::size_t vec4Size = sizeof(glm::vec4);
@@ -1779,7 +1863,7 @@ void InitTreeObjects()
         glVertexAttribDivisor(5, 1);
         glVertexAttribDivisor(6, 1);
 
-        glBindVertexArray(0);
+        g_gl.BindVertexArray(0);
     }
 }
 
@@ -1788,152 +1872,88 @@ void DrawTreeObjects(const glm::mat4& proj, const glm::mat4& view)
     if (g_treeModel.meshes.empty() || !g_treeShader || g_treeInstanceCount == 0)
         return;
 
-    glUseProgram(g_treeShader);
-
-    glUniformMatrix4fv(glGetUniformLocation(g_treeShader, "uProjection"), 1, GL_FALSE, &proj[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(g_treeShader, "uView"), 1, GL_FALSE, &view[0][0]);
-
-    glm::vec3 lightDir = glm::normalize(glm::vec3(0.4f, 1.0f, 0.2f));
-    glUniform3fv(glGetUniformLocation(g_treeShader, "uLightDir"), 1, &lightDir[0]);
-    //Ограничить дальность леса
-    glUniform3fv(glGetUniformLocation(g_treeShader, "uCamPos"), 1, &g_cam.pos[0]);
-    glUniform1f(glGetUniformLocation(g_treeShader, "uMaxDist"), 250.0f); // по вкусу
+    // матрицы/свет/камера — в блоке Frame, uMaxDist — SetupTreeVariant
+    // после pre-pass — вариант без discard и глубина GL_EQUAL
+    GLuint sh = g_depthPrepass ? g_treeShaderPrepassed : g_treeShader;
+    g_gl.UseProgram(sh);
 
     // мягкая альфа, двухсторонние листья
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDisable(GL_CULL_FACE);
-
-    g_treeModel.DrawInstanced(g_treeShader, g_treeInstanceCount);
+    g_gl.Enable(GL_BLEND);
+    g_gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    g_gl.Disable(GL_CULL_FACE);
+    if (g_depthPrepass)
+        BeginPrepassedColor();
+    else {
+        g_gl.Enable(GL_DEPTH_TEST);
+        g_gl.DepthMask(GL_TRUE);
+        g_gl.DepthFunc(GL_LEQUAL);
+    }
 
-    glDisable(GL_BLEND);
-    glEnable(GL_CULL_FACE);
+    g_treeModel.DrawInstanced(sh, g_treeInstanceCount);
 }
 
 void ResolveTreeCollisions(glm::vec3& pos)
 {
-    int i = -1;
-    for (const auto& inst : g_treeInstances)
-    {   
-        i++;
-        if (i < g_treeRemoved.size() && g_treeRemoved[i])
-        {            
-            continue;
-        }
-        
-        glm::vec2 p(pos.x, pos.z);
-        glm::vec2 c(inst.pos.x, inst.pos.z);
-        glm::vec2 d = p - c;
-        float dist = glm::length(d);
-        float minDist = g_playerRadius + inst.radius;
-
-        if (dist < minDist && dist > 0.0001f)
-        {
-            glm::vec2 dir = d / dist;
-            float push = minDist - dist;
-            p += dir * push;
-            pos.x = p.x;
-            pos.z = p.y;
-        }
-    }
+    ResolveTreeCollisionsXZ(g_treeInstances, g_treeRemoved, g_playerRadius, pos);
 }
 
 bool IsTreeBlockingDig(const glm::vec3& center, float holeRadius)
 {
-    const float extra = 0.5f; // небольшой запас
-    float r = holeRadius + extra;
-    int i = -1;
-
-    for (const auto& t : g_treeInstances)
-    {
-        i++;
-        if (i < g_treeRemoved.size() && g_treeRemoved[i]) {
-
-            continue;
-        }
-        
-        float dx = t.pos.x - center.x;
-        float dz = t.pos.z - center.z;
-        float dist2 = dx * dx + dz * dz;
-        float blockR = (t.radius > 0.0f ? t.radius : 0.8f); // примерный радиус ствола
-        float limit = r + blockR;
-        if (dist2 < limit * limit)
-            return true; // слишком близко к дереву — не копаем
-    }
-    return false;
+    return TreeBlocksDig(g_treeInstances, g_treeRemoved, center, holeRadius);
 }
 
+// то же, что грабли (grass.h)
 void RemoveGrassInRadius(const glm::vec3& center, float radius)
 {
-    float r2 = radius * radius;
-
-    for (auto& g : g_grassInstances)
-    {
-        if (g.alive <= 0.0f)
-            continue;
-
-        float dx = g.pos.x - center.x;
-        float dz = g.pos.z - center.z;
-        float dist2 = dx * dx + dz * dz;
-
-        if (dist2 < r2)
-        {
-            g.alive = 0.0f;
-        }
-    }
-
-    // Обновляем instance-буфер под инстансинг
-    // (подставь свою функцию/код, как ты уже делал для удаления травы граблями)
-    std::vector<glm::vec4> instanceData;
-    instanceData.reserve(g_grassInstances.size());
-    for (auto& g : g_grassInstances)
-    {
-        if (g.alive > 0.0f)
-            instanceData.push_back(glm::vec4(g.pos, 1.0f));
-    }
-
-    glBindBuffer(GL_ARRAY_BUFFER, g_grassVBOInstances);
-    glBufferData(GL_ARRAY_BUFFER,
-        instanceData.size() * sizeof(glm::vec4),
-        instanceData.data(),
-        GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    g_grassAliveCount = (int)instanceData.size();
+    RemoveGrassAt(center, radius);
 }
 
 void InitSceneFBO(int w, int h)
 {
     if (g_sceneFBO) {
         glDeleteFramebuffers(1, &g_sceneFBO);
-        glDeleteTextures(1, &g_sceneColorTex);
-        glDeleteRenderbuffers(1, &g_sceneDepthRBO);
+        MemGpuDeleteTextures(1, &g_sceneColorTex);
+        MemGpuDeleteTextures(1, &g_sceneDepthTex);
+        g_gl.DeleteTextures(1, &g_sceneColorTex);
+        g_gl.DeleteTextures(1, &g_sceneDepthTex);
     }
 
+    g_sceneFBOWidth = w;
+    g_sceneFBOHeight = h;
+
     glGenFramebuffers(1, &g_sceneFBO);
     glBindFramebuffer(GL_FRAMEBUFFER, g_sceneFBO);
 
     // цвет
     glGenTextures(1, &g_sceneColorTex);
-    glBindTexture(GL_TEXTURE_2D, g_sceneColorTex);
+    g_gl.BindTexture(GL_TEXTURE_2D, g_sceneColorTex);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    MemGpuTexture(g_sceneColorTex, GL_RGBA8, w, h, false, MEM_TARGETS);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
         GL_TEXTURE_2D, g_sceneColorTex, 0);
 
-    // depth
-    glGenRenderbuffers(1, &g_sceneDepthRBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, g_sceneDepthRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-        GL_RENDERBUFFER, g_sceneDepthRBO);
+    // depth — текстурой, а не renderbuffer: пост-проход читает её для тумана
+    glGenTextures(1, &g_sceneDepthTex);
+    g_gl.BindTexture(GL_TEXTURE_2D, g_sceneDepthTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, w, h, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    MemGpuTexture(g_sceneDepthTex, GL_DEPTH_COMPONENT24, w, h, false, MEM_TARGETS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+        GL_TEXTURE_2D, g_sceneDepthTex, 0);
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         OutputDebugStringA("Scene FBO NOT complete!\n");
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    InitWaterHalfResTarget(w, h);
 }
 
 void InitScreenQuad()
@@ -1948,16 +1968,17 @@ void InitScreenQuad()
 
     glGenVertexArrays(1, &g_screenVAO);
     glGenBuffers(1, &g_screenVBO);
-    glBindVertexArray(g_screenVAO);
+    g_gl.BindVertexArray(g_screenVAO);
     glBindBuffer(GL_ARRAY_BUFFER, g_screenVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+    MemGpuBuffer(g_screenVBO, sizeof(verts), MEM_TARGETS);
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 
-    glBindVertexArray(0);
+    g_gl.BindVertexArray(0);
 }
 
 int FindNearestTree(const glm::vec3& playerPosXZ, float maxDist,
@@ -1980,27 +2001,6 @@ int FindNearestTree(const glm::vec3& playerPosXZ, float maxDist,
     return best;
 }
 
-static int FindNearestTreeIndexXZ(const glm::vec3& p, float maxDist)
-{
-    int best = -1;
-    float best2 = maxDist * maxDist;
-
-    for (int i = 0; i < (int)g_treeInstances.size(); ++i)
-    {
-        const auto& t = g_treeInstances[i];
-        float dx = t.pos.x - p.x;
-        float dz = t.pos.z - p.z;
-        float d2 = dx * dx + dz * dz;
-
-        if (d2 < best2)
-        {
-            best2 = d2;
-            best = i;
-        }
-    }
-    return best;
-}
-
 static void SnapPlayerToTreeFront(int treeIdx)
 {
     const auto& t = g_treeInstances[treeIdx];
@@ -2029,32 +2029,41 @@ static void SnapPlayerToTreeFront(int treeIdx)
 
 void RebuildTreeInstanceBuffer()
 {
-    std::vector<glm::mat4> mats;
-    mats.reserve(g_treeInstances.size());
-
-    for (size_t i = 0; i < g_treeInstances.size(); ++i)
-    {
-        if (i < g_treeRemoved.size() && g_treeRemoved[i]) {
-
-            continue;
-        }
-
-        const auto& t = g_treeInstances[i];
-
-        glm::mat4 M(1.0f);
-        M = glm::translate(M, t.pos);
-        M = glm::scale(M, glm::vec3(t.scale));
-        mats.push_back(M);
-    }
-
-    g_treeInstanceCount = (GLsizei)mats.size();
+    TRACE_SCOPE("RebuildTreeInstanceBuffer");
+    ALLOC_SCOPE("RebuildTreeInstanceBuffer");
+    ArenaVector<glm::mat4> mats;
+    BuildTreeMatrices(g_treeInstances, g_treeRemoved, mats);
+    TRACE_COUNTER("trees", mats.size());
+
+    // матрицы собрал сим, буфер и счётчик — поток рендера
+    g_gpuCommands.Push([mats = std::move(mats)]() mutable
+        {
+            GLsizeiptr bytes = (GLsizeiptr)(mats.size() * sizeof(glm::mat4));
+            if (bytes > g_treeInstanceBytes)
+            {
+                // больше, чем выделено при InitTreeObjects — переразмечаем (не бывает, деревья только рубятся)
+                glBindBuffer(GL_ARRAY_BUFFER, g_treeInstanceVBO);
+                glBufferData(GL_ARRAY_BUFFER, bytes, mats.data(), GL_DYNAMIC_DRAW);
+                CountGpuUpload((size_t)bytes);
+                MemGpuBuffer(g_treeInstanceVBO, (size_t)bytes);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                g_treeInstanceBytes = bytes;
+                g_treeInstanceCount = (GLsizei)mats.size();
+                return;
+            }
 
-    glBindBuffer(GL_ARRAY_BUFFER, g_treeInstanceVBO);
-    glBufferData(GL_ARRAY_BUFFER,
-        mats.size() * sizeof(glm::mat4),
-        mats.empty() ? nullptr : mats.data(),
-        GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+            // буфер прежний, хвост за g_treeInstanceCount просто не рисуется;
+            // счётчик — когда матрицы дошли (stream_upload.h может отложить)
+            GLsizei count = (GLsizei)mats.size();
+            if (bytes == 0)
+            {
+                g_treeInstanceCount = 0;
+                return;
+            }
+            auto owner = std::make_shared<ArenaVector<glm::mat4>>(std::move(mats));
+            g_upload.Upload(g_treeInstanceVBO, 0, owner->data(), bytes, owner,
+                [count]() { g_treeInstanceCount = count; });
+        });
 }
 
 void TryStartCut()
@@ -2066,10 +2075,11 @@ void TryStartCut()
     p.y = 0.0f;
 
     // 1) ищем дерево рядом (радиус подстрой)
-    int idx = FindNearestTreeIndexXZ(p, 5.0f);
+    int idx = FindNearestTreeXZ(g_treeInstances, g_treeRemoved, p, 5.0f);
     if (idx < 0) return;
     if (g_treeRemoved[idx]) return;
     g_treeRemoved[idx] = true;
+    ++g_treeRemovals;
     RebuildTreeInstanceBuffer();
 
     // 3) заспавнить анимацию на позиции дерева
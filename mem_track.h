@@ -0,0 +1,225 @@
+﻿#pragma once
+// mem_track.h
+// Учёт памяти по подсистемам: GPU (буферы, текстуры) и крупные CPU-контейнеры.
+// Каждая подсистема — тег; по тегу текущие и пиковые байты, отдельно CPU и GPU.
+//
+//   MemScope tag(MEM_GRASS);                 // всё, что ниже в блоке, без явного тега — трава
+//   MemSetGpu(MEM_KIND_BUFFER, vbo, bytes);  // размер GL-объекта (повторный вызов — новый размер)
+//   MemReleaseGpu(MEM_KIND_TEXTURE, tex);    // рядом с glDelete*
+//   MemTrackVector(g_grassInstances);        // контейнер: capacity * sizeof
+//
+// GL-объект, уже известный учёту, тег не меняет: перезаливка маски воды при раскопке
+// (вне всяких MemScope) остаётся на воде. GL-обёртки — gl_mem.h, здесь GL нет
+// (годится для ядра и bench_core.cpp).
+//
+// Бюджеты: "-membudget <тег>=<МБ>" (CPU + GPU вместе), можно несколько; при превышении —
+// одно предупреждение в лог на тег. Отчёт — MemReport() / F5 (mem_report.txt), на экране — оверлей F3 (profiler.h).
+
+#include <mutex>
+#include <unordered_map>
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "core_platform.h"
+
+enum MemTag {
+    MEM_MISC = 0,
+    MEM_TERRAIN,
+    MEM_WATER,
+    MEM_GRASS,
+    MEM_TREES,
+    MEM_MODELS,          // test_cut.glb, бенч-модели
+    MEM_TOOLS,           // грабли, лопата
+    MEM_CHAINSAW,        // ChainsawTest (вместе с живым aiScene)
+    MEM_SKY,
+    MEM_TARGETS,         // FBO сцены и половинки воды
+    MEM_STREAMING,       // кольцо stream_upload.h, UBO кадра
+    MEM_SCRATCH,         // арены кадра (frame_arena.h), ёмкость
+    MEM_TAG_COUNT
+};
+
+const char* const MEM_TAG_NAMES[MEM_TAG_COUNT] = {
+    "misc", "terrain", "water", "grass", "trees", "models", "tools", "chainsaw", "sky", "targets", "streaming", "scratch"
+};
+
+enum MemKind {
+    MEM_KIND_BUFFER = 0,
+    MEM_KIND_TEXTURE = 1
+};
+
+struct MemTagStats
+{
+    size_t cpu = 0, cpuPeak = 0;
+    size_t gpu = 0, gpuPeak = 0;
+    size_t budget = 0;          // байт, 0 — без бюджета
+    bool overBudgetReported = false;
+};
+
+struct MemEntry
+{
+    MemTag tag;
+    size_t bytes;
+};
+
+struct MemTracker
+{
+    std::mutex m;                                      // зовут при выделении, не в кадре
+    MemTagStats tags[MEM_TAG_COUNT];
+    std::unordered_map<const void*, MemEntry> cpu;     // владелец (адрес контейнера)
+    std::unordered_map<uint64_t, MemEntry> gpu;        // (вид << 32) | GL-имя
+};
+
+MemTracker g_mem;
+
+thread_local MemTag t_memTag = MEM_MISC;
+
+inline MemTag MemCurrentTag() { return t_memTag; }
+
+struct MemScope
+{
+    MemTag prev;
+    explicit MemScope(MemTag t) : prev(t_memTag) { t_memTag = t; }
+    ~MemScope() { t_memTag = prev; }
+    MemScope(const MemScope&) = delete;
+    MemScope& operator=(const MemScope&) = delete;
+};
+
+// под g_mem.m
+inline void MemCheckBudget(MemTag tag)
+{
+    MemTagStats& s = g_mem.tags[tag];
+    if (!s.budget || s.overBudgetReported || s.cpu + s.gpu <= s.budget)
+        return;
+
+    s.overBudgetReported = true;
+    char buf[160];
+    snprintf(buf, sizeof(buf), "Mem: '%s' over budget: %.1f MB of %.1f MB\n",
+        MEM_TAG_NAMES[tag], (s.cpu + s.gpu) / (1024.0 * 1024.0), s.budget / (1024.0 * 1024.0));
+    CoreLog(buf);
+}
+
+// bytes = 0 — освободить
+template <typename Key>
+inline void MemSetEntry(std::unordered_map<Key, MemEntry>& map, const Key& key, MemTag tag, size_t bytes, bool isGpu)
+{
+    std::lock_guard<std::mutex> lock(g_mem.m);
+
+    auto it = map.find(key);
+    if (it != map.end())
+    {
+        tag = it->second.tag;   // известный объект тег не меняет
+        size_t& cur = isGpu ? g_mem.tags[tag].gpu : g_mem.tags[tag].cpu;
+        cur -= std::min(cur, it->second.bytes);
+        if (bytes) it->second.bytes = bytes;
+        else map.erase(it);
+    }
+    else if (bytes)
+    {
+        map[key] = MemEntry{ tag, bytes };
+    }
+
+    MemTagStats& s = g_mem.tags[tag];
+    if (isGpu) { s.gpu += bytes; s.gpuPeak = std::max(s.gpuPeak, s.gpu); }
+    else       { s.cpu += bytes; s.cpuPeak = std::max(s.cpuPeak, s.cpu); }
+    MemCheckBudget(tag);
+}
+
+inline void MemSetCpu(const void* owner, size_t bytes, MemTag tag = MemCurrentTag())
+{
+    if (owner) MemSetEntry(g_mem.cpu, owner, tag, bytes, false);
+}
+
+template <typename V>
+inline void MemTrackVector(const V& v, MemTag tag = MemCurrentTag())
+{
+    MemSetCpu(&v, v.capacity() * sizeof(typename V::value_type), tag);
+}
+
+inline void MemSetGpu(MemKind kind, unsigned name, size_t bytes, MemTag tag = MemCurrentTag())
+{
+    if (name) MemSetEntry(g_mem.gpu, ((uint64_t)kind << 32) | name, tag, bytes, true);
+}
+
+inline void MemReleaseGpu(MemKind kind, unsigned name)
+{
+    MemSetGpu(kind, name, 0);
+}
+
+inline MemTagStats MemGetStats(MemTag tag)
+{
+    std::lock_guard<std::mutex> lock(g_mem.m);
+    return g_mem.tags[tag];
+}
+
+inline void MemTotals(size_t& cpu, size_t& gpu)
+{
+    std::lock_guard<std::mutex> lock(g_mem.m);
+    cpu = gpu = 0;
+    for (const MemTagStats& s : g_mem.tags) { cpu += s.cpu; gpu += s.gpu; }
+}
+
+// "-membudget terrain=256 -membudget grass=64"
+void MemInit(const char* cmdLine)
+{
+    if (!cmdLine) return;
+    std::istringstream ss(cmdLine);
+    std::string tok;
+    while (ss >> tok)
+    {
+        if (tok != "-membudget" || !(ss >> tok)) continue;
+
+        size_t eq = tok.find('=');
+        if (eq == std::string::npos) continue;
+        std::string name = tok.substr(0, eq);
+        double mb = atof(tok.c_str() + eq + 1);
+
+        for (int t = 0; t < MEM_TAG_COUNT; ++t)
+            if (name == MEM_TAG_NAMES[t])
+            {
+                std::lock_guard<std::mutex> lock(g_mem.m);
+                g_mem.tags[t].budget = (size_t)(mb * 1024.0 * 1024.0);
+                MemCheckBudget((MemTag)t);
+            }
+    }
+}
+
+// таблица по тегам (МБ): текущее / пик, CPU и GPU
+std::string MemReport()
+{
+    const double MB = 1024.0 * 1024.0;
+    std::string out;
+    char buf[192];
+
+    snprintf(buf, sizeof(buf), "%-10s %9s %9s %9s %9s %9s\n", "tag", "cpu", "cpu peak", "gpu", "gpu peak", "budget");
+    out += buf;
+
+    size_t cpu = 0, gpu = 0;
+    for (int t = 0; t < MEM_TAG_COUNT; ++t)
+    {
+        MemTagStats s = MemGetStats((MemTag)t);
+        snprintf(buf, sizeof(buf), "%-10s %9.2f %9.2f %9.2f %9.2f %9.1f\n", MEM_TAG_NAMES[t],
+            s.cpu / MB, s.cpuPeak / MB, s.gpu / MB, s.gpuPeak / MB, s.budget / MB);
+        out += buf;
+        cpu += s.cpu;
+        gpu += s.gpu;
+    }
+    snprintf(buf, sizeof(buf), "%-10s %9.2f %9s %9.2f\n", "total", cpu / MB, "", gpu / MB);
+    out += buf;
+    return out;
+}
+
+// F5: таблица в лог и в файл (перезапись)
+void MemWriteReport(const char* path)
+{
+    std::string table = MemReport();
+    CoreLog(table);
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return;
+    fputs(table.c_str(), f);
+    fclose(f);
+}
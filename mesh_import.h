@@ -0,0 +1,416 @@
+﻿#pragma once
+// mesh_import.h
+// Импорт мешей в CPU-буферы без GL: OBJ (свой парсер) и сцены Assimp
+// (вершины pos3 + normal3 + uv2, индексы, веса костей, ноды и клип в AnimRig).
+// Заливку в VAO/VBO и текстуры делают Model::Load / LoadOBJ (modelwork.h, main.cpp).
+// CORE_NO_ASSIMP — только OBJ (сборка ядра там, где Assimp нет).
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <fstream>
+#include <sstream>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#ifndef CORE_NO_ASSIMP
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#endif
+
+#include "core_platform.h"
+#include "anim_rig.h"
+
+const int MESH_VERTEX_FLOATS = 8;   // pos3 + normal3 + uv2
+
+const int MAX_BONES = 128;          // как в шейдерах
+const int MAX_BONE_INFLUENCE = 4;   // top-4 влияния на вершину
+
+// атрибуты вершины для скиннинга (layout 3 = ivec4 ids, layout 4 = vec4 weights)
+struct BoneVertex
+{
+    int   ids[MAX_BONE_INFLUENCE] = { 0, 0, 0, 0 };
+    float weights[MAX_BONE_INFLUENCE] = { 0.0f, 0.0f, 0.0f, 0.0f };
+};
+
+#ifndef CORE_NO_ASSIMP
+
+// флаги ReadFile для Model::Load
+const unsigned MODEL_IMPORT_FLAGS =
+    aiProcess_Triangulate |
+    aiProcess_GenSmoothNormals |
+    aiProcess_CalcTangentSpace |
+    aiProcess_JoinIdenticalVertices |
+    aiProcess_ImproveCacheLocality |
+    aiProcess_SortByPType |
+    aiProcess_OptimizeMeshes |
+    aiProcess_OptimizeGraph |
+    aiProcess_FlipUVs;
+
+inline glm::mat4 AiToGlm(const aiMatrix4x4& m)
+{
+    glm::mat4 r;
+    // GLM: r[col][row]
+    r[0][0] = m.a1; r[0][1] = m.b1; r[0][2] = m.c1; r[0][3] = m.d1;
+    r[1][0] = m.a2; r[1][1] = m.b2; r[1][2] = m.c2; r[1][3] = m.d2;
+    r[2][0] = m.a3; r[2][1] = m.b3; r[2][2] = m.c3; r[2][3] = m.d3;
+    r[3][0] = m.a4; r[3][1] = m.b4; r[3][2] = m.c4; r[3][3] = m.d4;
+    return r;
+}
+
+// =======================================================
+// BONE WEIGHTS
+// =======================================================
+
+// Собирает веса костей меша.
+// Индексы костей общие на всю модель (boneIndexByName), offset-матрицы
+// дописываются в boneOffsets при первом появлении кости.
+// На вершину оставляем 4 самых тяжёлых влияния и нормализуем сумму в 1.
+inline bool ImportBoneWeights(const aiMesh* mesh,
+    std::unordered_map<std::string, int>& boneIndexByName,
+    std::vector<std::string>& boneNames,
+    std::vector<glm::mat4>& boneOffsets,
+    std::vector<BoneVertex>& out)
+{
+    out.assign(mesh->mNumVertices, BoneVertex());
+    if (!mesh->HasBones())
+        return false;
+
+    for (unsigned b = 0; b < mesh->mNumBones; ++b)
+    {
+        const aiBone* bone = mesh->mBones[b];
+        std::string name = bone->mName.C_Str();
+
+        int boneIndex;
+        auto it = boneIndexByName.find(name);
+        if (it == boneIndexByName.end())
+        {
+            if ((int)boneNames.size() >= MAX_BONES) {
+                CoreLog("Skinning: too many bones, skip " + name + "\n");
+                continue;
+            }
+            boneIndex = (int)boneNames.size();
+            boneIndexByName[name] = boneIndex;
+            boneNames.push_back(name);
+            boneOffsets.push_back(AiToGlm(bone->mOffsetMatrix));
+        }
+        else
+        {
+            boneIndex = it->second;
+        }
+
+        for (unsigned w = 0; w < bone->mNumWeights; ++w)
+        {
+            const aiVertexWeight& vw = bone->mWeights[w];
+            if (vw.mVertexId >= mesh->mNumVertices || vw.mWeight <= 0.0f)
+                continue;
+
+            // вставка в top-4: вытесняем самое лёгкое влияние
+            BoneVertex& bv = out[vw.mVertexId];
+            int minSlot = 0;
+            for (int s = 1; s < MAX_BONE_INFLUENCE; ++s)
+                if (bv.weights[s] < bv.weights[minSlot]) minSlot = s;
+
+            if (vw.mWeight > bv.weights[minSlot])
+            {
+                bv.ids[minSlot] = boneIndex;
+                bv.weights[minSlot] = vw.mWeight;
+            }
+        }
+    }
+
+    // нормализация
+    for (auto& bv : out)
+    {
+        float sum = bv.weights[0] + bv.weights[1] + bv.weights[2] + bv.weights[3];
+        if (sum > 1e-6f)
+            for (int s = 0; s < MAX_BONE_INFLUENCE; ++s)
+                bv.weights[s] /= sum;
+    }
+    return true;
+}
+
+#endif // CORE_NO_ASSIMP
+
+// =======================================================
+// CPU MESH
+// =======================================================
+
+struct CpuMesh
+{
+    std::string name;
+    int nodeIndex = -1;
+    unsigned materialIndex = 0;
+    unsigned sceneMesh = 0;              // индекс в aiScene::mMeshes (морфы и пр. — у вызывающего)
+
+    std::vector<float> vertices;         // MESH_VERTEX_FLOATS на вершину
+    std::vector<unsigned int> indices;
+
+    std::vector<BoneVertex> bones;       // по вершине, если skinned
+    bool skinned = false;
+
+    size_t VertexCount() const { return vertices.size() / MESH_VERTEX_FLOATS; }
+};
+
+// =======================================================
+// OBJ
+// =======================================================
+
+// v/vt/vn/f (треугольники); одинаковые тройки индексов — одна вершина
+inline bool ParseOBJ(std::istream& file, CpuMesh& out)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texcoords;
+
+    struct VertexKey {
+        int vi, ti, ni;
+        bool operator<(const VertexKey& o) const {
+            if (vi != o.vi) return vi < o.vi;
+            if (ti != o.ti) return ti < o.ti;
+            return ni < o.ni;
+        }
+    };
+
+    std::map<VertexKey, unsigned int> vertMap;
+    std::vector<float>& vertexData = out.vertices;
+    std::vector<unsigned int>& indices = out.indices;
+    vertexData.clear();
+    indices.clear();
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.size() < 2) continue;
+        if (line[0] == 'v' && line[1] == ' ') {
+            std::istringstream ss(line.substr(2));
+            glm::vec3 v; ss >> v.x >> v.y >> v.z;
+            positions.push_back(v);
+        }
+        else if (line[0] == 'v' && line[1] == 't') {
+            std::istringstream ss(line.substr(3));
+            glm::vec2 t; ss >> t.x >> t.y;
+            texcoords.push_back(t);
+        }
+        else if (line[0] == 'v' && line[1] == 'n') {
+            std::istringstream ss(line.substr(3));
+            glm::vec3 n; ss >> n.x >> n.y >> n.z;
+            normals.push_back(n);
+        }
+        else if (line[0] == 'f' && line[1] == ' ') {
+            std::istringstream ss(line.substr(2));
+            std::string comps[3];
+            ss >> comps[0] >> comps[1] >> comps[2];
+            for (int k = 0; k < 3; ++k) {
+                VertexKey key = { -1,-1,-1 };
+                std::string& c = comps[k];
+                int s1 = (int)c.find('/');
+                int s2 = (int)c.find('/', s1 + 1);
+
+                key.vi = std::stoi(c.substr(0, s1)) - 1;
+                if (s2 > s1 + 1)
+                    key.ti = std::stoi(c.substr(s1 + 1, s2 - s1 - 1)) - 1;
+                else
+                    key.ti = -1;
+                if (s2 != (int)std::string::npos)
+                    key.ni = std::stoi(c.substr(s2 + 1)) - 1;
+
+                auto it = vertMap.find(key);
+                if (it == vertMap.end()) {
+                    glm::vec3 pos = positions[key.vi];
+                    glm::vec3 nor(0, 1, 0);
+                    glm::vec2 uv(0, 0);
+
+                    if (key.ni >= 0 && key.ni < (int)normals.size())
+                        nor = normals[key.ni];
+                    if (key.ti >= 0 && key.ti < (int)texcoords.size())
+                        uv = texcoords[key.ti];
+
+                    unsigned int newIndex = (unsigned int)(vertexData.size() / MESH_VERTEX_FLOATS);
+                    vertMap[key] = newIndex;
+
+                    vertexData.push_back(pos.x);
+                    vertexData.push_back(pos.y);
+                    vertexData.push_back(pos.z);
+                    vertexData.push_back(nor.x);
+                    vertexData.push_back(nor.y);
+                    vertexData.push_back(nor.z);
+                    vertexData.push_back(uv.x);
+                    vertexData.push_back(uv.y);
+
+                    indices.push_back(newIndex);
+                }
+                else {
+                    indices.push_back(it->second);
+                }
+            }
+        }
+    }
+
+    if (vertexData.empty() || indices.empty()) {
+        CoreLog("OBJ has no geometry or faces\n");
+        return false;
+    }
+    return true;
+}
+
+inline bool ParseOBJ(const char* path, CpuMesh& out)
+{
+    std::ifstream file(path);
+    if (!file) {
+        CoreLog(std::string("Failed to open OBJ: ") + path + "\n");
+        return false;
+    }
+    return ParseOBJ(file, out);
+}
+
+#ifndef CORE_NO_ASSIMP
+
+// =======================================================
+// ASSIMP SCENE
+// =======================================================
+
+// первый клип сцены -> rig.clip (каналы только для известных нод)
+inline void ImportAnimClip(const aiScene* scene,
+    const std::unordered_map<std::string, int>& nodeIndexByName, AnimRig& rig)
+{
+    rig.hasAnimation = (scene->mNumAnimations > 0);
+    if (!rig.hasAnimation)
+        return;
+
+    AnimClip& clip = rig.clip;
+    aiAnimation* a = scene->mAnimations[0];
+    clip.durationTicks = a->mDuration;
+    clip.ticksPerSecond = (a->mTicksPerSecond != 0.0 ? a->mTicksPerSecond : 25.0);
+
+    clip.channels.clear();
+    clip.channels.reserve(a->mNumChannels);
+
+    for (unsigned int c = 0; c < a->mNumChannels; ++c)
+    {
+        aiNodeAnim* ch = a->mChannels[c];
+        auto it = nodeIndexByName.find(ch->mNodeName.C_Str());
+        if (it == nodeIndexByName.end()) continue;
+
+        AnimChannel out;
+        out.nodeIndex = it->second;
+
+        // T
+        out.tTimes.reserve(ch->mNumPositionKeys);
+        out.tValues.reserve(ch->mNumPositionKeys);
+        for (unsigned int k = 0; k < ch->mNumPositionKeys; ++k)
+        {
+            out.tTimes.push_back(ch->mPositionKeys[k].mTime);
+            auto v = ch->mPositionKeys[k].mValue;
+            out.tValues.push_back(glm::vec3(v.x, v.y, v.z));
+        }
+
+        // R
+        out.rTimes.reserve(ch->mNumRotationKeys);
+        out.rValues.reserve(ch->mNumRotationKeys);
+        for (unsigned int k = 0; k < ch->mNumRotationKeys; ++k)
+        {
+            out.rTimes.push_back(ch->mRotationKeys[k].mTime);
+            auto q = ch->mRotationKeys[k].mValue;
+            out.rValues.push_back(glm::quat((float)q.w, (float)q.x, (float)q.y, (float)q.z));
+        }
+
+        // S
+        out.sTimes.reserve(ch->mNumScalingKeys);
+        out.sValues.reserve(ch->mNumScalingKeys);
+        for (unsigned int k = 0; k < ch->mNumScalingKeys; ++k)
+        {
+            out.sTimes.push_back(ch->mScalingKeys[k].mTime);
+            auto v = ch->mScalingKeys[k].mValue;
+            out.sValues.push_back(glm::vec3(v.x, v.y, v.z));
+        }
+
+        clip.channels.push_back(std::move(out));
+    }
+}
+
+// ноды, меши (в порядке обхода), кости и клип. Текстуры материалов — у вызывающего
+// (сцена живёт, пока жив его Assimp::Importer)
+inline bool ImportModelScene(const aiScene* scene, AnimRig& rig, std::vector<CpuMesh>& meshes)
+{
+    meshes.clear();
+    rig.ClearRig();
+    if (!scene || !scene->mRootNode)
+        return false;
+
+    rig.globalInverse = glm::inverse(AiToGlm(scene->mRootNode->mTransformation));
+
+    std::unordered_map<std::string, int> nodeIndexByName;
+    std::unordered_map<std::string, int> boneIndexByName;
+
+    std::function<void(aiNode*, int)> processNode;
+    processNode = [&](aiNode* node, int parentIndex)
+        {
+            int myIndex = (int)rig.nodeNames.size();
+            rig.nodeNames.push_back(node->mName.C_Str());
+            nodeIndexByName[rig.nodeNames.back()] = myIndex;
+
+            rig.nodeParent.push_back(parentIndex);
+            rig.nodeBaseLocal.push_back(AiToGlm(node->mTransformation));
+
+            // meshes of this node
+            for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+            {
+                aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+
+                CpuMesh out;
+                out.name = mesh->mName.C_Str();
+                out.nodeIndex = myIndex;
+                out.materialIndex = mesh->mMaterialIndex;
+                out.sceneMesh = node->mMeshes[i];
+
+                out.vertices.reserve(mesh->mNumVertices * MESH_VERTEX_FLOATS);
+                for (unsigned int v = 0; v < mesh->mNumVertices; ++v)
+                {
+                    aiVector3D pos = mesh->mVertices[v];
+                    aiVector3D nor = mesh->HasNormals() ? mesh->mNormals[v] : aiVector3D(0, 1, 0);
+                    aiVector3D uv = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0][v] : aiVector3D(0, 0, 0);
+
+                    // POSITION (3)
+                    out.vertices.push_back(pos.x);
+                    out.vertices.push_back(pos.y);
+                    out.vertices.push_back(pos.z);
+
+                    // NORMAL (3)
+                    out.vertices.push_back(nor.x);
+                    out.vertices.push_back(nor.y);
+                    out.vertices.push_back(nor.z);
+
+                    // UV (2)
+                    out.vertices.push_back((float)uv.x);
+                    out.vertices.push_back((float)uv.y);
+                }
+
+                out.indices.reserve(mesh->mNumFaces * 3);
+                for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+                    const aiFace& face = mesh->mFaces[f];
+                    for (unsigned int j = 0; j < face.mNumIndices; ++j)
+                        out.indices.push_back(face.mIndices[j]);
+                }
+
+                out.skinned = ImportBoneWeights(mesh, boneIndexByName,
+                    rig.boneNames, rig.boneOffsets, out.bones);
+
+                meshes.push_back(std::move(out));
+            }
+
+            for (unsigned int i = 0; i < node->mNumChildren; ++i)
+                processNode(node->mChildren[i], myIndex);
+        };
+
+    processNode(scene->mRootNode, -1);
+
+    rig.FinishRig(nodeIndexByName);
+    ImportAnimClip(scene, nodeIndexByName, rig);
+
+    return !meshes.empty();
+}
+
+#endif // CORE_NO_ASSIMP
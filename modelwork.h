@@ -33,27 +33,19 @@
   - OutputDebugStringA
 */
 
+// CPU-часть (скелет/клип, импорт в буферы) — без GL
+#include "anim_rig.h"
+#include "mesh_import.h"
+
+// буферы весов и палитра на GPU
+#include "skinning.h"
+
+#include "trace.h"
+
 // =======================================================
 // TEXTURES
 // =======================================================
 
-inline glm::mat4 AiToGlm(const aiMatrix4x4& m)
-{
-  /*  return glm::mat4(
-        m.a1, m.a2, m.a3, m.a4,
-        m.b1, m.b2, m.b3, m.b4,
-        m.c1, m.c2, m.c3, m.c4,
-        m.d1, m.d2, m.d3, m.d4
-    );*/
-    glm::mat4 r;
-    // GLM: r[col][row]
-    r[0][0] = m.a1; r[0][1] = m.b1; r[0][2] = m.c1; r[0][3] = m.d1;
-    r[1][0] = m.a2; r[1][1] = m.b2; r[1][2] = m.c2; r[1][3] = m.d2;
-    r[2][0] = m.a3; r[2][1] = m.b3; r[2][2] = m.c3; r[2][3] = m.d3;
-    r[3][0] = m.a4; r[3][1] = m.b4; r[3][2] = m.c4; r[3][3] = m.d4;
-    return r;
-}
-
 struct TextureInfo {
     GLuint id = 0;
     std::string type; // "texture_diffuse"
@@ -91,6 +83,7 @@ static TextureInfo LoadTexture_Assimp(
     std::vector<TextureInfo>& loaded
 )
 {
+    TRACE_SCOPE("LoadTexture_Assimp");
     aiString str;
     if (material->GetTexture(type, index, &str) != AI_SUCCESS)
         return { 0, "", "" };
@@ -117,7 +110,7 @@ static TextureInfo LoadTexture_Assimp(
 
             GLuint id = 0;
             glGenTextures(1, &id);
-            glBindTexture(GL_TEXTURE_2D, id);
+            g_gl.BindTexture(GL_TEXTURE_2D, id);
 
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -136,13 +129,15 @@ static TextureInfo LoadTexture_Assimp(
                 if (img)
                 {
                     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, img);
+                    CountGpuUpload((size_t)w * h * 4);
+                    MemGpuTexture(id, GL_RGBA, w, h, true);
                     glGenerateMipmap(GL_TEXTURE_2D);
                     stbi_image_free(img);
                     tex.id = id;
                 }
                 else
                 {
-                    glDeleteTextures(1, &id);
+                    g_gl.DeleteTextures(1, &id);
                 }
             }
             else
@@ -164,12 +159,14 @@ static TextureInfo LoadTexture_Assimp(
 
                 glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0,
                     GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+                CountGpuUpload((size_t)w * h * 4);
+                MemGpuTexture(id, GL_RGBA, w, h, true);
                 glGenerateMipmap(GL_TEXTURE_2D);
 
                 tex.id = id;
             }
 
-            glBindTexture(GL_TEXTURE_2D, 0);
+            g_gl.BindTexture(GL_TEXTURE_2D, 0);
         }
     }
     else
@@ -185,10 +182,12 @@ static TextureInfo LoadTexture_Assimp(
         {
             GLuint id;
             glGenTextures(1, &id);
-            glBindTexture(GL_TEXTURE_2D, id);
+            g_gl.BindTexture(GL_TEXTURE_2D, id);
 
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0,
                 GL_RGBA, GL_UNSIGNED_BYTE, data);
+            CountGpuUpload((size_t)w * h * 4);
+            MemGpuTexture(id, GL_RGBA, w, h, true);
             glGenerateMipmap(GL_TEXTURE_2D);
 
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -197,7 +196,7 @@ static TextureInfo LoadTexture_Assimp(
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
             stbi_image_free(data);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            g_gl.BindTexture(GL_TEXTURE_2D, 0);
 
             tex.id = id;
         }
@@ -222,95 +221,98 @@ struct Mesh {
     // Для анимации по нодам:
     int nodeIndex = -1;
 
+    // Скиннинг: отдельный VBO с BoneVertex (layout 3/4)
+    GLuint boneVbo = 0;
+    bool skinned = false;
+
     void Draw(GLuint shader) const
     {
         GLuint texId = 0;
         if (!textures.empty() && textures[0].id != 0)
             texId = textures[0].id;
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texId);
+        // uTex всегда на юните 0 (значение сэмплера по умолчанию),
+        // поэтому в draw его не трогаем
+        g_gl.ActiveTexture(GL_TEXTURE0);
+        g_gl.BindTexture(GL_TEXTURE_2D, texId);
 
-        GLint locTex = glGetUniformLocation(shader, "uTex");
-        if (locTex >= 0) glUniform1i(locTex, 0);
-
-        glBindVertexArray(vao);
+        // VAO/текстуру не отвязываем: следующий меш с тем же состоянием
+        // не пошлёт в драйвер ничего (см. gl_state.h)
+        g_gl.BindVertexArray(vao);
         glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        glBindTexture(GL_TEXTURE_2D, 0);
+        ProfDraw(GL_TRIANGLES, indexCount);
     }
 
     void DrawInstanced(GLuint shader, GLsizei instanceCount) const
     {
         if (!textures.empty()) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, textures[0].id);
-            GLint loc = glGetUniformLocation(shader, "uTex");
-            if (loc >= 0) glUniform1i(loc, 0);
+            g_gl.ActiveTexture(GL_TEXTURE0);
+            g_gl.BindTexture(GL_TEXTURE_2D, textures[0].id);
         }
 
-        glBindVertexArray(vao);
+        g_gl.BindVertexArray(vao);
         glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, instanceCount);
-        glBindVertexArray(0);
-
-        glActiveTexture(GL_TEXTURE0);
+        ProfDraw(GL_TRIANGLES, indexCount, instanceCount);
     }
 };
 
-// =======================================================
-// ANIMATION (node TRS)
-// =======================================================
-
-struct NodeTRS
+// CpuMesh (mesh_import.h) -> VAO: pos/normal/uv в layout 0..2, веса костей в 3/4.
+// Уже созданные vao/vbo/ebo переиспользуются
+inline void UploadCpuMesh(const CpuMesh& src, Mesh& out)
 {
-    glm::vec3 t{ 0,0,0 };
-    glm::quat r;        // identity
-    glm::vec3 s{ 1,1,1 };
-
-    NodeTRS() : r(1.0f, 0.0f, 0.0f, 0.0f) {}
-};
-
-struct AnimChannel
-{
-    int nodeIndex = -1;
-
-    std::vector<double> tTimes;
-    std::vector<glm::vec3> tValues;
-
-    std::vector<double> rTimes;
-    std::vector<glm::quat> rValues;
-
-    std::vector<double> sTimes;
-    std::vector<glm::vec3> sValues;
-};
+    if (!out.vao) glGenVertexArrays(1, &out.vao);
+    if (!out.vbo) glGenBuffers(1, &out.vbo);
+    if (!out.ebo) glGenBuffers(1, &out.ebo);
+
+    g_gl.BindVertexArray(out.vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, out.vbo);
+    glBufferData(GL_ARRAY_BUFFER,
+        src.vertices.size() * sizeof(float),
+        src.vertices.data(),
+        GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, out.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+        src.indices.size() * sizeof(unsigned int),
+        src.indices.data(),
+        GL_STATIC_DRAW);
+    CountGpuUpload(src.vertices.size() * sizeof(float) + src.indices.size() * sizeof(unsigned int));
+    MemGpuBuffer(out.vbo, src.vertices.size() * sizeof(float));
+    MemGpuBuffer(out.ebo, src.indices.size() * sizeof(unsigned int));
+
+    GLsizei stride = MESH_VERTEX_FLOATS * sizeof(float);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+
+    // layout 3/4 только у skinned мешей (у деревьев там инстанс-матрица)
+    if (src.skinned)
+        out.boneVbo = CreateBoneVertexBuffer(src.bones);
+
+    g_gl.BindVertexArray(0);
+
+    out.indexCount = (GLsizei)src.indices.size();
+    out.nodeIndex = src.nodeIndex;
+    out.skinned = src.skinned;
+}
 
-struct AnimClip
-{
-    double durationTicks = 0.0;
-    double ticksPerSecond = 25.0;
-    std::vector<AnimChannel> channels;
-};
+// NodeTRS / AnimChannel / AnimClip — anim_rig.h
 
 // =======================================================
 // MODEL
 // =======================================================
 
-struct Model {
+// скелет и выборка позы — AnimRig (anim_rig.h), здесь меши и GL
+struct Model : AnimRig {
     std::vector<Mesh> meshes;
     std::string directory;
     std::vector<TextureInfo> loadedTextures;
 
-    // Ноды (для анимации)
-    std::vector<std::string> nodeNames;
-    std::vector<int> nodeParent;
-    std::vector<glm::mat4> nodeBaseLocal;  // base local from aiNode->mTransformation
-    std::vector<glm::mat4> nodeAnimLocal;  // animated local (base * TRS from clip)
-    std::vector<glm::mat4> nodeGlobal;     // final global
-
-    AnimClip clip;
-    bool hasAnimation = false;
-    double animTimeTicks = 0.0;
+    BonePaletteBuffer skinBuffer;
 
     bool Load(const std::string& path);
 
@@ -318,21 +320,16 @@ struct Model {
     void Draw(GLuint shader) const;
     void DrawInstanced(GLuint shader, GLsizei instanceCount) const;
 
-    // анимация нод
-    void ResetAnimation() { animTimeTicks = 0.0; }
-    void UpdateAnimation(float dt);
+    // анимация нод: UpdateAnimation/EvaluatePose — AnimRig
     void DrawWithAnimation(GLuint shader, const glm::mat4& world) const;
+    void UploadSkinPalette();
 };
 
 // =======================================================
 // TREE SYSTEM (как у тебя было)
 // =======================================================
 
-struct TreeInstance {
-    glm::vec3 pos;
-    float     scale;
-    float     radius;
-};
+// TreeInstance — vegetation.h
 
 extern Model g_treeModel;
 extern GLuint g_treeInstanceVBO;
@@ -348,43 +345,16 @@ void InitTreeObjects();
 void DrawTreeObjects(const glm::mat4& proj, const glm::mat4& view);
 void ResolveTreeCollisions(glm::vec3& pos);
 
-// =======================================================
-// HELPERS
-// =======================================================
-
-static int FindKeyIndex(const std::vector<double>& times, double t)
-{
-    if (times.empty()) return -1;
-    int i = 0;
-    while (i + 1 < (int)times.size() && times[i + 1] <= t) ++i;
-    return i;
-}
-
-static glm::vec3 LerpVec3(const glm::vec3& a, const glm::vec3& b, float k)
-{
-    return a + (b - a) * k;
-}
-
 // =======================================================
 // Model::Load
 // =======================================================
 
 inline bool Model::Load(const std::string& path)
 {
+    TRACE_SCOPE("Model::Load");
     Assimp::Importer importer;
 
-    const aiScene* scene = importer.ReadFile(
-        path,
-        aiProcess_Triangulate |
-        aiProcess_GenSmoothNormals |
-        aiProcess_CalcTangentSpace |
-        aiProcess_JoinIdenticalVertices |
-        aiProcess_ImproveCacheLocality |
-        aiProcess_SortByPType |
-        aiProcess_OptimizeMeshes |
-        aiProcess_OptimizeGraph |
-        aiProcess_FlipUVs
-    );
+    const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
 
     if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->mRootNode) {
         OutputDebugStringA(("ASSIMP error: " + std::string(importer.GetErrorString()) + "\n").c_str());
@@ -395,238 +365,45 @@ inline bool Model::Load(const std::string& path)
     meshes.clear();
     loadedTextures.clear();
 
-    // ноды/анимация
-    nodeNames.clear();
-    nodeParent.clear();
-    nodeBaseLocal.clear();
-    nodeAnimLocal.clear();
-    nodeGlobal.clear();
-    clip.channels.clear();
-    hasAnimation = false;
-    animTimeTicks = 0.0;
-
-    std::unordered_map<std::string, int> nodeIndexByName;
-
-    std::function<void(aiNode*, int)> processNode;
-    processNode = [&](aiNode* node, int parentIndex)
-        {
-            int myIndex = (int)nodeNames.size();
-            nodeNames.push_back(node->mName.C_Str());
-            nodeIndexByName[nodeNames.back()] = myIndex;
-
-            nodeParent.push_back(parentIndex);
-            nodeBaseLocal.push_back(AiToGlm(node->mTransformation));
-            nodeAnimLocal.push_back(nodeBaseLocal.back());
-            nodeGlobal.push_back(glm::mat4(1.0f));
-
-            // meshes of this node
-            for (unsigned int i = 0; i < node->mNumMeshes; ++i)
-            {
-                aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-
-                const std::string meshName = mesh->mName.C_Str();
-                const bool isSaw = (meshName == "Mesh0");
-
-                float minU = 0.0f, minV = 0.0f;
-                float maxU = 0.0f, maxV = 0.0f;
-                bool hasUV = mesh->HasTextureCoords(0);
-
-                if (isSaw && hasUV)
-                {
-                    minU = minV = 1e9f;
-                    maxU = maxV = -1e9f;
-
-                    for (unsigned int v = 0; v < mesh->mNumVertices; ++v)
-                    {
-                        const aiVector3D uv = mesh->mTextureCoords[0][v];
-                        minU = std::min(minU, (float)uv.x);
-                        minV = std::min(minV, (float)uv.y);
-                        maxU = std::max(maxU, (float)uv.x);
-                        maxV = std::max(maxV, (float)uv.y);
-                    }
-                }
-
-                std::vector<float> vertices;
-                std::vector<unsigned int> indices;
-                std::vector<TextureInfo> textures;
-
-                vertices.reserve(mesh->mNumVertices * 8);
-
-                for (unsigned int v = 0; v < mesh->mNumVertices; ++v)
-                {
-                    aiVector3D pos = mesh->mVertices[v];
-                    aiVector3D nor = mesh->HasNormals() ? mesh->mNormals[v] : aiVector3D(0, 1, 0);
-                    aiVector3D uv = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0][v] : aiVector3D(0, 0, 0);
-
-                    float u = (float)uv.x;
-                    float vv = (float)uv.y;
-
-                    //// ✅ ONLY for saw: normalize UV into 0..1
-                    //if (isSaw && mesh->HasTextureCoords(0))
-                    //{
-                    //    float offU = -std::floor(minU);
-                    //    float offV = -std::floor(minV);
-
-                    //    u += offU;
-                    //    vv += offV;
-                    //}
-
-                    // POSITION (3)
-                    vertices.push_back(pos.x);
-                    vertices.push_back(pos.y);
-                    vertices.push_back(pos.z);
-
-                    // NORMAL (3)
-                    vertices.push_back(nor.x);
-                    vertices.push_back(nor.y);
-                    vertices.push_back(nor.z);
-
-                    // UV (2)
-                    vertices.push_back(u);
-                    vertices.push_back(vv);
-                }
-
-                for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
-                    const aiFace& face = mesh->mFaces[f];
-                    for (unsigned int j = 0; j < face.mNumIndices; ++j)
-                        indices.push_back(face.mIndices[j]);
-                }
-
-                if (mesh->mMaterialIndex >= 0)
-                {
-                    aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-
-                    // ✅ For glTF/GLB prefer BASE_COLOR
-                    TextureInfo texBase = LoadTexture_Assimp(scene, material,
-                        (aiTextureType)aiTextureType_BASE_COLOR,
-                        0, directory,
-                        "texture_diffuse", textures);
-
-                    if (texBase.id == 0)
-                    {
-                        // fallback
-                        LoadTexture_Assimp(scene, material,
-                            aiTextureType_DIFFUSE,
-                            0, directory,
-                            "texture_diffuse", textures);
-                    }
-                }
-
-                // optional material debug
-                /*
-                if (isSaw)
-                {
-                    OutputDebugStringA("==== Mesh0 material debug ====\n");
-                    char b[128];
-                    sprintf_s(b, "materialIndex=%d texturesCount=%d\n",
-                        mesh->mMaterialIndex, (int)textures.size());
-                    OutputDebugStringA(b);
-
-                    for (auto& t : textures)
-                    {
-                        std::string s = "type=" + t.type + " path=" + t.path + " id=" + std::to_string(t.id) + "\n";
-                        OutputDebugStringA(s.c_str());
-                    }
-                }
-                */
-
-                Mesh out;
-                out.name = meshName;
-                out.textures = textures;
-                out.indexCount = (GLsizei)indices.size();
-                out.nodeIndex = myIndex;
-
-                glGenVertexArrays(1, &out.vao);
-                glGenBuffers(1, &out.vbo);
-                glGenBuffers(1, &out.ebo);
-
-                glBindVertexArray(out.vao);
-
-                glBindBuffer(GL_ARRAY_BUFFER, out.vbo);
-                glBufferData(GL_ARRAY_BUFFER,
-                    vertices.size() * sizeof(float),
-                    vertices.data(),
-                    GL_STATIC_DRAW);
-
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, out.ebo);
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                    indices.size() * sizeof(unsigned int),
-                    indices.data(),
-                    GL_STATIC_DRAW);
-
-                GLsizei stride = 8 * sizeof(float);
-                glEnableVertexAttribArray(0);
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-                glEnableVertexAttribArray(1);
-                glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-                glEnableVertexAttribArray(2);
-                glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-
-                glBindVertexArray(0);
-
-                meshes.push_back(out);
-            }
-
-            for (unsigned int i = 0; i < node->mNumChildren; ++i)
-                processNode(node->mChildren[i], myIndex);
-        };
+    // ноды, кости, клип и вершины — без GL (mesh_import.h)
+    std::vector<CpuMesh> cpuMeshes;
+    ImportModelScene(scene, *this, cpuMeshes);
 
-    processNode(scene->mRootNode, -1);
-
-    // ==== Load animation (only first clip) ====
-    hasAnimation = (scene->mNumAnimations > 0);
-    if (hasAnimation)
+    for (const CpuMesh& src : cpuMeshes)
     {
-        aiAnimation* a = scene->mAnimations[0];
-        clip.durationTicks = a->mDuration;
-        clip.ticksPerSecond = (a->mTicksPerSecond != 0.0 ? a->mTicksPerSecond : 25.0);
-
-        clip.channels.clear();
-        clip.channels.reserve(a->mNumChannels);
-
-        for (unsigned int c = 0; c < a->mNumChannels; ++c)
+        std::vector<TextureInfo> textures;
+        if (src.materialIndex < scene->mNumMaterials)
         {
-            aiNodeAnim* ch = a->mChannels[c];
-            auto it = nodeIndexByName.find(ch->mNodeName.C_Str());
-            if (it == nodeIndexByName.end()) continue;
+            aiMaterial* material = scene->mMaterials[src.materialIndex];
 
-            AnimChannel out;
-            out.nodeIndex = it->second;
+            // ✅ For glTF/GLB prefer BASE_COLOR
+            TextureInfo texBase = LoadTexture_Assimp(scene, material,
+                (aiTextureType)aiTextureType_BASE_COLOR,
+                0, directory,
+                "texture_diffuse", textures);
 
-            // T
-            out.tTimes.reserve(ch->mNumPositionKeys);
-            out.tValues.reserve(ch->mNumPositionKeys);
-            for (unsigned int k = 0; k < ch->mNumPositionKeys; ++k)
+            if (texBase.id == 0)
             {
-                out.tTimes.push_back(ch->mPositionKeys[k].mTime);
-                auto v = ch->mPositionKeys[k].mValue;
-                out.tValues.push_back(glm::vec3(v.x, v.y, v.z));
-            }
-
-            // R
-            out.rTimes.reserve(ch->mNumRotationKeys);
-            out.rValues.reserve(ch->mNumRotationKeys);
-            for (unsigned int k = 0; k < ch->mNumRotationKeys; ++k)
-            {
-                out.rTimes.push_back(ch->mRotationKeys[k].mTime);
-                auto q = ch->mRotationKeys[k].mValue;
-                out.rValues.push_back(glm::quat((float)q.w, (float)q.x, (float)q.y, (float)q.z));
+                // fallback
+                LoadTexture_Assimp(scene, material,
+                    aiTextureType_DIFFUSE,
+                    0, directory,
+                    "texture_diffuse", textures);
             }
+        }
 
-            // S
-            out.sTimes.reserve(ch->mNumScalingKeys);
-            out.sValues.reserve(ch->mNumScalingKeys);
-            for (unsigned int k = 0; k < ch->mNumScalingKeys; ++k)
-            {
-                out.sTimes.push_back(ch->mScalingKeys[k].mTime);
-                auto v = ch->mScalingKeys[k].mValue;
-                out.sValues.push_back(glm::vec3(v.x, v.y, v.z));
-            }
+        Mesh out;
+        out.name = src.name;
+        out.textures = textures;
+        UploadCpuMesh(src, out);
 
-            clip.channels.push_back(std::move(out));
-        }
+        meshes.push_back(out);
     }
 
+    // палитра в bind pose уже собрана (AnimRig::FinishRig)
+    if (hasSkin)
+        UploadSkinPalette();
+
     return !meshes.empty();
 }
 
@@ -648,97 +425,10 @@ inline void Model::DrawInstanced(GLuint shader, GLsizei instanceCount) const
         m.DrawInstanced(shader, instanceCount);
 }
 
-// =======================================================
-// UpdateAnimation (node TRS)
-// =======================================================
-
-inline void Model::UpdateAnimation(float dt)
+inline void Model::UploadSkinPalette()
 {
-    if (!hasAnimation) return;
-
-    animTimeTicks += (double)dt * clip.ticksPerSecond;
-    if (clip.durationTicks > 0.0)
-        animTimeTicks = std::fmod(animTimeTicks, clip.durationTicks);
-
-    // по умолчанию — base pose
-    for (size_t i = 0; i < nodeBaseLocal.size(); ++i)
-        nodeAnimLocal[i] = nodeBaseLocal[i];
-
-    // применяем каналы: мы перезаписываем локалку на base*TRS
-    for (const auto& ch : clip.channels)
-    {
-        int ni = ch.nodeIndex;
-        if (ni < 0 || ni >= (int)nodeAnimLocal.size()) continue;
-
-        glm::vec3 T(0, 0, 0);
-        glm::quat R(1, 0, 0, 0);
-        glm::vec3 S(1, 1, 1);
-
-        // T
-        if (!ch.tTimes.empty())
-        {
-            int k = FindKeyIndex(ch.tTimes, animTimeTicks);
-            int k2 = std::min(k + 1, (int)ch.tTimes.size() - 1);
-            if (k >= 0)
-            {
-                double t0 = ch.tTimes[k], t1 = ch.tTimes[k2];
-                float f = (t1 > t0) ? (float)((animTimeTicks - t0) / (t1 - t0)) : 0.0f;
-                T = LerpVec3(ch.tValues[k], ch.tValues[k2], f);
-            }
-        }
-
-        // R
-        if (!ch.rTimes.empty())
-        {
-            int k = FindKeyIndex(ch.rTimes, animTimeTicks);
-            int k2 = std::min(k + 1, (int)ch.rTimes.size() - 1);
-            if (k >= 0)
-            {
-                double t0 = ch.rTimes[k], t1 = ch.rTimes[k2];
-                float f = (t1 > t0) ? (float)((animTimeTicks - t0) / (t1 - t0)) : 0.0f;
-                glm::quat q0 = ch.rValues[k];
-                glm::quat q1 = ch.rValues[k2];
-
-                // чтобы не крутило через "длинный путь"
-                if (glm::dot(q0, q1) < 0.0f) q1 = -q1;
-
-                R = glm::normalize(glm::quat(
-                    q0.w + (q1.w - q0.w) * f,
-                    q0.x + (q1.x - q0.x) * f,
-                    q0.y + (q1.y - q0.y) * f,
-                    q0.z + (q1.z - q0.z) * f
-                ));
-            }
-        }
-
-        // S
-        if (!ch.sTimes.empty())
-        {
-            int k = FindKeyIndex(ch.sTimes, animTimeTicks);
-            int k2 = std::min(k + 1, (int)ch.sTimes.size() - 1);
-            if (k >= 0)
-            {
-                double t0 = ch.sTimes[k], t1 = ch.sTimes[k2];
-                float f = (t1 > t0) ? (float)((animTimeTicks - t0) / (t1 - t0)) : 0.0f;
-                S = LerpVec3(ch.sValues[k], ch.sValues[k2], f);
-            }
-        }
-
-        glm::mat4 TRS(1.0f);
-        TRS = glm::translate(TRS, T);
-        TRS *= glm::mat4_cast(R);
-        TRS = glm::scale(TRS, S);
-
-        //nodeAnimLocal[ni] = nodeBaseLocal[ni] * TRS;
-        nodeAnimLocal[ni] = TRS;
-    }
-
-    // пересчитать global
-    for (int i = 0; i < (int)nodeAnimLocal.size(); ++i)
-    {
-        int p = nodeParent[i];
-        nodeGlobal[i] = (p >= 0) ? (nodeGlobal[p] * nodeAnimLocal[i]) : nodeAnimLocal[i];
-    }
+    if (!hasSkin || skinPalette.empty()) return;
+    skinBuffer.Upload(skinPalette.data(), (int)skinPalette.size(), BoneStride());
 }
 
 // =======================================================
@@ -747,7 +437,12 @@ inline void Model::UpdateAnimation(float dt)
 
 inline void Model::DrawWithAnimation(GLuint shader, const glm::mat4& world) const
 {
-    GLint loc = glGetUniformLocation(shader, "uModel");
+    GLint loc = UniformLoc(shader, "uModel");
+    GLint locNormal = UniformLoc(shader, "uModelNormal");
+    GLint locSkinned = UniformLoc(shader, "uSkinned");
+
+    if (hasSkin)
+        skinBuffer.Bind(shader, BONE_PALETTE_UNIT);
 
     for (const auto& m : meshes)
     {
@@ -758,12 +453,20 @@ inline void Model::DrawWithAnimation(GLuint shader, const glm::mat4& world) cons
 
         glm::mat4 M = world;
 
-        if (hasAnimation && m.nodeIndex >= 0 && m.nodeIndex < (int)nodeGlobal.size())
+        // skinned: нода уже сидит в палитре костей
+        if (hasAnimation && !m.skinned && m.nodeIndex >= 0 && m.nodeIndex < (int)nodeGlobal.size())
             M = world * nodeGlobal[m.nodeIndex];
 
         if (loc >= 0)
             glUniformMatrix4fv(loc, 1, GL_FALSE, &M[0][0]);
+        if (locNormal >= 0)
+        {
+            glm::mat4 N = glm::inverseTranspose(M);
+            glUniformMatrix4fv(locNormal, 1, GL_FALSE, &N[0][0]);
+        }
+        if (locSkinned >= 0)
+            glUniform1i(locSkinned, (m.skinned && hasSkin) ? 1 : 0);
 
         m.Draw(shader);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,506 @@
+﻿#pragma once
+// profiler.h
+// Покадровый профайлер проходов: сколько CPU и GPU уходит на небо, террейн, деревья,
+// траву, воду, cut-анимацию, пост и вьюмодели, плюс draw call'ы / треугольники / инстансы.
+//
+//   ProfScope z(PROF_GRASS);              // CPU-время (QPC) + GL_TIME_ELAPSED вокруг прохода
+//   ProfDraw(GL_TRIANGLES, count, inst);  // рядом с каждым glDraw*
+//
+// Зоны не вкладываются: пока одна открыта, вложенный ProfScope ничего не делает
+// (TIME_ELAPSED в GL тоже не вкладывается). Одна зона может открываться за кадр несколько
+// раз (pre-pass + цвет) — время складывается.
+// Query читаем через PROF_QUERY_FRAMES кадров и только если готовы — GPU не ждём никогда,
+// не успевшие кадры просто без GPU-времени.
+//
+// Включение:
+//   F3                    — оверлей: полосы по проходам в углу + цифры в заголовке окна,
+//                           справа — память по тегам mem_track.h (CPU / GPU, к бюджету или к самому большому)
+//   -prof [имя]           — без оверлея, в файлы: <имя>.csv — последние PROF_HISTORY кадров
+//                           построчно, <имя>.json — средние/максимумы. Переписываются каждые
+//                           PROF_HISTORY кадров и на выходе (годится для -bench и прогонов без присмотра)
+// Выключен — только проверка флага, ни одного GL-вызова.
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+#include "mem_track.h"
+
+enum ProfZone {
+    PROF_SKY = 0,        // LUT'ы + купол
+    PROF_PREPASS,        // depth pre-pass (все объекты)
+    PROF_TERRAIN,
+    PROF_TREES,
+    PROF_GRASS,
+    PROF_WATER,          // полное или половинное разрешение
+    PROF_CUTANIM,
+    PROF_POST,
+    PROF_VIEWMODEL,
+    PROF_ZONE_COUNT
+};
+
+const char* const PROF_ZONE_NAMES[PROF_ZONE_COUNT] = {
+    "sky", "prepass", "terrain", "trees", "grass", "water", "cutanim", "post", "viewmodel"
+};
+
+// цвета полос оверлея
+const float PROF_ZONE_COLORS[PROF_ZONE_COUNT][3] = {
+    { 0.45f, 0.70f, 1.00f },   // sky
+    { 0.50f, 0.50f, 0.50f },   // prepass
+    { 0.65f, 0.45f, 0.25f },   // terrain
+    { 0.15f, 0.55f, 0.20f },   // trees
+    { 0.55f, 0.90f, 0.30f },   // grass
+    { 0.20f, 0.40f, 0.95f },   // water
+    { 0.95f, 0.55f, 0.15f },   // cutanim
+    { 0.85f, 0.30f, 0.85f },   // post
+    { 0.95f, 0.90f, 0.30f },   // viewmodel
+};
+
+const int PROF_QUERY_FRAMES = 2;    // двойной буфер query: пишем в один, читаем другой
+const int PROF_MAX_SPANS = 32;      // открытий зон за кадр (на каждое — свой query)
+const int PROF_HISTORY = 600;       // кадров в кольце для CSV
+
+struct ProfPassStats
+{
+    double cpuMs = 0.0;
+    double gpuMs = 0.0;
+    unsigned draws = 0;
+    unsigned tris = 0;
+    unsigned instances = 0;
+};
+
+struct ProfFrameStats
+{
+    long long frame = -1;       // -1 — слот пуст
+    double frameMs = 0.0;       // от начала прошлого Render() до начала этого
+    double cpuMs = 0.0;         // Render() без SwapBuffers
+    bool gpuValid = false;      // query успели
+    ProfPassStats pass[PROF_ZONE_COUNT];
+
+    double GpuTotalMs() const
+    {
+        double s = 0.0;
+        for (int z = 0; z < PROF_ZONE_COUNT; ++z) s += pass[z].gpuMs;
+        return s;
+    }
+};
+
+struct ProfilerState
+{
+    bool overlay = false;       // F3
+    std::string outBase;        // -prof: непусто — пишем файлы
+    bool active = false;        // в этом кадре меряем
+
+    long long frame = 0;
+    double freqMs = 0.0;        // тиков QPC в мс
+    LARGE_INTEGER frameStart = {};
+    LARGE_INTEGER prevFrameStart = {};
+
+    // открытая зона
+    int zone = -1;
+    LARGE_INTEGER zoneStart = {};
+
+    // GPU-отрезки: [кадр в полёте][номер]
+    GLuint queries[PROF_QUERY_FRAMES][PROF_MAX_SPANS] = {};
+    int spanZone[PROF_QUERY_FRAMES][PROF_MAX_SPANS] = {};
+    int spanCount[PROF_QUERY_FRAMES] = {};
+    long long slotFrame[PROF_QUERY_FRAMES] = {};
+    int slot = 0;
+    unsigned gpuDropped = 0;    // query не успели к чтению
+
+    std::vector<ProfFrameStats> history;   // кольцо, индекс = frame % PROF_HISTORY
+    ProfFrameStats* cur = nullptr;
+
+    ProfPassStats smooth[PROF_ZONE_COUNT];   // для оверлея
+    double smoothGpuMs = 0.0, smoothCpuMs = 0.0, smoothFrameMs = 0.0;
+    bool titleSet = false;
+};
+
+ProfilerState g_prof;
+
+inline bool ProfEnabled() { return g_prof.overlay || !g_prof.outBase.empty(); }
+
+inline double ProfMs(const LARGE_INTEGER& a, const LARGE_INTEGER& b)
+{
+    return double(b.QuadPart - a.QuadPart) / g_prof.freqMs;
+}
+
+// "-prof [имя]"
+void ProfInit(const char* cmdLine)
+{
+    LARGE_INTEGER f;
+    QueryPerformanceFrequency(&f);
+    g_prof.freqMs = double(f.QuadPart) / 1000.0;
+
+    if (!cmdLine) return;
+    std::istringstream ss(cmdLine);
+    std::string tok;
+    while (ss >> tok)
+    {
+        if (tok == "-prof")
+        {
+            g_prof.outBase = "prof";
+            std::streampos pos = ss.tellg();
+            std::string arg;
+            if (ss >> arg && arg[0] != '-') g_prof.outBase = arg;
+            else { ss.clear(); ss.seekg(pos); }
+        }
+    }
+}
+
+// ===== зоны =====
+
+// false — профайлер выключен или зона уже открыта
+inline bool ProfBeginZone(int zone)
+{
+    if (!g_prof.active || g_prof.zone >= 0)
+        return false;
+
+    g_prof.zone = zone;
+    QueryPerformanceCounter(&g_prof.zoneStart);
+
+    int s = g_prof.slot;
+    int n = g_prof.spanCount[s];
+    if (n < PROF_MAX_SPANS)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, g_prof.queries[s][n]);
+        g_prof.spanZone[s][n] = zone;
+    }
+    return true;
+}
+
+inline void ProfEndZone()
+{
+    int s = g_prof.slot;
+    if (g_prof.spanCount[s] < PROF_MAX_SPANS)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        ++g_prof.spanCount[s];
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    g_prof.cur->pass[g_prof.zone].cpuMs += ProfMs(g_prof.zoneStart, now);
+    g_prof.zone = -1;
+}
+
+struct ProfScope
+{
+    bool open;
+    explicit ProfScope(ProfZone z) : open(ProfBeginZone(z)) {}
+    ~ProfScope() { if (open) ProfEndZone(); }
+    ProfScope(const ProfScope&) = delete;
+    ProfScope& operator=(const ProfScope&) = delete;
+};
+
+// draw call в открытую зону; вне зон не считается
+inline void ProfDraw(GLenum mode, GLsizei count, GLsizei instances = 1)
+{
+    if (!g_prof.active || g_prof.zone < 0) return;
+
+    unsigned prims = 0;
+    if (mode == GL_TRIANGLES) prims = (unsigned)count / 3;
+    else if (mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) prims = count > 2 ? (unsigned)count - 2 : 0;
+
+    ProfPassStats& p = g_prof.cur->pass[g_prof.zone];
+    ++p.draws;
+    p.tris += prims * (unsigned)instances;
+    p.instances += (unsigned)instances;
+}
+
+// ===== кадр =====
+
+// результаты слота, записанного PROF_QUERY_FRAMES кадров назад — только если готовы
+void ProfCollectGpu(int s)
+{
+    int n = g_prof.spanCount[s];
+    if (n == 0) return;
+    g_prof.spanCount[s] = 0;
+
+    ProfFrameStats& f = g_prof.history[g_prof.slotFrame[s] % PROF_HISTORY];
+    if (f.frame != g_prof.slotFrame[s])
+        return;
+
+    // query завершаются по порядку: готов последний — готовы все
+    GLint ready = 0;
+    glGetQueryObjectiv(g_prof.queries[s][n - 1], GL_QUERY_RESULT_AVAILABLE, &ready);
+    if (!ready)
+    {
+        ++g_prof.gpuDropped;
+        return;
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(g_prof.queries[s][i], GL_QUERY_RESULT, &ns);
+        f.pass[g_prof.spanZone[s][i]].gpuMs += double(ns) * 1e-6;
+    }
+    f.gpuValid = true;
+
+    const float k = 0.1f;
+    for (int z = 0; z < PROF_ZONE_COUNT; ++z)
+        g_prof.smooth[z].gpuMs += (f.pass[z].gpuMs - g_prof.smooth[z].gpuMs) * k;
+    g_prof.smoothGpuMs += (f.GpuTotalMs() - g_prof.smoothGpuMs) * k;
+}
+
+void ProfWriteFiles();
+
+// в начале Render()
+void ProfBeginFrame()
+{
+    g_prof.active = ProfEnabled();
+    if (!g_prof.active)
+        return;
+
+    if (!g_prof.queries[0][0])
+    {
+        for (int s = 0; s < PROF_QUERY_FRAMES; ++s)
+            glGenQueries(PROF_MAX_SPANS, g_prof.queries[s]);
+        g_prof.history.assign(PROF_HISTORY, ProfFrameStats());
+    }
+
+    g_prof.prevFrameStart = g_prof.frameStart;
+    QueryPerformanceCounter(&g_prof.frameStart);
+
+    ++g_prof.frame;
+    g_prof.slot = (int)(g_prof.frame % PROF_QUERY_FRAMES);
+    ProfCollectGpu(g_prof.slot);
+    g_prof.slotFrame[g_prof.slot] = g_prof.frame;
+
+    g_prof.cur = &g_prof.history[g_prof.frame % PROF_HISTORY];
+    *g_prof.cur = ProfFrameStats();
+    g_prof.cur->frame = g_prof.frame;
+    if (g_prof.prevFrameStart.QuadPart)
+        g_prof.cur->frameMs = ProfMs(g_prof.prevFrameStart, g_prof.frameStart);
+}
+
+// в конце Render(), до SwapBuffers
+void ProfEndFrame()
+{
+    if (!g_prof.active)
+        return;
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    ProfFrameStats& f = *g_prof.cur;
+    f.cpuMs = ProfMs(g_prof.frameStart, now);
+
+    // счётчики точные, время — сглаженное
+    const float k = 0.1f;
+    for (int z = 0; z < PROF_ZONE_COUNT; ++z)
+    {
+        ProfPassStats& s = g_prof.smooth[z];
+        s.cpuMs += (f.pass[z].cpuMs - s.cpuMs) * k;
+        s.draws = f.pass[z].draws;
+        s.tris = f.pass[z].tris;
+        s.instances = f.pass[z].instances;
+    }
+    g_prof.smoothCpuMs += (f.cpuMs - g_prof.smoothCpuMs) * k;
+    g_prof.smoothFrameMs += (f.frameMs - g_prof.smoothFrameMs) * k;
+
+    if (!g_prof.outBase.empty() && g_prof.frame % PROF_HISTORY == 0)
+        ProfWriteFiles();
+}
+
+// ===== вывод =====
+
+// кольцо в порядке кадров; последние PROF_QUERY_FRAMES ещё ждут GPU — их не пишем
+template <typename Fn>
+void ProfForEachFinished(const Fn& fn)
+{
+    long long last = g_prof.frame - PROF_QUERY_FRAMES;
+    long long first = std::max(1LL, last - PROF_HISTORY + 1);
+    for (long long i = first; i <= last; ++i)
+    {
+        const ProfFrameStats& f = g_prof.history[i % PROF_HISTORY];
+        if (f.frame == i) fn(f);
+    }
+}
+
+void ProfWriteFiles()
+{
+    if (g_prof.history.empty())
+        return;
+
+    // CSV: кадр на строку, у каждого прохода gpu/cpu/draws/tris/inst; gpu пустой — query не успел
+    std::ofstream csv(g_prof.outBase + ".csv");
+    csv << "frame,frame_ms,cpu_ms,gpu_ms";
+    for (int z = 0; z < PROF_ZONE_COUNT; ++z)
+    {
+        const char* n = PROF_ZONE_NAMES[z];
+        csv << "," << n << "_gpu_ms," << n << "_cpu_ms," << n << "_draws," << n << "_tris," << n << "_inst";
+    }
+    csv << "\n";
+
+    int frames = 0, gpuFrames = 0;
+    double sumFrame = 0.0, maxFrame = 0.0, sumCpu = 0.0, sumGpu = 0.0, maxGpu = 0.0;
+    struct PassSum { double gpuMs = 0, cpuMs = 0, draws = 0, tris = 0, instances = 0; };
+    PassSum sum[PROF_ZONE_COUNT];   // double: за 600 кадров треугольники не влезут в unsigned
+    double maxPassGpu[PROF_ZONE_COUNT] = {};
+
+    ProfForEachFinished([&](const ProfFrameStats& f)
+        {
+            csv << f.frame << "," << f.frameMs << "," << f.cpuMs << ",";
+            if (f.gpuValid) csv << f.GpuTotalMs();
+            for (int z = 0; z < PROF_ZONE_COUNT; ++z)
+            {
+                const ProfPassStats& p = f.pass[z];
+                csv << ",";
+                if (f.gpuValid) csv << p.gpuMs;
+                csv << "," << p.cpuMs << "," << p.draws << "," << p.tris << "," << p.instances;
+
+                sum[z].cpuMs += p.cpuMs;
+                sum[z].draws += p.draws;
+                sum[z].tris += p.tris;
+                sum[z].instances += p.instances;
+                if (f.gpuValid)
+                {
+                    sum[z].gpuMs += p.gpuMs;
+                    maxPassGpu[z] = std::max(maxPassGpu[z], p.gpuMs);
+                }
+            }
+            csv << "\n";
+
+            ++frames;
+            sumFrame += f.frameMs;
+            maxFrame = std::max(maxFrame, f.frameMs);
+            sumCpu += f.cpuMs;
+            if (f.gpuValid)
+            {
+                ++gpuFrames;
+                sumGpu += f.GpuTotalMs();
+                maxGpu = std::max(maxGpu, f.GpuTotalMs());
+            }
+        });
+
+    // JSON: средние по тем же кадрам
+    double nf = std::max(1, frames), ng = std::max(1, gpuFrames);
+    std::ofstream js(g_prof.outBase + ".json");
+    js << "{\n"
+        << "  \"frames\": " << frames << ",\n"
+        << "  \"gpu_frames\": " << gpuFrames << ",\n"
+        << "  \"gpu_dropped\": " << g_prof.gpuDropped << ",\n"
+        << "  \"frame_ms\": { \"avg\": " << sumFrame / nf << ", \"max\": " << maxFrame << " },\n"
+        << "  \"cpu_ms\": { \"avg\": " << sumCpu / nf << " },\n"
+        << "  \"gpu_ms\": { \"avg\": " << sumGpu / ng << ", \"max\": " << maxGpu << " },\n"
+        << "  \"passes\": {\n";
+    for (int z = 0; z < PROF_ZONE_COUNT; ++z)
+    {
+        js << "    \"" << PROF_ZONE_NAMES[z] << "\": { "
+            << "\"gpu_ms_avg\": " << sum[z].gpuMs / ng << ", "
+            << "\"gpu_ms_max\": " << maxPassGpu[z] << ", "
+            << "\"cpu_ms_avg\": " << sum[z].cpuMs / nf << ", "
+            << "\"draws\": " << sum[z].draws / nf << ", "
+            << "\"tris\": " << sum[z].tris / nf << ", "
+            << "\"instances\": " << sum[z].instances / nf << " }"
+            << (z + 1 < PROF_ZONE_COUNT ? ",\n" : "\n");
+    }
+    js << "  }\n}\n";
+}
+
+// на выходе из WinMain
+void ProfShutdown()
+{
+    if (!g_prof.outBase.empty())
+        ProfWriteFiles();
+}
+
+// оверлей: полосы GPU (толстая) и CPU (тонкая) по проходам, шкала — 16.6 мс на всю ширину
+// фона; рисуем glClear'ом с ножницами, без шейдеров. Цифры — в заголовке окна
+void ProfDrawOverlay(int winW, int winH, HWND hWnd)
+{
+    if (!g_prof.overlay)
+    {
+        if (g_prof.titleSet)
+        {
+            SetWindowTextA(hWnd, "OpenGL Terrain");
+            g_prof.titleSet = false;
+        }
+        return;
+    }
+    if (winW <= 0 || winH <= 0)
+        return;
+
+    const float budgetMs = 16.6f;
+    const int x0 = 10, rowH = 9, barW = 300;
+    const int y0 = winH - 10 - PROF_ZONE_COUNT * rowH;
+
+    g_gl.ColorMask(true);
+    g_gl.Enable(GL_SCISSOR_TEST);
+
+    auto Rect = [](int x, int y, int w, int h, float r, float g, float b)
+        {
+            if (w <= 0 || h <= 0) return;
+            glScissor(x, y, w, h);
+            glClearColor(r, g, b, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        };
+
+    Rect(x0 - 2, y0 - 2, barW + 4, PROF_ZONE_COUNT * rowH + 4, 0.05f, 0.05f, 0.05f);
+    for (int z = 0; z < PROF_ZONE_COUNT; ++z)
+    {
+        const float* c = PROF_ZONE_COLORS[z];
+        int y = winH - 10 - (z + 1) * rowH;   // сверху вниз в порядке зон
+        int gw = (int)(std::min(g_prof.smooth[z].gpuMs / budgetMs, 1.0) * barW);
+        int cw = (int)(std::min(g_prof.smooth[z].cpuMs / budgetMs, 1.0) * barW);
+        Rect(x0, y + 3, gw, rowH - 4, c[0], c[1], c[2]);
+        Rect(x0, y + 1, cw, 2, c[0] * 0.6f, c[1] * 0.6f, c[2] * 0.6f);
+    }
+
+    // память: GPU — голубая, CPU — оранжевая следом; шкала — бюджет тега, без него — самый
+    // большой пик среди тегов. Перебор бюджета — красная рамка
+    {
+        MemTagStats ms[MEM_TAG_COUNT];
+        size_t scale = 1;
+        for (int t = 0; t < MEM_TAG_COUNT; ++t)
+        {
+            ms[t] = MemGetStats((MemTag)t);
+            scale = std::max(scale, ms[t].cpuPeak + ms[t].gpuPeak);
+        }
+
+        const int mx = x0 + barW + 20, memW = 200;
+        const int my0 = winH - 10 - MEM_TAG_COUNT * rowH;
+        Rect(mx - 2, my0 - 2, memW + 4, MEM_TAG_COUNT * rowH + 4, 0.05f, 0.05f, 0.05f);
+        for (int t = 0; t < MEM_TAG_COUNT; ++t)
+        {
+            const MemTagStats& s = ms[t];
+            double full = (double)(s.budget ? s.budget : scale);
+            int y = winH - 10 - (t + 1) * rowH;
+            if (s.budget && s.cpu + s.gpu > s.budget)
+                Rect(mx - 1, y, memW + 2, rowH - 1, 0.8f, 0.1f, 0.1f);
+            int gw = (int)(std::min(s.gpu / full, 1.0) * memW);
+            int cw = (int)(std::min((s.cpu + s.gpu) / full, 1.0) * memW) - gw;
+            Rect(mx, y + 1, gw, rowH - 3, 0.3f, 0.7f, 1.0f);
+            Rect(mx + gw, y + 1, cw, rowH - 3, 1.0f, 0.6f, 0.2f);
+        }
+    }
+
+    g_gl.Disable(GL_SCISSOR_TEST);
+
+    // заголовок — раз в полсекунды, SetWindowText не бесплатный
+    if (g_prof.frame % 30 == 0)
+    {
+        std::ostringstream os;
+        os.precision(2);
+        os << std::fixed << "frame " << g_prof.smoothFrameMs << " ms | cpu " << g_prof.smoothCpuMs
+            << " gpu " << g_prof.smoothGpuMs << " |";
+        unsigned draws = 0, tris = 0;
+        for (int z = 0; z < PROF_ZONE_COUNT; ++z)
+        {
+            os << " " << PROF_ZONE_NAMES[z] << " " << g_prof.smooth[z].gpuMs;
+            draws += g_prof.smooth[z].draws;
+            tris += g_prof.smooth[z].tris;
+        }
+        os << " | draws " << draws << " tris " << tris;
+
+        size_t memCpu = 0, memGpu = 0;
+        MemTotals(memCpu, memGpu);
+        os.precision(0);
+        os << " | mem cpu " << memCpu / (1024.0 * 1024.0) << " gpu " << memGpu / (1024.0 * 1024.0) << " MB";
+        SetWindowTextA(hWnd, os.str().c_str());
+        g_prof.titleSet = true;
+    }
+}
@@ -9,6 +9,7 @@ bool   g_rakeHitDone = false;   // чтобы косить траву один 
 
 void InitRake()
 {
+    MemScope memTag(MEM_TOOLS);
     // Подложи сюда свой файл, например "rake.obj" или "rake.fbx"
     if (!g_rakeModel.Load("gardeners_rake.glb")) {
         OutputDebugStringA("Failed to load rake model\n");
@@ -19,7 +20,7 @@ void InitRake()
     // если он: uProjection, uView, uModel, uTex, uLightDir.
     // Но лучше сделать отдельный, попроще.
     //g_rakeShader = CreateShaderProgram("rake.vert", "rake.frag");
-    g_rakeShader = CreateShaderProgram("rake.vert", "rake.frag");
+    if (!g_rakeShader) g_rakeShader = CreateShaderProgram("rake.vert", "rake.frag");
 }
 
 //void DrawRakeViewModel(const glm::mat4& proj, const glm::mat4& view)
@@ -79,16 +80,12 @@ void InitRake()
 
 void DrawRakeViewModel(const glm::mat4& proj, const glm::mat4& view)
 {
-    if (g_currentTool != TOOL_RAKE) return;
+    const SimSnapshot& rs = g_renderState;
+    if (rs.tool != TOOL_RAKE) return;
     if (!g_rakeShader || g_rakeModel.meshes.empty()) return;
 
-    glUseProgram(g_rakeShader);
-
-    glUniformMatrix4fv(glGetUniformLocation(g_rakeShader, "uProjection"), 1, GL_FALSE, &proj[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(g_rakeShader, "uView"), 1, GL_FALSE, &view[0][0]);
-
-    glm::vec3 lightDir = glm::normalize(glm::vec3(0.4f, 1.0f, 0.2f));
-    glUniform3fv(glGetUniformLocation(g_rakeShader, "uLightDir"), 1, &lightDir[0]);
+    // матрицы и свет — в блоке Frame (frame_ubo.h)
+    g_gl.UseProgram(g_rakeShader);
 
     // локальное положение граблей в системе камеры
     glm::mat4 local(1.0f);
@@ -107,8 +104,8 @@ void DrawRakeViewModel(const glm::mat4& proj, const glm::mat4& view)
 
     // === АНИМАЦИЯ ВЗМАХА ===
     float t = 0.0f;
-    if (g_rakeSwinging)
-        t = glm::clamp(g_rakeSwingTime / g_rakeSwingDuration, 0.0f, 1.0f);
+    if (rs.rakeSwinging)
+        t = glm::clamp(rs.rakeSwingTime / g_rakeSwingDuration, 0.0f, 1.0f);
 
     if (t > 0.0f)
     {
@@ -136,11 +133,11 @@ void DrawRakeViewModel(const glm::mat4& proj, const glm::mat4& view)
     glm::mat4 camMatrix = glm::inverse(view);   // корректная матрица камеры
     glm::mat4 model = camMatrix * local;
 
-    glUniformMatrix4fv(glGetUniformLocation(g_rakeShader, "uModel"), 1, GL_FALSE, &model[0][0]);
+    glUniformMatrix4fv(UniformLoc(g_rakeShader, "uModel"), 1, GL_FALSE, &model[0][0]);
 
-    glDisable(GL_DEPTH_TEST);
+    g_gl.Disable(GL_DEPTH_TEST);
     g_rakeModel.Draw(g_rakeShader);
-    glEnable(GL_DEPTH_TEST);
+    g_gl.Enable(GL_DEPTH_TEST);
 }
 
 //void DrawRakeViewModel(const glm::mat4& proj, const glm::mat4& view)
@@ -0,0 +1,126 @@
+﻿#pragma once
+// render_queue.h
+// Очередь отрисовки: подсистемы кидают пакеты с 64-битным ключом сортировки,
+// раз в кадр очередь сортируется и исполняется. Порядок задаётся ключом,
+// а не порядком вызовов в Render(): новый тип объектов просто делает Submit.
+//
+// Раскладка ключа (старшие биты важнее):
+//   [63:60] pass     — крупные проходы (небо, depth pre-pass, мир, вьюмодели)
+//   [59:58] bucket   — opaque / alpha-tested / background (небо) / transparent
+//   opaque и alpha-tested (минимум смен состояния, дальше front-to-back для early-z):
+//     [57:48] shader  [47:36] texture  [35:26] vao  [25:12] depth  [11:0] seq
+//   transparent (back-to-front важнее состояния):
+//     [57:44] ~depth  [43:34] shader   [33:22] texture  [21:12] vao  [11:0] seq
+// seq — номер пакета в кадре, чтобы при равных ключах сохранялся порядок Submit.
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+enum RenderPass {
+    PASS_SKY = 0,        // фон до всего (небо теперь BUCKET_BACKGROUND мира, sky.h)
+    PASS_DEPTH = 1,      // depth pre-pass (depth_prepass.h), цвет не пишется
+    PASS_WORLD = 2,      // мир в scene FBO
+    PASS_VIEWMODEL = 3   // инструменты поверх пост-обработки
+};
+
+enum RenderBucket {
+    BUCKET_OPAQUE = 0,
+    BUCKET_ALPHATEST = 1,
+    BUCKET_BACKGROUND = 2,   // после всего непрозрачного, на дальней плоскости: early-z режет закрытое
+    BUCKET_TRANSPARENT = 3
+};
+
+// то, что нужно колбэку пакета из кадра
+struct RenderView
+{
+    glm::mat4 proj;
+    glm::mat4 view;
+    glm::vec3 camPos;
+};
+
+struct DrawPacket;
+typedef void (*DrawPacketFn)(const DrawPacket& p, const RenderView& v);
+
+struct DrawPacket
+{
+    uint64_t key = 0;
+    DrawPacketFn draw = nullptr;
+    const void* object = nullptr;   // данные подсистемы (меш, модель...), если нужны
+};
+
+struct RenderQueue
+{
+    std::vector<DrawPacket> packets;
+    RenderView view;
+    float maxDepth = 500.0f;        // дальняя плоскость: дистанции дальше сливаются
+
+    void Begin(const glm::mat4& proj, const glm::mat4& viewM, const glm::vec3& camPos)
+    {
+        packets.clear();            // capacity остаётся: аллокаций в кадре нет
+        view.proj = proj;
+        view.view = viewM;
+        view.camPos = camPos;
+    }
+
+    // квантованная дистанция от камеры до центра объекта
+    uint64_t QuantizeDepth(const glm::vec3& center) const
+    {
+        float d = glm::length(center - view.camPos) / maxDepth;
+        d = glm::clamp(d, 0.0f, 1.0f);
+        return (uint64_t)(d * 0x3FFF);
+    }
+
+    // shader/texture/vao — GL-имена, в ключ идут младшие биты
+    void Submit(RenderPass pass, RenderBucket bucket,
+        GLuint shader, GLuint texture, GLuint vao,
+        const glm::vec3& center, DrawPacketFn fn, const void* object = nullptr)
+    {
+        uint64_t depth = QuantizeDepth(center);
+        uint64_t seq = (uint64_t)(packets.size() & 0xFFF);
+
+        uint64_t key = ((uint64_t)pass & 0xF) << 60 | ((uint64_t)bucket & 0x3) << 58;
+        if (bucket == BUCKET_TRANSPARENT)
+        {
+            key |= ((~depth) & 0x3FFF) << 44;
+            key |= ((uint64_t)shader & 0x3FF) << 34;
+            key |= ((uint64_t)texture & 0xFFF) << 22;
+            key |= ((uint64_t)vao & 0x3FF) << 12;
+        }
+        else
+        {
+            key |= ((uint64_t)shader & 0x3FF) << 48;
+            key |= ((uint64_t)texture & 0xFFF) << 36;
+            key |= ((uint64_t)vao & 0x3FF) << 26;
+            key |= depth << 12;
+        }
+        key |= seq;
+
+        DrawPacket p;
+        p.key = key;
+        p.draw = fn;
+        p.object = object;
+        packets.push_back(p);
+    }
+
+    // один раз за кадр, после всех Submit
+    void Sort()
+    {
+        std::sort(packets.begin(), packets.end(),
+            [](const DrawPacket& a, const DrawPacket& b) { return a.key < b.key; });
+    }
+
+    // исполнить пакеты проходов [first..last] (очередь уже отсортирована)
+    void Execute(RenderPass first, RenderPass last) const
+    {
+        for (const DrawPacket& p : packets)
+        {
+            int pass = (int)(p.key >> 60);
+            if (pass < first || pass > last) continue;
+            if (p.draw) p.draw(p, view);
+        }
+    }
+};
+
+RenderQueue g_renderQueue;
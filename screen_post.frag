@@ -3,8 +3,77 @@ in vec2 vUV;
 out vec4 FragColor;
 
 uniform sampler2D uSceneTex;
-uniform int  uUnderwater;
-uniform float uTime;
+
+// динамическое разрешение (dynres.h): мир лежит в [0, uSceneScale] текстуры
+uniform vec2  uSceneScale;
+uniform vec2  uSceneTexel;   // 1 / размер FBO
+uniform float uSharpen;      // 0 — без шарпена (родное разрешение)
+
+// вода в половинном разрешении (water_halfres.h)
+uniform int       uWaterHalf;       // 1 — воды в сцене нет, она в uWaterTex
+uniform sampler2D uWaterTex;        // rgb * a, a
+uniform sampler2D uWaterDist;       // расстояние до поверхности, 0 — воды нет
+uniform sampler2D uWaterLowDepth;   // глубина мира, уменьшенная 2x2 (max)
+
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
+#include "fog.glsl"
+
+// экранные uv -> uv в FBO, не вылезая за нарисованный прямоугольник
+vec2 SceneUV(vec2 uv)
+{
+    return clamp(uv * uSceneScale, uSceneTexel * 0.5, uSceneScale - uSceneTexel * 0.5);
+}
+
+vec4 SampleScene(vec2 uv)
+{
+    return texture(uSceneTex, SceneUV(uv));
+}
+
+// билатеральный апскейл воды: 4 тексела половинки вокруг пикселя,
+// вес = билинейный * похожесть глубины половинки на нашу полную глубину
+vec4 UpsampleWater(vec2 suv, float depth, out float waterDist)
+{
+    vec2 p = suv / uSceneTexel * 0.5 - 0.5;          // в текселях половинки
+    ivec2 base = ivec2(floor(p));
+    vec2 f = p - vec2(base);
+    ivec2 maxT = ivec2(ceil(uSceneScale / uSceneTexel * 0.5)) - 1;
+
+    float z = SceneViewDepth(depth);
+
+    vec4 sum = vec4(0.0);
+    float wsum = 0.0, dsum = 0.0, dw = 0.0;
+    vec4 best = vec4(0.0);
+    float bestDist = 0.0, bestDiff = 1e9;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 o = ivec2(i & 1, i >> 1);
+        ivec2 t = clamp(base + o, ivec2(0), maxT);
+
+        vec4  c = texelFetch(uWaterTex, t, 0);
+        float d = texelFetch(uWaterDist, t, 0).r;
+        float diff = abs(SceneViewDepth(texelFetch(uWaterLowDepth, t, 0).r) - z) / max(z, 0.1);
+
+        float wb = (o.x == 1 ? f.x : 1.0 - f.x) * (o.y == 1 ? f.y : 1.0 - f.y);
+        float w = (wb + 1e-3) / (0.01 + diff);
+
+        sum += c * w;
+        wsum += w;
+        if (d > 0.0) { dsum += d * w; dw += w; }
+
+        if (diff < bestDiff) { bestDiff = diff; best = c; bestDist = d; }
+    }
+
+    // ни один не похож (тонкая суша на фоне воды) — ближайший по глубине, без размазывания
+    if (bestDiff > 0.1)
+    {
+        waterDist = bestDist;
+        return best;
+    }
+
+    waterDist = (dw > 0.0) ? dsum / dw : 0.0;
+    return sum / wsum;
+}
 
 vec2 wobble(vec2 uv, float strength)
 {
@@ -18,7 +87,35 @@ void main()
     // == НАД ВОДОЙ ==
     if (uUnderwater == 0)
     {
-        FragColor = texture(uSceneTex, vUV);
+        vec2 suv = SceneUV(vUV);
+        vec4 scene = texture(uSceneTex, suv);
+
+        // апскейл билинейный; при scale < 1 чуть возвращаем резкость (unsharp по крестику)
+        if (uSharpen > 0.0)
+        {
+            vec3 n = texture(uSceneTex, suv + vec2(uSceneTexel.x, 0.0)).rgb
+                   + texture(uSceneTex, suv - vec2(uSceneTexel.x, 0.0)).rgb
+                   + texture(uSceneTex, suv + vec2(0.0, uSceneTexel.y)).rgb
+                   + texture(uSceneTex, suv - vec2(0.0, uSceneTexel.y)).rgb;
+            scene.rgb = clamp(scene.rgb + uSharpen * (4.0 * scene.rgb - n), 0.0, 1.0);
+        }
+
+        // вода из половинки поверх мира; туман — до её поверхности, как в полном разрешении
+        if (uWaterHalf == 1)
+        {
+            float depth = texture(uSceneDepth, suv).r;
+            float waterDist;
+            vec4 water = UpsampleWater(suv, depth, waterDist);
+            scene.rgb = scene.rgb * (1.0 - water.a) + water.rgb;
+
+            if (water.a > 0.0 && waterDist > 0.0)
+            {
+                FragColor = vec4(ApplyFog(scene.rgb, waterDist, vUV), scene.a);
+                return;
+            }
+        }
+
+        FragColor = vec4(ApplySceneFog(scene.rgb, vUV, suv), scene.a);
         return;
     }
 
@@ -26,11 +123,14 @@ void main()
     float strength = 1.0;
     vec2 uv0 = wobble(vUV, strength);
 
-    vec4 col = texture(uSceneTex, uv0) * 0.4;
-    col += texture(uSceneTex, wobble(vUV + vec2( 0.003, 0.0), strength)) * 0.15;
-    col += texture(uSceneTex, wobble(vUV + vec2(-0.003, 0.0), strength)) * 0.15;
-    col += texture(uSceneTex, wobble(vUV + vec2(0.0,  0.003), strength)) * 0.15;
-    col += texture(uSceneTex, wobble(vUV + vec2(0.0, -0.003), strength)) * 0.15;
+    vec4 col = SampleScene(uv0) * 0.4;
+    col += SampleScene(wobble(vUV + vec2( 0.003, 0.0), strength)) * 0.15;
+    col += SampleScene(wobble(vUV + vec2(-0.003, 0.0), strength)) * 0.15;
+    col += SampleScene(wobble(vUV + vec2(0.0,  0.003), strength)) * 0.15;
+    col += SampleScene(wobble(vUV + vec2(0.0, -0.003), strength)) * 0.15;
+
+    // туман + затемнение по глубине центрального сэмпла
+    col.rgb = ApplySceneFog(col.rgb, uv0, SceneUV(uv0));
 
     vec3 tint = vec3(0.0, 0.3, 0.35);
     col.rgb = mix(col.rgb, tint, 0.15);
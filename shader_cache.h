@@ -0,0 +1,279 @@
+﻿#pragma once
+// shader_cache.h
+// Ускорение старта:
+//  - кэш бинарников программ (glGetProgramBinary / glProgramBinary) в shader_cache/,
+//    ключ = хэш исходников (с defines) + vendor/renderer/version драйвера;
+//  - при промахе компиляция без ожидания: все программы запускаются сразу,
+//    статусы спрашиваем потом (FinishShaderPrograms), с GL_KHR_parallel_shader_compile
+//    драйвер собирает их в своих потоках.
+// Функции расширений грузим сами через wglGetProcAddress — от версии glad не зависим.
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRY* PFN_GetProgramBinary)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+typedef void (APIENTRY* PFN_ProgramBinary)(GLuint, GLenum, const void*, GLsizei);
+typedef void (APIENTRY* PFN_ProgramParameteri)(GLuint, GLenum, GLint);
+typedef void (APIENTRY* PFN_MaxShaderCompilerThreads)(GLuint);
+
+struct ShaderCacheState
+{
+    bool initialized = false;
+    bool binarySupported = false;
+    bool parallelCompile = false;
+    uint64_t driverHash = 0;
+
+    PFN_GetProgramBinary getProgramBinary = nullptr;
+    PFN_ProgramBinary programBinary = nullptr;
+    PFN_ProgramParameteri programParameteri = nullptr;
+
+    // статистика старта
+    int fromCache = 0;
+    int compiled = 0;
+    int failed = 0;
+};
+
+ShaderCacheState g_shaderCache;
+
+// программа, у которой ещё не спрашивали статус линковки
+struct PendingProgram
+{
+    GLuint prog = 0;
+    GLuint vs = 0, fs = 0;
+    uint64_t key = 0;
+    std::string name;
+};
+
+std::vector<PendingProgram> g_pendingPrograms;
+
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t h = 1469598103934665603ull)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+inline bool HasGLExtension(const char* name)
+{
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for (GLint i = 0; i < n; ++i)
+    {
+        const char* e = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (e && strcmp(e, name) == 0) return true;
+    }
+    return false;
+}
+
+// один раз, при первом CreateShaderProgram (контекст уже есть)
+void InitShaderCache()
+{
+    if (g_shaderCache.initialized) return;
+    g_shaderCache.initialized = true;
+
+    // драйвер входит в ключ: обновили драйвер — бинарники просто не найдутся
+    const char* strs[3] = {
+        (const char*)glGetString(GL_VENDOR),
+        (const char*)glGetString(GL_RENDERER),
+        (const char*)glGetString(GL_VERSION)
+    };
+    uint64_t h = 1469598103934665603ull;
+    for (const char* s : strs)
+        if (s) h = HashBytes(s, strlen(s), h);
+    g_shaderCache.driverHash = h;
+
+    g_shaderCache.getProgramBinary = (PFN_GetProgramBinary)wglGetProcAddress("glGetProgramBinary");
+    g_shaderCache.programBinary = (PFN_ProgramBinary)wglGetProcAddress("glProgramBinary");
+    g_shaderCache.programParameteri = (PFN_ProgramParameteri)wglGetProcAddress("glProgramParameteri");
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    g_shaderCache.binarySupported = g_shaderCache.getProgramBinary && g_shaderCache.programBinary &&
+        g_shaderCache.programParameteri && formats > 0;
+
+    if (HasGLExtension("GL_KHR_parallel_shader_compile") || HasGLExtension("GL_ARB_parallel_shader_compile"))
+    {
+        PFN_MaxShaderCompilerThreads maxThreads =
+            (PFN_MaxShaderCompilerThreads)wglGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (!maxThreads)
+            maxThreads = (PFN_MaxShaderCompilerThreads)wglGetProcAddress("glMaxShaderCompilerThreadsARB");
+        if (maxThreads)
+        {
+            maxThreads(0xFFFFFFFFu);   // сколько драйвер сочтёт нужным
+            g_shaderCache.parallelCompile = true;
+        }
+    }
+
+    CreateDirectoryA("shader_cache", nullptr);
+
+    char buf[160];
+    sprintf_s(buf, "ShaderCache: binary=%d parallel=%d\n",
+        g_shaderCache.binarySupported ? 1 : 0, g_shaderCache.parallelCompile ? 1 : 0);
+    OutputDebugStringA(buf);
+}
+
+inline uint64_t ProgramCacheKey(const std::string& vsSrc, const std::string& fsSrc)
+{
+    uint64_t h = g_shaderCache.driverHash;
+    h = HashBytes(vsSrc.data(), vsSrc.size(), h);
+    h = HashBytes("\0", 1, h);   // граница vs/fs
+    h = HashBytes(fsSrc.data(), fsSrc.size(), h);
+    return h;
+}
+
+inline std::string ProgramCachePath(uint64_t key)
+{
+    char name[64];
+    sprintf_s(name, "shader_cache/%016llx.bin", (unsigned long long)key);
+    return name;
+}
+
+// файл: [GLenum format][GLsizei length][bytes...]
+GLuint LoadProgramBinary(uint64_t key)
+{
+    if (!g_shaderCache.binarySupported) return 0;
+
+    std::ifstream f(ProgramCachePath(key), std::ios::binary);
+    if (!f) return 0;
+
+    GLenum format = 0;
+    GLsizei length = 0;
+    f.read((char*)&format, sizeof(format));
+    f.read((char*)&length, sizeof(length));
+    if (!f || length <= 0) return 0;
+
+    std::vector<char> data((size_t)length);
+    f.read(data.data(), length);
+    if (!f) return 0;
+
+    GLuint prog = glCreateProgram();
+    g_shaderCache.programBinary(prog, format, data.data(), length);
+
+    // драйвер вправе отказать (другая версия и т.п.) — тогда компилируем заново
+    GLint ok = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        glDeleteProgram(prog);
+        return 0;
+    }
+    return prog;
+}
+
+void SaveProgramBinary(GLuint prog, uint64_t key)
+{
+    if (!g_shaderCache.binarySupported) return;
+
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> data((size_t)length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    g_shaderCache.getProgramBinary(prog, length, &written, &format, data.data());
+    if (written <= 0) return;
+
+    std::ofstream f(ProgramCachePath(key), std::ios::binary);
+    f.write((const char*)&format, sizeof(format));
+    f.write((const char*)&written, sizeof(written));
+    f.write(data.data(), written);
+}
+
+// статус + лог + кэш + рефлексия для одной отложенной программы
+void FinalizeProgram(PendingProgram& pp)
+{
+    GLint ok = 0;
+    glGetProgramiv(pp.prog, GL_LINK_STATUS, &ok);
+
+    if (!ok)
+    {
+        char log[1024];
+        OutputDebugStringA(("Shader program failed: " + pp.name + "\n").c_str());
+
+        GLuint stages[2] = { pp.vs, pp.fs };
+        for (GLuint s : stages)
+        {
+            GLint cok = 0;
+            glGetShaderiv(s, GL_COMPILE_STATUS, &cok);
+            if (!cok) {
+                glGetShaderInfoLog(s, 1024, nullptr, log);
+                OutputDebugStringA(log);
+            }
+        }
+        glGetProgramInfoLog(pp.prog, 1024, nullptr, log);
+        OutputDebugStringA(log);
+        ++g_shaderCache.failed;
+    }
+    else
+    {
+        SaveProgramBinary(pp.prog, pp.key);
+    }
+
+    glDetachShader(pp.prog, pp.vs);
+    glDetachShader(pp.prog, pp.fs);
+    glDeleteShader(pp.vs);
+    glDeleteShader(pp.fs);
+
+    // локации uniform'ов и биндинг блока Frame
+    ReflectProgram(pp.prog);
+}
+
+// одну программу — когда она понадобилась раньше FinishShaderPrograms (UniformLoc)
+void FinishShaderProgram(GLuint prog)
+{
+    for (size_t i = 0; i < g_pendingPrograms.size(); ++i)
+    {
+        if (g_pendingPrograms[i].prog != prog) continue;
+
+        PendingProgram pp = g_pendingPrograms[i];
+        g_pendingPrograms.erase(g_pendingPrograms.begin() + i);
+        FinalizeProgram(pp);
+        return;
+    }
+}
+
+// все оставшиеся; с parallel compile забираем в порядке готовности
+void FinishShaderPrograms()
+{
+    while (!g_pendingPrograms.empty())
+    {
+        bool progress = false;
+        for (size_t i = 0; i < g_pendingPrograms.size(); )
+        {
+            GLint done = 1;
+            if (g_shaderCache.parallelCompile)
+                glGetProgramiv(g_pendingPrograms[i].prog, GL_COMPLETION_STATUS_KHR, &done);
+
+            if (done)
+            {
+                PendingProgram pp = g_pendingPrograms[i];
+                g_pendingPrograms.erase(g_pendingPrograms.begin() + i);
+                FinalizeProgram(pp);
+                progress = true;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        if (!progress) Sleep(0);
+    }
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+// shader_reflect.h
+// Кэш локаций uniform'ов: один раз после линковки опрашиваем программу
+// (glGetActiveUniform), дальше UniformLoc() — только поиск в хэш-таблице,
+// без glGetUniformLocation в кадре.
+
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+
+// FNV-1a, строка -> 64 бита (ключ без аллокаций std::string в кадре)
+inline uint64_t HashName(const char* s)
+{
+    uint64_t h = 1469598103934665603ull;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+struct ProgramUniforms
+{
+    std::unordered_map<uint64_t, GLint> locs;
+};
+
+std::unordered_map<GLuint, ProgramUniforms> g_programUniforms;
+
+// биндинги uniform-блоков (общие для всех программ)
+const GLuint FRAME_UBO_BINDING = 0;
+
+void ReflectProgram(GLuint prog)
+{
+    ProgramUniforms& pu = g_programUniforms[prog];
+    pu.locs.clear();
+
+    GLint count = 0, maxLen = 0;
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+
+    std::string name(maxLen > 0 ? maxLen : 1, '\0');
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLsizei len = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(prog, (GLuint)i, maxLen, &len, &size, &type, &name[0]);
+        name[len] = '\0';
+
+        // члены uniform-блоков локаций не имеют
+        GLint loc = glGetUniformLocation(prog, name.c_str());
+        if (loc < 0) continue;
+
+        pu.locs[HashName(name.c_str())] = loc;
+
+        // массивы: "uBones[0]" доступен и как "uBones"
+        if (len > 3 && name.compare(len - 3, 3, "[0]") == 0)
+        {
+            name[len - 3] = '\0';
+            pu.locs[HashName(name.c_str())] = loc;
+        }
+    }
+
+    // общий блок кадра (frame_ubo.h) — на фиксированный биндинг
+    GLuint frameBlock = glGetUniformBlockIndex(prog, "Frame");
+    if (frameBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(prog, frameBlock, FRAME_UBO_BINDING);
+}
+
+// shader_cache.h: дождаться отложенной (ещё линкующейся) программы
+void FinishShaderProgram(GLuint prog);
+
+// -1, если такого активного uniform'а нет (как у glGetUniformLocation)
+inline GLint UniformLoc(GLuint prog, const char* name)
+{
+    auto it = g_programUniforms.find(prog);
+    if (it == g_programUniforms.end())
+    {
+        // программа ещё не рефлексирована — компиляция в фоне, забираем сейчас
+        FinishShaderProgram(prog);
+        it = g_programUniforms.find(prog);
+        if (it == g_programUniforms.end()) return -1;
+    }
+
+    auto li = it->second.locs.find(HashName(name));
+    return (li != it->second.locs.end()) ? li->second : -1;
+}
@@ -0,0 +1,68 @@
+﻿#pragma once
+// shader_variants.h
+// Варианты одной программы через #define (вставляются после #version):
+//   UNDERWATER  — подводная версия (вода) вместо ветки по uUnderwater
+//   ALPHA_TEST  — discard по альфе (без него — цветовой проход после depth pre-pass)
+//   INSTANCED   — матрица из атрибута экземпляра (лес), иначе uModel
+// Семейство = пара vs/fs + какие биты ему вообще важны. Вариант компилируется
+// при первом запросе и дальше лежит в кэше семейства (на диске — shader_cache.h).
+
+#include <unordered_map>
+#include <string>
+
+enum ShaderVariantBits
+{
+    SV_UNDERWATER = 1 << 0,
+    SV_ALPHA_TEST = 1 << 1,
+    SV_INSTANCED = 1 << 2
+};
+
+// постоянные uniform'ы варианта (программа уже в UseProgram)
+typedef void (*ShaderVariantSetup)(GLuint prog);
+
+struct ShaderVariant
+{
+    GLuint prog = 0;
+    bool ready = false;   // рефлексия + setup сделаны
+};
+
+struct ShaderFamily
+{
+    const char* vs;
+    const char* fs;
+    unsigned bits;                  // биты, которые есть в шейдерах; остальные отбрасываем
+    ShaderVariantSetup setup;
+    std::unordered_map<unsigned, ShaderVariant> variants;
+};
+
+inline std::string ShaderVariantDefines(unsigned bits)
+{
+    std::string d;
+    if (bits & SV_UNDERWATER) d += "#define UNDERWATER\n";
+    if (bits & SV_ALPHA_TEST) d += "#define ALPHA_TEST\n";
+    if (bits & SV_INSTANCED)  d += "#define INSTANCED\n";
+    return d;
+}
+
+// prewarm = true: только запустить компиляцию (старт, LoadShaders),
+// статус и setup — при первом обычном запросе
+GLuint GetShaderVariant(ShaderFamily& f, unsigned bits, bool prewarm = false)
+{
+    bits &= f.bits;
+
+    ShaderVariant& v = f.variants[bits];
+    if (!v.prog)
+        v.prog = CreateShaderProgram(f.vs, f.fs, ShaderVariantDefines(bits).c_str());
+
+    if (!v.ready && !prewarm)
+    {
+        FinishShaderProgram(v.prog);   // если ещё линкуется — дождаться
+        if (f.setup)
+        {
+            g_gl.UseProgram(v.prog);
+            f.setup(v.prog);
+        }
+        v.ready = true;
+    }
+    return v.prog;
+}
@@ -5,7 +5,8 @@ in vec3 vNormal;
 out vec4 FragColor;
 
 uniform sampler2D uTex;
-uniform vec3 uLightDir;
+
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
 
 void main()
 {
@@ -10,6 +10,7 @@ const float g_shovelSwingDuration = 0.5f;
 
 void InitShovel()
 {
+    MemScope memTag(MEM_TOOLS);
     // Подложи сюда свой файл, например "rake.obj" или "rake.fbx"
     if (!g_shovelModel.Load("shovel_low_poly_gltf\\untitled.obj")) {
         OutputDebugStringA("Failed to load rake model\n");
@@ -19,23 +20,19 @@ void InitShovel()
     // Можно использовать тот же шейдер, что и для деревьев,
     // если он: uProjection, uView, uModel, uTex, uLightDir.
     // Но лучше сделать отдельный, попроще.
-    g_shovelShader = CreateShaderProgram("shovel.vert", "shovel.frag");
+    if (!g_shovelShader) g_shovelShader = CreateShaderProgram("shovel.vert", "shovel.frag");
 }
 
 void DrawShovelViewModel(const glm::mat4& proj, const glm::mat4& view)
 {
-    if (g_currentTool != TOOL_SHOVEL && !g_shovelSwinging)
+    const SimSnapshot& rs = g_renderState;
+    if (rs.tool != TOOL_SHOVEL && !rs.shovelSwinging)
         return;
     if (!g_shovelShader || g_shovelModel.meshes.empty())
         return;
 
-    glUseProgram(g_shovelShader);
-
-    glUniformMatrix4fv(glGetUniformLocation(g_shovelShader, "uProjection"), 1, GL_FALSE, &proj[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(g_shovelShader, "uView"), 1, GL_FALSE, &view[0][0]);
-
-    glm::vec3 lightDir = glm::normalize(glm::vec3(0.4f, 1.0f, 0.2f));
-    glUniform3fv(glGetUniformLocation(g_shovelShader, "uLightDir"), 1, &lightDir[0]);
+    // матрицы и свет — в блоке Frame (frame_ubo.h)
+    g_gl.UseProgram(g_shovelShader);
 
     // === ЛОКАЛЬНАЯ ПОЗИЦИЯ ЛОПАТЫ (в системе камеры) ===
 
@@ -54,8 +51,8 @@ void DrawShovelViewModel(const glm::mat4& proj, const glm::mat4& view)
 
     // === АНИМАЦИЯ ВЗМАХА ===
     float t = 0.0f;
-    if (g_shovelSwinging)
-        t = glm::clamp(g_shovelSwingTime / g_shovelSwingDuration, 0.0f, 1.0f);
+    if (rs.shovelSwinging)
+        t = glm::clamp(rs.shovelSwingTime / g_shovelSwingDuration, 0.0f, 1.0f);
 
     if (t > 0.0f)
     {
@@ -82,27 +79,27 @@ void DrawShovelViewModel(const glm::mat4& proj, const glm::mat4& view)
     glm::mat4 camMatrix = glm::inverse(view);   // корректная матрица камеры
     glm::mat4 model = camMatrix * local;
 
-    glUniformMatrix4fv(glGetUniformLocation(g_shovelShader, "uModel"), 1, GL_FALSE, &model[0][0]);
+    glUniformMatrix4fv(UniformLoc(g_shovelShader, "uModel"), 1, GL_FALSE, &model[0][0]);
 
     // depth-тест ВКЛЮЧЁН, записываем глубину (само-окклюзия работает)
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-    glDepthFunc(GL_LEQUAL);
+    g_gl.Enable(GL_DEPTH_TEST);
+    g_gl.DepthMask(GL_TRUE);
+    g_gl.DepthFunc(GL_LEQUAL);
 
     // инструмент рендерим в ближнем диапазоне глубины [0 .. 0.1]
-    glDepthRange(0.0, 0.1);
+    g_gl.DepthRange(0.0, 0.1);
 
     // отсечение задних граней
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
+    g_gl.Enable(GL_CULL_FACE);
+    g_gl.CullFace(GL_BACK);
+    g_gl.FrontFace(GL_CCW);
 
     g_shovelModel.Draw(g_shovelShader);
 
     // === ВОЗВРАЩАЕМ СОСТОЯНИЕ ===
 
-    glDisable(GL_CULL_FACE);
-    glDepthRange(0.0, 1.0);
+    g_gl.Disable(GL_CULL_FACE);
+    g_gl.DepthRange(0.0, 1.0);
     // depth-test оставляем включенным — мир уже нарисован раньше
 }
 
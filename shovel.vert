@@ -4,8 +4,8 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTex;
 
-uniform mat4 uProjection;
-uniform mat4 uView;
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
+
 uniform mat4 uModel;
 uniform mat4 uNode;   // <<< ДОБАВИЛИ
 
@@ -0,0 +1,362 @@
+﻿#pragma once
+// sim_thread.h
+// Симуляция в своём потоке с фиксированным тиком (SIM_HZ), рендер — в главном.
+//  - сим-поток владеет игровым состоянием (g_cam, инструменты, раскопки, рубка):
+//    после каждого тика пишет неизменяемый SimSnapshot и публикует его через
+//    тройной буфер без блокировок (писатель и читатель никогда не делят слот);
+//  - рендер берёт два последних снапшота и интерполирует между ними (камера, таймеры
+//    анимаций), рисуя "на тик позади" — движение гладкое при любом FPS;
+//  - GL только в главном потоке: сим кладёт заливки в g_gpuCommands (данные — копией
+//    в команде), рендер исполняет их в начале кадра, после взятия снапшота.
+// "-simsync" — без потока: те же тики в главном цикле (A/B и отладка).
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <timeapi.h>
+#include <glm/glm.hpp>
+
+#include "frame_arena.h"
+
+#pragma comment(lib, "winmm.lib")   // timeBeginPeriod: Sleep(1) ~1 мс, а не 15.6
+
+const int SIM_HZ = 60;
+const double SIM_DT = 1.0 / SIM_HZ;
+const double SIM_MAX_LAG = 0.25;    // отстали больше (отладчик, свёрнутое окно) — не догоняем
+
+// всё, что рендеру нужно от симуляции за один тик
+struct SimSnapshot
+{
+    uint64_t tick = 0;
+    double time = 0.0;               // tick * SIM_DT
+
+    // камера игрока
+    glm::vec3 camPos{ 0.0f };
+    float camYaw = -90.0f, camPitch = 0.0f;
+    bool underwater = false;
+
+    // инструменты
+    int tool = 0;
+    bool rakeSwinging = false;   float rakeSwingTime = 0.0f;
+    bool shovelSwinging = false; float shovelSwingTime = 0.0f;
+    bool cuttingTree = false;    float cutTime = 0.0f;
+    float chainsawTime = 0.0f;       // время анимации пилы (крутится, пока она в руках)
+    glm::vec3 toolOffset{ 0.0f };
+
+    // срубленное дерево
+    bool cutAnimActive = false;
+    glm::vec3 cutAnimPos{ 0.0f }, cutAnimRot{ 0.0f };
+    float cutAnimScale = 1.0f;
+    float cutAnimTime = 0.0f;
+
+    // правки мира (сами данные ушли командами в g_gpuCommands)
+    uint32_t treeRemovals = 0;       // всего срублено
+    uint32_t terrainEdits = 0;       // всего раскопок
+    glm::vec4 lastEdit{ 0.0f };      // центр + радиус последней
+};
+
+// тройной буфер: latest — индекс последнего опубликованного слота (+ флаг "свежий")
+struct SnapshotTripleBuffer
+{
+    static const int FRESH = 4;
+
+    SimSnapshot slots[3];
+    std::atomic<int> latest{ 0 };
+    int write = 1;                   // трогает только сим
+    int read = 2;                    // трогает только рендер
+
+    SimSnapshot& WriteSlot() { return slots[write]; }
+
+    void Publish()
+    {
+        write = latest.exchange(write | FRESH) & 3;
+    }
+
+    // true — пришёл новый снапшот (Read() уже на нём)
+    bool Acquire()
+    {
+        if (!(latest.load() & FRESH)) return false;
+        read = latest.exchange(read) & 3;
+        return true;
+    }
+
+    const SimSnapshot& Read() const { return slots[read]; }
+};
+
+// GL-работа из сим-потока; исполняется рендером по порядку.
+// Данные команды могут лежать в арене сима (frame_arena.h): её сбрасывают только при Drained()
+// (в том числе хвосты заливок, которые держит g_upload, stream_upload.h)
+struct GpuCommandQueue
+{
+    std::mutex m;
+    std::vector<std::function<void()>> pending;
+    std::vector<std::function<void()>> running;   // только главный поток
+    uint64_t pushed = 0;                          // под m
+    std::atomic<uint64_t> executed{ 0 };          // команда отработала и уничтожена
+
+    void Push(std::function<void()> fn)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        pending.push_back(std::move(fn));
+        ++pushed;
+    }
+
+    void Execute()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            running.swap(pending);
+        }
+        for (auto& fn : running) fn();
+        size_t n = running.size();
+        running.clear();
+        executed.fetch_add(n);
+    }
+
+    // всё, что прислали, исполнено и залито до конца — на их данные больше никто не смотрит
+    bool Drained()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return executed.load() == pushed && g_upload.Idle();
+    }
+};
+
+GpuCommandQueue g_gpuCommands;
+
+// мышь читается в главном потоке (окно), сим забирает накопленное в начале тика
+struct SimInput
+{
+    std::atomic<int> mouseDx{ 0 };
+    std::atomic<int> mouseDy{ 0 };
+};
+
+SimInput g_simInput;
+
+typedef void (*SimTickFn)(float dt);
+typedef void (*SimCaptureFn)(SimSnapshot& out);
+
+struct SimSystem
+{
+    bool threaded = true;
+    bool lockstep = false;           // ровно тик на кадр, без часов (-replay, input.h)
+    std::thread thread;
+    std::atomic<bool> quit{ false };
+
+    SimTickFn tickFn = nullptr;
+    SimCaptureFn captureFn = nullptr;
+    uint64_t tick = 0;               // номер последнего тика (сим-поток)
+
+    // часы симуляции: с потоком — QPC от start (сдвигается, если бросили отставание),
+    // без потока — накопленный dt кадров
+    LARGE_INTEGER freq{};
+    std::atomic<long long> start{ 0 };
+    double syncClock = 0.0;
+
+    SnapshotTripleBuffer snapshots;
+    SimSnapshot prev, curr;          // у рендера: между ними интерполируем
+    bool haveSnapshot = false;
+
+    // статистика (сим-поток)
+    double maxTickMs = 0.0;
+    unsigned dropped = 0;            // сколько раз бросали отставание
+};
+
+SimSystem g_sim;
+
+// состояние кадра (интерполированное): его, а не игровые глобалы, читает отрисовка
+SimSnapshot g_renderState;
+
+// "-simsync"
+void SimInit(const char* cmdLine)
+{
+    if (cmdLine && strstr(cmdLine, "-simsync"))
+        g_sim.threaded = false;
+    QueryPerformanceFrequency(&g_sim.freq);
+}
+
+inline double SimClock()
+{
+    if (!g_sim.threaded) return g_sim.syncClock;
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return double(now.QuadPart - g_sim.start.load()) / double(g_sim.freq.QuadPart);
+}
+
+// один тик + публикация
+void SimRunTick()
+{
+    TRACE_SCOPE("SimTick");
+    ALLOC_SCOPE("SimTick");
+    LARGE_INTEGER t0, t1;
+    QueryPerformanceCounter(&t0);
+
+    g_sim.tickFn((float)SIM_DT);
+    ++g_sim.tick;
+
+    SimSnapshot& s = g_sim.snapshots.WriteSlot();
+    g_sim.captureFn(s);
+    s.tick = g_sim.tick;
+    s.time = double(g_sim.tick) * SIM_DT;
+    g_sim.snapshots.Publish();
+
+    // временное тика — в арене; пока рендер не исполнил команды с её данными, не трогаем
+    if (g_sim.threaded)
+        FrameArenaEndFrame(g_gpuCommands.Drained());
+
+    QueryPerformanceCounter(&t1);
+    double ms = double(t1.QuadPart - t0.QuadPart) * 1000.0 / double(g_sim.freq.QuadPart);
+    g_sim.maxTickMs = std::max(g_sim.maxTickMs, ms);
+
+#ifdef _DEBUG
+    if (g_sim.tick % (SIM_HZ * 10) == 0)
+    {
+        char buf[128];
+        sprintf_s(buf, "Sim: tick %llu, max %.2f ms/tick, dropped %u\n",
+            (unsigned long long)g_sim.tick, g_sim.maxTickMs, g_sim.dropped);
+        OutputDebugStringA(buf);
+        g_sim.maxTickMs = 0.0;
+    }
+#endif
+}
+
+// тик N считается, когда часы дошли до N * SIM_DT
+void SimThreadMain()
+{
+    TRACE_THREAD_NAME("sim");
+    while (!g_sim.quit.load())
+    {
+        double now = SimClock();
+        double due = double(g_sim.tick + 1) * SIM_DT;
+
+        if (now < due)
+        {
+            if (due - now > 0.002) Sleep(1);
+            else std::this_thread::yield();
+            continue;
+        }
+
+        // сильно отстали — сдвигаем начало часов, а не гоним пачку тиков
+        if (now - due > SIM_MAX_LAG)
+        {
+            long long shift = (long long)((now - due) * double(g_sim.freq.QuadPart));
+            g_sim.start.fetch_add(shift);
+            ++g_sim.dropped;
+        }
+
+        SimRunTick();
+    }
+}
+
+// после загрузки мира: стартовый снапшот и (если можно) поток
+void SimStart(SimTickFn tick, SimCaptureFn capture)
+{
+    g_sim.tickFn = tick;
+    g_sim.captureFn = capture;
+
+    SimSnapshot& s = g_sim.snapshots.WriteSlot();
+    capture(s);
+    s.tick = 0;
+    s.time = 0.0;
+    g_sim.snapshots.Publish();
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    g_sim.start = now.QuadPart;
+
+    if (g_sim.threaded)
+    {
+        timeBeginPeriod(1);
+        g_sim.thread = std::thread(SimThreadMain);
+    }
+
+    OutputDebugStringA(g_sim.threaded ? "Sim: own thread, 60 Hz\n" :
+        g_sim.lockstep ? "Sim: main thread, lockstep (-replay), 60 Hz\n" : "Sim: main thread (-simsync), 60 Hz\n");
+}
+
+// без потока: тики прямо из главного цикла
+void SimAdvanceSync(float frameDt)
+{
+    if (g_sim.threaded) return;
+
+    if (g_sim.lockstep)
+    {
+        // рисуем ровно этот тик (SimInterpolate: renderTime = curr.time)
+        SimRunTick();
+        g_sim.syncClock = double(g_sim.tick + 1) * SIM_DT;
+        return;
+    }
+
+    g_sim.syncClock += std::min((double)frameDt, SIM_MAX_LAG);
+    while (double(g_sim.tick + 1) * SIM_DT <= g_sim.syncClock)
+        SimRunTick();
+}
+
+void SimShutdown()
+{
+    if (!g_sim.thread.joinable()) return;
+
+    g_sim.quit = true;
+    g_sim.thread.join();
+    timeEndPeriod(1);
+}
+
+// ===== сторона рендера =====
+
+inline float SimLerpAngleDeg(float a, float b, float t)
+{
+    float d = std::fmod(b - a + 540.0f, 360.0f) - 180.0f;   // кратчайший путь
+    return a + d * t;
+}
+
+// таймер, который мог начаться заново: назад не интерполируем
+inline float SimLerpTimer(float a, float b, float t)
+{
+    return (b < a) ? b : a + (b - a) * t;
+}
+
+// непрерывное — плавно, дискретное (флаги, инструмент, счётчики) — из свежего
+void SimLerpSnapshot(const SimSnapshot& a, const SimSnapshot& b, float t, SimSnapshot& out)
+{
+    out = b;
+    out.time = a.time + (b.time - a.time) * t;
+
+    out.camPos = glm::mix(a.camPos, b.camPos, t);
+    out.camYaw = SimLerpAngleDeg(a.camYaw, b.camYaw, t);
+    out.camPitch = a.camPitch + (b.camPitch - a.camPitch) * t;
+
+    if (a.rakeSwinging == b.rakeSwinging)     out.rakeSwingTime = SimLerpTimer(a.rakeSwingTime, b.rakeSwingTime, t);
+    if (a.shovelSwinging == b.shovelSwinging) out.shovelSwingTime = SimLerpTimer(a.shovelSwingTime, b.shovelSwingTime, t);
+    if (a.cuttingTree == b.cuttingTree)       out.cutTime = SimLerpTimer(a.cutTime, b.cutTime, t);
+    out.chainsawTime = SimLerpTimer(a.chainsawTime, b.chainsawTime, t);
+    out.toolOffset = glm::mix(a.toolOffset, b.toolOffset, t);
+
+    if (a.cutAnimActive && b.cutAnimActive && b.cutAnimTime >= a.cutAnimTime)
+    {
+        out.cutAnimPos = glm::mix(a.cutAnimPos, b.cutAnimPos, t);
+        out.cutAnimTime = SimLerpTimer(a.cutAnimTime, b.cutAnimTime, t);
+    }
+}
+
+// раз в кадр, до Render(): свежий снапшот (если есть) и состояние на "тик назад"
+void SimInterpolate(SimSnapshot& out)
+{
+    if (g_sim.snapshots.Acquire())
+    {
+        g_sim.prev = g_sim.haveSnapshot ? g_sim.curr : g_sim.snapshots.Read();
+        g_sim.curr = g_sim.snapshots.Read();
+        g_sim.haveSnapshot = true;
+    }
+
+    double span = g_sim.curr.time - g_sim.prev.time;
+    double renderTime = SimClock() - SIM_DT;
+    float t = (span > 0.0) ? (float)glm::clamp((renderTime - g_sim.prev.time) / span, 0.0, 1.0) : 1.0f;
+
+    SimLerpSnapshot(g_sim.prev, g_sim.curr, t, out);
+}
@@ -0,0 +1,94 @@
+﻿#pragma once
+// skinning.h
+// Скелетная анимация на GPU: VBO весов костей и палитра матриц
+// (texture buffer, чтобы влезало много инстансов).
+// Импорт весов (BoneVertex, ImportBoneWeights) — mesh_import.h, без GL.
+
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "mesh_import.h"
+
+// VBO с BoneVertex + атрибуты 3/4 в текущем VAO
+inline GLuint CreateBoneVertexBuffer(const std::vector<BoneVertex>& bones)
+{
+    GLuint vbo = 0;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, bones.size() * sizeof(BoneVertex), bones.data(), GL_STATIC_DRAW);
+    CountGpuUpload(bones.size() * sizeof(BoneVertex));
+    MemGpuBuffer(vbo, bones.size() * sizeof(BoneVertex));
+
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 4, GL_INT, sizeof(BoneVertex), (void*)offsetof(BoneVertex, ids));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(BoneVertex), (void*)offsetof(BoneVertex, weights));
+    return vbo;
+}
+
+// =======================================================
+// Палитра на GPU
+// =======================================================
+// Раскладка блока одного инстанса (uBoneStride матриц):
+//   [0]         - world инстанса (для одиночного draw = identity)
+//   [1..N]      - матрицы костей
+//   [N+1..2N+1] - то же для нормалей: обратные-транспонированные (AnimRig::NormalOffset)
+// Шейдер берёт блок по gl_InstanceID, так что 100 персонажей = 1 draw call на меш.
+
+struct BonePaletteBuffer
+{
+    GLuint buffer = 0;
+    GLuint texture = 0;
+    GLsizeiptr capacity = 0;   // байт
+    int stride = 0;            // матриц на инстанс
+
+    void Upload(const glm::mat4* mats, int count, int matricesPerInstance)
+    {
+        stride = matricesPerInstance;
+        GLsizeiptr bytes = (GLsizeiptr)count * sizeof(glm::mat4);
+        if (bytes <= 0) return;
+
+        if (!buffer) glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        if (bytes > capacity)
+        {
+            glBufferData(GL_TEXTURE_BUFFER, bytes, mats, GL_STREAM_DRAW);
+            capacity = bytes;
+            MemGpuBuffer(buffer, (size_t)capacity);
+        }
+        else
+        {
+            // orphan, чтобы не ждать кадр, который ещё читает палитру
+            glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, mats);
+        }
+        CountGpuUpload((size_t)bytes);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        if (!texture)
+        {
+            glGenTextures(1, &texture);
+            g_gl.BindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+            g_gl.BindTexture(GL_TEXTURE_BUFFER, 0);
+        }
+    }
+
+    // uBonePalette / uBoneStride в шейдере
+    void Bind(GLuint shader, int unit) const
+    {
+        g_gl.ActiveTexture(GL_TEXTURE0 + unit);
+        g_gl.BindTexture(GL_TEXTURE_BUFFER, texture);
+        g_gl.ActiveTexture(GL_TEXTURE0);
+
+        GLint locPal = UniformLoc(shader, "uBonePalette");
+        if (locPal >= 0) glUniform1i(locPal, unit);
+        GLint locStride = UniformLoc(shader, "uBoneStride");
+        if (locStride >= 0) glUniform1i(locStride, stride);
+    }
+};
+
+// юнит текстуры под палитру (0 — базовый цвет)
+const int BONE_PALETTE_UNIT = 5;
@@ -1,18 +1,35 @@
 // sky.frag
+// Небо из sky-view LUT (sky.h) + диск солнца. Рисуется после непрозрачного мира.
 #version 330 core
 
+in vec2 vNDC;
 out vec4 FragColor;
 
-uniform vec3 uTopColor;      // цвет наверху
-uniform vec3 uBottomColor;   // цвет у горизонта / внизу
-uniform float uScreenHeight; // высота экрана в пикселях
+uniform vec3  uSunDir;
+uniform vec3  uSunColor;
+uniform float uSunCosSize;   // cos углового радиуса диска
+
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
+#include "sky.glsl"
 
 void main()
 {
-    // 0 внизу экрана, 1 наверху
-    float t = gl_FragCoord.y / uScreenHeight;
-    t = clamp(t, 0.0, 1.0);
+    // направление взгляда: NDC -> вид (без inverse) -> мир (transpose вращения)
+    vec3 viewDir = vec3(vNDC.x / uProjection[0][0], vNDC.y / uProjection[1][1], -1.0);
+    vec3 dir = normalize(transpose(mat3(uView)) * viewDir);
+
+    vec3 col = SkyColor(dir);
+
+    // диск солнца, с пропусканием атмосферы (краснеет у горизонта)
+    float c = dot(dir, uSunDir);
+    float core = smoothstep(uSunCosSize, mix(uSunCosSize, 1.0, 0.5), c);
+    col = mix(col, uSunColor * SunTransmittance(uSunDir), core);
+
+    // под водой чуть тоним в цвет тумана
+    if (uUnderwater == 1)
+    {
+        col = mix(col, uFogColor, 0.6);
+    }
 
-    vec3 col = mix(uBottomColor, uTopColor, t);
     FragColor = vec4(col, 1.0);
 }
@@ -0,0 +1,26 @@
+// sky.glsl
+// LUT'ы неба (sky.h) для любых шейдеров: небо, отражение в воде, цвет тумана.
+// Текстуры висят на постоянных юнитах SKY_TRANSMITTANCE_UNIT / SKY_VIEW_UNIT,
+// сэмплеры выставляются один раз при создании программы.
+#include "atmosphere.glsl"
+
+uniform sampler2D uTransmittanceLUT;
+uniform sampler2D uSkyViewLUT;
+
+// радиация неба в направлении dir (экспозиция уже внутри LUT)
+vec3 SkyRadiance(vec3 dir)
+{
+    return texture(uSkyViewLUT, SkyViewUV(dir)).rgb;
+}
+
+// то же, в цвет экрана
+vec3 SkyColor(vec3 dir)
+{
+    return 1.0 - exp(-SkyRadiance(dir));
+}
+
+// сколько света солнца доходит до камеры
+vec3 SunTransmittance(vec3 sunDir)
+{
+    return SampleTransmittance(uTransmittanceLUT, SKY_VIEW_HEIGHT, sunDir.y);
+}
@@ -1,153 +1,167 @@
 #pragma once
-
-GLuint g_skySphereVAO = 0;
-GLuint g_skySphereVBO = 0;
-GLuint g_skySphereEBO = 0;
-GLuint g_skySphereShader = 0;
-GLsizei g_skySphereIndexCount = 0;
-
-//GLuint skyVAO, skyVBO;
-//GLuint g_skyShader;
-
-
-void InitSkySphere()
+// sky.h
+//    LUT' (  atmosphere.glsl):
+//  - transmittance LUT 256x64 (, )     ,   ;
+//  - sky-view LUT 192x108 (,   )     ,
+//         (UpdateSkyLUTs).
+//      fullscreen-      
+// (BUCKET_BACKGROUND): early-z  ,     .
+// LUT'    :  ()        sky.glsl.
+
+const int SKY_TRANSMITTANCE_UNIT = 6;
+const int SKY_VIEW_UNIT = 7;
+
+const int SKY_TRANSMITTANCE_W = 256, SKY_TRANSMITTANCE_H = 64;
+const int SKY_VIEW_W = 192, SKY_VIEW_H = 108;
+
+GLuint g_skyShader = 0;
+GLuint g_skyTransmittanceShader = 0;
+GLuint g_skyViewShader = 0;
+
+GLuint g_skyVAO = 0;                 // :    sky.vert
+GLuint g_skyLutFBO = 0;
+GLuint g_skyTransmittanceTex = 0;
+GLuint g_skyViewTex = 0;
+
+glm::vec3 g_sunDir = glm::normalize(glm::vec3(0.3f, 0.6f, 0.2f)); //   
+glm::vec3 g_skyBuiltSunDir(0.0f);    //     sky-view
+float g_sunIlluminance = 40.0f;      //   =  
+int g_skyLutRebuilds = 0;
+
+//   LoadShaders (  )
+void LoadSkyShaders()
 {
-    if (g_skySphereVAO)
-        return;
-
-    //  
-    g_skySphereShader = CreateShaderProgram("sky_sphere.vert", "sky_sphere.frag");
-    if (!g_skySphereShader)
-    {
-        OutputDebugStringA("Failed to create sky sphere shader\n");
-        return;
-    }
-
-    const int stacks = 32;   //  
-    const int slices = 64;   //  
-    const float radius = 500.0f; //  -   ,      
+    if (!g_skyShader)             g_skyShader = CreateShaderProgram("sky.vert", "sky.frag");
+    if (!g_skyTransmittanceShader) g_skyTransmittanceShader = CreateShaderProgram("sky.vert", "sky_transmittance.frag");
+    if (!g_skyViewShader)         g_skyViewShader = CreateShaderProgram("sky.vert", "sky_view.frag");
+}
 
-    std::vector<glm::vec3> vertices;
-    std::vector<unsigned int> indices;
+//  LUT'     ,   sky.glsl
+inline void SetSkyLUTSamplers(GLuint prog)
+{
+    glUniform1i(UniformLoc(prog, "uTransmittanceLUT"), SKY_TRANSMITTANCE_UNIT);
+    glUniform1i(UniformLoc(prog, "uSkyViewLUT"), SKY_VIEW_UNIT);
+}
 
-    for (int i = 0; i <= stacks; ++i)
-    {
-        float v = (float)i / (float)stacks;         // 0..1
-        float phi = v * glm::pi<float>();           // 0..PI
+inline void BindSkyLUTs()
+{
+    g_gl.BindTexture(GL_TEXTURE0 + SKY_TRANSMITTANCE_UNIT, GL_TEXTURE_2D, g_skyTransmittanceTex);
+    g_gl.BindTexture(GL_TEXTURE0 + SKY_VIEW_UNIT, GL_TEXTURE_2D, g_skyViewTex);
+}
 
-        for (int j = 0; j <= slices; ++j)
-        {
-            float u = (float)j / (float)slices;     // 0..1
-            float theta = u * glm::two_pi<float>(); // 0..2PI
+GLuint CreateSkyLUT(int w, int h, GLenum wrapS)
+{
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    g_gl.BindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, w, h, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+    MemGpuTexture(tex, GL_RGBA16F, w, h, false, MEM_SKY);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return tex;
+}
 
-            float x = sin(phi) * cos(theta);
-            float y = cos(phi);
-            float z = sin(phi) * sin(theta);
+//  LUT: fullscreen-  
+void RenderSkyLUT(GLuint prog, GLuint tex, int w, int h)
+{
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+    glViewport(0, 0, w, h);
 
-            vertices.push_back(glm::vec3(x, y, z) * radius);
-        }
-    }
+    g_gl.UseProgram(prog);
+    glUniform2f(UniformLoc(prog, "uLutSize"), float(w), float(h));
+    glUniform3fv(UniformLoc(prog, "uSunDir"), 1, &g_sunDir[0]);
+    glUniform1f(UniformLoc(prog, "uSunIlluminance"), g_sunIlluminance);
 
-    //  ()
-    for (int i = 0; i < stacks; ++i)
-    {
-        for (int j = 0; j < slices; ++j)
-        {
-            int row1 = i * (slices + 1);
-            int row2 = (i + 1) * (slices + 1);
-
-            int a = row1 + j;
-            int b = row1 + j + 1;
-            int c = row2 + j;
-            int d = row2 + j + 1;
-
-            indices.push_back(a);
-            indices.push_back(c);
-            indices.push_back(b);
-
-            indices.push_back(b);
-            indices.push_back(c);
-            indices.push_back(d);
-        }
-    }
+    g_gl.BindVertexArray(g_skyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    ProfDraw(GL_TRIANGLES, 3);
+}
 
-    g_skySphereIndexCount = static_cast<GLsizei>(indices.size());
+//   ,  : LUT'    
+void UpdateSkyLUTs(bool force = false)
+{
+    if (!g_skyLutFBO || !g_skyTransmittanceShader || !g_skyViewShader) return;
+    if (!force && g_sunDir == g_skyBuiltSunDir) return;
 
-    glGenVertexArrays(1, &g_skySphereVAO);
-    glGenBuffers(1, &g_skySphereVBO);
-    glGenBuffers(1, &g_skySphereEBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, g_skyLutFBO);
+    g_gl.Disable(GL_BLEND);
+    g_gl.Disable(GL_DEPTH_TEST);
+    g_gl.Disable(GL_CULL_FACE);
+    g_gl.ColorMask(true);
 
-    glBindVertexArray(g_skySphereVAO);
+    // transmittance         
+    if (force)
+        RenderSkyLUT(g_skyTransmittanceShader, g_skyTransmittanceTex, SKY_TRANSMITTANCE_W, SKY_TRANSMITTANCE_H);
 
-    glBindBuffer(GL_ARRAY_BUFFER, g_skySphereVBO);
-    glBufferData(GL_ARRAY_BUFFER,
-        vertices.size() * sizeof(glm::vec3),
-        vertices.data(),
-        GL_STATIC_DRAW);
+    // sky-view  transmittance
+    g_gl.BindTexture(GL_TEXTURE0 + SKY_TRANSMITTANCE_UNIT, GL_TEXTURE_2D, g_skyTransmittanceTex);
+    RenderSkyLUT(g_skyViewShader, g_skyViewTex, SKY_VIEW_W, SKY_VIEW_H);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_skySphereEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-        indices.size() * sizeof(unsigned int),
-        indices.data(),
-        GL_STATIC_DRAW);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    //     
+    g_gl.UseProgram(g_skyShader);
+    glUniform3fv(UniformLoc(g_skyShader, "uSunDir"), 1, &g_sunDir[0]);
 
-    glBindVertexArray(0);
+    g_skyBuiltSunDir = g_sunDir;
+    ++g_skyLutRebuilds;
 }
 
-
-void DrawSkySphere(const glm::mat4& proj, const glm::mat4& view)
+void InitSky()
 {
-    if (!g_skySphereShader || !g_skySphereVAO)
+    if (g_skyVAO)
         return;
 
-    //    :
-    glDepthMask(GL_FALSE);       //   
-    glDisable(GL_CULL_FACE);     //  "" ,     
-    //   DEPTH_TEST      :
-    glDisable(GL_DEPTH_TEST);
-
-    glUseProgram(g_skySphereShader);
-
-    glUniformMatrix4fv(glGetUniformLocation(g_skySphereShader, "uProjection"),
-        1, GL_FALSE, &proj[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(g_skySphereShader, "uView"),
-        1, GL_FALSE, &view[0][0]);
-
-    //    
-    glm::vec3 topColor = glm::vec3(0.02f, 0.20f, 0.55f); // -
-    glm::vec3 horizonColor = glm::vec3(0.35f, 0.55f, 0.95f); // -
-    glm::vec3 bottomColor = glm::vec3(0.7f, 0.8f, 1.0f);    //  -
+    LoadSkyShaders();
+    if (!g_skyShader || !g_skyTransmittanceShader || !g_skyViewShader)
+    {
+        OutputDebugStringA("Failed to create sky shaders\n");
+        return;
+    }
 
-    glUniform3fv(glGetUniformLocation(g_skySphereShader, "uTopColor"), 1, &topColor[0]);
-    glUniform3fv(glGetUniformLocation(g_skySphereShader, "uHorizonColor"), 1, &horizonColor[0]);
-    glUniform3fv(glGetUniformLocation(g_skySphereShader, "uBottomColor"), 1, &bottomColor[0]);
+    glGenVertexArrays(1, &g_skyVAO);
 
-    //   , , 
-    glm::vec3 sunDir = glm::normalize(glm::vec3(0.3f, 0.6f, 0.2f)); //   
-    glUniform3fv(glGetUniformLocation(g_skySphereShader, "uSunDir"), 1, &sunDir[0]);
+    g_skyTransmittanceTex = CreateSkyLUT(SKY_TRANSMITTANCE_W, SKY_TRANSMITTANCE_H, GL_CLAMP_TO_EDGE);
+    g_skyViewTex = CreateSkyLUT(SKY_VIEW_W, SKY_VIEW_H, GL_REPEAT);   //   
+    glGenFramebuffers(1, &g_skyLutFBO);
 
+    //  uniform'    ,    
+    g_gl.UseProgram(g_skyShader);
+    SetSkyLUTSamplers(g_skyShader);
     glm::vec3 sunColor(1.0f, 0.97f, 0.9f);
-    glUniform3fv(glGetUniformLocation(g_skySphereShader, "uSunColor"), 1, &sunColor[0]);
+    glUniform3fv(UniformLoc(g_skyShader, "uSunColor"), 1, &sunColor[0]);
+    glUniform1f(UniformLoc(g_skyShader, "uSunCosSize"), cosf(glm::radians(0.75f))); //  ~1.5
 
-    glUniform1f(glGetUniformLocation(g_skySphereShader, "uSunSize"), glm::radians(1.5f)); // ~1.5
-    glUniform1f(glGetUniformLocation(g_skySphereShader, "uSunGlow"), glm::radians(8.0f)); //  
+    g_gl.UseProgram(g_skyViewShader);
+    SetSkyLUTSamplers(g_skyViewShader);
+    g_gl.UseProgram(0);
 
-    glUniform1i(glGetUniformLocation(g_skySphereShader, "uUnderwater"), underwater ? 1 : 0);
-    glUniform3fv(glGetUniformLocation(g_skySphereShader, "uFogColor"), 1, &fogColorUnder[0]); //  
+    UpdateSkyLUTs(true);
+    BindSkyLUTs();
+}
 
+void DrawSky()
+{
+    if (!g_skyShader || !g_skyVAO)
+        return;
 
+    //  :    (1.0),    
+    g_gl.Disable(GL_BLEND);
+    g_gl.Disable(GL_CULL_FACE);
+    g_gl.Enable(GL_DEPTH_TEST);
+    g_gl.DepthFunc(GL_LEQUAL);
+    g_gl.DepthMask(GL_FALSE);
+    g_gl.DepthRange(0.0, 1.0);
 
+    //        Frame
+    g_gl.UseProgram(g_skyShader);
+    BindSkyLUTs();
 
-    glBindVertexArray(g_skySphereVAO);
-    glDrawElements(GL_TRIANGLES, g_skySphereIndexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    g_gl.BindVertexArray(g_skyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    ProfDraw(GL_TRIANGLES, 3);
 
-    //  
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-    glEnable(GL_CULL_FACE);
+    //   :      g_gl
 }
-
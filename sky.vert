@@ -1,14 +1,19 @@
 // sky.vert
+// Fullscreen-треугольник на дальней плоскости (z = w -> глубина 1.0):
+// с GL_LEQUAL небо рисуется только там, где после мира осталась пустая глубина.
+// Им же рисуются LUT'ы неба (там depth test выключен).
 #version 330 core
 
-const vec2 quad[4] = vec2[4](
+const vec2 tri[3] = vec2[3](
     vec2(-1.0, -1.0),
-    vec2( 1.0, -1.0),
-    vec2(-1.0,  1.0),
-    vec2( 1.0,  1.0)
+    vec2( 3.0, -1.0),
+    vec2(-1.0,  3.0)
 );
 
+out vec2 vNDC;
+
 void main()
 {
-    gl_Position = vec4(quad[gl_VertexID], 0.0, 1.0);
+    vNDC = tri[gl_VertexID];
+    gl_Position = vec4(vNDC, 1.0, 1.0);
 }
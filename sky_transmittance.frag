@@ -0,0 +1,42 @@
+// sky_transmittance.frag
+// Transmittance LUT (sky.h): пропускание атмосферы от точки до её верхней границы.
+// Зависит только от модели атмосферы — строится один раз.
+#version 330 core
+
+out vec4 FragColor;
+
+uniform vec2 uLutSize;
+
+#include "atmosphere.glsl"
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / uLutSize;
+    float h = uv.y * (ATMOS_R - PLANET_R);
+    float mu = uv.x * 2.0 - 1.0;
+
+    vec3 ro = vec3(0.0, PLANET_R + h, 0.0);
+    vec3 rd = vec3(sqrt(max(0.0, 1.0 - mu * mu)), mu, 0.0);
+
+    // луч в землю — солнце за горизонтом
+    if (RaySphere(ro, rd, PLANET_R) > 0.0)
+    {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    const int STEPS = 40;
+    float dt = RaySphere(ro, rd, ATMOS_R) / float(STEPS);
+
+    vec3 depth = vec3(0.0);
+    for (int i = 0; i < STEPS; ++i)
+    {
+        vec3 p = ro + rd * ((float(i) + 0.5) * dt);
+        vec3 rayleigh, extinction;
+        float mie;
+        AtmosphereMedium(length(p) - PLANET_R, rayleigh, mie, extinction);
+        depth += extinction * dt;
+    }
+
+    FragColor = vec4(exp(-depth), 1.0);
+}
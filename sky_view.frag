@@ -0,0 +1,53 @@
+// sky_view.frag
+// Sky-view LUT (sky.h): однократное рассеяние по всем направлениям с высоты камеры.
+// Зависит от солнца — перестраивается только когда оно сдвинулось.
+#version 330 core
+
+out vec4 FragColor;
+
+uniform vec2  uLutSize;
+uniform vec3  uSunDir;
+uniform float uSunIlluminance;   // заодно экспозиция
+
+uniform sampler2D uTransmittanceLUT;
+
+#include "atmosphere.glsl"
+
+void main()
+{
+    vec3 dir = SkyViewDir(gl_FragCoord.xy / uLutSize);
+    vec3 ro = vec3(0.0, PLANET_R + SKY_VIEW_HEIGHT, 0.0);
+
+    float tGround = RaySphere(ro, dir, PLANET_R);
+    float tMax = (tGround > 0.0) ? tGround : RaySphere(ro, dir, ATMOS_R);
+
+    float c = dot(dir, uSunDir);
+    float phaseR = RayleighPhase(c);
+    float phaseM = MiePhase(c);
+
+    const int STEPS = 32;
+    float dt = tMax / float(STEPS);
+
+    vec3 L = vec3(0.0);
+    vec3 T = vec3(1.0);
+    for (int i = 0; i < STEPS; ++i)
+    {
+        vec3 p = ro + dir * ((float(i) + 0.5) * dt);
+        float r = length(p);
+        float h = r - PLANET_R;
+
+        vec3 rayleigh, extinction;
+        float mie;
+        AtmosphereMedium(h, rayleigh, mie, extinction);
+
+        vec3 sunT = SampleTransmittance(uTransmittanceLUT, h, dot(p / r, uSunDir));
+        vec3 S = (rayleigh * phaseR + mie * phaseM) * sunT;
+
+        // интеграл по шагу при постоянной среде (не теряет энергию на длинных шагах)
+        vec3 stepT = exp(-extinction * dt);
+        L += T * (S - S * stepT) / max(extinction, vec3(1e-7));
+        T *= stepT;
+    }
+
+    FragColor = vec4(L * uSunIlluminance, 1.0);
+}
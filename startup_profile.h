@@ -0,0 +1,155 @@
+﻿#pragma once
+// startup_profile.h
+// Фазы загрузки до первого кадра: на каждую — время, байты с диска, байты в GPU, пиковый RSS.
+//
+//   StartupPhase("heightmap");   // закрывает прошлую фазу и открывает новую
+//   ...
+//   StartupReport(summary);      // после первого SwapBuffers: таблица в лог и в startup_phases.txt
+//
+// Диск — GetProcessIoCounters (все чтения процесса, без хуков в загрузчиках).
+// GPU — CountGpuUpload() рядом с каждой заливкой данных (glBufferData/glTexImage2D с данными,
+// glBufferSubData, кольцо stream_upload.h); счётчик общий, фаза берёт разницу.
+// Пиковый RSS — PeakWorkingSetSize на конец фазы (пик процесса на тот момент).
+// Фазы попадают и в трассу (trace.h), если она пишется с -trace.
+
+#include <windows.h>
+#include <psapi.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+
+#pragma comment(lib, "psapi.lib")
+
+#include "trace.h"
+
+// все заливки в GPU с начала процесса (GL — только главный поток, атомик не нужен)
+unsigned long long g_gpuUploadBytes = 0;
+
+inline void CountGpuUpload(size_t bytes) { g_gpuUploadBytes += bytes; }
+
+struct StartupPhaseStats
+{
+    const char* name;
+    double ms;
+    unsigned long long diskBytes;
+    unsigned long long gpuBytes;
+    unsigned long long peakRss;     // на конец фазы
+};
+
+struct StartupProfiler
+{
+    std::vector<StartupPhaseStats> phases;
+    const char* current = nullptr;
+    LARGE_INTEGER freq = {};
+    LARGE_INTEGER phaseStart = {};
+    unsigned long long phaseDisk = 0;
+    unsigned long long phaseGpu = 0;
+    bool reported = false;
+};
+
+StartupProfiler g_startup;
+
+inline unsigned long long StartupDiskRead()
+{
+    IO_COUNTERS io = {};
+    GetProcessIoCounters(GetCurrentProcess(), &io);
+    return io.ReadTransferCount;
+}
+
+inline unsigned long long StartupPeakRss()
+{
+    PROCESS_MEMORY_COUNTERS pmc = {};
+    pmc.cb = sizeof(pmc);
+    GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+    return pmc.PeakWorkingSetSize;
+}
+
+inline double StartupMs(const LARGE_INTEGER& a, const LARGE_INTEGER& b)
+{
+    return double(b.QuadPart - a.QuadPart) * 1000.0 / double(g_startup.freq.QuadPart);
+}
+
+void StartupEndPhase()
+{
+    if (!g_startup.current) return;
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+
+    StartupPhaseStats s;
+    s.name = g_startup.current;
+    s.ms = StartupMs(g_startup.phaseStart, now);
+    s.diskBytes = StartupDiskRead() - g_startup.phaseDisk;
+    s.gpuBytes = g_gpuUploadBytes - g_startup.phaseGpu;
+    s.peakRss = StartupPeakRss();
+    g_startup.phases.push_back(s);
+
+#if TRACE_ENABLED
+    if (TraceRecording())
+    {
+        int64_t durUs = (int64_t)(s.ms * 1000.0);
+        TracePush(s.name, TRACE_EV_COMPLETE, TraceNowUs() - durUs, durUs, 0.0);
+    }
+#endif
+
+    g_startup.current = nullptr;
+}
+
+// name — литерал (хранится указатель)
+void StartupPhase(const char* name)
+{
+    if (g_startup.reported) return;
+
+    if (!g_startup.freq.QuadPart)
+        QueryPerformanceFrequency(&g_startup.freq);
+
+    StartupEndPhase();
+    g_startup.current = name;
+    QueryPerformanceCounter(&g_startup.phaseStart);
+    g_startup.phaseDisk = StartupDiskRead();
+    g_startup.phaseGpu = g_gpuUploadBytes;
+}
+
+// после первого SwapBuffers. Таблица — в лог и в startup_phases.txt (перезапись),
+// строка итога — в startup.txt (дописывается, история запусков)
+void StartupReport(const std::string& summary)
+{
+    if (g_startup.reported) return;
+    StartupEndPhase();
+    g_startup.reported = true;
+
+    const double MB = 1024.0 * 1024.0;
+    std::string table;
+    char buf[256];
+
+    sprintf_s(buf, "%-16s %10s %10s %10s %10s\n", "phase", "ms", "disk MB", "gpu MB", "peak MB");
+    table += buf;
+
+    double totalMs = 0.0;
+    unsigned long long totalDisk = 0, totalGpu = 0;
+    for (const StartupPhaseStats& p : g_startup.phases)
+    {
+        sprintf_s(buf, "%-16s %10.1f %10.2f %10.2f %10.1f\n",
+            p.name, p.ms, p.diskBytes / MB, p.gpuBytes / MB, p.peakRss / MB);
+        table += buf;
+        totalMs += p.ms;
+        totalDisk += p.diskBytes;
+        totalGpu += p.gpuBytes;
+    }
+    sprintf_s(buf, "%-16s %10.1f %10.2f %10.2f %10.1f\n",
+        "total", totalMs, totalDisk / MB, totalGpu / MB, StartupPeakRss() / MB);
+    table += buf;
+
+    OutputDebugStringA(summary.c_str());
+    OutputDebugStringA(table.c_str());
+
+    {
+        std::ofstream f("startup_phases.txt");
+        f << summary << table;
+    }
+    {
+        std::ofstream f("startup.txt", std::ios::app);
+        f << summary;
+    }
+}
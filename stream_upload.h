@@ -0,0 +1,284 @@
+﻿#pragma once
+// stream_upload.h
+// Заливка динамических данных (трава, матрицы деревьев, морф цепи, вершины террейна)
+// без glBufferData/glBufferSubData по буферам, которые GPU ещё читает.
+//
+// Стейджинг — кольцо из 3 регионов, по региону на кадр в полёте:
+//   GL 4.4+ / ARB_buffer_storage: glBufferStorage, persistent + coherent mapping, просто memcpy;
+//   иначе: один регион, который в начале кадра орфанится (glBufferData(nullptr)).
+// Из кольца в целевой буфер — glCopyBufferSubData: копия на GPU, в порядке команд,
+// VAO/атрибуты целевых буферов не меняются. Регион берём снова только после его fence.
+// Бюджет на кадр = размер региона: большое (террейн ~38 МБ) уходит кусками за несколько кадров.
+//
+// То, что влезает в регион, не рвём: в dst либо старое, либо новое целиком. Большое рвётся —
+// пока идут куски, в dst смесь, поэтому счётчики/смену буфера — в done (после последнего куска),
+// а рисовать из другого буфера (террейн: задний VBO, Terrain::UploadVertices).
+// Хвост не копируем: данные держит owner вызывающего (арена сима, frame_arena.h),
+// арена не сбрасывается, пока очередь не пуста (Idle, GpuCommandQueue::Drained).
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (APIENTRY* PFN_BufferStorage)(GLenum, GLsizeiptr, const void*, GLbitfield);
+
+struct StreamUploadStats
+{
+    unsigned long long bytes = 0;   // ушло в GPU за кадр
+    unsigned long long deferred = 0; // на начало кадра ещё ждало в очереди
+    unsigned stalls = 0;            // ждали fence (GPU отстаёт больше чем на 3 кадра)
+};
+
+struct StreamUploader
+{
+    static const int REGIONS = 3;
+
+    // заливка, не ушедшая целиком в свой кадр
+    struct Pending
+    {
+        GLuint dst = 0;
+        GLintptr dstOffset = 0;
+        const char* src = nullptr;      // у owner или в copy
+        size_t size = 0;
+        size_t done = 0;
+        std::shared_ptr<void> owner;
+        std::vector<char> copy;         // owner не дали — копия хвоста
+        std::function<void()> onDone;
+    };
+
+    GLsizeiptr regionSize = 8 * 1024 * 1024;   // он же бюджет байт на кадр
+    GLuint staging = 0;
+    char* mapped = nullptr;
+    bool persistent = false;
+
+    GLsync fences[REGIONS] = {};
+    int region = 0;
+    GLsizeiptr used = 0;                       // занято в текущем регионе
+
+    std::deque<Pending> pending;
+    std::atomic<size_t> queued{ 0 };           // pending.size() для других потоков (Idle)
+
+    StreamUploadStats frame;
+    StreamUploadStats last;
+
+    void Init()
+    {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        bool hasStorage = (major > 4 || (major == 4 && minor >= 4)) || HasGLExtension("GL_ARB_buffer_storage");
+
+        PFN_BufferStorage bufferStorage = hasStorage ?
+            (PFN_BufferStorage)wglGetProcAddress("glBufferStorage") : nullptr;
+
+        glGenBuffers(1, &staging);
+        glBindBuffer(GL_COPY_READ_BUFFER, staging);
+
+        if (bufferStorage)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorage(GL_COPY_READ_BUFFER, regionSize * REGIONS, nullptr, flags);
+            MemGpuBuffer(staging, (size_t)regionSize * REGIONS, MEM_STREAMING);
+            mapped = (char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, regionSize * REGIONS, flags);
+            persistent = (mapped != nullptr);
+
+            if (!persistent)
+            {
+                // storage неизменяемый — под фоллбэк нужен новый буфер
+                MemGpuDeleteBuffers(1, &staging);
+                glDeleteBuffers(1, &staging);
+                glGenBuffers(1, &staging);
+                glBindBuffer(GL_COPY_READ_BUFFER, staging);
+            }
+        }
+
+        if (!persistent)
+        {
+            glBufferData(GL_COPY_READ_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+            MemGpuBuffer(staging, (size_t)regionSize, MEM_STREAMING);
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        OutputDebugStringA(persistent ? "StreamUpload: persistent mapped ring\n"
+                                      : "StreamUpload: orphaning fallback\n");
+    }
+
+    // dst должен уже иметь нужный размер (glBufferData при создании).
+    // owner держит data, пока заливка в очереди (нет — хвост копируется);
+    // done — когда в dst ушёл последний кусок (сразу, если всё влезло в кадр)
+    void Upload(GLuint dst, GLintptr dstOffset, const void* data, GLsizeiptr size,
+        std::shared_ptr<void> owner = nullptr, std::function<void()> done = nullptr)
+    {
+        if (!dst || !data || size <= 0) return;
+        CountGpuUpload((size_t)size);
+
+        if (!staging)
+        {
+            // до Init (загрузка) — по-старому
+            glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, dstOffset, size, data);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            if (done) done();
+            return;
+        }
+
+        // старые хвосты в тот же буфер, целиком перекрытые новыми данными, больше не нужны
+        // (их done не зовём — вместо него будет done новой заливки)
+        bool queuedForDst = false;
+        for (auto it = pending.begin(); it != pending.end(); )
+        {
+            GLintptr pBegin = it->dstOffset + (GLintptr)it->done;
+            GLintptr pEnd = it->dstOffset + (GLintptr)it->size;
+            if (it->dst == dst && pBegin >= dstOffset && pEnd <= dstOffset + size)
+            {
+                it = pending.erase(it);
+                continue;
+            }
+            if (it->dst == dst) queuedForDst = true;
+            ++it;
+        }
+
+        const char* src = (const char*)data;
+        GLsizeiptr n = 0;
+
+        // если в этот буфер ещё что-то ждёт — только в очередь, иначе старый хвост затрёт новое
+        if (!queuedForDst)
+            n = Copy(dst, dstOffset, src, size, size <= regionSize);
+
+        if (n == size)
+        {
+            queued.store(pending.size());
+            if (done) done();
+            return;
+        }
+
+        Pending p;
+        p.dst = dst;
+        p.onDone = std::move(done);
+        if (owner)
+        {
+            p.dstOffset = dstOffset;
+            p.src = src;
+            p.size = (size_t)size;
+            p.done = (size_t)n;
+            p.owner = std::move(owner);
+        }
+        else
+        {
+            p.dstOffset = dstOffset + n;
+            p.copy.assign(src + n, src + size);
+            p.src = p.copy.data();
+            p.size = p.copy.size();
+        }
+        pending.push_back(std::move(p));
+        queued.store(pending.size());
+    }
+
+    // в очереди пусто: ни одна заливка больше не читает данные вызывающих (любой поток)
+    bool Idle() const { return queued.load() == 0; }
+
+    // после SwapBuffers: fence на регион кадра, следующий регион, хвосты
+    void EndFrame()
+    {
+        if (!staging) return;
+
+        if (persistent)
+        {
+            if (fences[region]) glDeleteSync(fences[region]);
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+            region = (region + 1) % REGIONS;
+            if (fences[region])
+            {
+                GLenum r = glClientWaitSync(fences[region], 0, 0);
+                if (r == GL_TIMEOUT_EXPIRED)
+                {
+                    ++frame.stalls;
+                    while (glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+                }
+                glDeleteSync(fences[region]);
+                fences[region] = 0;
+            }
+        }
+        else
+        {
+            // орфан: драйвер даст свежую память, старую GPU дочитает сам
+            glBindBuffer(GL_COPY_READ_BUFFER, staging);
+            glBufferData(GL_COPY_READ_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+
+        last = frame;
+        frame = StreamUploadStats();
+        used = 0;
+
+        // хвосты больших заливок — в новый регион, сколько влезет в бюджет
+        while (!pending.empty())
+        {
+            Pending& p = pending.front();
+            GLsizeiptr left = (GLsizeiptr)(p.size - p.done);
+            GLsizeiptr n = Copy(p.dst, p.dstOffset + (GLintptr)p.done, p.src + p.done, left,
+                (GLsizeiptr)p.size <= regionSize);
+            p.done += (size_t)n;
+            if (n < left) break;
+            std::function<void()> done = std::move(p.onDone);
+            pending.pop_front();
+            if (done) done();
+        }
+        for (const Pending& p : pending)
+            frame.deferred += p.size - p.done;
+        queued.store(pending.size());
+
+#ifdef _DEBUG
+        static int frames = 0;
+        if (++frames >= 300)
+        {
+            frames = 0;
+            char buf[160];
+            sprintf_s(buf, "StreamUpload: %llu bytes/frame, %llu deferred, %u stalls\n",
+                last.bytes, last.deferred, last.stalls);
+            OutputDebugStringA(buf);
+        }
+#endif
+    }
+
+private:
+    // сколько влезло в остаток бюджета региона; whole — всё или ничего
+    GLsizeiptr Copy(GLuint dst, GLintptr dstOffset, const char* src, GLsizeiptr size, bool whole)
+    {
+        GLsizeiptr n = std::min(size, regionSize - used);
+        if (n <= 0 || (whole && n < size)) return 0;
+
+        GLintptr srcOffset = (persistent ? region * regionSize : 0) + used;
+
+        glBindBuffer(GL_COPY_READ_BUFFER, staging);
+        if (persistent)
+            memcpy(mapped + srcOffset, src, (size_t)n);
+        else
+            glBufferSubData(GL_COPY_READ_BUFFER, srcOffset, n, src);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, srcOffset, dstOffset, n);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        used += (n + 15) & ~(GLsizeiptr)15;   // следующие копии с выравниванием 16
+        if (used > regionSize) used = regionSize;
+        frame.bytes += (unsigned long long)n;
+        return n;
+    }
+};
+
+StreamUploader g_upload;
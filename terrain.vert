@@ -10,10 +10,13 @@ out vec2 vTex;
 out float vMat;
 out vec3 vWorldPos;
 
-uniform mat4 uProjection;
-uniform mat4 uView;
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
+
 uniform mat4 uModel;
 
+// глубина в pre-pass и в цветовом проходе должна совпасть бит в бит (GL_EQUAL)
+invariant gl_Position;
+
 void main()
 {
     vec4 worldPos = uModel * vec4(aPos, 1.0);
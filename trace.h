@@ -0,0 +1,262 @@
+﻿#pragma once
+// trace.h
+// Трассировка в формате Chrome trace (chrome://tracing, ui.perfetto.dev): таймлайны
+// потоков (главный, сим, воркеры jobs.h), загрузка ассетов, провалы кадра.
+//
+//   TRACE_SCOPE("Terrain::Dig");            // зона до конца блока
+//   TRACE_COUNTER("grassAlive", count);     // график значения
+//   TRACE_INSTANT("hitch");                 // отметка на таймлайне
+//   TRACE_THREAD_NAME("sim");               // имя потока в просмотрщике
+//
+// Имена — только строковые литералы: в событие кладётся указатель.
+// У каждого потока своё кольцо на TRACE_RING_EVENTS событий, пишет только хозяин
+// (без локов, старое затирается). Мьютекс — один раз на поток, при регистрации.
+// Зона пишется одним событием "X" в конце (начало + длительность): кольцо может
+// затереть что угодно, непарных begin/end не бывает.
+//
+//   -trace [файл]  — писать с самого старта (загрузка), в файл на выходе; по умолчанию trace.json
+//   F4             — начать / остановить запись, при остановке — в файл
+// -DTRACE_ENABLED=0 — макросы пустые, в коде не остаётся ничего.
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#if TRACE_ENABLED
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+#include "core_platform.h"
+
+const uint32_t TRACE_RING_EVENTS = 1u << 16;   // на поток, степень двойки
+
+enum TraceEventType : uint8_t {
+    TRACE_EV_COMPLETE = 0,   // зона: ts + dur
+    TRACE_EV_COUNTER = 1,
+    TRACE_EV_INSTANT = 2
+};
+
+struct TraceEvent
+{
+    const char* name;
+    int64_t tsUs;
+    int64_t durUs;
+    double value;            // счётчик
+    uint8_t type;
+};
+
+struct TraceThreadBuffer
+{
+    std::atomic<TraceEvent*> events{ nullptr };   // кольцо — при первом событии (имя потока его не требует)
+    std::atomic<uint64_t> written{ 0 };   // всего записано (индекс в кольце = written % размер)
+    int tid = 0;
+    std::string name;                     // под g_trace.registryMutex
+};
+
+struct TraceState
+{
+    std::atomic<bool> recording{ false };
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string path = "trace.json";
+
+    // буферы не освобождаются: поток может закончиться раньше, чем мы сбросим файл
+    std::mutex registryMutex;
+    std::vector<TraceThreadBuffer*> threads;
+};
+
+TraceState g_trace;
+
+inline int64_t TraceNowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - g_trace.start).count();
+}
+
+inline bool TraceRecording() { return g_trace.recording.load(std::memory_order_relaxed); }
+
+inline TraceThreadBuffer* TraceThisThread()
+{
+    thread_local TraceThreadBuffer* t = nullptr;
+    if (!t)
+    {
+        t = new TraceThreadBuffer();
+        std::lock_guard<std::mutex> lock(g_trace.registryMutex);
+        t->tid = (int)g_trace.threads.size() + 1;
+        g_trace.threads.push_back(t);
+    }
+    return t;
+}
+
+inline void TracePush(const char* name, uint8_t type, int64_t tsUs, int64_t durUs, double value)
+{
+    TraceThreadBuffer* t = TraceThisThread();
+    TraceEvent* ring = t->events.load(std::memory_order_relaxed);
+    if (!ring)
+    {
+        ring = new TraceEvent[TRACE_RING_EVENTS];
+        t->events.store(ring, std::memory_order_release);
+    }
+    uint64_t w = t->written.load(std::memory_order_relaxed);
+    TraceEvent& e = ring[w & (TRACE_RING_EVENTS - 1)];
+    e.name = name;
+    e.tsUs = tsUs;
+    e.durUs = durUs;
+    e.value = value;
+    e.type = type;
+    t->written.store(w + 1, std::memory_order_release);
+}
+
+inline void TraceSetThreadName(const char* name)
+{
+    TraceThreadBuffer* t = TraceThisThread();
+    std::lock_guard<std::mutex> lock(g_trace.registryMutex);
+    t->name = name;
+}
+
+struct TraceScope
+{
+    const char* name;   // nullptr — запись была выключена на входе
+    int64_t t0;
+
+    explicit TraceScope(const char* n)
+        : name(TraceRecording() ? n : nullptr), t0(name ? TraceNowUs() : 0) {}
+    ~TraceScope()
+    {
+        if (name) TracePush(name, TRACE_EV_COMPLETE, t0, TraceNowUs() - t0, 0.0);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+// все кольца -> JSON. Можно во время записи: то, что поток успел затереть,
+// пока мы копировали, выбрасываем
+inline bool TraceFlush(const char* path)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f)
+    {
+        CoreLog(std::string("Trace: can't write ") + path + "\n");
+        return false;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"terrain\"}}");
+
+    size_t total = 0;
+    std::vector<TraceEvent> copy;
+    std::lock_guard<std::mutex> lock(g_trace.registryMutex);
+    for (TraceThreadBuffer* t : g_trace.threads)
+    {
+        std::string name = t->name.empty() ? ("thread " + std::to_string(t->tid)) : t->name;
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            t->tid, name.c_str());
+
+        const TraceEvent* ring = t->events.load(std::memory_order_acquire);
+        if (!ring) continue;
+
+        uint64_t w1 = t->written.load(std::memory_order_acquire);
+        uint64_t first = (w1 > TRACE_RING_EVENTS) ? w1 - TRACE_RING_EVENTS : 0;
+        copy.clear();
+        for (uint64_t i = first; i < w1; ++i)
+            copy.push_back(ring[i & (TRACE_RING_EVENTS - 1)]);
+
+        uint64_t w2 = t->written.load(std::memory_order_acquire);
+        // +1: слот w2 мог уже начать переписываться (written ещё не сдвинут)
+        uint64_t valid = (w2 + 1 > TRACE_RING_EVENTS) ? w2 + 1 - TRACE_RING_EVENTS : 0;
+
+        for (uint64_t i = first; i < w1; ++i)
+        {
+            if (i < valid) continue;   // затёрто во время копирования
+            const TraceEvent& e = copy[(size_t)(i - first)];
+            switch (e.type)
+            {
+            case TRACE_EV_COMPLETE:
+                fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}",
+                    e.name, t->tid, (long long)e.tsUs, (long long)e.durUs);
+                break;
+            case TRACE_EV_COUNTER:
+                fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"args\":{\"value\":%.6g}}",
+                    e.name, t->tid, (long long)e.tsUs, e.value);
+                break;
+            case TRACE_EV_INSTANT:
+                fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%lld}",
+                    e.name, t->tid, (long long)e.tsUs);
+                break;
+            }
+            ++total;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "Trace: %zu events -> %s\n", total, path);
+    CoreLog(buf);
+    return true;
+}
+
+// "-trace [файл]" — как можно раньше в WinMain, чтобы попала загрузка
+inline void TraceInit(const char* cmdLine)
+{
+    TraceSetThreadName("main");
+    if (!cmdLine) return;
+
+    std::istringstream ss(cmdLine);
+    std::string tok;
+    while (ss >> tok)
+    {
+        if (tok == "-trace")
+        {
+            g_trace.recording = true;
+            std::streampos pos = ss.tellg();
+            std::string arg;
+            if (ss >> arg && arg[0] != '-') g_trace.path = arg;
+            else { ss.clear(); ss.seekg(pos); }
+        }
+    }
+}
+
+// F4: старт / стоп со сбросом в файл
+inline void TraceToggle()
+{
+    bool was = g_trace.recording.exchange(!g_trace.recording.load());
+    if (was)
+        TraceFlush(g_trace.path.c_str());
+}
+
+// на выходе: если пишем — в файл
+inline void TraceShutdown()
+{
+    if (g_trace.recording.exchange(false))
+        TraceFlush(g_trace.path.c_str());
+}
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_COUNTER(name, v) \
+    do { if (TraceRecording()) TracePush(name, TRACE_EV_COUNTER, TraceNowUs(), 0, (double)(v)); } while (0)
+#define TRACE_INSTANT(name) \
+    do { if (TraceRecording()) TracePush(name, TRACE_EV_INSTANT, TraceNowUs(), 0, 0.0); } while (0)
+#define TRACE_THREAD_NAME(name) TraceSetThreadName(name)
+
+#else // !TRACE_ENABLED
+
+inline void TraceInit(const char*) {}
+inline void TraceToggle() {}
+inline void TraceShutdown() {}
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_COUNTER(name, v) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+
+#endif
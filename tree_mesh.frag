@@ -3,47 +3,38 @@
 in vec3 vNormal;
 in vec3 vWorldPos;
 in vec2 vTex;
-uniform vec3 uCamPos;
-uniform float uMaxDist; // радиус видимости деревьев
+
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
+#include "lighting.glsl"
+
+#ifdef INSTANCED
+uniform float uMaxDist; // радиус видимости леса
+#endif
 
 out vec4 FragColor;
 
 uniform sampler2D uTex;
-uniform vec3 uLightDir;
-
-// туман
-uniform int  uUnderwater;
-uniform vec3 uFogColor;
-uniform float uFogDensity;
 
 void main()
 {
     vec2 uv = vec2(vTex.x, 1.0 - vTex.y);
     vec4 tex = texture(uTex, uv);
 
+    // альфа-тест и дальность уже отработали в depth pre-pass (глубина GL_EQUAL):
+    // тогда вариант без ALPHA_TEST
+#ifdef ALPHA_TEST
     if (tex.a < 0.2)
         discard;
-		
-    float dist = length(uCamPos - vWorldPos);
-    if (dist > uMaxDist)
-        discard;
 
-    vec3 N = normalize(vNormal);
-    vec3 L = normalize(uLightDir);
-
-    float diff = max(dot(N, L), 0.0);
-    float ambient = 0.25;
-    float lighting = ambient + diff * 0.75;
-
-    vec3 color = tex.rgb * lighting;
+#ifdef INSTANCED
+    if (length(uCamPos - vWorldPos) > uMaxDist)
+        discard;
+#endif
+#endif
 
-    // === ТУМАН ===
-    float fogFactor = 1.0 - exp(-uFogDensity * dist);
-    fogFactor = clamp(fogFactor, 0.0, 1.0);
-    color = mix(color, uFogColor, fogFactor);
+    vec3 color = tex.rgb * Lambert(vNormal, 0.25);
 
-    if (uUnderwater == 1)
-        color *= 0.85;
+    // туман — в пост-проходе (fog.glsl)
 
     FragColor = vec4(color, tex.a);
 }
@@ -4,23 +4,35 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTex;
 
+#ifdef INSTANCED
 // матрица экземпляра (из VBO)
 layout (location = 3) in mat4 aInstanceModel;
+#else
+uniform mat4 uModel;
+#endif
 
-uniform mat4 uProjection;
-uniform mat4 uView;
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
 
 out vec3 vNormal;
 out vec3 vWorldPos;
 out vec2 vTex;
 
+// глубина в pre-pass и в цветовом проходе должна совпасть бит в бит (GL_EQUAL)
+invariant gl_Position;
+
 void main()
 {
-    vec4 worldPos = aInstanceModel * vec4(aPos, 1.0);
+#ifdef INSTANCED
+    mat4 M = aInstanceModel;
+#else
+    mat4 M = uModel;
+#endif
+
+    vec4 worldPos = M * vec4(aPos, 1.0);
     vWorldPos = worldPos.xyz;
 
     // нормали с учётом масштаба/поворота
-    vNormal = mat3(transpose(inverse(aInstanceModel))) * aNormal;
+    vNormal = mat3(transpose(inverse(M))) * aNormal;
 
     vTex = aTex; // переворот делаем во frag
     gl_Position = uProjection * uView * worldPos;
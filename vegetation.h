@@ -0,0 +1,450 @@
+﻿#pragma once
+// vegetation.h
+// Трава и деревья без GL: расстановка по Heightfield и запросы к инстансам
+// (вырубка травы, коллизия со стволами, ближайшее дерево, матрицы для инстансинга).
+// Буферы и счётчики для отрисовки — в main.cpp/grass.h, сюда только данные.
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "jobs.h"
+#include "heightfield.h"
+
+struct GrassInstance {
+    glm::vec3 pos;   // центр пучка на земле
+    float scale;     // размер
+    bool  alive;     // можно убрать граблями
+};
+
+struct TreeInstance {
+    glm::vec3 pos;
+    float     scale;
+    float     radius;
+};
+
+// ===== СЛУЧАЙНЫЕ ЧИСЛА: Philox4x32-10 =====
+// Счётчиковый генератор (Random123): блок = f(счётчик, ключ), без состояния между
+// вызовами. Ключ — seed мира, счётчик — (тайл X, тайл Z, поток, номер кандидата):
+// кандидат i в тайле получает одни и те же 4 числа, кто бы и в каком порядке его ни считал.
+
+struct Philox4x32
+{
+    uint32_t v[4];
+
+    static inline uint32_t MulHiLo(uint32_t a, uint32_t b, uint32_t& hi)
+    {
+        uint64_t p = (uint64_t)a * b;
+        hi = (uint32_t)(p >> 32);
+        return (uint32_t)p;
+    }
+
+    static Philox4x32 Block(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t key)
+    {
+        uint32_t c[4] = { c0, c1, c2, c3 };
+        uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+        for (int r = 0; r < 10; ++r)
+        {
+            uint32_t hi0, hi1;
+            uint32_t lo0 = MulHiLo(0xD2511F53u, c[0], hi0);
+            uint32_t lo1 = MulHiLo(0xCD9E8D57u, c[2], hi1);
+            uint32_t n0 = hi1 ^ c[1] ^ k0;
+            uint32_t n2 = hi0 ^ c[3] ^ k1;
+            c[0] = n0; c[1] = lo1; c[2] = n2; c[3] = lo0;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        Philox4x32 out;
+        for (int i = 0; i < 4; ++i) out.v[i] = c[i];
+        return out;
+    }
+
+    // [0, 1), 24 бита
+    static inline float ToFloat01(uint32_t x) { return float(x >> 8) * (1.0f / 16777216.0f); }
+    float F(int i) const { return ToFloat01(v[i]); }
+};
+
+// последовательный поток поверх Philox (тестовые данные, бенчи)
+struct PhiloxStream
+{
+    uint64_t key;
+    uint32_t stream;
+    uint32_t index = 0;
+    Philox4x32 buf{};
+    int have = 0;
+
+    explicit PhiloxStream(uint64_t seed, uint32_t streamId = 0) : key(seed), stream(streamId) {}
+
+    uint32_t Next()
+    {
+        if (have == 0)
+        {
+            buf = Philox4x32::Block(index++, 0, stream, 0x53545245u, key);
+            have = 4;
+        }
+        return buf.v[4 - have--];
+    }
+
+    float Next01() { return Philox4x32::ToFloat01(Next()); }
+};
+
+// ===== РАССТАНОВКА: тайловый Poisson-disk =====
+// Карта режется на тайлы, в тайле — дротики (кандидаты по Philox) с отбором по правилам
+// террейна (высота, наклон, плотность) и по минимальной дистанции r до уже принятых.
+// Тайлы идут в 4 фазы шахматкой 2x2: в одной фазе тайлы не соседи и считаются по потокам,
+// точки соседей (из прошлых фаз) в полосе r вокруг тайла только читают. Тайл >= 2r.
+// Выход — тайлы по порядку: при одном seed результат побитно один и тот же
+// при любом -jobs (можно кэшировать). T — с полем pos (GrassInstance, TreeInstance).
+// Число точек — около target: r подбирается по доле пригодной площади.
+
+struct ScatterRules
+{
+    float minHeight = 3.0f, maxHeight = 35.0f;
+    float fadeHeight = 0.0f;    // у краёв полосы высот плотность спадает до 0
+    float minNormalY = 0.0f;    // 0 — наклон не проверяем
+};
+
+// плотность 0..1 по правилам (без дистанции)
+inline float ScatterDensity(const Heightfield& hf, const ScatterRules& rules, float x, float z, float& y)
+{
+    y = hf.getHeight(x, z);
+    if (y < rules.minHeight || y > rules.maxHeight)
+        return 0.0f;
+    if (rules.minNormalY > 0.0f && hf.normalAt(x, z).y < rules.minNormalY)
+        return 0.0f;
+    if (rules.fadeHeight <= 0.0f)
+        return 1.0f;
+    float edge = std::min(y - rules.minHeight, rules.maxHeight - y);
+    return std::min(1.0f, edge / rules.fadeHeight);
+}
+
+// make(pos, rnd01, item) — заполнить инстанс; rnd01 — свободное случайное число кандидата
+template <typename T, typename Make>
+void ScatterPoisson(const Heightfield& hf, const ScatterRules& rules, int target, uint64_t seed,
+    uint32_t stream, std::vector<T>& out, const Make& make)
+{
+    out.clear();
+    if (target <= 0 || hf.size <= 0.0f)
+        return;
+
+    const float size = hf.size;
+    const float half = size * 0.5f;
+
+    // доля пригодной площади — по решётке 128x128
+    const int PROBE = 128;
+    double usable = 0.0;
+    for (int j = 0; j < PROBE; ++j)
+        for (int i = 0; i < PROBE; ++i)
+        {
+            float y;
+            usable += ScatterDensity(hf, rules, -half + (i + 0.5f) * size / PROBE, -half + (j + 0.5f) * size / PROBE, y);
+        }
+    usable /= double(PROBE * PROBE);
+    if (usable <= 0.0)
+        return;
+
+    // дротики до насыщения укладывают ~0.55 r^-2 точек на м^2 (ниже — под столько кандидатов)
+    const float PACKING = 0.55f;
+    const float r = (float)std::sqrt(PACKING * usable * size * size / target);
+    const float r2 = r * r;
+
+    int tiles = std::max(1, (int)(size / std::max(2.0f * r, size / 64.0f)));
+    const float tile = size / tiles;
+
+    // своя сетка у тайла: тайл + полоса r, клетка r/sqrt(2) — в клетке не больше одной точки,
+    // все соседи ближе r — в +-2 клетках. Пустая клетка — точка далеко (дистанцию не проходит)
+    const float cell = r * 0.70710678f;
+    const int grid = (int)std::ceil((tile + 2.0f * r) / cell) + 1;
+
+    std::vector<std::vector<T>> parts((size_t)tiles * tiles);
+
+    auto runTile = [&](int tx, int tz)
+    {
+        std::vector<T>& part = parts[(size_t)tz * tiles + tx];
+        float x0 = -half + tx * tile, z0 = -half + tz * tile;
+        float gx0 = x0 - r, gz0 = z0 - r;
+
+        std::vector<glm::vec2> cells((size_t)grid * grid, glm::vec2(1e30f));
+        auto cellOf = [&](float x, float z, int& cx, int& cz)
+        {
+            cx = (int)std::floor((x - gx0) / cell);
+            cz = (int)std::floor((z - gz0) / cell);
+            return cx >= 0 && cx < grid && cz >= 0 && cz < grid;
+        };
+
+        // соседи: уже посчитаны в прошлых фазах (или пусты — их фаза позже)
+        for (int nz = tz - 1; nz <= tz + 1; ++nz)
+            for (int nx = tx - 1; nx <= tx + 1; ++nx)
+            {
+                if ((nx == tx && nz == tz) || nx < 0 || nz < 0 || nx >= tiles || nz >= tiles) continue;
+                for (const T& item : parts[(size_t)nz * tiles + nx])
+                {
+                    int cx, cz;
+                    if (cellOf(item.pos.x, item.pos.z, cx, cz))
+                        cells[(size_t)cz * grid + cx] = glm::vec2(item.pos.x, item.pos.z);
+                }
+            }
+
+        // дротики только в пригодные ячейки тайла (сторона >= r; пригодна, если пригоден
+        // центр или угол), по 3 на r^2 — скалы и воду не обстреливаем.
+        // Порядок — раунд за раундом по всем ячейкам, чтобы тайл заполнялся равномерно
+        const int strata = std::max(1, std::min(8, (int)(tile / r)));
+        const float ss = tile / strata;
+        auto usableAt = [&](float x, float z) { float y; return ScatterDensity(hf, rules, x, z, y) > 0.0f; };
+
+        bool corner[9 * 9];
+        for (int j = 0; j <= strata; ++j)
+            for (int i = 0; i <= strata; ++i)
+                corner[j * 9 + i] = usableAt(x0 + i * ss, z0 + j * ss);
+
+        int usable[8 * 8];
+        int usableCount = 0;
+        for (int j = 0; j < strata; ++j)
+            for (int i = 0; i < strata; ++i)
+            {
+                const bool* c = &corner[j * 9 + i];
+                if (c[0] || c[1] || c[9] || c[10] || usableAt(x0 + (i + 0.5f) * ss, z0 + (j + 0.5f) * ss))
+                    usable[usableCount++] = j * strata + i;
+            }
+
+        const int rounds = (int)std::ceil(ss * ss / r2 * 3.0f);
+        for (int k = 0; k < rounds; ++k)
+        {
+            for (int u = 0; u < usableCount; ++u)
+            {
+                int st = usable[u];
+                Philox4x32 rnd = Philox4x32::Block((uint32_t)tx, (uint32_t)tz, stream, (uint32_t)(k * strata * strata + st), seed);
+
+                float x = x0 + ((st % strata) + rnd.F(0)) * ss;
+                float z = z0 + ((st / strata) + rnd.F(1)) * ss;
+                if (x >= half || z >= half)
+                    continue;
+
+                float y;
+                float density = ScatterDensity(hf, rules, x, z, y);
+                if (density <= 0.0f || rnd.F(2) >= density)
+                    continue;
+
+                int cx, cz;
+                cellOf(x, z, cx, cz);
+                bool free = true;
+                for (int dz = -2; dz <= 2 && free; ++dz)
+                {
+                    int gz = cz + dz;
+                    if (gz < 0 || gz >= grid) continue;
+                    for (int dx = -2; dx <= 2; ++dx)
+                    {
+                        int gx = cx + dx;
+                        if (gx < 0 || gx >= grid) continue;
+                        glm::vec2 q = cells[(size_t)gz * grid + gx];
+                        glm::vec2 d(q.x - x, q.y - z);
+                        if (glm::dot(d, d) < r2) { free = false; break; }
+                    }
+                }
+                if (!free)
+                    continue;
+
+                cells[(size_t)cz * grid + cx] = glm::vec2(x, z);
+                T item;
+                make(glm::vec3(x, y, z), rnd.F(3), item);
+                part.push_back(item);
+            }
+        }
+    };
+
+    for (int phase = 0; phase < 4; ++phase)
+    {
+        int px = phase & 1, pz = phase >> 1;
+        int nx = (tiles - px + 1) / 2, nz = (tiles - pz + 1) / 2;
+        if (nx <= 0 || nz <= 0) continue;
+        ParallelFor(nx * nz, 1, [&](int t0, int t1)
+            {
+                for (int t = t0; t < t1; ++t)
+                    runTile(px + 2 * (t % nx), pz + 2 * (t / nx));
+            });
+    }
+
+    size_t total = 0;
+    for (const auto& p : parts) total += p.size();
+    out.reserve(total);
+    for (const auto& p : parts)
+        out.insert(out.end(), p.begin(), p.end());
+}
+
+// трава: полоса высот с мягкими краями, не на обрывах
+inline void ScatterGrass(const Heightfield& hf, int target, uint64_t seed, std::vector<GrassInstance>& out)
+{
+    ScatterRules rules;
+    rules.minHeight = 3.0f;
+    rules.maxHeight = 35.0f;
+    rules.fadeHeight = 2.0f;
+    rules.minNormalY = 0.6f;
+
+    ScatterPoisson(hf, rules, target, seed, 1, out,
+        [](const glm::vec3& p, float rnd, GrassInstance& gi)
+        {
+            gi.pos = p;
+            gi.scale = 0.6f + rnd * 0.8f;
+            gi.alive = true;
+        });
+}
+
+// деревья: высота + почти ровная земля
+inline void ScatterTrees(const Heightfield& hf, int target, uint64_t seed, std::vector<TreeInstance>& out)
+{
+    ScatterRules rules;
+    rules.minHeight = 3.0f;    // не на вершинах и не в ямах
+    rules.maxHeight = 45.0f;
+    rules.minNormalY = 0.9f;   // только почти ровные места
+
+    ScatterPoisson(hf, rules, target, seed, 2, out,
+        [](const glm::vec3& p, float rnd, TreeInstance& inst)
+        {
+            inst.pos = p;
+            inst.scale = 2.5f + rnd * 3.5f;      // разные высоты
+            inst.radius = 0.4f * inst.scale;     // для коллизии
+        });
+}
+
+// ===== ТРАВА =====
+
+// сколько пучков погасили
+inline int KillGrassInRadius(std::vector<GrassInstance>& grass, const glm::vec3& center, float radius)
+{
+    float r2 = radius * radius;
+    int killed = 0;
+
+    for (auto& gi : grass)
+    {
+        if (!gi.alive) continue;
+        glm::vec2 d(gi.pos.x - center.x, gi.pos.z - center.z);
+        if (glm::dot(d, d) <= r2)
+        {
+            gi.alive = false;
+            ++killed;
+        }
+    }
+    return killed;
+}
+
+// живые пучки в раскладке инстанс-буфера: pos.xyz + scale.
+// Out — std::vector<glm::vec4> или ArenaVector (frame_arena.h) для временных
+template <typename Out>
+inline void CollectGrassInstanceData(const std::vector<GrassInstance>& grass, Out& out)
+{
+    out.clear();
+    out.reserve(grass.size());
+    for (const auto& gi : grass)
+        if (gi.alive)
+            out.emplace_back(gi.pos, gi.scale);
+}
+
+// ===== ДЕРЕВЬЯ =====
+// removed[i] — дерево срублено (может быть короче trees)
+
+inline bool TreeRemoved(const std::vector<bool>& removed, size_t i)
+{
+    return i < removed.size() && removed[i];
+}
+
+// выталкиваем точку из стволов по XZ
+inline void ResolveTreeCollisionsXZ(const std::vector<TreeInstance>& trees, const std::vector<bool>& removed,
+    float playerRadius, glm::vec3& pos)
+{
+    for (size_t i = 0; i < trees.size(); ++i)
+    {
+        if (TreeRemoved(removed, i))
+            continue;
+
+        const TreeInstance& inst = trees[i];
+        glm::vec2 p(pos.x, pos.z);
+        glm::vec2 c(inst.pos.x, inst.pos.z);
+        glm::vec2 d = p - c;
+        float dist = glm::length(d);
+        float minDist = playerRadius + inst.radius;
+
+        if (dist < minDist && dist > 0.0001f)
+        {
+            glm::vec2 dir = d / dist;
+            float push = minDist - dist;
+            p += dir * push;
+            pos.x = p.x;
+            pos.z = p.y;
+        }
+    }
+}
+
+// яма радиуса holeRadius заденет корни?
+inline bool TreeBlocksDig(const std::vector<TreeInstance>& trees, const std::vector<bool>& removed,
+    const glm::vec3& center, float holeRadius)
+{
+    const float extra = 0.5f; // небольшой запас
+    float r = holeRadius + extra;
+
+    for (size_t i = 0; i < trees.size(); ++i)
+    {
+        if (TreeRemoved(removed, i))
+            continue;
+
+        const TreeInstance& t = trees[i];
+        float dx = t.pos.x - center.x;
+        float dz = t.pos.z - center.z;
+        float dist2 = dx * dx + dz * dz;
+        float blockR = (t.radius > 0.0f ? t.radius : 0.8f); // примерный радиус ствола
+        float limit = r + blockR;
+        if (dist2 < limit * limit)
+            return true; // слишком близко к дереву — не копаем
+    }
+    return false;
+}
+
+// ближайшее несрубленное дерево по XZ; -1 — нет в maxDist
+inline int FindNearestTreeXZ(const std::vector<TreeInstance>& trees, const std::vector<bool>& removed,
+    const glm::vec3& p, float maxDist)
+{
+    int best = -1;
+    float best2 = maxDist * maxDist;
+
+    for (size_t i = 0; i < trees.size(); ++i)
+    {
+        if (TreeRemoved(removed, i))
+            continue;
+
+        const TreeInstance& t = trees[i];
+        float dx = t.pos.x - p.x;
+        float dz = t.pos.z - p.z;
+        float d2 = dx * dx + dz * dz;
+
+        if (d2 < best2)
+        {
+            best2 = d2;
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+// матрицы инстансов несрубленных деревьев (Out — как у CollectGrassInstanceData)
+template <typename Out>
+inline void BuildTreeMatrices(const std::vector<TreeInstance>& trees, const std::vector<bool>& removed,
+    Out& out)
+{
+    out.clear();
+    out.reserve(trees.size());
+
+    for (size_t i = 0; i < trees.size(); ++i)
+    {
+        if (TreeRemoved(removed, i))
+            continue;
+
+        const TreeInstance& t = trees[i];
+        glm::mat4 M(1.0f);
+        M = glm::translate(M, t.pos);
+        M = glm::scale(M, glm::vec3(t.scale));
+        out.push_back(M);
+    }
+}
@@ -2,7 +2,8 @@
 #version 330 core
 
 in vec3 vWorldPos;
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 FragWaterDist;   // только в половинке (water_halfres.h), в сцене буфера 1 нет
 
 // маска: где вообще есть вода
 uniform sampler2D uWaterMask;
@@ -13,14 +14,13 @@ uniform vec3 uWaterColor;   // цвет воды в глубине
 uniform float uAlpha;       // базовая прозрачность
 
 // туман / подводный режим
-uniform vec3  uCamPos;
-uniform int   uUnderwater;
-uniform vec3  uFogColor;
-uniform float uFogDensity;
 
-// новое:
-uniform vec3 uSkyColor;     // цвет неба (для отражений)
-uniform vec3 uLightDir;     // направление света (как в террейне)
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
+#include "lighting.glsl"
+#include "sky.glsl"
+
+uniform vec3  uWaterFogColor;   // туман воды свой (подводный), не кадровый
+uniform float uWaterFogDensity;
 
 void main()
 {
@@ -44,8 +44,7 @@ void main()
     vec3 V = normalize(uCamPos - vWorldPos);
 
     // diffuse
-    float diff = max(dot(N, L), 0.0);
-    vec3 base = uWaterColor * (0.4 + 0.6 * diff);
+    vec3 base = uWaterColor * Lambert(N, 0.4);
 
     // простое зеркальное (specular)
     vec3 R = reflect(-L, N);
@@ -56,29 +55,25 @@ void main()
 
     float cosTheta = max(dot(N, V), 0.0);
     float fresnel = pow(1.0 - cosTheta, 3.0);     // 0..1
-    vec3 reflection = uSkyColor;
+    vec3 reflection = SkyColor(reflect(-V, N));   // sky-view LUT
 
     vec3 waterCol = mix(base, reflection, fresnel) + specColor;
 
     // --- 4. Туман / подводное "молоко" ---
+    // над водой туман кладёт пост-проход (fog.glsl, по глубине или FragWaterDist) — здесь не мешаем, иначе дважды
 
     float dist = length(uCamPos - vWorldPos);
-    float fogFactor = 1.0 - exp(-uFogDensity * dist);
-    fogFactor = clamp(fogFactor, 0.0, 1.0);
 
-    vec3 col;
+    vec3 col = waterCol;
     float alpha = uAlpha;
 
-    if (uUnderwater == 1)
-    {
-        // под водой сильнее туман
-        col   = mix(waterCol, uFogColor, fogFactor * 0.7);
-        alpha = 0.0;
-    }
-    else
-    {
-        col = mix(waterCol, uFogColor, fogFactor * 0.4);
-    }
+#ifdef UNDERWATER
+    // под водой сильнее туман
+    float fogFactor = clamp(1.0 - exp(-uWaterFogDensity * dist), 0.0, 1.0);
+    col   = mix(waterCol, uWaterFogColor, fogFactor * 0.7);
+    alpha = 0.0;
+#endif
 
     FragColor = vec4(col, alpha);
+    FragWaterDist = vec4(dist, 0.0, 0.0, 1.0);   // alpha 1: блендинг просто перезаписывает
 }
@@ -1,10 +1,11 @@
 #pragma once
 GLuint g_waterVAO = 0;
 GLuint g_waterVBO = 0;
+GLuint g_waterEBO = 0;
 GLuint g_waterShader = 0;
 
-float g_waterHeight = 2.0f;        //    Y    
-float g_waterSize = 1024.0f;      //    (   )
+float g_waterHeight = WORLD_WATER_LEVEL;   //    Y (world_config.h)
+float g_waterSize = 1024.0f;      //    ;     (UpdateWaterMesh)
 
 //        
 std::vector<uint8_t> waterMask; // 0 = , 1 = 
@@ -20,9 +21,213 @@ fogColorUnder = glm::vec3(0.04f, 0.18f, 0.22f);
 fogDensityTop = 0.001f;
 fogDensityUnder = 0.8f;
 
+// =====       =====
+//      :  ,    (+1  ,
+//       water.frag),   WATER_TILE x WATER_TILE 
+//    .     ,
+//   .    ~  ,    .
+
+const int WATER_TILE = 64;   //     
+
+struct WaterQuad { int x0, z0, x1, z1; };   //  [x0,x1) x [z0,z1)
+
+struct WaterMesh
+{
+    int cellsX = 0, cellsZ = 0;     //  =   - 1
+    int tilesX = 0, tilesZ = 0;
+    float terrainSize = 0.0f;
+
+    std::vector<uint8_t> lastMask;  //   ,     ( )
+    std::vector<std::vector<WaterQuad>> tiles;
+    std::vector<uint8_t> dirty;
+
+    GLsizei indexCount = 0;
+    int quadCount = 0;
+};
+
+WaterMesh g_waterMesh;
+
+//  ,      .
+//    g_waterMesh: waterMask      - (sim_thread.h)
+inline bool WaterCellWet(int cx, int cz)
+{
+    if (cx < 0 || cz < 0 || cx >= g_waterMesh.cellsX || cz >= g_waterMesh.cellsZ)
+        return false;
+    const std::vector<uint8_t>& m = g_waterMesh.lastMask;
+    int w = g_waterMesh.cellsX + 1;   //  lastMask: waterW  -
+    int i = cz * w + cx;
+    return m[i] || m[i + 1] || m[i + w] || m[i + w + 1];
+}
+
+//      (   )
+inline bool WaterCellCovered(int cx, int cz)
+{
+    for (int dz = -1; dz <= 1; ++dz)
+        for (int dx = -1; dx <= 1; ++dx)
+            if (WaterCellWet(cx + dx, cz + dz)) return true;
+    return false;
+}
+
+//  :   ,    
+void BuildWaterTile(int tx, int tz)
+{
+    WaterMesh& m = g_waterMesh;
+    std::vector<WaterQuad>& quads = m.tiles[tz * m.tilesX + tx];
+    quads.clear();
+
+    int x0 = tx * WATER_TILE, z0 = tz * WATER_TILE;
+    int w = std::min(WATER_TILE, m.cellsX - x0);
+    int h = std::min(WATER_TILE, m.cellsZ - z0);
+
+    std::vector<uint8_t> cover(w * h), used(w * h, 0);
+    for (int z = 0; z < h; ++z)
+        for (int x = 0; x < w; ++x)
+            cover[z * w + x] = WaterCellCovered(x0 + x, z0 + z) ? 1 : 0;
+
+    for (int z = 0; z < h; ++z)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            if (!cover[z * w + x] || used[z * w + x]) continue;
+
+            int qw = 1;
+            while (x + qw < w && cover[z * w + x + qw] && !used[z * w + x + qw]) ++qw;
+
+            int qh = 1;
+            for (; z + qh < h; ++qh)
+            {
+                bool full = true;
+                for (int i = 0; i < qw && full; ++i)
+                    full = cover[(z + qh) * w + x + i] && !used[(z + qh) * w + x + i];
+                if (!full) break;
+            }
+
+            for (int j = 0; j < qh; ++j)
+                for (int i = 0; i < qw; ++i)
+                    used[(z + j) * w + x + i] = 1;
+
+            quads.push_back({ x0 + x, z0 + z, x0 + x + qw, z0 + z + qh });
+        }
+    }
+}
+
+//   ->  VBO/EBO (   ,  )
+void UploadWaterMesh()
+{
+    WaterMesh& m = g_waterMesh;
+
+    float half = m.terrainSize * 0.5f;
+    float cell = m.terrainSize / float(m.cellsX);
+
+    std::vector<float> verts;
+    std::vector<unsigned> idx;
+    m.quadCount = 0;
+    for (const auto& t : m.tiles) m.quadCount += (int)t.size();
+    verts.reserve(m.quadCount * 4 * 5);
+    idx.reserve(m.quadCount * 6);
+
+    for (const auto& t : m.tiles)
+    {
+        for (const WaterQuad& q : t)
+        {
+            float ax = -half + q.x0 * cell, bx = -half + q.x1 * cell;
+            float az = -half + q.z0 * cell, bz = -half + q.z1 * cell;
+            unsigned base = (unsigned)(verts.size() / 5);
+
+            //  + uv (uv   ,    )
+            float v[20] = {
+                ax, g_waterHeight, az,  q.x0 / float(m.cellsX), q.z0 / float(m.cellsZ),
+                bx, g_waterHeight, az,  q.x1 / float(m.cellsX), q.z0 / float(m.cellsZ),
+                bx, g_waterHeight, bz,  q.x1 / float(m.cellsX), q.z1 / float(m.cellsZ),
+                ax, g_waterHeight, bz,  q.x0 / float(m.cellsX), q.z1 / float(m.cellsZ)
+            };
+            verts.insert(verts.end(), v, v + 20);
+
+            unsigned i6[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+            idx.insert(idx.end(), i6, i6 + 6);
+        }
+    }
+
+    m.indexCount = (GLsizei)idx.size();
+
+    glBindBuffer(GL_ARRAY_BUFFER, g_waterVBO);
+    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.empty() ? nullptr : verts.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // EBO   VAO
+    g_gl.BindVertexArray(g_waterVAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_waterEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(unsigned), idx.empty() ? nullptr : idx.data(), GL_STATIC_DRAW);
+    CountGpuUpload(verts.size() * sizeof(float) + idx.size() * sizeof(unsigned));
+    MemGpuBuffer(g_waterVBO, verts.size() * sizeof(float), MEM_WATER);
+    MemGpuBuffer(g_waterEBO, idx.size() * sizeof(unsigned), MEM_WATER);
+}
+
+//  RebuildWaterMask:  ,   .
+// mask   waterMask (  -   ), w x h   
+void UpdateWaterMesh(const std::vector<uint8_t>& mask, int w, int h, float terrainSize)
+{
+    if (!g_waterVAO || w < 2 || h < 2 || (int)mask.size() != w * h)
+        return;
+
+    WaterMesh& m = g_waterMesh;
+
+    if (m.cellsX != w - 1 || m.cellsZ != h - 1 || m.terrainSize != terrainSize)
+    {
+        //   /     
+        m.cellsX = w - 1;
+        m.cellsZ = h - 1;
+        m.terrainSize = terrainSize;
+        m.tilesX = (m.cellsX + WATER_TILE - 1) / WATER_TILE;
+        m.tilesZ = (m.cellsZ + WATER_TILE - 1) / WATER_TILE;
+        m.tiles.assign(m.tilesX * m.tilesZ, std::vector<WaterQuad>());
+        m.dirty.assign(m.tilesX * m.tilesZ, 1);
+    }
+    else
+    {
+        //  (x,z)    x-1..x,    :  x-2..x+1
+        for (int z = 0; z < h; ++z)
+        {
+            const uint8_t* a = &mask[z * w];
+            const uint8_t* b = &m.lastMask[z * w];
+            if (memcmp(a, b, w) == 0) continue;
+
+            for (int x = 0; x < w; ++x)
+            {
+                if (a[x] == b[x]) continue;
+                int tx0 = std::max(0, x - 2) / WATER_TILE, tx1 = std::min(m.cellsX - 1, x + 1) / WATER_TILE;
+                int tz0 = std::max(0, z - 2) / WATER_TILE, tz1 = std::min(m.cellsZ - 1, z + 1) / WATER_TILE;
+                for (int tz = tz0; tz <= tz1; ++tz)
+                    for (int tx = tx0; tx <= tx1; ++tx)
+                        m.dirty[tz * m.tilesX + tx] = 1;
+            }
+        }
+    }
+    m.lastMask = mask;
+    MemTrackVector(m.lastMask, MEM_WATER);
+
+    bool any = false;
+    for (int tz = 0; tz < m.tilesZ; ++tz)
+        for (int tx = 0; tx < m.tilesX; ++tx)
+        {
+            if (!m.dirty[tz * m.tilesX + tx]) continue;
+            BuildWaterTile(tx, tz);
+            m.dirty[tz * m.tilesX + tx] = 0;
+            any = true;
+        }
+
+    if (any)
+    {
+        size_t quads = 0;
+        for (const auto& t : m.tiles) quads += t.capacity() * sizeof(WaterQuad);
+        MemSetCpu(&m.tiles, quads + m.tiles.capacity() * sizeof(m.tiles[0]), MEM_WATER);
+        UploadWaterMesh();
+    }
+}
+
 void InitWater()
 {
-    g_waterShader = CreateShaderProgram("water.vert", "water.frag");
+    //    g_waterFamily (LoadShaders)
     if (!g_waterShader) {
         //    water_vert / water_frag, . 
         return;
@@ -30,31 +235,14 @@ void InitWater()
 
     if (!g_waterVAO)
     {
-        float s = g_waterSize * 0.5f;
-
-        //  XY:  + UV
-        float verts[] = {
-            //  x      y                z       u  v
-            -s, g_waterHeight, -s,     0.0f, 0.0f,
-             s, g_waterHeight, -s,     1.0f, 0.0f,
-             s, g_waterHeight,  s,     1.0f, 1.0f,
-            -s, g_waterHeight,  s,     0.0f, 1.0f
-        };
-
-        unsigned int idx[] = { 0,1,2,  0,2,3 };
-
-        GLuint ebo;
         glGenVertexArrays(1, &g_waterVAO);
         glGenBuffers(1, &g_waterVBO);
-        glGenBuffers(1, &ebo);
+        glGenBuffers(1, &g_waterEBO);
 
-        glBindVertexArray(g_waterVAO);
+        g_gl.BindVertexArray(g_waterVAO);
 
         glBindBuffer(GL_ARRAY_BUFFER, g_waterVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(idx), idx, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_waterEBO);
 
         GLsizei stride = 5 * sizeof(float);
         glEnableVertexAttribArray(0); // position
@@ -62,13 +250,6 @@ void InitWater()
         glEnableVertexAttribArray(1); // uv
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
 
-        glBindVertexArray(0);
+        g_gl.BindVertexArray(0);
     }
 }
-
-
-
-
-
-
-
@@ -3,9 +3,7 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTex;
 
-uniform mat4 uProjection;
-uniform mat4 uView;
-uniform float uTime;
+#include "frame.glsl"   // общие константы кадра (frame_ubo.h)
 
 out vec3 vWorldPos;
 
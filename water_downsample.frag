@@ -0,0 +1,21 @@
+// water_downsample.frag
+// Глубина сцены -> половинное разрешение (water_halfres.h).
+// Из квадрата 2x2 берём самую дальнюю: у кромки вода в половинке лучше нарисуется лишняя —
+// билатеральный апскейл в посте отбросит её по глубине, а вот дыру он не закроет.
+#version 330 core
+
+uniform sampler2D uSceneDepth;
+uniform ivec2     uSceneSize;   // прямоугольник мира в полном FBO (dynres.h)
+
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy) * 2;
+    ivec2 m = uSceneSize - 1;
+
+    float d = texelFetch(uSceneDepth, min(p, m), 0).r;
+    d = max(d, texelFetch(uSceneDepth, min(p + ivec2(1, 0), m), 0).r);
+    d = max(d, texelFetch(uSceneDepth, min(p + ivec2(0, 1), m), 0).r);
+    d = max(d, texelFetch(uSceneDepth, min(p + ivec2(1, 1), m), 0).r);
+
+    gl_FragDepth = d;
+}
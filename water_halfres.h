@@ -0,0 +1,135 @@
+﻿#pragma once
+// water_halfres.h
+// Вода в половинном разрешении: над открытым морем прозрачная вода закрывает почти
+// весь экран, и её блендинг в полном разрешении съедает fill rate.
+//   1) глубина мира -> половинка (max из 2x2, water_downsample.frag);
+//   2) вода рисуется в половинку против этой глубины, глубину не пишет:
+//      цвет0 = (rgb * a, a), цвет1 = расстояние до поверхности (для тумана);
+//   3) пост-проход (screen_post.frag) поднимает её билатерально: 4 тексела половинки,
+//      вес = билинейный * похожесть глубины; если не похож ни один — ближайший по глубине.
+//      Так кромка берега остаётся резкой, вода не наползает на сушу.
+// Под водой поверхность всё равно невидима — половинку не рисуем.
+// A/B: клавиша H, "-waterhalf" в командной строке.
+
+bool g_waterHalfRes = false;
+
+struct WaterHalfResTarget
+{
+    GLuint fbo = 0;
+    GLuint colorTex = 0;    // RGBA8, premultiplied
+    GLuint distTex = 0;     // R32F, 0 — воды нет
+    GLuint depthTex = 0;    // глубина мира, уменьшенная
+    int width = 0, height = 0;
+};
+
+WaterHalfResTarget g_waterHalf;
+GLuint g_waterDownsampleShader = 0;
+
+// "-waterhalf"
+void WaterHalfResInit(const char* cmdLine)
+{
+    if (cmdLine && strstr(cmdLine, "-waterhalf"))
+        g_waterHalfRes = true;
+}
+
+// из InitSceneFBO: половинка под размер сцены
+void InitWaterHalfResTarget(int sceneW, int sceneH)
+{
+    WaterHalfResTarget& t = g_waterHalf;
+    if (t.fbo)
+    {
+        glDeleteFramebuffers(1, &t.fbo);
+        GLuint texs[3] = { t.colorTex, t.distTex, t.depthTex };
+        MemGpuDeleteTextures(3, texs);
+        g_gl.DeleteTextures(3, texs);
+    }
+
+    t.width = (sceneW + 1) / 2;
+    t.height = (sceneH + 1) / 2;
+
+    glGenFramebuffers(1, &t.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+
+    // всё читается texelFetch'ем — фильтрация не нужна
+    auto makeTex = [&](GLuint& tex, GLenum internal, GLenum format, GLenum type, GLenum attach)
+    {
+        glGenTextures(1, &tex);
+        g_gl.BindTexture(GL_TEXTURE_2D, tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal, t.width, t.height, 0, format, type, nullptr);
+        MemGpuTexture(tex, internal, t.width, t.height, false, MEM_TARGETS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attach, GL_TEXTURE_2D, tex, 0);
+    };
+
+    makeTex(t.colorTex, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0);
+    makeTex(t.distTex, GL_R32F, GL_RED, GL_FLOAT, GL_COLOR_ATTACHMENT1);
+    makeTex(t.depthTex, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, GL_DEPTH_ATTACHMENT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    GLenum bufs[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, bufs);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        OutputDebugStringA("Water half-res FBO NOT complete!\n");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// в этом кадре вода идёт через половинку (иначе — обычным пакетом в PASS_WORLD)
+inline bool WaterHalfResActive()
+{
+    return g_waterHalfRes && !underwater && g_waterHalf.fbo && g_waterDownsampleShader;
+}
+
+// после PASS_WORLD, пока в g_sceneFBO мир без воды. sceneW/H — прямоугольник мира
+void RenderWaterHalfRes(int sceneW, int sceneH, const glm::mat4& proj, const glm::mat4& view)
+{
+    WaterHalfResTarget& t = g_waterHalf;
+    int w = std::min(t.width, (sceneW + 1) / 2);
+    int h = std::min(t.height, (sceneH + 1) / 2);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+    glViewport(0, 0, w, h);
+
+    // 1) глубина (цвет не трогаем)
+    g_gl.UseProgram(g_waterDownsampleShader);
+    glUniform2i(UniformLoc(g_waterDownsampleShader, "uSceneSize"), sceneW, sceneH);
+    g_gl.BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, g_sceneDepthTex);
+
+    g_gl.ColorMask(false);
+    g_gl.Disable(GL_BLEND);
+    g_gl.Disable(GL_CULL_FACE);
+    g_gl.Enable(GL_DEPTH_TEST);
+    g_gl.DepthFunc(GL_ALWAYS);
+    g_gl.DepthMask(GL_TRUE);
+    g_gl.DepthRange(0.0, 1.0);
+
+    g_gl.BindVertexArray(g_screenVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    ProfDraw(GL_TRIANGLE_STRIP, 4);
+    g_gl.ColorMask(true);
+
+    // 2) вода — в чистые цвет/дистанцию
+    const float clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glClearBufferfv(GL_COLOR, 0, clear);
+    glClearBufferfv(GL_COLOR, 1, clear);
+
+    g_terrain.DrawWater(proj, view, true);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, g_sceneFBO);
+}
+
+// пост-проход: юниты 2..4 + флаг
+void BindWaterHalfResForPost(GLuint postProg, bool active)
+{
+    glUniform1i(UniformLoc(postProg, "uWaterHalf"), active ? 1 : 0);
+    if (!active) return;
+
+    g_gl.BindTexture(GL_TEXTURE2, GL_TEXTURE_2D, g_waterHalf.colorTex);
+    g_gl.BindTexture(GL_TEXTURE3, GL_TEXTURE_2D, g_waterHalf.distTex);
+    g_gl.BindTexture(GL_TEXTURE4, GL_TEXTURE_2D, g_waterHalf.depthTex);
+}
@@ -0,0 +1,302 @@
+﻿#pragma once
+// world_cache.h
+// Запечённый мир. При тех же heightmap, параметрах и seed Terrain::build, маска воды,
+// трава и деревья каждый запуск дают одно и то же — считаем один раз, кладём в
+// world_cache/world_<ключ>.bin, дальше файл мапится (MapViewOfFile) и льётся прямо в GL.
+//
+//   ключ = байты heightmap.png + параметры мира (WorldParams) + seed + WORLD_CACHE_VERSION
+//   (версию поднять, если поменялась генерация: Generate, BuildVertices, BuildWaterMask, Scatter*)
+//
+// Секции — в раскладке GL-буферов: вершины террейна (HEIGHTFIELD_VERTEX_FLOATS, с нормалями),
+// трава (vec4 pos+scale), матрицы деревьев; плюс CPU-копии: высоты, материал, маска воды,
+// инстансы деревьев. Индексы не храним — зависят только от n, BuildIndices быстрее чтения.
+//
+// Потребитель берёт секцию (WorldCacheGet / WorldCacheRead). Нет секции или размер не тот —
+// считает сам, кэш помечается dirty, и WorldCacheFinish() в конце загрузки перезаписывает
+// файл (старые world_*.bin удаляются). -noworldcache — не читать и не писать.
+
+#include <windows.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+#include "heightfield.h"
+#include "vegetation.h"
+
+const uint32_t WORLD_CACHE_MAGIC = 0x444C5257;   // "WRLD"
+const uint32_t WORLD_CACHE_VERSION = 1;
+
+enum WorldSection {
+    WORLD_HEIGHTS = 0,      // float, n*n
+    WORLD_MATERIAL,         // float, n*n
+    WORLD_VERTICES,         // float, n*n*HEIGHTFIELD_VERTEX_FLOATS — VBO террейна как есть
+    WORLD_WATER_MASK,       // uint8_t, n*n
+    WORLD_GRASS,            // glm::vec4 pos+scale — инстанс-буфер травы (все живые)
+    WORLD_TREES,            // TreeInstance
+    WORLD_TREE_MATRICES,    // glm::mat4 — инстанс-буфер деревьев (все стоят)
+    WORLD_SECTION_COUNT
+};
+
+// всё, от чего зависит мир, кроме heightmap и seed
+struct WorldParams
+{
+    int32_t verts;
+    float size;
+    float maxHeight;
+    float waterLevel;
+    int32_t grassTarget;
+    int32_t treeTarget;
+};
+
+struct WorldCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    WorldParams params;
+    uint64_t offset[WORLD_SECTION_COUNT];
+    uint64_t bytes[WORLD_SECTION_COUNT];
+};
+
+struct WorldCache
+{
+    bool enabled = true;
+    bool hit = false;
+    bool dirty = false;      // что-то посчитали заново — перезаписать на Finish
+    uint64_t key = 0;
+    WorldParams params{};
+    std::string path;
+
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    const uint8_t* view = nullptr;
+    uint64_t viewBytes = 0;
+};
+
+WorldCache g_worldCache;
+
+void WorldCacheClose()
+{
+    if (g_worldCache.view) UnmapViewOfFile(g_worldCache.view);
+    if (g_worldCache.mapping) CloseHandle(g_worldCache.mapping);
+    if (g_worldCache.file != INVALID_HANDLE_VALUE) CloseHandle(g_worldCache.file);
+    g_worldCache.view = nullptr;
+    g_worldCache.mapping = nullptr;
+    g_worldCache.file = INVALID_HANDLE_VALUE;
+    g_worldCache.viewBytes = 0;
+}
+
+bool WorldCacheMap()
+{
+    WorldCache& wc = g_worldCache;
+    wc.file = CreateFileA(wc.path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (wc.file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(wc.file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(WorldCacheHeader))
+    {
+        WorldCacheClose();
+        return false;
+    }
+
+    wc.mapping = CreateFileMappingA(wc.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    wc.view = wc.mapping ? (const uint8_t*)MapViewOfFile(wc.mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!wc.view)
+    {
+        WorldCacheClose();
+        return false;
+    }
+    wc.viewBytes = (uint64_t)fileSize.QuadPart;
+
+    const WorldCacheHeader* h = (const WorldCacheHeader*)wc.view;
+    bool ok = h->magic == WORLD_CACHE_MAGIC && h->version == WORLD_CACHE_VERSION && h->key == wc.key;
+    for (int s = 0; ok && s < WORLD_SECTION_COUNT; ++s)
+        ok = h->offset[s] <= wc.viewBytes && h->bytes[s] <= wc.viewBytes - h->offset[s];
+    if (!ok)
+        WorldCacheClose();
+    return ok;
+}
+
+// до загрузки мира (после InputInit — нужен seed)
+void WorldCacheOpen(const char* cmdLine, const char* heightmapPath, const WorldParams& params, uint64_t seed)
+{
+    WorldCache& wc = g_worldCache;
+    wc.params = params;
+    if (cmdLine && strstr(cmdLine, "-noworldcache"))
+    {
+        wc.enabled = false;
+        OutputDebugStringA("WorldCache: off (-noworldcache)\n");
+        return;
+    }
+
+    // heightmap — по байтам файла: декодировать png ради ключа незачем
+    std::ifstream f(heightmapPath, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    uint64_t h = HashBytes(&WORLD_CACHE_VERSION, sizeof(WORLD_CACHE_VERSION));
+    h = HashBytes(bytes.data(), bytes.size(), h);
+    h = HashBytes(&params, sizeof(params), h);
+    h = HashBytes(&seed, sizeof(seed), h);
+    wc.key = h;
+
+    char name[64];
+    sprintf_s(name, "world_cache/world_%016llx.bin", (unsigned long long)h);
+    wc.path = name;
+
+    wc.hit = WorldCacheMap();
+    wc.dirty = !wc.hit;
+
+    char buf[160];
+    sprintf_s(buf, "WorldCache: %s %s (%.1f MB)\n", wc.hit ? "hit" : "miss", name,
+        double(wc.viewBytes) / (1024.0 * 1024.0));
+    OutputDebugStringA(buf);
+}
+
+// файл с нашим ключом, но нужная секция не та — считаем, что кэша нет вовсе:
+// дальше всё строится с нуля (из heightmap) и на Finish файл перезаписывается
+void WorldCacheDrop(const char* why)
+{
+    WorldCache& wc = g_worldCache;
+    if (!wc.hit)
+        return;
+    WorldCacheClose();
+    wc.hit = false;
+    wc.dirty = true;
+    OutputDebugStringA((std::string("WorldCache: dropped (") + why + ")\n").c_str());
+}
+
+// секция прямо из отображения (живёт до WorldCacheFinish). expected — сколько элементов
+// должно быть (0 — сколько есть). nullptr — нет: считай сам
+template <typename T>
+const T* WorldCacheGet(WorldSection s, size_t& count, size_t expected = 0)
+{
+    count = 0;
+    if (!g_worldCache.enabled)
+        return nullptr;
+
+    const WorldCacheHeader* h = (const WorldCacheHeader*)g_worldCache.view;
+    if (!h || h->bytes[s] == 0 || h->bytes[s] % sizeof(T) != 0 ||
+        (expected && h->bytes[s] / sizeof(T) != expected))
+    {
+        g_worldCache.dirty = true;
+        return nullptr;
+    }
+    count = (size_t)(h->bytes[s] / sizeof(T));
+    return (const T*)(g_worldCache.view + h->offset[s]);
+}
+
+// копия — для того, что игра потом меняет (высоты, маска)
+template <typename V>
+bool WorldCacheRead(WorldSection s, V& out, size_t expected = 0)
+{
+    size_t count = 0;
+    const auto* p = WorldCacheGet<typename V::value_type>(s, count, expected);
+    if (!p)
+        return false;
+    out.assign(p, p + count);
+    return true;
+}
+
+// конец загрузки, до старта симуляции (мир ещё не копали): отображение закрываем,
+// если что-то считали заново — пишем файл целиком
+void WorldCacheFinish(const Heightfield& hf, const std::vector<uint8_t>& waterMask,
+    const std::vector<GrassInstance>& grass, const std::vector<TreeInstance>& trees)
+{
+    WorldCache& wc = g_worldCache;
+    WorldCacheClose();
+    if (!wc.enabled || !wc.dirty)
+        return;
+
+    // что-то не построилось (нет текстуры травы, модели деревьев) — такой мир не запекаем
+    if (hf.heights.empty() || waterMask.empty() || grass.empty() || trees.empty())
+    {
+        OutputDebugStringA("WorldCache: world incomplete, not saved\n");
+        return;
+    }
+
+    std::vector<float> verts;
+    hf.BuildVertices(verts);
+    std::vector<glm::vec4> grassData;
+    CollectGrassInstanceData(grass, grassData);
+    std::vector<glm::mat4> treeMats;
+    BuildTreeMatrices(trees, std::vector<bool>(), treeMats);
+
+    const void* data[WORLD_SECTION_COUNT] = {
+        hf.heights.data(), hf.material.data(), verts.data(), waterMask.data(),
+        grassData.data(), trees.data(), treeMats.data()
+    };
+    uint64_t bytes[WORLD_SECTION_COUNT] = {
+        hf.heights.size() * sizeof(float), hf.material.size() * sizeof(float),
+        verts.size() * sizeof(float), waterMask.size(),
+        grassData.size() * sizeof(glm::vec4), trees.size() * sizeof(TreeInstance),
+        treeMats.size() * sizeof(glm::mat4)
+    };
+
+    WorldCacheHeader h = {};
+    h.magic = WORLD_CACHE_MAGIC;
+    h.version = WORLD_CACHE_VERSION;
+    h.key = wc.key;
+    h.params = wc.params;
+    uint64_t at = sizeof(h);
+    for (int s = 0; s < WORLD_SECTION_COUNT; ++s)
+    {
+        at = (at + 63) & ~63ull;   // секции по 64 байта
+        h.offset[s] = at;
+        h.bytes[s] = bytes[s];
+        at += bytes[s];
+    }
+
+    // во временный и подменой: недописанный файл никогда не выглядит целым
+    CreateDirectoryA("world_cache", nullptr);
+    std::string tmp = wc.path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f)
+    {
+        OutputDebugStringA(("WorldCache: can't write " + tmp + "\n").c_str());
+        return;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    uint64_t pos = sizeof(h);
+    static const char zeros[64] = {};
+    for (int s = 0; ok && s < WORLD_SECTION_COUNT; ++s)
+    {
+        ok = fwrite(zeros, 1, (size_t)(h.offset[s] - pos), f) == h.offset[s] - pos;
+        if (ok && bytes[s])
+            ok = fwrite(data[s], 1, (size_t)bytes[s], f) == bytes[s];
+        pos = h.offset[s] + bytes[s];
+    }
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || !MoveFileExA(tmp.c_str(), wc.path.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFileA(tmp.c_str());
+        OutputDebugStringA(("WorldCache: can't write " + wc.path + "\n").c_str());
+        return;
+    }
+
+    // один мир на диске: прошлые seed / heightmap больше не нужны
+    WIN32_FIND_DATAA fd;
+    HANDLE find = FindFirstFileA("world_cache/world_*.bin", &fd);
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            std::string other = std::string("world_cache/") + fd.cFileName;
+            if (other != wc.path)
+                DeleteFileA(other.c_str());
+        } while (FindNextFileA(find, &fd));
+        FindClose(find);
+    }
+
+    char buf[160];
+    sprintf_s(buf, "WorldCache: saved %s (%.1f MB)\n", wc.path.c_str(), double(pos) / (1024.0 * 1024.0));
+    OutputDebugStringA(buf);
+    wc.dirty = false;
+}
@@ -0,0 +1,12 @@
+﻿#pragma once
+// world_config.h
+// Параметры мира — одни на игру (main.cpp, water.h) и бенчмарки ядра (bench_core.cpp),
+// чтобы замеры шли на той же конфигурации, что и игра. Входят в ключ запечённого мира
+// (world_cache.h). Без GL и windows.h.
+
+const int   WORLD_VERTS = 1024;         // кол-во вершин по стороне
+const float WORLD_SIZE = 1024.0f;       // РАЗМЕР КАРТЫ
+const float WORLD_MAX_HEIGHT = 50.0f;
+const float WORLD_WATER_LEVEL = 2.0f;   // начальный g_waterHeight (water.h)
+const int   GRASS_TARGET = 400000;      // плотность травы
+const int   TREE_TARGET = 2000;         // сколько деревьев хотим